@@ -0,0 +1,264 @@
+#include "AxRdpControl.h"
+#include "RdcLog.h"
+#include <qt_windows.h>
+
+namespace {
+
+// 取对象的 IDispatch 接口（已 AddRef，调用方 Release）
+IDispatch *dispatchOf(QAxBase *base) {
+  IDispatch *disp = nullptr;
+  base->queryInterface(IID_IDispatch, reinterpret_cast<void **>(&disp));
+  return disp;
+}
+
+int resolveDispatchId(QAxBase *base, const char *name) {
+  IDispatch *disp = dispatchOf(base);
+  if (!disp) {
+    return -1;
+  }
+
+  const QString wideName = QString::fromLatin1(name);
+  LPOLESTR names = reinterpret_cast<LPOLESTR>(
+      const_cast<ushort *>(wideName.utf16()));
+  DISPID dispId = DISPID_UNKNOWN;
+  HRESULT hr = disp->GetIDsOfNames(IID_NULL, &names, 1, LOCALE_USER_DEFAULT,
+                                   &dispId);
+  disp->Release();
+  return SUCCEEDED(hr) ? static_cast<int>(dispId) : -1;
+}
+
+// 直接通过 IDispatch::Invoke(DISPATCH_PROPERTYPUT) 设置属性，
+// 只支持 RDP 设置用到的 bool / int / QString 类型
+bool putById(QAxBase *base, int dispId, const QVariant &value) {
+  VARIANT arg;
+  VariantInit(&arg);
+  switch (value.type()) {
+  case QVariant::Bool:
+    arg.vt = VT_BOOL;
+    arg.boolVal = value.toBool() ? VARIANT_TRUE : VARIANT_FALSE;
+    break;
+  case QVariant::Int:
+  case QVariant::UInt:
+    arg.vt = VT_I4;
+    arg.lVal = value.toInt();
+    break;
+  case QVariant::String:
+    arg.vt = VT_BSTR;
+    arg.bstrVal = SysAllocString(
+        reinterpret_cast<const OLECHAR *>(value.toString().utf16()));
+    break;
+  default:
+    return false;
+  }
+
+  IDispatch *disp = dispatchOf(base);
+  if (!disp) {
+    VariantClear(&arg);
+    return false;
+  }
+
+  DISPID putId = DISPID_PROPERTYPUT;
+  DISPPARAMS params = {&arg, &putId, 1, 1};
+  HRESULT hr = disp->Invoke(dispId, IID_NULL, LOCALE_USER_DEFAULT,
+                            DISPATCH_PROPERTYPUT, &params, nullptr, nullptr,
+                            nullptr);
+  VariantClear(&arg);
+  disp->Release();
+  return SUCCEEDED(hr);
+}
+
+// 事件参数转换，参数可能是 VT_BYREF
+bool variantToInt(VARIANTARG *arg, int *value) {
+  VARIANT converted;
+  VariantInit(&converted);
+  const bool ok = SUCCEEDED(VariantChangeType(&converted, arg, 0, VT_I4));
+  if (ok) {
+    *value = V_I4(&converted);
+  }
+  VariantClear(&converted);
+  return ok;
+}
+
+bool variantToBool(VARIANTARG *arg, bool *value) {
+  VARIANT converted;
+  VariantInit(&converted);
+  const bool ok = SUCCEEDED(VariantChangeType(&converted, arg, 0, VT_BOOL));
+  if (ok) {
+    *value = V_BOOL(&converted) != VARIANT_FALSE;
+  }
+  VariantClear(&converted);
+  return ok;
+}
+
+bool variantToLongLong(VARIANTARG *arg, qlonglong *value) {
+  VARIANT converted;
+  VariantInit(&converted);
+  const bool ok = SUCCEEDED(VariantChangeType(&converted, arg, 0, VT_I8));
+  if (ok) {
+    *value = qlonglong(V_I8(&converted));
+  }
+  VariantClear(&converted);
+  return ok;
+}
+
+bool variantToString(VARIANTARG *arg, QString *value) {
+  VARIANT converted;
+  VariantInit(&converted);
+  const bool ok = SUCCEEDED(VariantChangeType(&converted, arg, 0, VT_BSTR));
+  if (ok) {
+    *value = QString::fromWCharArray(V_BSTR(&converted),
+                                     int(SysStringLen(V_BSTR(&converted))));
+  }
+  VariantClear(&converted);
+  return ok;
+}
+
+} // namespace
+
+AxRdpDispatch::AxRdpDispatch(QAxObject *object) : m_object(object) {}
+
+AxRdpDispatch::~AxRdpDispatch() { delete m_object; }
+
+bool AxRdpDispatch::setValue(const char *name, const QVariant &value) {
+  return m_object->setProperty(name, value);
+}
+
+QVariant AxRdpDispatch::value(const char *name) {
+  return m_object->property(name);
+}
+
+QVariant AxRdpDispatch::dynamicCall(const char *function,
+                                    const QVariantList &args) {
+  QVariantList vars = args;
+  return m_object->dynamicCall(function, vars);
+}
+
+RdpDispatch *AxRdpDispatch::querySubObject(const char *name) {
+  QAxObject *object = m_object->querySubObject(name);
+  return object ? new AxRdpDispatch(object) : nullptr;
+}
+
+int AxRdpDispatch::dispatchId(const char *name) {
+  return resolveDispatchId(m_object, name);
+}
+
+bool AxRdpDispatch::setValueById(int dispId, const char *name,
+                                 const QVariant &value) {
+  return putById(m_object, dispId, value) || setValue(name, value);
+}
+
+AxRdpControl::AxRdpControl(QObject *parent)
+    : RdpControl(parent), m_axWidget(nullptr) {
+  RDC_LOG_DEBUG(RdcLog::Control, 0, "Initializing RDP ActiveX control...");
+
+  // 创建 MsTscAx ActiveX 控件
+  // CLSID: {7390F3D8-0439-4C05-91E3-CF5CB290C3D0}
+  m_axWidget = new QAxWidget("MsTscAx.MsTscAx");
+  if (m_axWidget->isNull()) {
+    RDC_LOG_CRITICAL(RdcLog::Control, 0,
+                     "Failed to create RDP ActiveX control");
+    return;
+  }
+  RDC_LOG_DEBUG(RdcLog::Control, 0, "QAxWidget interface COM ID: %1",
+                m_axWidget->control());
+
+  // 所有控件事件都从通用事件中按名称解析：不为每个事件做字符串签名连接，
+  // 参数直接从 VARIANT 转换（OnRemoteProgramResult 的枚举、
+  // OnRemoteWindowDisplayed 的 HWND 无法用签名连接）
+  QObject::connect(m_axWidget, SIGNAL(signal(QString, int, void *)), this,
+                   SLOT(onAxSignal(QString, int, void *)));
+}
+
+AxRdpControl::~AxRdpControl() {
+  if (m_axWidget) {
+    m_axWidget->clear(); // 清除 ActiveX 控件内容
+    m_axWidget->deleteLater();
+    m_axWidget = nullptr;
+  }
+}
+
+void AxRdpControl::reset() {
+  // 从窗口中取出控件，属性在下次 configureClient 时重新设置
+  m_axWidget->hide();
+  m_axWidget->setParent(nullptr);
+}
+
+QString AxRdpControl::version() {
+  // IMsTscAx::Version，例如 "10.0.19041"
+  return m_axWidget->control() + QLatin1Char('/') +
+         m_axWidget->property("Version").toString();
+}
+
+void AxRdpControl::setRenderingSuspended(bool suspended) {
+  m_axWidget->setUpdatesEnabled(!suspended);
+}
+
+bool AxRdpControl::setValue(const char *name, const QVariant &value) {
+  return m_axWidget->setProperty(name, value);
+}
+
+QVariant AxRdpControl::value(const char *name) {
+  return m_axWidget->property(name);
+}
+
+QVariant AxRdpControl::dynamicCall(const char *function,
+                                   const QVariantList &args) {
+  QVariantList vars = args;
+  return m_axWidget->dynamicCall(function, vars);
+}
+
+RdpDispatch *AxRdpControl::querySubObject(const char *name) {
+  QAxObject *object = m_axWidget->querySubObject(name);
+  return object ? new AxRdpDispatch(object) : nullptr;
+}
+
+int AxRdpControl::dispatchId(const char *name) {
+  return resolveDispatchId(m_axWidget, name);
+}
+
+bool AxRdpControl::setValueById(int dispId, const char *name,
+                                const QVariant &value) {
+  return putById(m_axWidget, dispId, value) || setValue(name, value);
+}
+
+void AxRdpControl::onAxSignal(const QString &name, int argc, void *argv) {
+  // name 为事件签名，例如 "OnDisconnected(int)"
+  const QStringRef event = name.leftRef(name.indexOf(QLatin1Char('(')));
+  // 参数按逆序存放：argv[argc - 1] 为第一个参数
+  VARIANTARG *params = static_cast<VARIANTARG *>(argv);
+  int code = 0;
+
+  if (event == QLatin1String("OnConnected")) {
+    postEvent(RdpEvent::Connected);
+  } else if (event == QLatin1String("OnLoginComplete")) {
+    postEvent(RdpEvent::LoginComplete);
+  } else if (event == QLatin1String("OnDisconnected")) {
+    if (argc >= 1 && variantToInt(&params[argc - 1], &code)) {
+      postEvent(RdpEvent::Disconnected, code);
+    }
+  } else if (event == QLatin1String("OnFatalError")) {
+    if (argc >= 1 && variantToInt(&params[argc - 1], &code)) {
+      postEvent(RdpEvent::FatalError, code);
+    }
+  } else if (event == QLatin1String("OnRemoteProgramResult")) {
+    RdpEvent result;
+    result.type = RdpEvent::RemoteProgramResult;
+    if (argc >= 3 &&
+        variantToString(&params[argc - 1], &result.executablePath) &&
+        variantToInt(&params[argc - 2], &result.code) &&
+        variantToBool(&params[argc - 3], &result.flag)) {
+      postEvent(std::move(result));
+    } else {
+      RDC_LOG_WARNING(RdcLog::RemoteApp, 0,
+                      "Cannot decode OnRemoteProgramResult arguments");
+    }
+  } else if (event == QLatin1String("OnRemoteWindowDisplayed")) {
+    // vbWindowVisible, hwnd
+    RdpEvent window;
+    window.type = RdpEvent::RemoteWindowDisplayed;
+    if (argc >= 2 && variantToBool(&params[argc - 1], &window.flag) &&
+        variantToLongLong(&params[argc - 2], &window.windowId)) {
+      postEvent(std::move(window));
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef AXRDPCONTROL_H
+#define AXRDPCONTROL_H
+
+#include "RdpControl.h"
+#include <QAxObject>
+#include <QAxWidget>
+
+// QAxObject 子对象的 RdpDispatch 包装（拥有并负责删除 QAxObject）
+class AxRdpDispatch : public RdpDispatch {
+public:
+  explicit AxRdpDispatch(QAxObject *object);
+  ~AxRdpDispatch() override;
+
+  bool setValue(const char *name, const QVariant &value) override;
+  QVariant value(const char *name) override;
+  QVariant dynamicCall(const char *function,
+                       const QVariantList &args = QVariantList()) override;
+  RdpDispatch *querySubObject(const char *name) override;
+  int dispatchId(const char *name) override;
+  bool setValueById(int dispId, const char *name,
+                    const QVariant &value) override;
+  // QAxObject 包装及其动态元对象
+  qint64 memoryFootprint() const override { return 64 * 1024; }
+
+private:
+  QAxObject *m_object;
+};
+
+// MsTscAx ActiveX 控件后端
+class AxRdpControl : public RdpControl {
+  Q_OBJECT
+
+public:
+  explicit AxRdpControl(QObject *parent = nullptr);
+  ~AxRdpControl() override;
+
+  bool isNull() const { return !m_axWidget || m_axWidget->isNull(); }
+
+  QWidget *widget() override { return m_axWidget; }
+  void reset() override;
+  QString version() override;
+  void setRenderingSuspended(bool suspended) override;
+
+  bool setValue(const char *name, const QVariant &value) override;
+  QVariant value(const char *name) override;
+  QVariant dynamicCall(const char *function,
+                       const QVariantList &args = QVariantList()) override;
+  RdpDispatch *querySubObject(const char *name) override;
+  int dispatchId(const char *name) override;
+  bool setValueById(int dispId, const char *name,
+                    const QVariant &value) override;
+  // 无法从 COM 取得控件实际占用，按一个 mstscax 实例（不含帧缓冲）的
+  // 典型工作集估算
+  qint64 memoryFootprint() const override { return 24 * 1024 * 1024; }
+
+private slots:
+  void onAxSignal(const QString &name, int argc, void *argv);
+
+private:
+  QAxWidget *m_axWidget;
+};
+
+#endif // AXRDPCONTROL_H
@@ -2,6 +2,7 @@ import QtQuick 2.15
 import QtQuick.Window 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
+import RDC 1.0
 
 Dialog {
     id: dialog
@@ -10,19 +11,20 @@ Dialog {
     standardButtons: Dialog.Ok | Dialog.Cancel
     
     width: 500
-    height: 550
+    height: 720
     
     x: (parent.width - width) / 2
     y: (parent.height - height) / 2
     
     // 对外暴露的属性
     property string ip: ""
-    property int port: 8848
+    property int port: 3389
     property string username: ""
     property int desktopWidth: 1920
     property int desktopHeight: 1080
     property int colorDepth: 32
     property bool fullScreen: false
+    property bool dynamicResolution: true
     property bool enableSound: true
     property bool enableClipboard: true
     property bool enablePrinter: false
@@ -35,28 +37,49 @@ Dialog {
         desktopHeight = parseInt(heightField.text)
         colorDepth = parseInt(colorDepthCombo.currentValue)
         fullScreen = fullScreenCheck.checked
+        dynamicResolution = dynamicResolutionCheck.checked
         enableSound = soundCheck.checked
         enableClipboard = clipboardCheck.checked
         enablePrinter = printerCheck.checked
+        
+        // 保存为连接档案，参数相同的已有档案会被更新
+        profileModel.saveProfile({
+            "remoteAppMode": false,
+            "server": ip,
+            "port": port,
+            "username": username,
+            "desktopWidth": desktopWidth,
+            "desktopHeight": desktopHeight,
+            "colorDepth": colorDepth,
+            "fullScreen": fullScreen,
+            "dynamicResolution": dynamicResolution,
+            "enableSound": enableSound,
+            "enableClipboard": enableClipboard,
+            "enablePrinter": enablePrinter
+        })
     }
     
     onAboutToShow: {
-        // 打开对话框时重置或保留上次的值
-        ipField.text = ip || "192.168.10.9"
-        portField.text = port.toString() || "8899"
-        usernameField.text = username || "Administrator"
-        widthField.text = desktopWidth.toString() || "1920"
-        heightField.text = desktopHeight.toString() || "1080"
-        
-        // 设置色彩深度下拉框
-        for (var i = 0; i < colorDepthCombo.model.length; i++) {
-            if (colorDepthCombo.model[i].value === colorDepth) {
-                colorDepthCombo.currentIndex = i
-                break
+        // 没有上次的值时使用最近保存的档案
+        if (!ip && profileModel.totalCount > 0) {
+            searchField.text = ""
+            if (profileModel.count > 0) {
+                var recent = profileModel.get(0)
+                ip = recent.server
+                port = recent.port
+                username = recent.username
             }
         }
         
+        ipField.text = ip
+        portField.text = port.toString()
+        usernameField.text = username
+        widthField.text = desktopWidth.toString()
+        heightField.text = desktopHeight.toString()
+        setColorDepth(colorDepth)
+        
         fullScreenCheck.checked = fullScreen
+        dynamicResolutionCheck.checked = dynamicResolution
         soundCheck.checked = enableSound
         clipboardCheck.checked = enableClipboard
         printerCheck.checked = enablePrinter
@@ -64,6 +87,37 @@ Dialog {
         ipField.forceActiveFocus()
     }
     
+    // 按输入过滤的已保存桌面连接
+    ProfileModel {
+        id: profileModel
+        kind: ProfileModel.Desktop
+        filter: searchField.text.trim()
+    }
+    
+    function setColorDepth(depth) {
+        // 设置色彩深度下拉框
+        for (var i = 0; i < colorDepthCombo.model.length; i++) {
+            if (colorDepthCombo.model[i].value === depth) {
+                colorDepthCombo.currentIndex = i
+                break
+            }
+        }
+    }
+    
+    function applyProfile(profile) {
+        ipField.text = profile.server
+        portField.text = profile.port.toString()
+        usernameField.text = profile.username
+        widthField.text = profile.desktopWidth.toString()
+        heightField.text = profile.desktopHeight.toString()
+        setColorDepth(profile.colorDepth)
+        fullScreenCheck.checked = profile.fullScreen
+        dynamicResolutionCheck.checked = profile.dynamicResolution !== false
+        soundCheck.checked = profile.enableSound
+        clipboardCheck.checked = profile.enableClipboard
+        printerCheck.checked = profile.enablePrinter
+    }
+    
     ScrollView {
         anchors.fill: parent
         clip: true
@@ -72,6 +126,40 @@ Dialog {
             width: parent.width
             spacing: 12
             
+            // 已保存的连接
+            GroupBox {
+                Layout.fillWidth: true
+                title: "已保存的连接 (" + profileModel.count + "/" + profileModel.totalCount + ")"
+                visible: profileModel.totalCount > 0
+                
+                ColumnLayout {
+                    anchors.fill: parent
+                    spacing: 6
+                    
+                    TextField {
+                        id: searchField
+                        Layout.fillWidth: true
+                        placeholderText: "搜索名称、主机、用户名或标签"
+                        selectByMouse: true
+                    }
+                    
+                    ListView {
+                        id: profileList
+                        Layout.fillWidth: true
+                        Layout.preferredHeight: 120
+                        clip: true
+                        model: profileModel
+                        ScrollBar.vertical: ScrollBar {}
+                        
+                        delegate: ItemDelegate {
+                            width: profileList.width
+                            text: model.name + "  (" + (model.username ? model.username + "@" : "") + model.server + ":" + model.port + ")"
+                            onClicked: applyProfile(profileModel.get(index))
+                        }
+                    }
+                }
+            }
+            
             // 连接设置组
             GroupBox {
                 Layout.fillWidth: true
@@ -223,6 +311,13 @@ Dialog {
                         text: "全屏显示"
                         checked: false
                     }
+                    
+                    // 动态分辨率
+                    CheckBox {
+                        id: dynamicResolutionCheck
+                        text: "随窗口调整分辨率"
+                        checked: true
+                    }
                 }
             }
             
@@ -0,0 +1,330 @@
+#include "FakeRdpControl.h"
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+
+std::atomic<int> s_liveControls(0);
+std::atomic<int> s_liveSubObjects(0);
+
+// 取方法签名中的方法名："Connect()" -> "Connect"
+QByteArray methodName(const char *function) {
+  QByteArray name(function);
+  int paren = name.indexOf('(');
+  return paren < 0 ? name : name.left(paren);
+}
+
+QByteArray scopedName(const QByteArray &scope, const QByteArray &name) {
+  return scope.isEmpty() ? name : scope + '.' + name;
+}
+
+// 模拟控件的子对象，所有状态都保存在所属控件中
+class FakeRdpDispatch : public RdpDispatch {
+public:
+  FakeRdpDispatch(FakeRdpControl *control, const QByteArray &scope)
+      : m_control(control), m_scope(scope) {
+    ++s_liveSubObjects;
+  }
+  ~FakeRdpDispatch() override { --s_liveSubObjects; }
+
+  bool setValue(const char *name, const QVariant &value) override {
+    return m_control && m_control->setScopedValue(m_scope, name, value);
+  }
+
+  QVariant value(const char *name) override {
+    return m_control ? m_control->scopedValue(m_scope, name) : QVariant();
+  }
+
+  QVariant dynamicCall(const char *function,
+                       const QVariantList &args) override {
+    return m_control ? m_control->scopedCall(m_scope, function, args)
+                     : QVariant();
+  }
+
+  RdpDispatch *querySubObject(const char *name) override {
+    return m_control ? m_control->scopedSubObject(m_scope, name) : nullptr;
+  }
+
+  int dispatchId(const char *name) override {
+    return m_control ? m_control->scopedDispatchId(m_scope, name) : -1;
+  }
+
+  bool setValueById(int dispId, const char *name,
+                    const QVariant &value) override {
+    Q_UNUSED(dispId);
+    return m_control && m_control->putScopedValue(m_scope, name, value);
+  }
+
+  qint64 memoryFootprint() const override {
+    return m_control ? m_control->subObjectFootprint() : 0;
+  }
+
+private:
+  QPointer<FakeRdpControl> m_control;
+  QByteArray m_scope;
+};
+
+} // namespace
+
+FakeRdpControl::FakeRdpControl(QObject *parent)
+    : RdpControl(parent), m_nextWindowId(0x10000),
+      m_version(QStringLiteral("FakeRdpControl/1.0")), m_defaultLatencyMs(0),
+      m_nameLookupUs(0), m_remoteProgramDelayMs(0),
+      m_remoteProgramResult(RdpEvent::RailOk), m_totalCalls(0),
+      m_generation(0), m_memoryFootprint(8 * 1024 * 1024),
+      m_subObjectFootprint(16 * 1024), m_connected(false),
+      m_renderingSuspended(false) {
+  m_connectScript << FakeRdpEvent{FakeRdpEvent::Connected, 0}
+                  << FakeRdpEvent{FakeRdpEvent::LoginComplete, 0};
+  ++s_liveControls;
+}
+
+FakeRdpControl::~FakeRdpControl() { --s_liveControls; }
+
+int FakeRdpControl::liveControls() { return s_liveControls.load(); }
+
+int FakeRdpControl::liveSubObjects() { return s_liveSubObjects.load(); }
+
+void FakeRdpControl::reset() {
+  m_values.clear();
+  m_remoteWindows.clear();
+  m_connected = false;
+  m_renderingSuspended = false;
+  ++m_generation;
+}
+
+bool FakeRdpControl::setValue(const char *name, const QVariant &value) {
+  return setScopedValue(QByteArray(), name, value);
+}
+
+QVariant FakeRdpControl::value(const char *name) {
+  return scopedValue(QByteArray(), name);
+}
+
+QVariant FakeRdpControl::dynamicCall(const char *function,
+                                     const QVariantList &args) {
+  return scopedCall(QByteArray(), function, args);
+}
+
+RdpDispatch *FakeRdpControl::querySubObject(const char *name) {
+  return scopedSubObject(QByteArray(), name);
+}
+
+int FakeRdpControl::dispatchId(const char *name) {
+  return scopedDispatchId(QByteArray(), name);
+}
+
+bool FakeRdpControl::setValueById(int dispId, const char *name,
+                                  const QVariant &value) {
+  Q_UNUSED(dispId);
+  return putScopedValue(QByteArray(), name, value);
+}
+
+void FakeRdpControl::setCallLatency(const QByteArray &name, int ms) {
+  m_latencies.insert(name, ms);
+}
+
+void FakeRdpControl::setConnectScript(const QList<FakeRdpEvent> &events) {
+  m_connectScript = events;
+}
+
+void FakeRdpControl::queueConnectScript(const QList<FakeRdpEvent> &events) {
+  m_queuedScripts.append(events);
+}
+
+void FakeRdpControl::injectDisconnect(int reason) {
+  // 丢弃尚未触发的脚本事件与 RemoteApp 结果
+  ++m_generation;
+  emitEvent(FakeRdpEvent{FakeRdpEvent::Disconnected, 0, reason});
+}
+
+void FakeRdpControl::setRemoteProgramResult(int delayMs,
+                                            RdpEvent::RailResult result) {
+  m_remoteProgramDelayMs = delayMs;
+  m_remoteProgramResult = result;
+}
+
+void FakeRdpControl::setRemoteProgramResult(const QString &executablePath,
+                                            int delayMs,
+                                            RdpEvent::RailResult result) {
+  m_remoteProgramResults.insert(executablePath, qMakePair(delayMs, result));
+}
+
+void FakeRdpControl::closeRemoteWindows(const QString &executablePath) {
+  for (auto it = m_remoteWindows.begin(); it != m_remoteWindows.end();) {
+    if (executablePath.isEmpty() || it.value() == executablePath) {
+      const qlonglong windowId = it.key();
+      it = m_remoteWindows.erase(it);
+      postWindowEvent(false, windowId);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void FakeRdpControl::setUnsupportedSubObjects(const QStringList &names) {
+  m_unsupportedSubObjects.clear();
+  for (const QString &name : names) {
+    m_unsupportedSubObjects.insert(name.toLatin1());
+  }
+}
+
+void FakeRdpControl::resetCounters() {
+  m_callCounts.clear();
+  m_totalCalls = 0;
+}
+
+bool FakeRdpControl::setScopedValue(const QByteArray &scope, const char *name,
+                                    const QVariant &value) {
+  lookupName();
+  return putScopedValue(scope, name, value);
+}
+
+bool FakeRdpControl::putScopedValue(const QByteArray &scope, const char *name,
+                                    const QVariant &value) {
+  simulateCall(name);
+  m_values.insert(scopedName(scope, name), value);
+  return true;
+}
+
+QVariant FakeRdpControl::scopedValue(const QByteArray &scope,
+                                     const char *name) {
+  lookupName();
+  simulateCall(name);
+  return m_values.value(scopedName(scope, name));
+}
+
+QVariant FakeRdpControl::scopedCall(const QByteArray &scope,
+                                    const char *function,
+                                    const QVariantList &args) {
+  const QByteArray name = methodName(function);
+  lookupName();
+  simulateCall(name);
+
+  if (scope.isEmpty() && name == "Connect") {
+    playConnectScript();
+  } else if (scope.isEmpty() && name == "Disconnect") {
+    if (m_connected) {
+      m_connected = false;
+      QTimer::singleShot(0, this,
+                         [this]() { postEvent(RdpEvent::Disconnected, 1); });
+    }
+  } else if (scope.isEmpty() && name == "UpdateSessionDisplaySettings") {
+    // 与真实控件一样，之后读到的桌面尺寸为调整后的尺寸
+    m_values.insert("DesktopWidth", args.value(0));
+    m_values.insert("DesktopHeight", args.value(1));
+  } else if (name == "ServerStartProgram" || name == "ServerStart") {
+    const QString path = args.value(0).toString();
+    const QPair<int, RdpEvent::RailResult> script =
+        m_remoteProgramResults.value(
+            path, qMakePair(m_remoteProgramDelayMs, m_remoteProgramResult));
+    const RdpEvent::RailResult result = script.second;
+    const int generation = m_generation;
+    QTimer::singleShot(script.first, this,
+                       [this, path, result, generation]() {
+                         if (generation != m_generation) {
+                           return;
+                         }
+                         RdpEvent event;
+                         event.type = RdpEvent::RemoteProgramResult;
+                         event.code = result;
+                         event.flag = true;
+                         event.executablePath = path;
+                         postEvent(std::move(event));
+                         if (result == RdpEvent::RailOk) {
+                           const qlonglong windowId = m_nextWindowId++;
+                           m_remoteWindows.insert(windowId, path);
+                           postWindowEvent(true, windowId);
+                         }
+                       });
+  }
+  return QVariant();
+}
+
+int FakeRdpControl::scopedDispatchId(const QByteArray &scope,
+                                     const char *name) {
+  lookupName();
+  const QByteArray key = scopedName(scope, name);
+  auto it = m_dispatchIds.find(key);
+  if (it == m_dispatchIds.end()) {
+    it = m_dispatchIds.insert(key, m_dispatchIds.size() + 1);
+  }
+  return it.value();
+}
+
+RdpDispatch *FakeRdpControl::scopedSubObject(const QByteArray &scope,
+                                             const char *name) {
+  simulateCall(name);
+  if (m_unsupportedSubObjects.contains(name)) {
+    return nullptr;
+  }
+  return new FakeRdpDispatch(this, scopedName(scope, name));
+}
+
+void FakeRdpControl::simulateCall(const QByteArray &name) {
+  ++m_totalCalls;
+  ++m_callCounts[name];
+  const int latency = m_latencies.value(name, m_defaultLatencyMs);
+  if (latency > 0) {
+    // 模拟同步 COM 调用：阻塞调用线程
+    QThread::msleep(latency);
+  }
+}
+
+void FakeRdpControl::lookupName() {
+  ++m_totalCalls;
+  ++m_callCounts["GetIDsOfNames"];
+  if (m_nameLookupUs > 0) {
+    // 微秒级的耗时用忙等，sleep 的精度不够
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.nsecsElapsed() < qint64(m_nameLookupUs) * 1000) {
+    }
+  }
+}
+
+void FakeRdpControl::playConnectScript() {
+  int elapsed = 0;
+  const int generation = m_generation;
+  const QList<FakeRdpEvent> script =
+      m_queuedScripts.isEmpty() ? m_connectScript : m_queuedScripts.takeFirst();
+  for (const FakeRdpEvent &event : script) {
+    elapsed += event.delayMs;
+    QTimer::singleShot(elapsed, this, [this, event, generation]() {
+      if (generation == m_generation) {
+        emitEvent(event);
+      }
+    });
+  }
+}
+
+void FakeRdpControl::emitEvent(const FakeRdpEvent &event) {
+  switch (event.type) {
+  case FakeRdpEvent::Connected:
+    m_connected = true;
+    postEvent(RdpEvent::Connected);
+    break;
+  case FakeRdpEvent::Disconnected:
+    m_connected = false;
+    m_remoteWindows.clear();
+    postEvent(RdpEvent::Disconnected, event.code);
+    break;
+  case FakeRdpEvent::LoginComplete:
+    postEvent(RdpEvent::LoginComplete);
+    break;
+  case FakeRdpEvent::FatalError:
+    m_connected = false;
+    postEvent(RdpEvent::FatalError, event.code);
+    break;
+  }
+}
+
+void FakeRdpControl::postWindowEvent(bool visible, qlonglong windowId) {
+  RdpEvent event;
+  event.type = RdpEvent::RemoteWindowDisplayed;
+  event.flag = visible;
+  event.windowId = windowId;
+  postEvent(std::move(event));
+}
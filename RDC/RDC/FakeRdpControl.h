@@ -0,0 +1,131 @@
+#ifndef FAKERDPCONTROL_H
+#define FAKERDPCONTROL_H
+
+#include "RdpControl.h"
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <atomic>
+
+// 模拟控件按脚本触发的事件
+struct FakeRdpEvent {
+  enum Type { Connected, Disconnected, LoginComplete, FatalError };
+
+  Type type;
+  int delayMs;  // 相对上一个事件的延迟
+  int code = 0; // Disconnected 原因 / FatalError 错误码
+};
+
+// 进程内模拟的 MsTscAx 控件，可脚本化每次调用的延迟与事件序列，
+// 用于在没有 ActiveX 的环境（Linux、CI）中运行和计时完整的会话流程。
+class FakeRdpControl : public RdpControl {
+  Q_OBJECT
+
+public:
+  explicit FakeRdpControl(QObject *parent = nullptr);
+  ~FakeRdpControl() override;
+
+  QWidget *widget() override { return nullptr; }
+  void reset() override;
+  QString version() override { return m_version; }
+  void setVersion(const QString &version) { m_version = version; }
+  void setRenderingSuspended(bool suspended) override {
+    m_renderingSuspended = suspended;
+  }
+  bool renderingSuspended() const { return m_renderingSuspended; }
+
+  bool setValue(const char *name, const QVariant &value) override;
+  QVariant value(const char *name) override;
+  QVariant dynamicCall(const char *function,
+                       const QVariantList &args = QVariantList()) override;
+  RdpDispatch *querySubObject(const char *name) override;
+  int dispatchId(const char *name) override;
+  bool setValueById(int dispId, const char *name,
+                    const QVariant &value) override;
+
+  // 脚本配置
+  // 名称为属性名、方法名（不含参数列表）或子对象名，延迟在调用线程上阻塞
+  void setCallLatency(const QByteArray &name, int ms);
+  void setDefaultCallLatency(int ms) { m_defaultLatencyMs = ms; }
+  // 按名称访问（setValue / value / dynamicCall / dispatchId）时解析名称的
+  // 耗时（微秒，忙等），模拟 IDispatch::GetIDsOfNames；setValueById 不解析
+  void setNameLookupCost(int us) { m_nameLookupUs = qMax(0, us); }
+  // Connect() 之后依次触发的事件，默认为 Connected + LoginComplete
+  void setConnectScript(const QList<FakeRdpEvent> &events);
+  // 只用于下一次 Connect() 的脚本，用完后恢复为 setConnectScript 的脚本；
+  // 可多次调用，依次用于之后的各次 Connect()
+  void queueConnectScript(const QList<FakeRdpEvent> &events);
+  // 立即模拟连接中断（如网络断开 0x904），用于测试自动重连
+  void injectDisconnect(int reason);
+  // ServerStartProgram 之后 OnRemoteProgramResult 的延迟与 RailResult
+  void setRemoteProgramResult(int delayMs, RdpEvent::RailResult result);
+  // 指定程序路径的延迟与 RailResult，可用于模拟乱序返回的结果
+  void setRemoteProgramResult(const QString &executablePath, int delayMs,
+                              RdpEvent::RailResult result);
+  // 结果为成功的 RemoteApp 启动会同时显示一个远程窗口；
+  // 关闭窗口模拟用户退出应用，路径为空时关闭全部窗口
+  void closeRemoteWindows(const QString &executablePath = QString());
+  int remoteWindowCount() const { return m_remoteWindows.size(); }
+  // 模拟不存在的子对象（如旧版本控件没有 RemoteProgram2）
+  void setUnsupportedSubObjects(const QStringList &names);
+  // 报告的合成内存占用：控件本身与每个子对象
+  qint64 memoryFootprint() const override { return m_memoryFootprint; }
+  void setMemoryFootprint(qint64 bytes) { m_memoryFootprint = bytes; }
+  qint64 subObjectFootprint() const { return m_subObjectFootprint; }
+  void setSubObjectFootprint(qint64 bytes) { m_subObjectFootprint = bytes; }
+
+  // 统计（名称查找计入 "GetIDsOfNames"）
+  int callCount(const QByteArray &name) const {
+    return m_callCounts.value(name);
+  }
+  int totalCalls() const { return m_totalCalls; }
+  void resetCounters();
+  // 进程内存活的模拟控件与子对象数，用于检查泄漏
+  static int liveControls();
+  static int liveSubObjects();
+
+  // 子对象通过限定名（如 "AdvancedSettings9.RDPPort"）访问控件的状态
+  bool setScopedValue(const QByteArray &scope, const char *name,
+                      const QVariant &value);
+  // 已解析 DISPID 的设置，不经过名称解析
+  bool putScopedValue(const QByteArray &scope, const char *name,
+                      const QVariant &value);
+  QVariant scopedValue(const QByteArray &scope, const char *name);
+  int scopedDispatchId(const QByteArray &scope, const char *name);
+  QVariant scopedCall(const QByteArray &scope, const char *function,
+                      const QVariantList &args);
+  RdpDispatch *scopedSubObject(const QByteArray &scope, const char *name);
+
+private:
+  void simulateCall(const QByteArray &name);
+  void lookupName();
+  void playConnectScript();
+  void emitEvent(const FakeRdpEvent &event);
+  void postWindowEvent(bool visible, qlonglong windowId);
+
+  QHash<QByteArray, QVariant> m_values;
+  QHash<QByteArray, int> m_dispatchIds;
+  QHash<QByteArray, int> m_latencies;
+  QHash<QByteArray, int> m_callCounts;
+  QSet<QByteArray> m_unsupportedSubObjects;
+  QList<FakeRdpEvent> m_connectScript;
+  QList<QList<FakeRdpEvent>> m_queuedScripts;
+  // 路径 -> (延迟, 结果)
+  QHash<QString, QPair<int, RdpEvent::RailResult>> m_remoteProgramResults;
+  QHash<qlonglong, QString> m_remoteWindows;               // 窗口 ID -> 路径
+  qlonglong m_nextWindowId;
+  QString m_version;
+  int m_defaultLatencyMs;
+  int m_nameLookupUs;
+  int m_remoteProgramDelayMs;
+  RdpEvent::RailResult m_remoteProgramResult;
+  int m_totalCalls;
+  int m_generation; // reset() 后丢弃尚未触发的脚本事件
+  qint64 m_memoryFootprint;
+  qint64 m_subObjectFootprint;
+  bool m_connected;
+  bool m_renderingSuspended;
+};
+
+#endif // FAKERDPCONTROL_H
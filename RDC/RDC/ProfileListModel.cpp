@@ -0,0 +1,129 @@
+#include "ProfileListModel.h"
+#include "ProfileStore.h"
+
+ProfileListModel::ProfileListModel(QObject *parent)
+    : ProfileListModel(ProfileStore::instance(), parent) {}
+
+ProfileListModel::ProfileListModel(ProfileStore *store, QObject *parent)
+    : QAbstractListModel(parent), m_store(store), m_kind(All) {
+  connect(m_store, &ProfileStore::changed, this, &ProfileListModel::refresh);
+  refresh();
+}
+
+int ProfileListModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : m_ids.size();
+}
+
+QVariant ProfileListModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_ids.size()) {
+    return QVariant();
+  }
+
+  const ConnectionProfile *profile = m_store->find(m_ids.at(index.row()));
+  if (!profile) {
+    return QVariant();
+  }
+  switch (role) {
+  case ProfileIdRole:
+    return profile->id;
+  case Qt::DisplayRole:
+  case NameRole:
+    return profile->name;
+  case ServerRole:
+    return profile->settings.server;
+  case PortRole:
+    return profile->settings.port;
+  case UsernameRole:
+    return profile->settings.username;
+  case TagsRole:
+    return profile->tags;
+  case RemoteAppModeRole:
+    return profile->settings.remoteAppMode;
+  case ExecutablePathRole:
+    return profile->settings.executablePath;
+  default:
+    return QVariant();
+  }
+}
+
+QHash<int, QByteArray> ProfileListModel::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles.insert(ProfileIdRole, "profileId");
+  roles.insert(NameRole, "name");
+  roles.insert(ServerRole, "server");
+  roles.insert(PortRole, "port");
+  roles.insert(UsernameRole, "username");
+  roles.insert(TagsRole, "tags");
+  roles.insert(RemoteAppModeRole, "remoteAppMode");
+  roles.insert(ExecutablePathRole, "executablePath");
+  return roles;
+}
+
+void ProfileListModel::setFilter(const QString &filter) {
+  if (m_filter != filter) {
+    m_filter = filter;
+    emit filterChanged();
+    refresh();
+  }
+}
+
+void ProfileListModel::setKind(Kind kind) {
+  if (m_kind != kind) {
+    m_kind = kind;
+    emit kindChanged();
+    refresh();
+  }
+}
+
+int ProfileListModel::totalCount() const { return m_store->count(); }
+
+QVariantMap ProfileListModel::get(int row) const {
+  if (row < 0 || row >= m_ids.size()) {
+    return QVariantMap();
+  }
+  const ConnectionProfile *profile = m_store->find(m_ids.at(row));
+  return profile ? profile->toVariantMap() : QVariantMap();
+}
+
+int ProfileListModel::saveProfile(const QVariantMap &map) {
+  ConnectionProfile profile = ConnectionProfile::fromVariantMap(map);
+  if (profile.settings.server.isEmpty()) {
+    return 0;
+  }
+  if (profile.id <= 0) {
+    profile.id = m_store->findMatching(profile.settings);
+  }
+  // 合并到已有档案时保留其名称和标签
+  if (const ConnectionProfile *existing = m_store->find(profile.id)) {
+    if (profile.name.isEmpty()) {
+      profile.name = existing->name;
+    }
+    if (profile.tags.isEmpty()) {
+      profile.tags = existing->tags;
+    }
+  }
+  return m_store->save(profile);
+}
+
+bool ProfileListModel::removeProfile(int profileId) {
+  return m_store->remove(profileId);
+}
+
+void ProfileListModel::refresh() {
+  beginResetModel();
+  m_ids = m_store->search(m_filter);
+  if (m_kind != All) {
+    const bool remoteApp = m_kind == RemoteApp;
+    int kept = 0;
+    for (int i = 0; i < m_ids.size(); ++i) {
+      const ConnectionProfile *profile = m_store->find(m_ids.at(i));
+      if (profile && profile->settings.remoteAppMode == remoteApp) {
+        m_ids[kept++] = m_ids.at(i);
+      }
+    }
+    m_ids.resize(kept);
+  }
+  endResetModel();
+  // totalCount 共用此信号，存储变化时即使过滤结果数不变也要通知
+  emit countChanged();
+}
@@ -0,0 +1,70 @@
+#ifndef PROFILELISTMODEL_H
+#define PROFILELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+
+class ProfileStore;
+
+// 连接档案的可过滤列表（QML 中为 ProfileModel）
+// filter 每次变化都通过 ProfileStore 的索引重新查询，不遍历全部档案。
+class ProfileListModel : public QAbstractListModel {
+  Q_OBJECT
+  Q_PROPERTY(QString filter READ filter WRITE setFilter NOTIFY filterChanged)
+  Q_PROPERTY(Kind kind READ kind WRITE setKind NOTIFY kindChanged)
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(int totalCount READ totalCount NOTIFY countChanged)
+
+public:
+  enum Kind { All, Desktop, RemoteApp };
+  Q_ENUM(Kind)
+
+  enum Roles {
+    ProfileIdRole = Qt::UserRole + 1,
+    NameRole,
+    ServerRole,
+    PortRole,
+    UsernameRole,
+    TagsRole,
+    RemoteAppModeRole,
+    ExecutablePathRole
+  };
+
+  explicit ProfileListModel(QObject *parent = nullptr);
+  // 使用指定的存储；默认为 ProfileStore::instance()
+  explicit ProfileListModel(ProfileStore *store, QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  QString filter() const { return m_filter; }
+  void setFilter(const QString &filter);
+  Kind kind() const { return m_kind; }
+  void setKind(Kind kind);
+  int count() const { return m_ids.size(); }
+  int totalCount() const;
+
+  // 返回该行档案的全部设置（含 profileId / name / tags）
+  Q_INVOKABLE QVariantMap get(int row) const;
+  // 保存档案；未指定 profileId 时与连接参数相同的已有档案合并。
+  // 服务器为空时不保存，返回 0
+  Q_INVOKABLE int saveProfile(const QVariantMap &profile);
+  Q_INVOKABLE bool removeProfile(int profileId);
+
+signals:
+  void filterChanged();
+  void kindChanged();
+  void countChanged();
+
+private slots:
+  void refresh();
+
+private:
+  ProfileStore *m_store;
+  QString m_filter;
+  Kind m_kind;
+  QVector<int> m_ids;
+};
+
+#endif // PROFILELISTMODEL_H
@@ -0,0 +1,631 @@
+#include "ProfileStore.h"
+#include "RdcLog.h"
+#include "RdcWorker.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+
+namespace {
+
+const QString kOp = QStringLiteral("op");
+const QString kPut = QStringLiteral("put");
+const QString kDel = QStringLiteral("del");
+const QString kId = QStringLiteral("id");
+const QString kProfile = QStringLiteral("profile");
+
+quint64 trigramKey(const QChar *text) {
+  return (quint64(text[0].unicode()) << 32) |
+         (quint64(text[1].unicode()) << 16) | quint64(text[2].unicode());
+}
+
+QString searchableText(const ConnectionProfile &profile) {
+  // 字段之间以换行分隔，跨字段的三元组不会入索引
+  QStringList fields;
+  fields << profile.name << profile.settings.server
+         << profile.settings.username << profile.tags;
+  return fields.join(QLatin1Char('\n')).toLower();
+}
+
+QString defaultName(const RdpSettings &settings) {
+  if (settings.remoteAppMode && !settings.executablePath.isEmpty()) {
+    const QString path = QDir::fromNativeSeparators(settings.executablePath);
+    return path.mid(path.lastIndexOf(QLatin1Char('/')) + 1) +
+           QStringLiteral(" @ ") + settings.server;
+  }
+  if (settings.username.isEmpty()) {
+    return settings.server;
+  }
+  return settings.username + QLatin1Char('@') + settings.server;
+}
+
+QVector<int> intersect(const QVector<int> &a, const QVector<int> &b) {
+  QVector<int> result;
+  result.reserve(qMin(a.size(), b.size()));
+  std::set_intersection(a.constBegin(), a.constEnd(), b.constBegin(),
+                        b.constEnd(), std::back_inserter(result));
+  return result;
+}
+
+} // namespace
+
+QVariantMap ConnectionProfile::toVariantMap() const {
+  QVariantMap map = settings.toVariantMap();
+  map.insert(QStringLiteral("profileId"), id);
+  map.insert(QStringLiteral("name"), name);
+  map.insert(QStringLiteral("tags"), tags);
+  return map;
+}
+
+ConnectionProfile ConnectionProfile::fromVariantMap(const QVariantMap &map) {
+  ConnectionProfile profile;
+  profile.id = map.value(QStringLiteral("profileId")).toInt();
+  profile.name = map.value(QStringLiteral("name")).toString().trimmed();
+  const QVariant tags = map.value(QStringLiteral("tags"));
+  if (tags.type() == QVariant::String) {
+    // QML 文本框中以逗号分隔的标签
+    for (const QString &tag :
+         tags.toString().split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+      if (!tag.trimmed().isEmpty()) {
+        profile.tags << tag.trimmed();
+      }
+    }
+  } else {
+    profile.tags = tags.toStringList();
+  }
+  profile.settings = RdpSettings::fromVariantMap(map);
+  return profile;
+}
+
+void ProfileIndex::clear() {
+  m_texts.clear();
+  m_trigrams.clear();
+  m_tokens.clear();
+  m_tokensSorted = true;
+}
+
+void ProfileIndex::insert(int slot, const ConnectionProfile &profile) {
+  if (m_texts.size() <= slot) {
+    m_texts.resize(slot + 1);
+  }
+  const QString text = searchableText(profile);
+  m_texts[slot] = text;
+
+  // 槽位单调递增，倒排表天然有序
+  const QChar *data = text.constData();
+  for (int i = 0; i + 3 <= text.size(); ++i) {
+    if (data[i] == QLatin1Char('\n') || data[i + 1] == QLatin1Char('\n') ||
+        data[i + 2] == QLatin1Char('\n')) {
+      continue;
+    }
+    QVector<int> &postings = m_trigrams[trigramKey(data + i)];
+    if (postings.isEmpty() || postings.last() != slot) {
+      postings.append(slot);
+    }
+  }
+
+  int start = -1;
+  for (int i = 0; i <= text.size(); ++i) {
+    const bool word = i < text.size() && data[i].isLetterOrNumber();
+    if (word && start < 0) {
+      start = i;
+    } else if (!word && start >= 0) {
+      m_tokens.append(qMakePair(text.mid(start, i - start), slot));
+      start = -1;
+    }
+  }
+  m_tokensSorted = false;
+}
+
+QVector<int> ProfileIndex::search(const QString &query) const {
+  const QStringList terms =
+      query.toLower().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+  if (terms.isEmpty()) {
+    return QVector<int>();
+  }
+
+  QVector<int> result = searchTerm(terms.first());
+  for (int i = 1; i < terms.size() && !result.isEmpty(); ++i) {
+    result = intersect(result, searchTerm(terms.at(i)));
+  }
+  return result;
+}
+
+QVector<int> ProfileIndex::searchTerm(const QString &term) const {
+  QVector<int> result;
+
+  if (term.size() < 3) {
+    if (!m_tokensSorted) {
+      std::sort(m_tokens.begin(), m_tokens.end());
+      m_tokensSorted = true;
+    }
+    auto it = std::lower_bound(m_tokens.constBegin(), m_tokens.constEnd(),
+                               qMakePair(term, -1));
+    for (; it != m_tokens.constEnd() && it->first.startsWith(term); ++it) {
+      result.append(it->second);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  // 从最短的倒排表开始求交集
+  QVector<const QVector<int> *> lists;
+  const QChar *data = term.constData();
+  for (int i = 0; i + 3 <= term.size(); ++i) {
+    const auto it = m_trigrams.constFind(trigramKey(data + i));
+    if (it == m_trigrams.constEnd()) {
+      return result;
+    }
+    lists.append(&*it);
+  }
+  std::sort(lists.begin(), lists.end(),
+            [](const QVector<int> *a, const QVector<int> *b) {
+              return a->size() < b->size();
+            });
+
+  QVector<int> candidates = *lists.first();
+  for (int i = 1; i < lists.size() && !candidates.isEmpty(); ++i) {
+    candidates = intersect(candidates, *lists.at(i));
+  }
+
+  // 三元组全部命中不代表连续出现，逐个校验
+  result.reserve(candidates.size());
+  for (int slot : candidates) {
+    if (m_texts.at(slot).contains(term)) {
+      result.append(slot);
+    }
+  }
+  return result;
+}
+
+ProfileStore::ProfileStore(const QString &journalPath, QObject *parent)
+    : QObject(parent), m_path(journalPath), m_worker(nullptr), m_nextId(1),
+      m_journalRecords(0) {
+  if (m_path.isEmpty()) {
+    m_path =
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+        QStringLiteral("/profiles.journal");
+  }
+  load();
+}
+
+ProfileStore::~ProfileStore() {
+  waitForWrites();
+  m_journal.close();
+}
+
+ProfileStore *ProfileStore::instance() {
+  // 工作线程先于档案存储创建，退出时后销毁
+  RdcWorker *worker = RdcWorker::instance();
+  static ProfileStore store;
+  store.setWorker(worker);
+  return &store;
+}
+
+void ProfileStore::waitForWrites() { m_lastWrite.waitForFinished(); }
+
+void ProfileStore::load() {
+  QElapsedTimer timer;
+  timer.start();
+
+  QFile file(m_path);
+  if (file.open(QIODevice::ReadOnly)) {
+    while (!file.atEnd()) {
+      const QByteArray line = file.readLine().trimmed();
+      if (line.isEmpty()) {
+        continue;
+      }
+      ++m_journalRecords;
+      QJsonParseError error;
+      const QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+      if (!doc.isObject()) {
+        // 通常是写入中途退出留下的半行，跳过即可
+        RDC_LOG_WARNING(RdcLog::General, 0,
+                        "Skipping bad profile journal record: %1",
+                        error.errorString());
+        continue;
+      }
+      replay(doc.object());
+    }
+    file.close();
+  }
+  rebuildIndex();
+
+  RDC_LOG_DEBUG(RdcLog::General, 0,
+                "Loaded %1 profiles from %2 journal records in %3 ms", count(),
+                m_journalRecords, timer.elapsed());
+
+  if (m_journalRecords > count() * 2 + 64) {
+    compact();
+  }
+}
+
+void ProfileStore::replay(const QJsonObject &record) {
+  const QString op = record.value(kOp).toString();
+  if (op == kPut) {
+    const ConnectionProfile profile = ConnectionProfile::fromVariantMap(
+        record.value(kProfile).toObject().toVariantMap());
+    if (profile.id > 0) {
+      put(profile);
+      m_nextId = qMax(m_nextId, profile.id + 1);
+    }
+  } else if (op == kDel) {
+    erase(record.value(kId).toInt());
+  }
+}
+
+void ProfileStore::put(const ConnectionProfile &profile) {
+  erase(profile.id);
+  m_slotById.insert(profile.id, m_slots.size());
+  m_slots.append(profile);
+}
+
+void ProfileStore::erase(int id) {
+  const auto it = m_slotById.find(id);
+  if (it == m_slotById.end()) {
+    return;
+  }
+  // 旧槽位留在索引中，搜索时按 id 为 0 过滤
+  m_slots[*it] = ConnectionProfile();
+  m_slotById.erase(it);
+}
+
+void ProfileStore::rebuildIndex() {
+  m_index.clear();
+  for (int slot = 0; slot < m_slots.size(); ++slot) {
+    if (m_slots.at(slot).id != 0) {
+      m_index.insert(slot, m_slots.at(slot));
+    }
+  }
+}
+
+int ProfileStore::save(const ConnectionProfile &profile) {
+  ConnectionProfile saved = profile;
+  if (saved.id <= 0) {
+    saved.id = m_nextId++;
+  }
+  if (saved.name.isEmpty()) {
+    saved.name = defaultName(saved.settings);
+  }
+
+  QJsonObject record;
+  record.insert(kOp, kPut);
+  record.insert(kProfile, QJsonObject::fromVariantMap(saved.toVariantMap()));
+  appendRecord(record);
+
+  put(saved);
+  m_index.insert(m_slots.size() - 1, saved);
+  emit changed();
+  return saved.id;
+}
+
+bool ProfileStore::remove(int id) {
+  if (!m_slotById.contains(id)) {
+    return false;
+  }
+
+  QJsonObject record;
+  record.insert(kOp, kDel);
+  record.insert(kId, id);
+  appendRecord(record);
+
+  erase(id);
+  emit changed();
+  return true;
+}
+
+const ConnectionProfile *ProfileStore::find(int id) const {
+  const auto it = m_slotById.constFind(id);
+  return it == m_slotById.constEnd() ? nullptr : &m_slots.at(*it);
+}
+
+int ProfileStore::findMatching(const RdpSettings &settings) const {
+  for (int slot = m_slots.size() - 1; slot >= 0; --slot) {
+    const ConnectionProfile &profile = m_slots.at(slot);
+    if (profile.id == 0) {
+      continue;
+    }
+    const RdpSettings &s = profile.settings;
+    if (s.remoteAppMode == settings.remoteAppMode && s.port == settings.port &&
+        s.server.compare(settings.server, Qt::CaseInsensitive) == 0 &&
+        s.username.compare(settings.username, Qt::CaseInsensitive) == 0 &&
+        (!s.remoteAppMode ||
+         s.executablePath.compare(settings.executablePath,
+                                  Qt::CaseInsensitive) == 0)) {
+      return profile.id;
+    }
+  }
+  return 0;
+}
+
+QVector<int> ProfileStore::search(const QString &query) const {
+  QVector<int> ids;
+  if (query.trimmed().isEmpty()) {
+    ids.reserve(count());
+    for (int slot = m_slots.size() - 1; slot >= 0; --slot) {
+      if (m_slots.at(slot).id != 0) {
+        ids.append(m_slots.at(slot).id);
+      }
+    }
+    return ids;
+  }
+
+  const QVector<int> matches = m_index.search(query);
+  ids.reserve(matches.size());
+  for (int i = matches.size() - 1; i >= 0; --i) {
+    const int id = m_slots.at(matches.at(i)).id;
+    if (id != 0) {
+      ids.append(id);
+    }
+  }
+  return ids;
+}
+
+bool ProfileStore::compact() {
+  // 重写前让排队中的追加写入落盘，之后由这里独占日志文件
+  waitForWrites();
+  QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+  QVector<ConnectionProfile> live;
+  live.reserve(count());
+  QSaveFile file(m_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot compact profile journal: %1",
+                    m_path);
+    return false;
+  }
+  for (const ConnectionProfile &profile : m_slots) {
+    if (profile.id == 0) {
+      continue;
+    }
+    QJsonObject record;
+    record.insert(kOp, kPut);
+    record.insert(kProfile,
+                  QJsonObject::fromVariantMap(profile.toVariantMap()));
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+    file.write("\n");
+    live.append(profile);
+  }
+
+  m_journal.close();
+  if (!file.commit()) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot compact profile journal: %1",
+                    file.errorString());
+    return false;
+  }
+
+  m_slots = live;
+  m_slotById.clear();
+  for (int slot = 0; slot < m_slots.size(); ++slot) {
+    m_slotById.insert(m_slots.at(slot).id, slot);
+  }
+  m_journalRecords = m_slots.size();
+  rebuildIndex();
+  RDC_LOG_DEBUG(RdcLog::General, 0, "Compacted profile journal to %1 records",
+                m_journalRecords);
+  return true;
+}
+
+bool ProfileStore::appendRecord(const QJsonObject &record) {
+  QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+  line.append('\n');
+  ++m_journalRecords;
+  if (m_worker) {
+    m_lastWrite = m_worker->post([this, line]() { writeJournal(line); });
+    return true;
+  }
+  return writeJournal(line);
+}
+
+bool ProfileStore::writeJournal(const QByteArray &line) {
+  if (!m_journal.isOpen()) {
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    m_journal.setFileName(m_path);
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      RDC_LOG_WARNING(RdcLog::General, 0, "Cannot open profile journal: %1 %2",
+                      m_path, m_journal.errorString());
+      return false;
+    }
+    // 上次写入中断留下的半行单独成行，不能与新记录连在一起
+    if (m_journal.size() > 0) {
+      QFile tail(m_path);
+      if (tail.open(QIODevice::ReadOnly) && tail.seek(tail.size() - 1) &&
+          tail.read(1) != "\n") {
+        m_journal.write("\n");
+      }
+    }
+  }
+
+  if (m_journal.write(line) != line.size() || !m_journal.flush()) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot write profile journal: %1",
+                    m_journal.errorString());
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+// 合成的档案：环境-角色-序号命名，按部门划分主机与标签
+ConnectionProfile benchmarkProfile(int i) {
+  static const char *const envs[] = {"prod", "staging", "dev", "qa"};
+  static const char *const roles[] = {"web",   "db",     "cache", "build",
+                                      "files", "report", "gateway", "ad"};
+  static const char *const depts[] = {"finance", "sales", "hr", "rnd",
+                                      "support", "ops"};
+  static const char *const users[] = {"alice", "bob",   "carol", "dave",
+                                      "erin",  "frank", "grace", "heidi"};
+  const QString env = QLatin1String(envs[i % 4]);
+  const QString role = QLatin1String(roles[(i / 4) % 8]);
+  const QString dept = QLatin1String(depts[(i / 32) % 6]);
+
+  ConnectionProfile profile;
+  profile.id = i + 1;
+  profile.name = QStringLiteral("%1-%2-%3").arg(env, role).arg(i);
+  profile.tags << env << dept;
+  profile.settings.server = QStringLiteral("%1%2.%3.corp.example")
+                                .arg(role)
+                                .arg(i % 997)
+                                .arg(dept);
+  profile.settings.username = QStringLiteral("CORP\\%1%2")
+                                  .arg(QLatin1String(users[(i / 7) % 8]))
+                                  .arg(i % 50);
+  if (i % 5 == 0) {
+    profile.settings.remoteAppMode = true;
+    profile.settings.executablePath =
+        QStringLiteral("C:\\Program Files\\%1\\%1.exe").arg(role);
+  }
+  return profile;
+}
+
+// 与 ProfileIndex 相同的语义，逐个档案比较；查询词不短于 3 时为子串匹配
+QVector<int> scanProfiles(const QVector<ConnectionProfile> &profiles,
+                          const QString &query) {
+  const QStringList terms =
+      query.toLower().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+  QVector<int> ids;
+  for (int i = profiles.size() - 1; i >= 0; --i) {
+    const QString text = searchableText(profiles.at(i));
+    bool match = !terms.isEmpty();
+    for (const QString &term : terms) {
+      match = match && text.contains(term);
+    }
+    if (match) {
+      ids.append(profiles.at(i).id);
+    }
+  }
+  return ids;
+}
+
+// 每次按键耗时（纳秒）的均值、p99 与最大值
+struct KeyTimes {
+  qint64 mean = 0;
+  qint64 p99 = 0;
+  qint64 max = 0;
+};
+
+KeyTimes summarize(QVector<qint64> samples) {
+  KeyTimes times;
+  if (samples.isEmpty()) {
+    return times;
+  }
+  std::sort(samples.begin(), samples.end());
+  qint64 sum = 0;
+  for (const qint64 ns : samples) {
+    sum += ns;
+  }
+  times.mean = sum / samples.size();
+  times.p99 = samples.at(samples.size() * 99 / 100);
+  times.max = samples.last();
+  return times;
+}
+
+} // namespace
+
+int ProfileStore::runSearchBenchmark(int profiles, QTextStream &out) {
+  // 模拟在搜索框中逐字输入：每个前缀都是一次搜索
+  const QStringList queries = {
+      QStringLiteral("prod web"),    QStringLiteral("finance"),
+      QStringLiteral("alice"),       QStringLiteral("gateway sales"),
+      QStringLiteral("staging-db"),  QStringLiteral("cache123"),
+      QStringLiteral("corp.example"), QStringLiteral("nomatch-host")};
+  const int repeats = 20;
+  int failures = 0;
+
+  QTemporaryDir dir;
+  const QString path = dir.filePath(QStringLiteral("profiles.journal"));
+  QVector<ConnectionProfile> all;
+  all.reserve(profiles);
+  {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+      out << "cannot write " << path << "\n";
+      return 1;
+    }
+    for (int i = 0; i < profiles; ++i) {
+      all.append(benchmarkProfile(i));
+      QJsonObject record;
+      record.insert(kOp, kPut);
+      record.insert(kProfile,
+                    QJsonObject::fromVariantMap(all.last().toVariantMap()));
+      file.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+      file.write("\n");
+    }
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  ProfileStore store(path);
+  const qint64 loadMs = timer.elapsed();
+  out << "profile search benchmark: " << store.count() << " profiles, "
+      << QString::number(QFileInfo(path).size() / 1e6, 'f', 1)
+      << " MB journal, load (replay + index) " << loadMs << " ms\n";
+  if (store.count() != profiles) {
+    out << "  FAIL  loaded " << store.count() << " of " << profiles
+        << " profiles\n";
+    ++failures;
+  }
+  out << QStringLiteral("  %1 %2 %3 %4 %5 %6 %7\n")
+             .arg(QStringLiteral("query"), -16)
+             .arg(QStringLiteral("keys"), 5)
+             .arg(QStringLiteral("matches"), 8)
+             .arg(QStringLiteral("mean us"), 9)
+             .arg(QStringLiteral("p99 us"), 9)
+             .arg(QStringLiteral("max us"), 9)
+             .arg(QStringLiteral("scan us"), 9);
+
+  // 每次按键的耗时（纳秒），取 repeats 次搜索的平均
+  QVector<qint64> everyKey;
+  auto usText = [](qint64 ns) { return QString::number(ns / 1000.0, 'f', 1); };
+  for (const QString &query : queries) {
+    QVector<qint64> keys;
+    for (int length = 1; length <= query.size(); ++length) {
+      const QString prefix = query.left(length);
+      if (prefix.endsWith(QLatin1Char(' '))) {
+        continue; // 空格不改变查询词
+      }
+      timer.restart();
+      for (int r = 0; r < repeats; ++r) {
+        store.search(prefix);
+      }
+      keys.append(timer.nsecsElapsed() / repeats);
+    }
+    everyKey += keys;
+
+    // 输入完成后的结果与逐个比较一致
+    const QVector<int> ids = store.search(query);
+    timer.restart();
+    const QVector<int> expected = scanProfiles(all, query);
+    const qint64 scanNs = timer.nsecsElapsed();
+    if (ids != expected) {
+      out << "  FAIL  \"" << query << "\": " << ids.size() << " match(es), "
+          << expected.size() << " expected\n";
+      ++failures;
+    }
+
+    const KeyTimes times = summarize(keys);
+    out << QStringLiteral("  %1 %2 %3 %4 %5 %6 %7\n")
+               .arg(QLatin1Char('"') + query + QLatin1Char('"'), -16)
+               .arg(keys.size(), 5)
+               .arg(ids.size(), 8)
+               .arg(usText(times.mean), 9)
+               .arg(usText(times.p99), 9)
+               .arg(usText(times.max), 9)
+               .arg(usText(scanNs), 9);
+    out.flush();
+  }
+
+  const KeyTimes times = summarize(everyKey);
+  out << "  all keystrokes: " << everyKey.size() << ", mean "
+      << usText(times.mean) << " us, p99 " << usText(times.p99)
+      << " us, max " << usText(times.max) << " us\n";
+  out.flush();
+  return failures;
+}
@@ -0,0 +1,111 @@
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+
+#include "RdpSettings.h"
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QJsonObject;
+class QTextStream;
+class RdcWorker;
+
+// 保存的连接（桌面或 RemoteApp，取决于 settings.remoteAppMode）
+struct ConnectionProfile {
+  int id = 0; // 0 表示未保存或已删除
+  QString name;
+  QStringList tags;
+  RdpSettings settings;
+
+  // 在 RdpSettings 的键之外增加 profileId / name / tags
+  QVariantMap toVariantMap() const;
+  static ConnectionProfile fromVariantMap(const QVariantMap &map);
+};
+
+// 名称、主机、用户名与标签的内存索引
+// 长度不少于 3 的词按三元组倒排表求交集后再校验子串；
+// 更短的词在排序后的分词表上做前缀查找。
+class ProfileIndex {
+public:
+  void clear();
+  void insert(int slot, const ConnectionProfile &profile);
+  // 返回匹配所有查询词的槽位（升序），空查询返回空
+  QVector<int> search(const QString &query) const;
+
+private:
+  QVector<int> searchTerm(const QString &term) const;
+
+  QVector<QString> m_texts; // 槽位 -> 小写的可搜索文本
+  QHash<quint64, QVector<int>> m_trigrams;
+  mutable QVector<QPair<QString, int>> m_tokens;
+  mutable bool m_tokensSorted = true;
+};
+
+// 连接档案存储
+// 全部档案常驻内存；修改以 JSON 行追加到日志文件，保存单个档案
+// 不会重写整个文件。启动重放日志时若冗余记录过多则压缩一次。
+class ProfileStore : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ProfileStore(const QString &journalPath = QString(),
+                        QObject *parent = nullptr);
+  ~ProfileStore();
+
+  // 默认的全局实例，日志位于 AppDataLocation/profiles.journal，
+  // 写入由 RdcWorker::instance() 执行
+  static ProfileStore *instance();
+
+  // 设置后日志的追加写入在工作线程中按顺序执行，内存中的档案仍立即更新；
+  // 为 nullptr（默认）时同步写入
+  void setWorker(RdcWorker *worker) { m_worker = worker; }
+  // 等待已提交的日志写入完成
+  void waitForWrites();
+
+  QString journalPath() const { return m_path; }
+  int count() const { return m_slotById.size(); }
+
+  // id 为 0 时新建；返回档案 ID
+  int save(const ConnectionProfile &profile);
+  bool remove(int id);
+  const ConnectionProfile *find(int id) const;
+  // 查找连接参数相同的档案（服务器、端口、用户名及 RemoteApp 程序）
+  int findMatching(const RdpSettings &settings) const;
+
+  // 返回匹配的档案 ID，最近保存的在前；空查询返回全部
+  QVector<int> search(const QString &query) const;
+
+  // 用当前全部档案重写日志
+  bool compact();
+
+  // 基准测试：重放 profiles 个合成档案的日志，模拟在搜索框中逐字输入，
+  // 输出每次按键的搜索耗时，并与逐个比较的结果核对；返回不一致的查询数
+  static int runSearchBenchmark(int profiles, QTextStream &out);
+
+signals:
+  void changed();
+
+private:
+  void load();
+  void replay(const QJsonObject &record);
+  void put(const ConnectionProfile &profile);
+  void erase(int id);
+  void rebuildIndex();
+  bool appendRecord(const QJsonObject &record);
+  bool writeJournal(const QByteArray &line);
+
+  QString m_path;
+  QFile m_journal; // 设置了工作线程时只在该线程中写入
+  RdcWorker *m_worker;
+  QFuture<void> m_lastWrite;
+  QVector<ConnectionProfile> m_slots; // 按保存顺序，删除后 id 置 0
+  QHash<int, int> m_slotById;
+  ProfileIndex m_index;
+  int m_nextId;
+  int m_journalRecords;
+};
+
+#endif // PROFILESTORE_H
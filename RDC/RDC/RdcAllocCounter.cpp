@@ -0,0 +1,39 @@
+#include "RdcAllocCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if RDC_COUNT_ALLOCATIONS
+
+namespace {
+std::atomic<quint64> g_allocations(0);
+} // namespace
+
+// 数组与 nothrow 版本的默认实现都转到这里
+void *operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  for (;;) {
+    if (void *p = std::malloc(size ? size : 1)) {
+      return p;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+quint64 RdcAllocCounter::allocations() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+quint64 RdcAllocCounter::allocations() { return 0; }
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef RDCALLOCCOUNTER_H
+#define RDCALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+// 堆分配计数
+// 替换全局 operator new，以原子计数记录经 operator new 的分配次数，供
+// 基准测试比较不同写法的分配量。QString、QByteArray 与 QMap 的数据块由
+// Qt 直接用 malloc 分配，不计入；Windows 上 Qt DLL 内部的 operator new
+// 也不计入，数值只用于同一构建内的相对比较。
+//
+// 默认只在调试构建中启用，发布构建可定义 RDC_COUNT_ALLOCATIONS=1 启用。
+
+#ifndef RDC_COUNT_ALLOCATIONS
+#ifdef QT_NO_DEBUG
+#define RDC_COUNT_ALLOCATIONS 0
+#else
+#define RDC_COUNT_ALLOCATIONS 1
+#endif
+#endif
+
+class RdcAllocCounter {
+public:
+  static bool enabled() { return RDC_COUNT_ALLOCATIONS != 0; }
+  // 进程启动以来的分配次数，未启用时为 0
+  static quint64 allocations();
+};
+
+#endif // RDCALLOCCOUNTER_H
@@ -0,0 +1,316 @@
+#include "RdcLauncher.h"
+#include "ProfileStore.h"
+#include "RdcLog.h"
+#include "RdcStartupProfiler.h"
+#include "RdpClient.h"
+#include "RdpControl.h"
+#include "RdpSession.h"
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <algorithm>
+
+void RdcLauncher::addOptions(QCommandLineParser &parser) {
+  parser.addPositionalArgument(
+      QStringLiteral("target"),
+      QString::fromUtf8("直接连接的主机：host、host:port 或 [IPv6]:port"),
+      QStringLiteral("[host[:port]]"));
+  parser.addOptions({
+      {QStringLiteral("profile"),
+       QString::fromUtf8("按名称、ID 或 .rdp 文件加载连接档案"),
+       QStringLiteral("name")},
+      {{QStringLiteral("u"), QStringLiteral("user")},
+       QString::fromUtf8("用户名"),
+       QStringLiteral("user")},
+      {QStringLiteral("app"),
+       QString::fromUtf8("以 RemoteApp 模式启动的远程程序路径"),
+       QStringLiteral("path")},
+      {QStringLiteral("args"), QString::fromUtf8("RemoteApp 程序的命令行参数"),
+       QStringLiteral("args")},
+      {QStringLiteral("fullscreen"), QString::fromUtf8("以全屏模式连接")},
+      {QStringLiteral("fake"),
+       QString::fromUtf8("使用进程内模拟控件（不做预检）")},
+      {QStringLiteral("no-preflight"),
+       QString::fromUtf8("跳过连接前的 DNS / TCP / X.224 预检")},
+      {QStringLiteral("timing"), QString::fromUtf8("输出启动耗时报告")},
+      {QStringLiteral("quit"),
+       QString::fromUtf8("连接完成（RemoteApp 为应用启动）或失败后退出")},
+  });
+}
+
+bool RdcLauncher::readOptions(const QCommandLineParser &parser,
+                              RdcLaunchOptions *options, QString *error) {
+  options->profile = parser.value(QStringLiteral("profile"));
+
+  const QStringList targets = parser.positionalArguments();
+  if (targets.size() > 1) {
+    *error = QString::fromUtf8("只能指定一个连接目标");
+    return false;
+  }
+  if (!targets.isEmpty()) {
+    QString host;
+    int port = 0;
+    if (!parseTarget(targets.first(), &host, &port)) {
+      *error = QString::fromUtf8("无效的连接目标: %1").arg(targets.first());
+      return false;
+    }
+    options->overrides.insert(QStringLiteral("server"), host);
+    if (port > 0) {
+      options->overrides.insert(QStringLiteral("port"), port);
+    }
+  }
+
+  if (parser.isSet(QStringLiteral("user"))) {
+    options->overrides.insert(QStringLiteral("username"),
+                              parser.value(QStringLiteral("user")));
+  }
+  if (parser.isSet(QStringLiteral("app"))) {
+    options->overrides.insert(QStringLiteral("remoteAppMode"), true);
+    options->overrides.insert(QStringLiteral("executablePath"),
+                              parser.value(QStringLiteral("app")));
+  }
+  if (parser.isSet(QStringLiteral("args"))) {
+    options->overrides.insert(QStringLiteral("arguments"),
+                              parser.value(QStringLiteral("args")));
+  }
+  if (parser.isSet(QStringLiteral("fullscreen"))) {
+    options->overrides.insert(QStringLiteral("fullScreen"), true);
+  }
+
+  // 模拟控件不需要真实的服务器
+  options->fakeControl = parser.isSet(QStringLiteral("fake"));
+  options->preflight =
+      !options->fakeControl && !parser.isSet(QStringLiteral("no-preflight"));
+  options->timing = parser.isSet(QStringLiteral("timing"));
+  options->quitAfter = parser.isSet(QStringLiteral("quit"));
+  return true;
+}
+
+bool RdcLauncher::parseTarget(const QString &target, QString *host,
+                              int *port) {
+  QString name = target.trimmed();
+  QString portText;
+  if (name.startsWith(QLatin1Char('['))) {
+    const int end = name.indexOf(QLatin1Char(']'));
+    if (end < 0) {
+      return false;
+    }
+    const QString rest = name.mid(end + 1);
+    if (!rest.isEmpty()) {
+      if (!rest.startsWith(QLatin1Char(':'))) {
+        return false;
+      }
+      portText = rest.mid(1);
+    }
+    name = name.mid(1, end - 1);
+  } else if (name.count(QLatin1Char(':')) == 1) {
+    const int colon = name.indexOf(QLatin1Char(':'));
+    portText = name.mid(colon + 1);
+    name = name.left(colon);
+  }
+
+  *port = 0;
+  if (!portText.isNull()) {
+    bool ok = false;
+    *port = portText.toInt(&ok);
+    if (!ok || *port < 1 || *port > 65535) {
+      return false;
+    }
+  }
+  *host = name;
+  return !name.isEmpty();
+}
+
+RdcLauncher::RdcLauncher(const RdcLaunchOptions &options, QObject *parent)
+    : QObject(parent), m_options(options), m_client(nullptr),
+      m_finished(false), m_reported(false) {
+  std::fill_n(m_marksNs, int(MarkCount), qint64(-1));
+  mark(AppReady);
+  m_client = new RdpClient(this);
+
+  if (m_options.fakeControl) {
+    qputenv("RDC_FAKE_CONTROL", "1");
+  }
+
+  RdpSession *session = m_client->session();
+  session->setPreflightEnabled(m_options.preflight);
+  // 快速启动不创建控件池，会话直接调用工厂，借此记录控件创建完成的时间
+  session->setControlFactory([this]() {
+    RdpControl *control = RdpControl::createDefault();
+    if (control) {
+      mark(ControlCreated);
+    }
+    return control;
+  });
+
+  // RdpClient 先在 aboutToConnect 中创建并显示窗口，随后才到这里
+  connect(session, &RdpSession::aboutToConnect, this,
+          &RdcLauncher::onConnectIssued);
+  connect(m_client, &RdpClient::connectionSuccess, this,
+          &RdcLauncher::onConnected);
+  connect(m_client, &RdpClient::remoteAppStarted, this,
+          &RdcLauncher::onRemoteAppStarted);
+  connect(m_client, &RdpClient::connectionError, this,
+          &RdcLauncher::onError);
+  connect(m_client, &RdpClient::remoteAppError, this, &RdcLauncher::onError);
+  connect(m_client, &RdpClient::connectedChanged, this,
+          &RdcLauncher::onConnectedChanged);
+}
+
+RdcLauncher::~RdcLauncher() {}
+
+double RdcLauncher::markMs(Mark mark) const {
+  return m_marksNs[mark] < 0 ? -1 : m_marksNs[mark] / 1e6;
+}
+
+bool RdcLauncher::start() {
+  QVariantMap settings;
+  QString error;
+  if (!loadProfile(&settings, &error)) {
+    onError(error);
+    return false;
+  }
+  for (auto it = m_options.overrides.constBegin();
+       it != m_options.overrides.constEnd(); ++it) {
+    settings.insert(it.key(), it.value());
+  }
+
+  // 档案与覆盖项合并后一次校验、一次写入
+  if (!m_client->applySettings(settings)) {
+    return false;
+  }
+  RDC_LOG_INFO(RdcLog::Connect, m_client->session()->logId(),
+               "Fast-start connecting to %1 after %2 ms", m_client->server(),
+               markMs(AppReady));
+  return m_client->connectToServer();
+}
+
+bool RdcLauncher::loadProfile(QVariantMap *settings, QString *error) const {
+  const QString profile = m_options.profile;
+  if (profile.isEmpty()) {
+    return true;
+  }
+
+  if (profile.endsWith(QStringLiteral(".rdp"), Qt::CaseInsensitive)) {
+    RdpFile file = RdpFile::load(RdpFile::localPath(profile), error);
+    if (!error->isEmpty()) {
+      return false;
+    }
+    *settings = file.toSettings(RdpSettings()).toVariantMap();
+    return true;
+  }
+
+  const ProfileStore *store = ProfileStore::instance();
+  bool isId = false;
+  const int id = profile.toInt(&isId);
+  const ConnectionProfile *found = isId ? store->find(id) : nullptr;
+  if (!found) {
+    for (int candidate : store->search(profile)) {
+      const ConnectionProfile *p = store->find(candidate);
+      if (p && p->name.compare(profile, Qt::CaseInsensitive) == 0) {
+        found = p;
+        break;
+      }
+    }
+  }
+  if (!found) {
+    *error = QString::fromUtf8("未找到连接档案: %1").arg(profile);
+    return false;
+  }
+  *settings = found->settings.toVariantMap();
+  return true;
+}
+
+QString RdcLauncher::timingReport() const {
+  static const char *const names[MarkCount] = {
+      "app ready", "control created", "connect issued", "connected",
+      "remoteapp started"};
+
+  QString report;
+  QTextStream out(&report);
+  out << "startup timing (ms since main):\n";
+  for (int i = 0; i < MarkCount; ++i) {
+    const double ms = markMs(Mark(i));
+    if (ms < 0) {
+      continue;
+    }
+    out << "  " << QString::fromLatin1(names[i]).leftJustified(18)
+        << QString::number(ms, 'f', 1) << '\n';
+  }
+
+  const RdpSession *session = m_client->session();
+  out << "phases (ms):\n";
+  for (int phase = 0; phase < RdpMetrics::Total; ++phase) {
+    const qint64 us = session->lastPhaseUs(RdpMetrics::Phase(phase));
+    if (us < 0) {
+      continue;
+    }
+    out << "  "
+        << RdpMetrics::phaseName(RdpMetrics::Phase(phase)).leftJustified(18)
+        << QString::number(us / 1000.0, 'f', 1) << '\n';
+  }
+  return report;
+}
+
+void RdcLauncher::onConnectIssued() { mark(ConnectIssued); }
+
+void RdcLauncher::onConnected() {
+  mark(Connected);
+  if (!m_client->remoteAppMode()) {
+    report();
+    if (m_options.quitAfter) {
+      finish(0);
+    }
+  }
+}
+
+void RdcLauncher::onRemoteAppStarted() {
+  mark(RemoteAppStarted);
+  report();
+  if (m_options.quitAfter) {
+    finish(0);
+  }
+}
+
+void RdcLauncher::onError(const QString &error) {
+  RDC_LOG_WARNING(RdcLog::Connect, m_client->session()->logId(),
+                  "Fast-start connection failed: %1", error);
+  finish(1);
+}
+
+void RdcLauncher::onConnectedChanged() {
+  if (m_client->connected() || m_client->session()->isRestoring()) {
+    return;
+  }
+  // 用户断开或登录前被断开
+  finish(m_marksNs[Connected] >= 0 ? 0 : 1);
+}
+
+void RdcLauncher::mark(Mark mark) {
+  // 启动分析输出（--startup-profile）中的名称
+  static const char *const names[MarkCount] = {
+      "launch_app_ready", "launch_control_created", "launch_connect_issued",
+      "launch_connected", "launch_remoteapp_started"};
+  if (m_marksNs[mark] < 0) {
+    m_marksNs[mark] = RdcStartupProfiler::elapsedNs();
+    RdcStartupProfiler::instance()->addMark(names[mark], m_marksNs[mark]);
+  }
+}
+
+void RdcLauncher::finish(int exitCode) {
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+  report();
+  emit finished(exitCode);
+}
+
+void RdcLauncher::report() {
+  if (!m_options.timing || m_reported) {
+    return;
+  }
+  m_reported = true;
+  QTextStream out(stdout);
+  out << timingReport();
+  out.flush();
+}
@@ -0,0 +1,89 @@
+#ifndef RDCLAUNCHER_H
+#define RDCLAUNCHER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class QCommandLineParser;
+class RdpClient;
+
+// 命令行直接发起的连接
+// rdc --profile 名称/ID/.rdp 文件，或 rdc host[:port] --user U --app C:\app.exe
+struct RdcLaunchOptions {
+  QString profile;
+  QVariantMap overrides; // 与 RdpClient 属性同名，覆盖档案中的值
+  bool fakeControl = false;
+  bool preflight = true;
+  bool timing = false;    // 输出启动耗时报告
+  bool quitAfter = false; // 连接完成（RemoteApp 为应用启动）或失败后退出
+
+  // 命令行中有连接目标时才走快速启动路径
+  bool isLaunch() const {
+    return !profile.isEmpty() || overrides.contains(QStringLiteral("server"));
+  }
+};
+
+// 快速启动：不创建 QML 引擎，只创建 RdpClient（连接时由它创建
+// RdpWindow）并立即连接。启动耗时以 RdcStartupProfiler 的时钟记录：
+// main() 开始 -> QApplication 就绪 -> 控件创建 -> Connect 发出 -> 连接成功
+// （RemoteApp 模式再到应用启动），并写入启动分析的输出文件。
+class RdcLauncher : public QObject {
+  Q_OBJECT
+
+public:
+  enum Mark {
+    AppReady,
+    ControlCreated,
+    ConnectIssued,
+    Connected,
+    RemoteAppStarted,
+    MarkCount
+  };
+
+  // 向 parser 添加快速启动的选项
+  static void addOptions(QCommandLineParser &parser);
+  // 读取 parser 中的选项；主机或端口格式错误时返回 false
+  static bool readOptions(const QCommandLineParser &parser,
+                          RdcLaunchOptions *options, QString *error);
+  // 解析 host、host:port 或 [IPv6]:port
+  static bool parseTarget(const QString &target, QString *host, int *port);
+
+  explicit RdcLauncher(const RdcLaunchOptions &options,
+                       QObject *parent = nullptr);
+  ~RdcLauncher();
+
+  // 加载档案、应用覆盖项并发起连接；设置无效时返回 false
+  bool start();
+
+  RdpClient *client() const { return m_client; }
+  // 相对 main() 开始的耗时（毫秒），未到达为 -1
+  double markMs(Mark mark) const;
+  QString timingReport() const;
+
+signals:
+  // 连接流程结束，exitCode 为 0 表示成功
+  void finished(int exitCode);
+
+private slots:
+  void onConnectIssued();
+  void onConnected();
+  void onRemoteAppStarted();
+  void onError(const QString &error);
+  void onConnectedChanged();
+
+private:
+  bool loadProfile(QVariantMap *settings, QString *error) const;
+  void mark(Mark mark);
+  void finish(int exitCode);
+  // 只输出一次：连接完成时，或流程提前结束时
+  void report();
+
+  RdcLaunchOptions m_options;
+  RdpClient *m_client;
+  qint64 m_marksNs[MarkCount];
+  bool m_finished;
+  bool m_reported;
+};
+
+#endif // RDCLAUNCHER_H
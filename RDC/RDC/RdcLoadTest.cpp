@@ -0,0 +1,661 @@
+#include "RdcLoadTest.h"
+#include "FakeRdpControl.h"
+#include "RdcTestSupport.h"
+#include "RdpCapabilityCache.h"
+#include "RdpEventRouter.h"
+#include "RdpSession.h"
+#include "SessionManager.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+using RdcTestSupport::waitUntil;
+
+namespace {
+
+const char *faultName(RdcLoadTest::Fault fault) {
+  switch (fault) {
+  case RdcLoadTest::NoFault:
+    return "none";
+  case RdcLoadTest::FatalError:
+    return "fatal_error";
+  case RdcLoadTest::EarlyDisconnect:
+    return "early_disconnect";
+  case RdcLoadTest::NoRemoteProgram2:
+    return "no_remoteprogram2";
+  case RdcLoadTest::NoRemoteProgram:
+    return "no_remoteprogram";
+  case RdcLoadTest::RailFailure:
+    return "rail_failure";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace
+
+void RdcLoadTest::addOptions(QCommandLineParser &parser) {
+  parser.addOptions({
+      {QStringLiteral("load-test"),
+       QString::fromUtf8("用模拟控件运行 sessions 个会话的负载测试"),
+       QStringLiteral("sessions")},
+      {QStringLiteral("load-concurrency"),
+       QString::fromUtf8("负载测试中同时存在的会话数（默认 100）"),
+       QStringLiteral("count")},
+      {QStringLiteral("load-seed"),
+       QString::fromUtf8("负载测试的随机种子（默认 1）"), QStringLiteral("seed")},
+      {QStringLiteral("load-fault-rate"),
+       QString::fromUtf8("每种故障的注入比例，0 到 1"), QStringLiteral("rate")},
+      {QStringLiteral("session-stress"),
+       QString::fromUtf8("用模拟控件在 SessionManager 中打开并关闭 sessions 个会话"),
+       QStringLiteral("sessions")},
+  });
+}
+
+bool RdcLoadTest::readOptions(const QCommandLineParser &parser,
+                              RdcLoadTestOptions *options) {
+  if (!parser.isSet(QStringLiteral("load-test"))) {
+    return false;
+  }
+  options->sessions =
+      qMax(1, parser.value(QStringLiteral("load-test")).toInt());
+  if (parser.isSet(QStringLiteral("load-concurrency"))) {
+    options->concurrency =
+        qMax(1, parser.value(QStringLiteral("load-concurrency")).toInt());
+  }
+  if (parser.isSet(QStringLiteral("load-seed"))) {
+    options->seed = parser.value(QStringLiteral("load-seed")).toUInt();
+  }
+  if (parser.isSet(QStringLiteral("load-fault-rate"))) {
+    const double rate = qBound(
+        0.0, parser.value(QStringLiteral("load-fault-rate")).toDouble(), 0.2);
+    options->fatalErrorRate = rate;
+    options->earlyDisconnectRate = rate;
+    options->noRemoteProgram2Rate = rate;
+    options->noRemoteProgramRate = rate;
+    options->railFailureRate = rate;
+  }
+  return true;
+}
+
+RdcLoadTest::RdcLoadTest(const RdcLoadTestOptions &options, QObject *parent)
+    : QObject(parent), m_options(options), m_random(options.seed),
+      m_bitmapCache(m_cacheDir.filePath(QStringLiteral("bitmap")), &m_metrics),
+      m_started(0), m_ended(0), m_peakLive(0), m_baseRss(-1), m_peakRss(-1),
+      m_elapsedNs(0), m_retainedWindows(0), m_retainedLaunches(0),
+      m_leakedControls(0), m_leakedSubObjects(0),
+      m_finished(false) {
+  for (auto &row : m_outcomes) {
+    std::fill_n(row, int(OutcomeCount), 0);
+  }
+  m_probeTimer.setInterval(10);
+  connect(&m_probeTimer, &QTimer::timeout, this, &RdcLoadTest::probeDispatch);
+  m_timeoutTimer.setInterval(1000);
+  connect(&m_timeoutTimer, &QTimer::timeout, this,
+          &RdcLoadTest::checkTimeouts);
+}
+
+RdcLoadTest::~RdcLoadTest() {
+  for (Run *run : m_runs) {
+    delete run->session;
+    delete run;
+  }
+  qDeleteAll(m_caches);
+}
+
+void RdcLoadTest::start() {
+  qDebug() << "Load test:" << m_options.sessions << "sessions,"
+           << m_options.concurrency << "concurrent, seed" << m_options.seed;
+  m_baseRss = residentBytes();
+  m_peakRss = m_baseRss;
+  m_clock.start();
+  m_probeTimer.start();
+  m_timeoutTimer.start();
+  startSessions();
+}
+
+void RdcLoadTest::startSessions() {
+  while (m_runs.size() < m_options.concurrency &&
+         m_started < m_options.sessions) {
+    startSession();
+  }
+  if (m_runs.size() > m_peakLive) {
+    m_peakLive = m_runs.size();
+    m_peakRss = qMax(m_peakRss, residentBytes());
+  }
+}
+
+RdcLoadTest::Fault RdcLoadTest::pickFault(bool remoteApp) {
+  double u = m_random.generateDouble();
+  const double rates[FaultCount] = {
+      0.0,
+      m_options.fatalErrorRate,
+      m_options.earlyDisconnectRate,
+      remoteApp ? m_options.noRemoteProgram2Rate : 0.0,
+      remoteApp ? m_options.noRemoteProgramRate : 0.0,
+      remoteApp ? m_options.railFailureRate : 0.0};
+  for (int fault = FatalError; fault < FaultCount; ++fault) {
+    if (u < rates[fault]) {
+      return Fault(fault);
+    }
+    u -= rates[fault];
+  }
+  return NoFault;
+}
+
+RdpCapabilityCache *RdcLoadTest::capabilityCache(const QString &version) {
+  // 能力缓存每个文件只记一个控件版本，不同的故障版本各用一个
+  RdpCapabilityCache *&cache = m_caches[version];
+  if (!cache) {
+    cache = new RdpCapabilityCache(
+        m_cacheDir.filePath(QStringLiteral("caps-%1.json").arg(m_caches.size())));
+  }
+  return cache;
+}
+
+void RdcLoadTest::startSession() {
+  Run *run = new Run;
+  run->id = ++m_started;
+  run->remoteApp = m_random.generateDouble() < m_options.remoteAppRatio;
+  run->fault = pickFault(run->remoteApp);
+  run->startNs = m_clock.nsecsElapsed();
+
+  const int maxDelay = qMax(0, m_options.maxEventDelayMs) + 1;
+  QList<FakeRdpEvent> script;
+  script << FakeRdpEvent{FakeRdpEvent::Connected, m_random.bounded(maxDelay)};
+  switch (run->fault) {
+  case FatalError:
+    script << FakeRdpEvent{FakeRdpEvent::FatalError,
+                           m_random.bounded(maxDelay), 3};
+    break;
+  case EarlyDisconnect:
+    script << FakeRdpEvent{FakeRdpEvent::Disconnected,
+                           m_random.bounded(maxDelay), 0x904};
+    break;
+  default:
+    script << FakeRdpEvent{FakeRdpEvent::LoginComplete,
+                           m_random.bounded(maxDelay)};
+    break;
+  }
+
+  QString version = QStringLiteral("FakeRdpControl/1.0");
+  QStringList unsupported;
+  if (run->fault == NoRemoteProgram2) {
+    version += QStringLiteral("-rp1");
+    unsupported << QStringLiteral("RemoteProgram2");
+  } else if (run->fault == NoRemoteProgram) {
+    version += QStringLiteral("-norail");
+    unsupported << QStringLiteral("RemoteProgram2")
+                << QStringLiteral("RemoteProgram");
+  }
+  const int railDelay = m_random.bounded(maxDelay);
+  const RdpEvent::RailResult railResult =
+      run->fault == RailFailure ? RdpEvent::RailNotInWhitelist : RdpEvent::RailOk;
+
+  RdpSession *session = new RdpSession(this);
+  run->session = session;
+  session->setMetrics(&m_metrics);
+  session->setCapabilityCache(capabilityCache(version));
+  session->setBitmapCache(&m_bitmapCache);
+  session->setPreflightEnabled(false);
+  session->reconnectPolicy()->setEnabled(false);
+  session->setControlFactory(
+      [script, version, unsupported, railDelay, railResult]() {
+        FakeRdpControl *control = new FakeRdpControl();
+        control->setVersion(version);
+        control->setConnectScript(script);
+        control->setUnsupportedSubObjects(unsupported);
+        control->setRemoteProgramResult(railDelay, railResult);
+        return control;
+      });
+
+  RdpSettings settings;
+  settings.server = QStringLiteral("sim-%1.test").arg(run->id % 16);
+  settings.username = QStringLiteral("load");
+  settings.remoteAppMode = run->remoteApp;
+  if (run->remoteApp) {
+    settings.executablePath = QStringLiteral("C:\\Windows\\notepad.exe");
+  }
+  session->setSettings(settings);
+
+  connect(session, &RdpSession::connectionSuccess, this, [this, run]() {
+    run->connected = true;
+    if (!run->remoteApp) {
+      scheduleDisconnect(run);
+    }
+  });
+  connect(session, &RdpSession::remoteAppResult, this,
+          [this, run](const RdpRemoteAppResult &result) {
+            if (!result.ok()) {
+              run->railFailed = true;
+            }
+            scheduleDisconnect(run);
+          });
+  connect(session, &RdpSession::connectionError, this,
+          [this, run]() { endRun(run, Failed); });
+  connect(session, &RdpSession::remoteAppError, this,
+          [this, run]() { endRun(run, Failed); });
+  connect(session, &RdpSession::connectedChanged, this, [this, run]() {
+    if (!run->session->connected()) {
+      endRun(run, run->disconnecting && !run->railFailed ? Completed : Failed);
+    }
+  });
+
+  m_runs.insert(run->id, run);
+  session->connectToServer();
+}
+
+void RdcLoadTest::scheduleDisconnect(Run *run) {
+  if (run->disconnectScheduled) {
+    return;
+  }
+  run->disconnectScheduled = true;
+  const int hold = m_random.bounded(qMax(0, m_options.maxHoldMs) + 1);
+  QTimer::singleShot(hold, run->session, [run]() {
+    run->disconnecting = true;
+    run->session->disconnectFromServer();
+  });
+}
+
+void RdcLoadTest::endRun(Run *run, Outcome outcome) {
+  if (run->ended) {
+    return;
+  }
+  run->ended = true;
+  ++m_ended;
+  ++m_outcomes[run->fault][outcome];
+  m_sessionUs.record((m_clock.nsecsElapsed() - run->startNs) / 1000);
+
+  // 断开后的清理排在事件队列里，两次排队后再检查
+  QMetaObject::invokeMethod(
+      this,
+      [this, run]() {
+        QMetaObject::invokeMethod(
+            this, [this, run]() { inspect(run); }, Qt::QueuedConnection);
+      },
+      Qt::QueuedConnection);
+}
+
+void RdcLoadTest::inspect(Run *run) {
+  // 没有控件池时会话断开后保留控件供重连复用，控件是否泄漏看销毁后
+  // 存活的模拟控件数，这里只检查远程窗口与启动请求
+  RdpSession *session = run->session;
+  if (session->remoteWindowCount() > 0) {
+    ++m_retainedWindows;
+  }
+  if (session->pendingRemoteAppLaunches() > 0 ||
+      session->inFlightRemoteAppLaunches() > 0) {
+    ++m_retainedLaunches;
+  }
+
+  m_runs.remove(run->id);
+  session->deleteLater();
+  delete run;
+
+  if (m_started < m_options.sessions) {
+    startSessions();
+  } else if (m_runs.isEmpty()) {
+    m_elapsedNs = m_clock.nsecsElapsed();
+    // 等待 deleteLater 执行完再统计存活对象
+    QTimer::singleShot(100, this, &RdcLoadTest::finish);
+  }
+}
+
+void RdcLoadTest::probeDispatch() {
+  const qint64 postedNs = m_clock.nsecsElapsed();
+  QMetaObject::invokeMethod(
+      this,
+      [this, postedNs]() {
+        m_dispatchUs.record((m_clock.nsecsElapsed() - postedNs) / 1000);
+      },
+      Qt::QueuedConnection);
+}
+
+void RdcLoadTest::checkTimeouts() {
+  const qint64 now = m_clock.nsecsElapsed();
+  const QList<Run *> runs = m_runs.values();
+  for (Run *run : runs) {
+    if (!run->ended &&
+        now - run->startNs > qint64(m_options.sessionTimeoutMs) * 1000000) {
+      qWarning() << "Load test session" << run->id << "timed out, fault"
+                 << faultName(run->fault);
+      endRun(run, TimedOut);
+    }
+  }
+}
+
+void RdcLoadTest::finish() {
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+  m_probeTimer.stop();
+  m_timeoutTimer.stop();
+  m_leakedControls = FakeRdpControl::liveControls();
+  m_leakedSubObjects = FakeRdpControl::liveSubObjects();
+
+  QTextStream out(stdout);
+  out << report();
+  out.flush();
+
+  int timedOut = 0;
+  for (const auto &row : m_outcomes) {
+    timedOut += row[TimedOut];
+  }
+  emit finished(timedOut > 0 || m_leakedControls > 0 || m_leakedSubObjects > 0
+                    ? 1
+                    : 0);
+}
+
+QString RdcLoadTest::report() const {
+  QString text;
+  QTextStream out(&text);
+  const double seconds = m_elapsedNs / 1e9;
+  out << "load test: " << m_ended << " sessions in "
+      << QString::number(seconds, 'f', 2) << " s ("
+      << QString::number(seconds > 0 ? m_ended / seconds : 0.0, 'f', 1)
+      << " sessions/s), peak " << m_peakLive << " concurrent\n";
+
+  if (m_baseRss >= 0 && m_peakLive > 0) {
+    out << "memory: base " << m_baseRss / 1024 << " KiB, peak "
+        << m_peakRss / 1024 << " KiB, ~"
+        << (m_peakRss - m_baseRss) / m_peakLive / 1024 << " KiB per session\n";
+  } else {
+    out << "memory: not available on this platform\n";
+  }
+
+  out << "event dispatch latency (us): p50 " << m_dispatchUs.percentile(50)
+      << ", p90 " << m_dispatchUs.percentile(90) << ", p99 "
+      << m_dispatchUs.percentile(99) << ", max " << m_dispatchUs.max()
+      << " (" << m_dispatchUs.count() << " samples)\n";
+  const RdpEventRouter *router = RdpEventRouter::instance();
+  out << "control event queue (us): p50 "
+      << router->queueLatency().percentile(50) << ", p99 "
+      << router->queueLatency().percentile(99) << ", max "
+      << router->queueLatency().max() << " (" << router->dispatchedCount()
+      << " dispatched, " << router->droppedCount() << " dropped)\n";
+  out << "session duration (ms): p50 "
+      << QString::number(m_sessionUs.percentile(50) / 1000.0, 'f', 1)
+      << ", p99 "
+      << QString::number(m_sessionUs.percentile(99) / 1000.0, 'f', 1)
+      << ", max " << QString::number(m_sessionUs.max() / 1000.0, 'f', 1)
+      << "\n";
+
+  out << "outcomes (completed / failed / timed out):\n";
+  for (int fault = 0; fault < FaultCount; ++fault) {
+    const int *row = m_outcomes[fault];
+    if (row[Completed] + row[Failed] + row[TimedOut] == 0) {
+      continue;
+    }
+    out << "  " << QString::fromLatin1(faultName(Fault(fault))).leftJustified(18)
+        << row[Completed] << " / " << row[Failed] << " / " << row[TimedOut]
+        << "\n";
+  }
+
+  out << "retained after session end: remote windows " << m_retainedWindows
+      << ", launches " << m_retainedLaunches << "\n";
+  out << "leaked after destroy: controls " << m_leakedControls
+      << ", sub-objects " << m_leakedSubObjects << "\n";
+  return text;
+}
+
+qint64 RdcLoadTest::residentBytes() {
+#if defined(Q_OS_WIN)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return qint64(counters.WorkingSetSize);
+  }
+  return -1;
+#elif defined(Q_OS_LINUX)
+  QFile statm(QStringLiteral("/proc/self/statm"));
+  if (!statm.open(QIODevice::ReadOnly)) {
+    return -1;
+  }
+  const QList<QByteArray> fields = statm.readAll().split(' ');
+  if (fields.size() < 2) {
+    return -1;
+  }
+  return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+  return -1;
+#endif
+}
+
+int RdcLoadTest::runSessionStress(int sessions, QTextStream &out) {
+  const int liveCap = qMin(64, sessions);
+  const int timeoutMs = 30000;
+
+  QTemporaryDir cacheDir;
+  RdpMetrics metrics;
+  RdpCapabilityCache capabilityCache(
+      cacheDir.filePath(QStringLiteral("capabilities.json")));
+  RdpBitmapCache bitmapCache(cacheDir.filePath(QStringLiteral("bitmap")),
+                             &metrics);
+
+  int failures = 0;
+  const qint64 baseRss = residentBytes();
+  QElapsedTimer clock;
+  clock.start();
+
+  out << "session stress: " << sessions << " sessions, base rss "
+      << baseRss / 1024 << " KiB\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+             .arg(QStringLiteral("phase"), -12)
+             .arg(QStringLiteral("ms"), 8)
+             .arg(QStringLiteral("live"), 6)
+             .arg(QStringLiteral("rss KiB/sess"), 13)
+             .arg(QStringLiteral("est KiB/sess"), 13);
+
+  {
+    SessionManager manager;
+    // 连接完成前断开（主机拒绝连接）的脚本，用于第 4 阶段
+    const QList<FakeRdpEvent> refused = {
+        FakeRdpEvent{FakeRdpEvent::Disconnected, 1, 0x204}};
+    bool refuseNewControl = false;
+    manager.setControlFactory([&]() {
+      FakeRdpControl *control = new FakeRdpControl();
+      control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 1},
+                                 FakeRdpEvent{FakeRdpEvent::LoginComplete, 2}});
+      if (refuseNewControl) {
+        control->queueConnectScript(refused);
+      }
+      return control;
+    });
+    manager.setSessionSetup([&](RdpSession *session) {
+      session->setMetrics(&metrics);
+      session->setCapabilityCache(&capabilityCache);
+      session->setBitmapCache(&bitmapCache);
+      session->setPreflightEnabled(false);
+      session->reconnectPolicy()->setEnabled(false);
+    });
+    // 回收器不参与本测试
+    manager.setReapIdleTimeout(-1);
+
+    auto countState = [&](const QList<int> &ids, SessionManager::State state) {
+      int n = 0;
+      for (const int id : ids) {
+        n += manager.state(id) == state ? 1 : 0;
+      }
+      return n;
+    };
+    auto allClosed = [&](const QList<int> &ids) {
+      for (const int id : ids) {
+        RdpSession *session = manager.session(id);
+        if (session && session->connected()) {
+          return false;
+        }
+      }
+      return true;
+    };
+    auto report = [&](const char *phase, qint64 startMs) {
+      const qint64 rss = residentBytes();
+      const qint64 estimated =
+          manager.memoryStats().value(QStringLiteral("total")).toLongLong();
+      out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+                 .arg(QLatin1String(phase), -12)
+                 .arg(clock.elapsed() - startMs, 8)
+                 .arg(manager.liveControlCount(), 6)
+                 .arg(baseRss >= 0 ? QString::number(double(rss - baseRss) /
+                                                         sessions / 1024,
+                                                     'f', 1)
+                                   : QStringLiteral("-"),
+                      13)
+                 .arg(double(estimated) / sessions / 1024, 13, 'f', 1);
+      out.flush();
+    };
+
+    // 1. 只登记：不应创建任何控件
+    qint64 phaseStart = clock.elapsed();
+    QList<int> ids;
+    for (int i = 0; i < sessions; ++i) {
+      QVariantMap settings;
+      settings.insert(QStringLiteral("server"),
+                      QStringLiteral("stress-%1.test").arg(i % 32));
+      settings.insert(QStringLiteral("username"), QStringLiteral("stress"));
+      ids << manager.addSession(settings);
+    }
+    report("register", phaseStart);
+    if (manager.liveControlCount() != 0 || FakeRdpControl::liveControls() != 0) {
+      out << "  FAIL: registering sessions created controls\n";
+      ++failures;
+    }
+
+    // 2. 全部连接
+    phaseStart = clock.elapsed();
+    manager.setMaxLiveControls(sessions);
+    for (const int id : ids) {
+      manager.connectSession(id);
+    }
+    if (!waitUntil(
+            [&]() {
+              return countState(ids, SessionManager::Connected) == sessions;
+            },
+            timeoutMs)) {
+      out << "  FAIL: " << countState(ids, SessionManager::Connected) << " of "
+          << sessions << " sessions connected\n";
+      ++failures;
+    }
+    report("connect", phaseStart);
+
+    // 3. 全部断开后在上限内逐个重连：每次连接都要回收最久未用会话的控件
+    phaseStart = clock.elapsed();
+    for (const int id : ids) {
+      manager.disconnectSession(id);
+    }
+    waitUntil([&]() { return allClosed(ids); }, timeoutMs);
+    manager.setMaxLiveControls(liveCap);
+    int cycled = 0;
+    int peakLive = 0;
+    for (const int id : ids) {
+      if (!manager.connectSession(id)) {
+        continue;
+      }
+      peakLive = qMax(peakLive, manager.liveControlCount());
+      if (!waitUntil(
+              [&]() { return manager.state(id) == SessionManager::Connected; },
+              timeoutMs)) {
+        continue;
+      }
+      manager.disconnectSession(id);
+      if (waitUntil([&]() { return allClosed({id}); }, timeoutMs)) {
+        ++cycled;
+      }
+    }
+    report("cycle", phaseStart);
+    if (cycled != sessions) {
+      out << "  FAIL: " << cycled << " of " << sessions
+          << " sessions reconnected under the cap\n";
+      ++failures;
+    }
+    // 降低上限时已存在的控件不强制回收，之后的连接不得超过上限
+    if (peakLive > liveCap) {
+      out << "  FAIL: " << peakLive << " live controls while cycling, cap "
+          << liveCap << "\n";
+      ++failures;
+    }
+
+    // 4. 连接完成前断开：会话进入失败状态而不是停留在连接中，控件可被
+    //    回收，之后在上限内重新连接成功
+    phaseStart = clock.elapsed();
+    QList<int> refusedIds;
+    for (int i = 0; i < ids.size(); i += 4) {
+      refusedIds << ids.at(i);
+    }
+    int stuck = 0;
+    for (const int id : refusedIds) {
+      RdpSession *session = manager.session(id);
+      FakeRdpControl *control =
+          session ? qobject_cast<FakeRdpControl *>(session->control())
+                  : nullptr;
+      if (control) {
+        control->queueConnectScript(refused);
+      }
+      refuseNewControl = !control;
+      const bool started = manager.connectSession(id);
+      refuseNewControl = false;
+      if (!started ||
+          !waitUntil(
+              [&]() { return manager.state(id) == SessionManager::Failed; },
+              timeoutMs)) {
+        ++stuck;
+      }
+    }
+    if (stuck) {
+      out << "  FAIL: " << stuck << " of " << refusedIds.size()
+          << " refused sessions did not fail\n";
+      ++failures;
+    }
+    int recovered = 0;
+    for (const int id : refusedIds) {
+      if (manager.connectSession(id) &&
+          waitUntil(
+              [&]() { return manager.state(id) == SessionManager::Connected; },
+              timeoutMs)) {
+        ++recovered;
+        peakLive = qMax(peakLive, manager.liveControlCount());
+      }
+      manager.disconnectSession(id);
+      waitUntil([&]() { return allClosed({id}); }, timeoutMs);
+    }
+    report("refused", phaseStart);
+    if (recovered != refusedIds.size() || peakLive > liveCap) {
+      out << "  FAIL: " << recovered << " of " << refusedIds.size()
+          << " refused sessions reconnected, peak " << peakLive
+          << " live controls, cap " << liveCap << "\n";
+      ++failures;
+    }
+
+    // 5. 全部删除
+    phaseStart = clock.elapsed();
+    for (const int id : ids) {
+      manager.removeSession(id);
+    }
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    report("remove", phaseStart);
+    if (manager.count() != 0 || manager.liveControlCount() != 0) {
+      out << "  FAIL: " << manager.count() << " sessions and "
+          << manager.liveControlCount() << " live controls after remove\n";
+      ++failures;
+    }
+  }
+  QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+  out << "leaked after destroy: controls " << FakeRdpControl::liveControls()
+      << ", sub-objects " << FakeRdpControl::liveSubObjects() << "\n";
+  if (FakeRdpControl::liveControls() != 0 ||
+      FakeRdpControl::liveSubObjects() != 0) {
+    ++failures;
+  }
+  out << (failures ? "session stress: FAILED\n" : "session stress: ok\n");
+  out.flush();
+  return failures ? 1 : 0;
+}
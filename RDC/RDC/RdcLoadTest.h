@@ -0,0 +1,132 @@
+#ifndef RDCLOADTEST_H
+#define RDCLOADTEST_H
+
+#include "RdpBitmapCache.h"
+#include "RdpMetrics.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTimer>
+
+class QCommandLineParser;
+class QTextStream;
+class RdpCapabilityCache;
+class RdpSession;
+
+// 负载测试参数，比例均为 [0, 1]
+struct RdcLoadTestOptions {
+  int sessions = 1000;
+  int concurrency = 100;        // 同时存在的会话数上限
+  quint32 seed = 1;
+  int maxEventDelayMs = 20;     // 模拟控件各事件之间的随机延迟上限
+  int maxHoldMs = 50;           // 登录后保持连接的随机时长上限
+  int sessionTimeoutMs = 30000; // 超过则视为卡住
+  double remoteAppRatio = 0.5;
+  // 故障注入
+  double fatalErrorRate = 0.02;      // 登录前 OnFatalError
+  double earlyDisconnectRate = 0.02; // 登录前断开
+  double noRemoteProgram2Rate = 0.05; // 只有 RemoteProgram（回退路径）
+  double noRemoteProgramRate = 0.02;  // 不支持 RemoteApp
+  double railFailureRate = 0.02;      // OnRemoteProgramResult 返回错误
+};
+
+// 合成负载测试
+// 用模拟控件驱动大量 RdpSession 走完 配置 -> 连接 -> 登录 -> RemoteApp ->
+// 断开，事件延迟随机并按比例注入故障。报告吞吐量、每会话内存、事件分发
+// 延迟分位数，以及会话结束后仍记录的远程窗口 / 未完成的启动和销毁后
+// 仍存活的模拟控件与子对象（泄漏）。
+class RdcLoadTest : public QObject {
+  Q_OBJECT
+
+public:
+  enum Fault {
+    NoFault,
+    FatalError,
+    EarlyDisconnect,
+    NoRemoteProgram2,
+    NoRemoteProgram,
+    RailFailure,
+    FaultCount
+  };
+  enum Outcome { Completed, Failed, TimedOut, OutcomeCount };
+
+  // 向 parser 添加 --load-test 等选项
+  static void addOptions(QCommandLineParser &parser);
+  // 未指定 --load-test 时返回 false
+  static bool readOptions(const QCommandLineParser &parser,
+                          RdcLoadTestOptions *options);
+
+  // SessionManager 压力测试：登记 sessions 个会话（不应创建控件），全部
+  // 连接，再在控件数上限下逐个重连，让四分之一的会话在连接完成前被断开
+  // （应进入失败状态并可再次连接），最后全部删除。报告各阶段每会话的
+  // 常驻内存与估算内存；超时、超过上限或有对象泄漏时返回 1
+  static int runSessionStress(int sessions, QTextStream &out);
+
+  explicit RdcLoadTest(const RdcLoadTestOptions &options,
+                       QObject *parent = nullptr);
+  ~RdcLoadTest();
+
+  void start();
+  QString report() const;
+
+signals:
+  // 全部会话结束；有超时或泄漏时 exitCode 为 1
+  void finished(int exitCode);
+
+private slots:
+  void startSessions();
+  void probeDispatch();
+  void checkTimeouts();
+
+private:
+  struct Run {
+    int id = 0;
+    RdpSession *session = nullptr;
+    Fault fault = NoFault;
+    bool remoteApp = false;
+    bool connected = false;
+    bool railFailed = false;
+    bool disconnectScheduled = false;
+    bool disconnecting = false; // 由负载测试主动断开
+    bool ended = false;
+    qint64 startNs = 0;
+  };
+
+  void startSession();
+  Fault pickFault(bool remoteApp);
+  RdpCapabilityCache *capabilityCache(const QString &version);
+  void scheduleDisconnect(Run *run);
+  void endRun(Run *run, Outcome outcome);
+  void inspect(Run *run);
+  void finish();
+  static qint64 residentBytes();
+
+  RdcLoadTestOptions m_options;
+  QRandomGenerator m_random;
+  RdpMetrics m_metrics; // 不计入界面与 /metrics 的全局统计
+  QTemporaryDir m_cacheDir; // 能力缓存文件，不写入用户的缓存目录
+  QHash<QString, RdpCapabilityCache *> m_caches; // 控件版本 -> 能力缓存
+  RdpBitmapCache m_bitmapCache; // 模拟主机的位图缓存目录，同样放在临时目录
+  QHash<int, Run *> m_runs;
+  QTimer m_probeTimer;
+  QTimer m_timeoutTimer;
+  QElapsedTimer m_clock;
+  RdpLatencyHistogram m_dispatchUs;  // 排队事件从投递到执行的延迟
+  RdpLatencyHistogram m_sessionUs;   // 会话从连接到结束的耗时
+  int m_started;
+  int m_ended;
+  int m_peakLive;
+  qint64 m_baseRss;
+  qint64 m_peakRss;
+  qint64 m_elapsedNs;
+  int m_outcomes[FaultCount][OutcomeCount];
+  int m_retainedWindows;     // 会话结束后仍记录着远程窗口
+  int m_retainedLaunches;    // 会话结束后仍有待发或未返回的启动
+  int m_leakedControls;      // 全部会话销毁后仍存活
+  int m_leakedSubObjects;
+  bool m_finished;
+};
+
+#endif // RDCLOADTEST_H
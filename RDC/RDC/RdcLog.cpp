@@ -0,0 +1,484 @@
+#include "RdcLog.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace RdcLog {
+
+namespace {
+
+const quint64 kCapacity = 4096; // 必须是 2 的幂
+const quint64 kMask = kCapacity - 1;
+
+struct Slot {
+  std::atomic<quint64> sequence;
+  Record record;
+};
+
+// 有界多生产者单消费者队列：槽位序号等于写入位置时可写，
+// 等于写入位置 + 1 时可读，读完后推进到下一圈
+struct Logger {
+  Logger() {
+    for (quint64 i = 0; i < kCapacity; ++i) {
+      ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  Slot ring[kCapacity];
+  std::atomic<quint64> enqueuePos{0};
+  quint64 dequeuePos = 0; // 只由写线程访问
+  std::atomic<bool> running{false};
+  std::atomic<bool> writerIdle{false};
+  std::atomic<quint64> written{0};
+  std::atomic<quint64> dropped{0};
+
+  QMutex mutex;
+  QWaitCondition wake;
+  QThread *thread = nullptr;
+  QFile file;
+};
+
+Logger &logger() {
+  static Logger instance;
+  return instance;
+}
+
+char levelChar(int level) {
+  switch (level) {
+  case Debug:
+    return 'D';
+  case Info:
+    return 'I';
+  case Warning:
+    return 'W';
+  default:
+    return 'C';
+  }
+}
+
+const char *categoryName(unsigned category) {
+  switch (category) {
+  case Connect:
+    return "connect";
+  case RemoteApp:
+    return "remoteapp";
+  case Control:
+    return "control";
+  case Preflight:
+    return "preflight";
+  default:
+    return "general";
+  }
+}
+
+QByteArray formatLine(const Record &record) {
+  const QString line =
+      QStringLiteral("%1 %2 [%3] #%4 %5\n")
+          .arg(QDateTime::fromMSecsSinceEpoch(record.timestampMs)
+                   .toString(QStringLiteral("yyyy-MM-dd HH:mm:ss.zzz")))
+          .arg(QLatin1Char(levelChar(record.level)))
+          .arg(QLatin1String(categoryName(record.category)))
+          .arg(record.sessionId)
+          .arg(record.message());
+  return line.toUtf8();
+}
+
+// 取出所有已发布的记录，返回写出的条数
+int drain(Logger &log) {
+  int count = 0;
+  for (;;) {
+    Slot &slot = log.ring[log.dequeuePos & kMask];
+    if (slot.sequence.load(std::memory_order_acquire) != log.dequeuePos + 1) {
+      break;
+    }
+    const QByteArray line = formatLine(slot.record);
+    if (log.file.isOpen()) {
+      log.file.write(line);
+    } else {
+      fwrite(line.constData(), 1, size_t(line.size()), stderr);
+    }
+    slot.sequence.store(log.dequeuePos + kCapacity, std::memory_order_release);
+    ++log.dequeuePos;
+    ++count;
+  }
+  if (count > 0) {
+    if (log.file.isOpen()) {
+      log.file.flush();
+    } else {
+      fflush(stderr);
+    }
+    log.written.fetch_add(quint64(count), std::memory_order_relaxed);
+  }
+  return count;
+}
+
+void writerLoop() {
+  Logger &log = logger();
+  while (log.running.load(std::memory_order_acquire)) {
+    if (drain(log) > 0) {
+      continue;
+    }
+    // 空闲时等待生产者唤醒；超时兜底丢失的唤醒
+    log.mutex.lock();
+    log.writerIdle.store(true, std::memory_order_release);
+    log.wake.wait(&log.mutex, 50);
+    log.writerIdle.store(false, std::memory_order_release);
+    log.mutex.unlock();
+  }
+  drain(log);
+}
+
+} // namespace
+
+void Record::add(double value) {
+  if (argCount >= MaxArgs) {
+    return;
+  }
+  Arg &arg = args[argCount++];
+  arg.type = Double;
+  arg.d = value;
+}
+
+void Record::addInt(qint64 value) {
+  if (argCount >= MaxArgs) {
+    return;
+  }
+  Arg &arg = args[argCount++];
+  arg.type = Int;
+  arg.i = value;
+}
+
+void Record::addText(const char *value, int length) {
+  if (argCount >= MaxArgs) {
+    return;
+  }
+  // 超出内联缓冲区的部分截断
+  length = qMin(length, int(TextSize) - int(textUsed));
+  Arg &arg = args[argCount++];
+  arg.type = Text;
+  arg.offset = textUsed;
+  arg.length = quint16(qMax(0, length));
+  if (arg.length > 0) {
+    memcpy(text + textUsed, value, arg.length);
+    textUsed += arg.length;
+  }
+}
+
+QString Record::message() const {
+  QString result = QString::fromUtf8(format);
+  for (int i = 0; i < argCount; ++i) {
+    const Arg &arg = args[i];
+    switch (arg.type) {
+    case Int:
+      result = result.arg(arg.i);
+      break;
+    case Double:
+      result = result.arg(arg.d);
+      break;
+    case Text:
+      result = result.arg(QString::fromUtf8(text + arg.offset, arg.length));
+      break;
+    }
+  }
+  return result;
+}
+
+void start(const QString &filePath) {
+  Logger &log = logger();
+  if (log.running.load()) {
+    return;
+  }
+
+  if (!filePath.isEmpty()) {
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    log.file.setFileName(filePath);
+    if (!log.file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      qWarning() << "Cannot open log file" << filePath << ", using stderr";
+    }
+  }
+
+  // 应用退出时兜底停止写线程，避免静态析构时线程仍在运行
+  static bool postRoutineAdded = false;
+  if (!postRoutineAdded) {
+    qAddPostRoutine(&stop);
+    postRoutineAdded = true;
+  }
+
+  log.running.store(true, std::memory_order_release);
+  log.thread = QThread::create(&writerLoop);
+  log.thread->setObjectName(QStringLiteral("RdcLogWriter"));
+  log.thread->start(QThread::LowPriority);
+}
+
+void stop() {
+  Logger &log = logger();
+  if (!log.running.exchange(false)) {
+    return;
+  }
+  log.wake.wakeOne();
+  log.thread->wait();
+  delete log.thread;
+  log.thread = nullptr;
+  log.file.close();
+}
+
+bool isRunning() { return logger().running.load(std::memory_order_acquire); }
+
+Stats stats() {
+  Stats result;
+  result.written = logger().written.load(std::memory_order_relaxed);
+  result.dropped = logger().dropped.load(std::memory_order_relaxed);
+  return result;
+}
+
+Record *acquire() {
+  Logger &log = logger();
+  if (!log.running.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  quint64 pos = log.enqueuePos.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot &slot = log.ring[pos & kMask];
+    const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+    const qint64 diff = qint64(sequence) - qint64(pos);
+    if (diff == 0) {
+      if (log.enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+        slot.record.ringPosition = pos;
+        return &slot.record;
+      }
+    } else if (diff < 0) {
+      // 缓冲区已满：丢弃，调用线程不等待
+      log.dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      pos = log.enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void publish(Record *record) {
+  Logger &log = logger();
+  const quint64 pos = record->ringPosition;
+  log.ring[pos & kMask].sequence.store(pos + 1, std::memory_order_release);
+  if (log.writerIdle.load(std::memory_order_acquire)) {
+    log.wake.wakeOne();
+  }
+}
+
+void writeSync(const Record &record) {
+  const QString message = QStringLiteral("[%1] #%2 %3")
+                              .arg(QLatin1String(categoryName(record.category)))
+                              .arg(record.sessionId)
+                              .arg(record.message());
+  switch (record.level) {
+  case Debug:
+  case Info:
+    qDebug().noquote() << message;
+    break;
+  case Warning:
+    qWarning().noquote() << message;
+    break;
+  default:
+    qCritical().noquote() << message;
+    break;
+  }
+}
+
+Record *begin(Record *record, Level level, Category category, int sessionId,
+              const char *format) {
+  record->timestampMs = QDateTime::currentMSecsSinceEpoch();
+  record->format = format;
+  record->sessionId = sessionId;
+  record->level = quint8(level);
+  record->category = category;
+  record->argCount = 0;
+  record->textUsed = 0;
+  return record;
+}
+
+namespace {
+
+FILE *s_benchmarkFile = nullptr;
+
+// 与 Qt 默认处理函数相同：在调用线程上格式化并同步写出
+void benchmarkMessageHandler(QtMsgType type, const QMessageLogContext &context,
+                             const QString &message) {
+  const QByteArray line =
+      qFormatLogMessage(type, context, message).toLocal8Bit() + '\n';
+  fwrite(line.constData(), 1, size_t(line.size()), s_benchmarkFile);
+  fflush(s_benchmarkFile);
+}
+
+// 等待写线程处理完 target 条记录（含丢弃）
+void waitForWriter(quint64 target) {
+  for (;;) {
+    const Stats current = stats();
+    if (current.written + current.dropped >= target) {
+      return;
+    }
+    QThread::yieldCurrentThread();
+  }
+}
+
+void printRow(QTextStream &out, const char *mode, QVector<qint64> &samples,
+              const QString &note) {
+  std::sort(samples.begin(), samples.end());
+  qint64 sum = 0;
+  for (const qint64 ns : samples) {
+    sum += ns;
+  }
+  auto at = [&samples](double p) {
+    return samples.isEmpty()
+               ? qint64(0)
+               : samples.at(qMin(samples.size() - 1,
+                                 int(samples.size() * p / 100)));
+  };
+  out << QStringLiteral("  %1 %2 %3 %4 %5  %6\n")
+             .arg(QLatin1String(mode), -22)
+             .arg(samples.isEmpty() ? 0 : sum / samples.size(), 9)
+             .arg(at(50), 9)
+             .arg(at(99), 9)
+             .arg(samples.isEmpty() ? 0 : samples.last(), 10)
+             .arg(note);
+  out.flush();
+}
+
+} // namespace
+
+void runBenchmark(int records, QTextStream &out) {
+  // 一次连接中的日志量：每批之后等写线程追上，缓冲区不会满
+  const int burst = 256;
+  const int threads = 4;
+  const QString server = QStringLiteral("rdp-gateway.corp.example");
+  const QString user = QStringLiteral("CORP\\alice");
+  const int port = 3389;
+
+  QTemporaryDir dir;
+  const QString qdebugPath = dir.filePath(QStringLiteral("qdebug.log"));
+  const QString ringPath = dir.filePath(QStringLiteral("rdclog.log"));
+  stop();
+
+  out << "log benchmark: " << records << " records per row, ns per record on "
+      << "the calling thread\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5  %6\n")
+             .arg(QStringLiteral("path"), -22)
+             .arg(QStringLiteral("mean"), 9)
+             .arg(QStringLiteral("p50"), 9)
+             .arg(QStringLiteral("p99"), 9)
+             .arg(QStringLiteral("max"), 10)
+             .arg(QStringLiteral("note"));
+
+  QVector<qint64> samples;
+  samples.reserve(records);
+  QElapsedTimer timer;
+
+  // 1. 原来的 qDebug 路径，处理函数同步写文件
+  s_benchmarkFile = fopen(QFile::encodeName(qdebugPath).constData(), "ab");
+  if (s_benchmarkFile) {
+    const QtMessageHandler previous =
+        qInstallMessageHandler(&benchmarkMessageHandler);
+    timer.start();
+    for (int i = 0; i < records; ++i) {
+      const qint64 before = timer.nsecsElapsed();
+      qDebug() << "Connecting to" << server << ":" << port << "as" << user
+               << "(attempt" << i << ")";
+      samples.append(timer.nsecsElapsed() - before);
+    }
+    qInstallMessageHandler(previous);
+    fclose(s_benchmarkFile);
+    s_benchmarkFile = nullptr;
+    printRow(out, "qDebug (sync file)", samples, QString());
+  }
+
+  // 2. 环形缓冲区，分批写入
+  start(ringPath);
+  samples.clear();
+  quint64 target = stats().written + stats().dropped;
+  timer.start();
+  for (int i = 0; i < records; ++i) {
+    const qint64 before = timer.nsecsElapsed();
+    RDC_LOG_INFO(Connect, i, "Connecting to %1:%2 as %3 (attempt %4)", server,
+                 port, user, i);
+    samples.append(timer.nsecsElapsed() - before);
+    if ((i + 1) % burst == 0 || i + 1 == records) {
+      target += quint64((i % burst) + 1);
+      waitForWriter(target);
+    }
+  }
+  const Stats batched = stats();
+  printRow(out, "RDC_LOG (bursts)", samples,
+           QStringLiteral("%1 dropped").arg(batched.dropped));
+
+  // 3. 多个线程持续写入：缓冲区满时丢弃，调用线程不等待写文件
+  QVector<QVector<qint64>> perThread(threads);
+  QList<QThread *> workers;
+  const int perWorker = qMax(1, records / threads);
+  const Stats before = stats();
+  timer.start();
+  for (int t = 0; t < threads; ++t) {
+    QVector<qint64> *mine = &perThread[t];
+    mine->reserve(perWorker);
+    workers << QThread::create([mine, perWorker, t, port, &server, &user]() {
+      QElapsedTimer clock;
+      clock.start();
+      for (int i = 0; i < perWorker; ++i) {
+        const qint64 start = clock.nsecsElapsed();
+        RDC_LOG_INFO(Connect, t, "Connecting to %1:%2 as %3 (attempt %4)",
+                     server, port, user, i);
+        mine->append(clock.nsecsElapsed() - start);
+      }
+    });
+    workers.last()->start();
+  }
+  for (QThread *worker : workers) {
+    worker->wait();
+    delete worker;
+  }
+  const qint64 produceNs = timer.nsecsElapsed();
+  waitForWriter(before.written + before.dropped + quint64(perWorker) * threads);
+  const qint64 drainNs = timer.nsecsElapsed();
+  samples.clear();
+  for (const QVector<qint64> &mine : perThread) {
+    samples += mine;
+  }
+  const Stats flooded = stats();
+  printRow(out, "RDC_LOG (4 threads)", samples,
+           QStringLiteral("%1 dropped, produced in %2 ms, written in %3 ms")
+               .arg(flooded.dropped - before.dropped)
+               .arg(produceNs / 1e6, 0, 'f', 1)
+               .arg(drainNs / 1e6, 0, 'f', 1));
+
+  // 4. 低于 RDC_LOG_MIN_LEVEL 的语句：条件在编译期为假，参数不求值
+  samples.clear();
+  int evaluated = 0;
+  timer.start();
+  for (int i = 0; i < records; ++i) {
+    const qint64 before = timer.nsecsElapsed();
+    RDC_LOG_DEBUG(Connect, i, "Connecting to %1 (attempt %2)", server,
+                  ++evaluated);
+    samples.append(timer.nsecsElapsed() - before);
+  }
+  printRow(out,
+           enabled(Debug, Connect) ? "RDC_LOG_DEBUG (enabled)"
+                                   : "RDC_LOG_DEBUG (compiled out)",
+           samples,
+           QStringLiteral("%1 argument evaluations").arg(evaluated));
+
+  stop();
+}
+
+} // namespace RdcLog
@@ -0,0 +1,161 @@
+#ifndef RDCLOG_H
+#define RDCLOG_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <initializer_list>
+#include <type_traits>
+
+class QTextStream;
+
+// 结构化异步日志
+// 调用线程只把格式串指针与参数拷进无锁环形缓冲区，格式化与写文件都在
+// 后台写线程完成；缓冲区满时丢弃记录而不是阻塞。未调用 start() 时
+// 退回同步的 qDebug 输出。
+//
+// 编译期过滤：RDC_LOG_MIN_LEVEL 以下的级别、不在 RDC_LOG_CATEGORIES
+// 中的类别，其日志语句（含参数求值）会被编译器整体消除。
+
+#ifndef RDC_LOG_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define RDC_LOG_MIN_LEVEL 1 // Info
+#else
+#define RDC_LOG_MIN_LEVEL 0 // Debug
+#endif
+#endif
+
+#ifndef RDC_LOG_CATEGORIES
+#define RDC_LOG_CATEGORIES 0xffffffffu
+#endif
+
+namespace RdcLog {
+
+enum Level { Debug = 0, Info = 1, Warning = 2, Critical = 3 };
+
+enum Category : unsigned {
+  General = 0x01,
+  Connect = 0x02,
+  RemoteApp = 0x04,
+  Control = 0x08,
+  Preflight = 0x10
+};
+
+constexpr bool enabled(Level level, Category category) {
+  return int(level) >= RDC_LOG_MIN_LEVEL &&
+         (unsigned(category) & unsigned(RDC_LOG_CATEGORIES)) != 0;
+}
+
+// 单条记录，写入后由写线程格式化
+struct Record {
+  enum { MaxArgs = 6, TextSize = 192 };
+  enum ArgType : quint8 { Int, Double, Text };
+
+  struct Arg {
+    ArgType type;
+    quint16 offset;
+    quint16 length;
+    union {
+      qint64 i;
+      double d;
+    };
+  };
+
+  qint64 timestampMs;
+  const char *format; // 必须是字符串字面量
+  int sessionId;
+  quint8 level;
+  quint8 argCount;
+  quint16 textUsed;
+  unsigned category;
+  quint64 ringPosition; // 所在环形缓冲区槽位的序号
+  Arg args[MaxArgs];
+  char text[TextSize];
+
+  void add(bool value) { addInt(value ? 1 : 0); }
+  void add(double value);
+  void add(const char *value) {
+    addText(value, value ? int(qstrlen(value)) : 0);
+  }
+  void add(const QByteArray &value) {
+    addText(value.constData(), value.size());
+  }
+  void add(const QString &value) { add(value.toUtf8()); }
+  void add(const QStringList &value) {
+    add(value.join(QLatin1String(", ")));
+  }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value ||
+                          std::is_enum<T>::value>::type
+  add(T value) {
+    addInt(qint64(value));
+  }
+
+  void addInt(qint64 value);
+  void addText(const char *value, int length);
+  QString message() const;
+};
+
+struct Stats {
+  quint64 written = 0;
+  quint64 dropped = 0;
+};
+
+// 启动写线程；filePath 为空时写到标准错误
+void start(const QString &filePath = QString());
+// 写出缓冲区中剩余的记录并停止写线程
+void stop();
+bool isRunning();
+Stats stats();
+
+// 比较调用线程上每条记录的耗时：同步写文件的 qDebug 处理函数与环形
+// 缓冲区（单线程分批、多线程持续写入），以及编译期关闭的语句。会停止
+// 当前的写线程，日志写到临时文件
+void runBenchmark(int records, QTextStream &out);
+
+// 以下供宏使用
+Record *acquire();
+void publish(Record *record);
+// 写线程未启动时的同步输出
+void writeSync(const Record &record);
+Record *begin(Record *record, Level level, Category category, int sessionId,
+              const char *format);
+
+template <typename... Args>
+void write(Level level, Category category, int sessionId, const char *format,
+           const Args &...args) {
+  Record *slot = acquire();
+  if (slot) {
+    begin(slot, level, category, sessionId, format);
+    (void)std::initializer_list<int>{(slot->add(args), 0)...};
+    publish(slot);
+  } else if (!isRunning()) {
+    Record local;
+    begin(&local, level, category, sessionId, format);
+    (void)std::initializer_list<int>{(local.add(args), 0)...};
+    writeSync(local);
+  }
+  // 写线程运行中但缓冲区已满：记录已计入 dropped
+}
+
+} // namespace RdcLog
+
+// 用法：RDC_LOG_DEBUG(RdcLog::Connect, sessionId, "Connecting to %1:%2",
+//                     server, port);
+#define RDC_LOG(level, category, sessionId, ...)                               \
+  do {                                                                         \
+    if (RdcLog::enabled(level, category)) {                                    \
+      RdcLog::write(level, category, sessionId, __VA_ARGS__);                  \
+    }                                                                          \
+  } while (0)
+
+#define RDC_LOG_DEBUG(category, sessionId, ...)                                \
+  RDC_LOG(RdcLog::Debug, category, sessionId, __VA_ARGS__)
+#define RDC_LOG_INFO(category, sessionId, ...)                                 \
+  RDC_LOG(RdcLog::Info, category, sessionId, __VA_ARGS__)
+#define RDC_LOG_WARNING(category, sessionId, ...)                              \
+  RDC_LOG(RdcLog::Warning, category, sessionId, __VA_ARGS__)
+#define RDC_LOG_CRITICAL(category, sessionId, ...)                             \
+  RDC_LOG(RdcLog::Critical, category, sessionId, __VA_ARGS__)
+
+#endif // RDCLOG_H
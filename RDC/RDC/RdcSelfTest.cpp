@@ -0,0 +1,2426 @@
+#include "RdcSelfTest.h"
+#include "FakeRdpControl.h"
+#include "ProfileStore.h"
+#include "RdcTestSupport.h"
+#include "RdcWorker.h"
+#include "RdpClient.h"
+#include "RdpConnectionHistory.h"
+#include "RdpControlPool.h"
+#include "RdpDisplayDebouncer.h"
+#include "RdpLoopbackServer.h"
+#include "RdpMetricsModel.h"
+#include "RdpMetricsServer.h"
+#include "RdpReconnectPolicy.h"
+#include "RdpSession.h"
+#include "RdpWarmup.h"
+#include "SessionManager.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <memory>
+#include <stdexcept>
+
+using RdcTestSupport::waitUntil;
+
+namespace {
+
+// 用 HTTP/1.0 取回本机端点的响应（含状态行）
+QByteArray httpGet(quint16 port, const QByteArray &path) {
+  QTcpSocket socket;
+  socket.connectToHost(QHostAddress::LocalHost, port);
+  QByteArray response;
+  QObject::connect(&socket, &QTcpSocket::readyRead,
+                   [&]() { response += socket.readAll(); });
+  QObject::connect(&socket, &QTcpSocket::connected, [&]() {
+    socket.write("GET " + path + " HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n");
+  });
+  waitUntil(
+      [&]() {
+        return socket.state() == QAbstractSocket::UnconnectedState &&
+               !response.isEmpty();
+      },
+      3000);
+  return response;
+}
+
+// 事件循环的响应：按固定间隔触发的定时器，记录相邻两次触发的最大间隔
+class LoopLatencyProbe {
+public:
+  explicit LoopLatencyProbe(int intervalMs) {
+    QObject::connect(&m_timer, &QTimer::timeout, [this]() {
+      const qint64 now = m_clock.elapsed();
+      m_maxGapMs = qMax(m_maxGapMs, now - m_lastMs);
+      m_lastMs = now;
+    });
+    m_timer.start(intervalMs);
+    m_clock.start();
+  }
+
+  void reset() {
+    m_lastMs = m_clock.elapsed();
+    m_maxGapMs = 0;
+  }
+  qint64 maxGapMs() const { return m_maxGapMs; }
+
+private:
+  QTimer m_timer;
+  QElapsedTimer m_clock;
+  qint64 m_lastMs = 0;
+  qint64 m_maxGapMs = 0;
+};
+
+// 写入 bytes 字节的合成文件并设置修改时间
+bool writeSyntheticFile(const QString &path, qint64 bytes,
+                        const QDateTime &modified) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+  file.write(QByteArray(int(bytes), 'x'));
+  file.flush();
+  return file.setFileTime(modified, QFileDevice::FileModificationTime);
+}
+
+// 按固定间隔依次发出尺寸变化（模拟拖动窗口边框），返回发出全部请求的耗时
+qint64 playResizeStream(RdpDisplayDebouncer *debouncer,
+                        const QVector<RdpDisplaySize> &stream,
+                        int intervalMs) {
+  int next = 0;
+  QTimer timer;
+  QObject::connect(&timer, &QTimer::timeout, [&]() {
+    if (next < stream.size()) {
+      debouncer->request(stream.at(next++));
+    }
+  });
+  QElapsedTimer clock;
+  clock.start();
+  timer.setTimerType(Qt::PreciseTimer);
+  timer.start(intervalMs);
+  waitUntil([&]() { return next >= stream.size(); },
+                         stream.size() * intervalMs * 4 + 2000);
+  return clock.elapsed();
+}
+
+// 从 from 线性变化到 to 的 steps 个尺寸
+QVector<RdpDisplaySize> resizeStream(const RdpDisplaySize &from,
+                                     const RdpDisplaySize &to, int steps) {
+  QVector<RdpDisplaySize> stream;
+  for (int i = 1; i <= steps; ++i) {
+    RdpDisplaySize size;
+    size.width = from.width + (to.width - from.width) * i / steps;
+    size.height = from.height + (to.height - from.height) * i / steps;
+    size.scaleFactor = to.scaleFactor;
+    stream.append(size);
+  }
+  return stream;
+}
+
+} // namespace
+
+RdcSelfTest::Sandbox::Sandbox()
+    : capabilityCache(dir.filePath(QStringLiteral("capabilities.json"))),
+      bitmapCache(dir.filePath(QStringLiteral("bitmap")), &metrics) {}
+
+RdpSession *RdcSelfTest::Sandbox::createSession(
+    const RdpSettings &settings, const RdpControlFactory &factory) {
+  RdpSession *session = new RdpSession;
+  session->setMetrics(&metrics);
+  session->setCapabilityCache(&capabilityCache);
+  session->setBitmapCache(&bitmapCache);
+  session->setPreflightEnabled(false);
+  session->reconnectPolicy()->setEnabled(false);
+  session->setControlFactory(factory);
+  session->setSettings(settings);
+  return session;
+}
+
+RdcSelfTest::RdcSelfTest(QTextStream &out) : m_out(out), m_failures(0) {}
+
+void RdcSelfTest::addOptions(QCommandLineParser &parser) {
+  parser.addOption(
+      {QStringLiteral("self-test"),
+       QString::fromUtf8("用模拟控件运行场景测试，suites 为逗号分隔的测试组"
+                         "（%1）或 all")
+           .arg(suiteNames().join(QLatin1String(", "))),
+       QStringLiteral("suites")});
+}
+
+bool RdcSelfTest::readOptions(const QCommandLineParser &parser,
+                              QStringList *suites) {
+  if (!parser.isSet(QStringLiteral("self-test"))) {
+    return false;
+  }
+  *suites = parser.value(QStringLiteral("self-test"))
+                .split(QLatin1Char(','), Qt::SkipEmptyParts);
+  return true;
+}
+
+const RdcSelfTest::Suite RdcSelfTest::kSuites[] = {
+    {"control-pool", &RdcSelfTest::testControlPool},
+    {"capability-cache", &RdcSelfTest::testCapabilityCache},
+    {"property-plan", &RdcSelfTest::testPropertyPlan},
+    {"metrics", &RdcSelfTest::testMetrics},
+    {"reconnect", &RdcSelfTest::testReconnect},
+    {"session-cache", &RdcSelfTest::testSessionCache},
+    {"worker", &RdcSelfTest::testWorker},
+    {"reaper", &RdcSelfTest::testReaper},
+    {"bitmap-cache", &RdcSelfTest::testBitmapCache},
+    {"warmup", &RdcSelfTest::testWarmup},
+    {"display", &RdcSelfTest::testDisplay},
+    {"throttle", &RdcSelfTest::testThrottle},
+    {"link-tuner", &RdcSelfTest::testLinkTuner},
+    {"remoteapp-queue", &RdcSelfTest::testRemoteAppQueue},
+    {"profile-store", &RdcSelfTest::testProfileStore},
+};
+
+QStringList RdcSelfTest::suiteNames() {
+  QStringList names;
+  for (const Suite &suite : kSuites) {
+    names << QLatin1String(suite.name);
+  }
+  return names;
+}
+
+int RdcSelfTest::run(const QStringList &suites, QTextStream &out) {
+  const bool all =
+      suites.isEmpty() || suites.contains(QStringLiteral("all"));
+  for (const QString &name : suites) {
+    if (name != QLatin1String("all") && !suiteNames().contains(name)) {
+      out << "unknown test suite: " << name << "\n";
+      return 1;
+    }
+  }
+
+  RdcSelfTest test(out);
+  for (const Suite &suite : kSuites) {
+    if (!all && !suites.contains(QLatin1String(suite.name))) {
+      continue;
+    }
+    out << suite.name << ":\n";
+    out.flush();
+    const int before = test.m_failures;
+    QElapsedTimer timer;
+    timer.start();
+    (test.*suite.run)();
+    // 会话与控件的 deleteLater 在下一组测试前完成
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    out << "  " << (test.m_failures == before ? "passed" : "FAILED") << " in "
+        << timer.elapsed() << " ms\n";
+    out.flush();
+  }
+  out << (test.m_failures ? "self-test: FAILED, " : "self-test: ok, ")
+      << test.m_failures << " failed check(s)\n";
+  out.flush();
+  return test.m_failures;
+}
+
+bool RdcSelfTest::check(bool ok, const char *name, const QString &detail) {
+  m_out << (ok ? "  ok    " : "  FAIL  ")
+        << QLatin1String(name).leftJustified(28)
+        << detail << "\n";
+  m_out.flush();
+  if (!ok) {
+    ++m_failures;
+  }
+  return ok;
+}
+
+bool RdcSelfTest::connectAndWait(RdpSession *session, int timeoutMs) {
+  bool done = false;
+  bool ok = false;
+  const bool remoteApp = session->settings().remoteAppMode;
+  QObject context;
+  if (remoteApp) {
+    QObject::connect(session, &RdpSession::remoteAppResult, &context,
+                     [&](const RdpRemoteAppResult &result) {
+                       done = true;
+                       ok = result.ok();
+                     });
+  } else {
+    QObject::connect(session, &RdpSession::connectionSuccess, &context,
+                     [&]() { done = ok = true; });
+  }
+  QObject::connect(session, &RdpSession::connectionError, &context,
+                   [&]() { done = true; });
+  QObject::connect(session, &RdpSession::remoteAppError, &context,
+                   [&]() { done = true; });
+  QObject::connect(session, &RdpSession::connectedChanged, &context, [&]() {
+    if (!session->connected() && !session->connecting() &&
+        !session->isRestoring()) {
+      done = true;
+    }
+  });
+
+  if (!session->connectToServer()) {
+    return false;
+  }
+  waitUntil([&]() { return done; }, timeoutMs);
+  return ok;
+}
+
+bool RdcSelfTest::disconnectAndWait(RdpSession *session, int timeoutMs) {
+  session->disconnectFromServer();
+  return waitUntil([session]() { return !session->connected(); }, timeoutMs);
+}
+
+// 计数工厂驱动的控件池：后台逐个预热到 size，取用的命中与未命中，低于
+// 低水位时补充，归还时重置并保留到高水位；连接失败的会话归还控件
+void RdcSelfTest::testControlPool() {
+  const int liveBefore = FakeRdpControl::liveControls();
+  int created = 0;
+  // 为 true 时新控件的第一次 Connect 在连接完成前断开
+  bool refuseFirstConnect = false;
+  auto factory = [&]() -> RdpControl * {
+    ++created;
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 10},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 20}});
+    if (refuseFirstConnect) {
+      control->queueConnectScript(
+          {FakeRdpEvent{FakeRdpEvent::Disconnected, 10, 0x204}});
+    }
+    return control;
+  };
+
+  {
+    RdpControlPool pool(factory);
+    pool.setSize(3);
+    pool.setLowWatermark(2);
+    pool.setHighWatermark(4);
+    const bool emptyNeeds = pool.needsControls() && pool.acceptsControls();
+
+    // 控件在事件循环空闲时逐个创建，warmUp 本身不阻塞
+    pool.warmUp();
+    const int createdSync = created;
+    const bool warmed = waitUntil([&]() { return pool.idleCount() == 3; },
+                                  2000);
+    check(emptyNeeds && createdSync == 0 && warmed && created == 3 &&
+              !pool.needsControls(),
+          "warm up",
+          QStringLiteral("%1 created synchronously, %2 idle after warm-up")
+              .arg(createdSync)
+              .arg(pool.idleCount()));
+
+    // 取到低水位不补充，低于低水位后补充到 size
+    QList<RdpControl *> taken;
+    taken << pool.acquire();
+    waitUntil([]() { return false; }, 20);
+    const int idleAtLow = pool.idleCount();
+    taken << pool.acquire();
+    const bool refilled =
+        waitUntil([&]() { return pool.idleCount() == 3; }, 2000);
+    check(idleAtLow == 2 && refilled && created == 5 && pool.hits() == 2 &&
+              pool.misses() == 0,
+          "refill below low watermark",
+          QStringLiteral("%1 idle at the low watermark, %2 created, %3 hit(s)")
+              .arg(idleAtLow)
+              .arg(created)
+              .arg(pool.hits()));
+
+    // 池空时同步创建，计为未命中
+    for (int i = 0; i < 4; ++i) {
+      taken << pool.acquire();
+    }
+    check(pool.hits() == 5 && pool.misses() == 1 && created == 6 &&
+              !taken.contains(nullptr),
+          "miss when empty",
+          QStringLiteral("%1 hit(s), %2 miss(es)")
+              .arg(pool.hits())
+              .arg(pool.misses()));
+    waitUntil([&]() { return pool.idleCount() == 3; }, 2000);
+
+    // 归还时重置；达到高水位后多出的控件被销毁
+    FakeRdpControl *returned = qobject_cast<FakeRdpControl *>(taken.first());
+    returned->setValue("Server", QStringLiteral("pool.test"));
+    const int liveHeld = FakeRdpControl::liveControls() - liveBefore;
+    for (RdpControl *control : taken) {
+      pool.release(control);
+    }
+    check(pool.idleCount() == 4 && !pool.acceptsControls() &&
+              liveHeld == 9 &&
+              FakeRdpControl::liveControls() - liveBefore == 4 &&
+              !returned->value("Server").isValid(),
+          "release to high watermark",
+          QStringLiteral("%1 idle, %2 of %3 control(s) alive")
+              .arg(pool.idleCount())
+              .arg(FakeRdpControl::liveControls() - liveBefore)
+              .arg(liveHeld));
+  }
+  check(FakeRdpControl::liveControls() == liveBefore, "pool destroyed",
+        QStringLiteral("%1 control(s) leaked")
+            .arg(FakeRdpControl::liveControls() - liveBefore));
+
+  // 连接完成前断开（如主机拒绝连接）：会话不再处于连接中，控件重置后归还
+  Sandbox sandbox;
+  RdpControlPool pool(factory);
+  pool.setSize(0);
+  pool.setHighWatermark(2);
+  RdpSettings settings;
+  settings.server = QStringLiteral("refused.test");
+  settings.username = QStringLiteral("pool");
+  RdpSession *session = sandbox.createSession(settings, factory);
+  session->setControlPool(&pool);
+  refuseFirstConnect = true;
+  const bool failed = !connectAndWait(session);
+  const bool returnedToPool =
+      waitUntil([&]() { return pool.idleCount() == 1; }, 2000);
+  check(failed && returnedToPool && !session->connecting() &&
+            !session->connected() && !session->control(),
+        "failed connect returns control",
+        QStringLiteral("%1 idle, session %2")
+            .arg(pool.idleCount())
+            .arg(QLatin1String(session->connecting() ? "still connecting"
+                                                     : "idle")));
+
+  // 下一次连接取用归还的控件，不再创建
+  refuseFirstConnect = false;
+  const int createdBefore = created;
+  const int hitsBefore = pool.hits();
+  const bool connected = connectAndWait(session);
+  check(connected && created == createdBefore &&
+            pool.hits() == hitsBefore + 1,
+        "reuse returned control",
+        QStringLiteral("%1 control(s) created, %2 hit(s)")
+            .arg(created - createdBefore)
+            .arg(pool.hits() - hitsBefore));
+  disconnectAndWait(session);
+  delete session;
+}
+
+// 能力缓存：空缓存时探测并写入磁盘，从同一文件新建的缓存（热启动）不再
+// 探测；控件版本变化时重新探测，会话连接时复用缓存
+void RdcSelfTest::testCapabilityCache() {
+  Sandbox sandbox;
+  const QString path =
+      sandbox.dir.filePath(QStringLiteral("probe-capabilities.json"));
+  auto capsText = [](const RdpCapabilities &caps) {
+    return QStringLiteral("%1 / %2 / %3")
+        .arg(QString::fromLatin1(caps.advancedSettingsInterface),
+             QString::fromLatin1(caps.remoteProgramInterface),
+             QString::fromLatin1(caps.startProgramMethod));
+  };
+
+  // 1. 空缓存：探测全部接口并持久化
+  RdpCapabilities cold;
+  int coldProbes = 0;
+  {
+    RdpCapabilityCache cache(path);
+    FakeRdpControl control;
+    cold = cache.capabilities(&control);
+    coldProbes = cache.probeCount();
+  }
+  check(coldProbes > 0 && QFileInfo::exists(path) &&
+            cold.advancedSettingsInterface == "AdvancedSettings9" &&
+            cold.remoteProgramInterface == "RemoteProgram2" &&
+            cold.startProgramMethod == "ServerStartProgram",
+        "cold probe",
+        QStringLiteral("%1 probe(s): %2").arg(coldProbes).arg(capsText(cold)));
+
+  // 2. 热启动：从同一文件读取，不再调用控件
+  {
+    RdpCapabilityCache cache(path);
+    FakeRdpControl control;
+    const RdpCapabilities warm = cache.capabilities(&control);
+    check(cache.probeCount() == 0 && control.totalCalls() == 0 &&
+              warm.version == cold.version &&
+              warm.advancedSettingsInterface ==
+                  cold.advancedSettingsInterface &&
+              warm.remoteProgramInterface == cold.remoteProgramInterface &&
+              warm.startProgramMethod == cold.startProgramMethod,
+          "warm start",
+          QStringLiteral("%1 probe(s), %2 control call(s)")
+              .arg(cache.probeCount())
+              .arg(control.totalCalls()));
+  }
+
+  // 3. 控件版本变化：缓存作废，重新探测出回退接口并写回磁盘
+  {
+    RdpCapabilityCache cache(path);
+    FakeRdpControl control;
+    control.setVersion(QStringLiteral("FakeRdpControl/2.0-rp1"));
+    control.setUnsupportedSubObjects({QStringLiteral("RemoteProgram2")});
+    const RdpCapabilities changed = cache.capabilities(&control);
+    check(cache.probeCount() > 0 &&
+              changed.version == control.version() &&
+              changed.remoteProgramInterface == "RemoteProgram",
+          "version change",
+          QStringLiteral("%1 probe(s): %2")
+              .arg(cache.probeCount())
+              .arg(capsText(changed)));
+  }
+  {
+    RdpCapabilityCache cache(path);
+    FakeRdpControl control;
+    control.setVersion(QStringLiteral("FakeRdpControl/2.0-rp1"));
+    control.setUnsupportedSubObjects({QStringLiteral("RemoteProgram2")});
+    const RdpCapabilities warm = cache.capabilities(&control);
+    check(cache.probeCount() == 0 && warm.remoteProgramInterface ==
+                                         "RemoteProgram",
+          "new version persisted",
+          QStringLiteral("%1 probe(s)").arg(cache.probeCount()));
+  }
+
+  // 4. 会话：第一个会话的控件探测一次，之后的会话直接使用缓存
+  RdpSettings settings;
+  settings.server = QStringLiteral("capabilities.test");
+  settings.username = QStringLiteral("capabilities");
+  auto factory = []() {
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 5},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 5}});
+    return control;
+  };
+  int probes[2] = {0, 0};
+  for (int i = 0; i < 2; ++i) {
+    RdpSession *session = sandbox.createSession(settings, factory);
+    const int before = sandbox.capabilityCache.probeCount();
+    connectAndWait(session);
+    probes[i] = sandbox.capabilityCache.probeCount() - before;
+    disconnectAndWait(session);
+    delete session;
+  }
+  check(probes[0] > 0 && probes[1] == 0, "session reuse",
+        QStringLiteral("%1 probe(s) for the first session, %2 for the second")
+            .arg(probes[0])
+            .arg(probes[1]));
+}
+
+// 属性计划：值未变化时不调用控件、改一个值只下发一次；会话重连只下发
+// 变化的属性，换用新控件后计划随旧控件清空
+void RdcSelfTest::testPropertyPlan() {
+  // 1. 计划本身：值未变化时不调用控件，改一个值只下发这一个属性
+  {
+    FakeRdpControl control;
+    std::unique_ptr<RdpDispatch> advanced(
+        control.querySubObject("AdvancedSettings9"));
+    RdpPropertyPlan plan;
+    plan.set(RdpPropertyPlan::Control, "Server", QStringLiteral("plan.test"));
+    plan.set(RdpPropertyPlan::Control, "DesktopWidth", 1280);
+    plan.set(RdpPropertyPlan::AdvancedSettings, "RDPPort", 3389);
+    plan.set(RdpPropertyPlan::AdvancedSettings, "Compress", 1);
+    const RdpPropertyPlan::Stats first = plan.apply(&control, advanced.get());
+
+    control.resetCounters();
+    const RdpPropertyPlan::Stats second = plan.apply(&control, advanced.get());
+    check(first.issued == 4 && second.issued == 0 && second.skipped == 4 &&
+              control.totalCalls() == 0,
+          "unchanged apply",
+          QStringLiteral("%1 put(s) first; %2 put(s), %3 control call(s) "
+                         "second")
+              .arg(first.issued)
+              .arg(second.issued)
+              .arg(control.totalCalls()));
+
+    plan.set(RdpPropertyPlan::AdvancedSettings, "RDPPort", 3390);
+    control.resetCounters();
+    const RdpPropertyPlan::Stats third = plan.apply(&control, advanced.get());
+    check(third.issued == 1 && third.resolved == 0 &&
+              control.totalCalls() == 1 && control.callCount("RDPPort") == 1,
+          "one field changed",
+          QStringLiteral("%1 put(s), %2 lookup(s), %3 control call(s)")
+              .arg(third.issued)
+              .arg(third.resolved)
+              .arg(control.totalCalls()));
+  }
+
+  // 2. 会话：同一控件重连时 configureClient 只下发变化的属性。
+  // 属性名与 RdpSession::configureClient 下发的相同（含旧接口的拼写）
+  const char *const configured[] = {
+      "Server", "RDPPort", "UserName", "DesktopWidth", "DesktopHeight",
+      "ColorDepth", "FullScreenTitle", "FullScreen", "Compress",
+      "PersistCacheDirectory", "BitmapPersistence", "BitmapPeristence",
+      "allowDesktopComposition", "PerformanceFlags", "NetworkConnectionType",
+      "AudioRedirectionMode", "RedirectClipboard", "RedirectPrinters"};
+  auto puts = [&configured](FakeRdpControl *control) {
+    int count = 0;
+    for (const char *name : configured) {
+      count += control->callCount(name);
+    }
+    return count;
+  };
+
+  Sandbox sandbox;
+  RdpSettings settings;
+  settings.server = QStringLiteral("plan.test");
+  settings.username = QStringLiteral("plan");
+  QList<FakeRdpControl *> controls;
+  auto factory = [&controls]() {
+    FakeRdpControl *control = new FakeRdpControl();
+    if (controls.isEmpty()) {
+      // 第一个控件只有旧的 IMsTscAdvancedSettings
+      control->setVersion(QStringLiteral("FakeRdpControl/legacy"));
+      control->setUnsupportedSubObjects({QStringLiteral("AdvancedSettings9")});
+    }
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 5},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 5}});
+    controls << control;
+    return control;
+  };
+  RdpSession *session = sandbox.createSession(settings, factory);
+
+  if (!check(connectAndWait(session), "initial connect")) {
+    delete session;
+    return;
+  }
+  const int planned = session->lastApplyStats().issued;
+  disconnectAndWait(session);
+  FakeRdpControl *legacy = controls.first();
+
+  legacy->resetCounters();
+  connectAndWait(session);
+  const RdpPropertyPlan::Stats unchanged = session->lastApplyStats();
+  check(controls.size() == 1 && unchanged.issued == 0 &&
+            unchanged.skipped == planned && puts(legacy) == 0,
+        "unchanged reconnect",
+        QStringLiteral("%1 put(s) to the control, %2 skipped")
+            .arg(puts(legacy))
+            .arg(unchanged.skipped));
+  disconnectAndWait(session);
+
+  // 用户名还决定位图缓存目录，这里只改窗口标题
+  settings.fullScreenTitle = QStringLiteral("Property Plan");
+  session->setSettings(settings);
+  legacy->resetCounters();
+  connectAndWait(session);
+  const RdpPropertyPlan::Stats changed = session->lastApplyStats();
+  check(changed.issued == 1 && puts(legacy) == 1 &&
+            legacy->callCount("FullScreenTitle") == 1,
+        "one setting changed",
+        QStringLiteral("%1 put(s) to the control, %2 FullScreenTitle")
+            .arg(puts(legacy))
+            .arg(legacy->callCount("FullScreenTitle")));
+  disconnectAndWait(session);
+
+  // 3. 换用新控件：计划随旧控件一起清空，新控件收到全部属性，
+  // 不会收到只有旧接口才有的属性名
+  session->releaseIdleControl();
+  connectAndWait(session);
+  FakeRdpControl *modern = controls.size() == 2 ? controls.last() : nullptr;
+  const RdpPropertyPlan::Stats fresh = session->lastApplyStats();
+  check(modern && fresh.issued == planned && fresh.skipped == 0 &&
+            modern->callCount("BitmapPeristence") == 0 &&
+            modern->callCount("BitmapPersistence") == 1,
+        "new control",
+        QStringLiteral("%1 control(s), %2 put(s) of %3, %4 legacy name(s)")
+            .arg(controls.size())
+            .arg(fresh.issued)
+            .arg(planned)
+            .arg(modern ? modern->callCount("BitmapPeristence") : -1));
+  disconnectAndWait(session);
+  delete session;
+}
+
+// 连接统计：脚本化延迟下各阶段的耗时、按主机的直方图、按原因的失败
+// 计数，以及 QML 模型与 /metrics 端点的输出
+void RdcSelfTest::testMetrics() {
+  Sandbox sandbox;
+  const int runs = 5;
+  const int createMs = 10;
+  const int configureMs = 15;
+  const int connectMs = 40;
+  const int loginMs = 60;
+  const int railMs = 30;
+  // 计时器与事件循环的调度误差；登录阶段从 OnConnected 送达时算起，
+  // 可能比脚本间隔略短
+  const qint64 earlyUs = 5000;
+  const qint64 slackUs = 40000;
+
+  RdpSettings good;
+  good.server = QStringLiteral("metrics-a.test");
+  good.username = QStringLiteral("metrics");
+  good.remoteAppMode = true;
+  good.executablePath = QStringLiteral("C:\\Windows\\notepad.exe");
+  for (int i = 0; i < runs; ++i) {
+    RdpSession *session = sandbox.createSession(good, [=]() {
+      // 控件创建的耗时
+      QThread::msleep(createMs);
+      FakeRdpControl *control = new FakeRdpControl();
+      control->setCallLatency("DesktopWidth", configureMs);
+      control->setConnectScript(
+          {FakeRdpEvent{FakeRdpEvent::Connected, connectMs},
+           FakeRdpEvent{FakeRdpEvent::LoginComplete, loginMs}});
+      control->setRemoteProgramResult(railMs, RdpEvent::RailOk);
+      return control;
+    });
+    connectAndWait(session);
+    disconnectAndWait(session);
+    delete session;
+  }
+
+  RdpSettings bad = good;
+  bad.server = QStringLiteral("metrics-b.test");
+  bad.remoteAppMode = false;
+  const QList<QList<FakeRdpEvent>> failures = {
+      {FakeRdpEvent{FakeRdpEvent::Connected, 20},
+       FakeRdpEvent{FakeRdpEvent::FatalError, 10, 516}},
+      {FakeRdpEvent{FakeRdpEvent::Connected, 20},
+       FakeRdpEvent{FakeRdpEvent::FatalError, 10, 516}},
+      {FakeRdpEvent{FakeRdpEvent::Connected, 20},
+       FakeRdpEvent{FakeRdpEvent::FatalError, 10, 516}},
+      {FakeRdpEvent{FakeRdpEvent::Connected, 20},
+       FakeRdpEvent{FakeRdpEvent::Disconnected, 10, 0x904}},
+      {FakeRdpEvent{FakeRdpEvent::Disconnected, 20, 0x904}},
+  };
+  for (const QList<FakeRdpEvent> &script : failures) {
+    RdpSession *session = sandbox.createSession(bad, [script]() {
+      FakeRdpControl *control = new FakeRdpControl();
+      control->setConnectScript(script);
+      return control;
+    });
+    connectAndWait(session);
+    delete session;
+  }
+
+  const RdpMetrics::HostStats *a = sandbox.metrics.hostStats(good.server);
+  const RdpMetrics::HostStats *b = sandbox.metrics.hostStats(bad.server);
+  if (!check(a && b, "hosts recorded",
+             sandbox.metrics.hosts().join(QLatin1String(", ")))) {
+    return;
+  }
+
+  struct Expected {
+    RdpMetrics::Phase phase;
+    qint64 minUs;
+  };
+  const Expected phases[] = {
+      {RdpMetrics::ControlCreate, createMs * 1000},
+      {RdpMetrics::Configure, configureMs * 1000},
+      {RdpMetrics::Connect, connectMs * 1000},
+      {RdpMetrics::Login, loginMs * 1000},
+      {RdpMetrics::RemoteAppStart, railMs * 1000},
+      {RdpMetrics::Total,
+       (createMs + configureMs + connectMs + loginMs + railMs) * 1000},
+  };
+  for (const Expected &expected : phases) {
+    const RdpLatencyHistogram &histogram = a->phases[expected.phase];
+    // 直方图每个 2 的幂区间分 16 个桶，p50 为所在桶的上界
+    const qint64 p50 = histogram.percentile(50);
+    const QByteArray name =
+        "phase " + RdpMetrics::phaseName(expected.phase).toLatin1();
+    check(histogram.count() == quint64(runs) &&
+              histogram.min() >= expected.minUs - earlyUs &&
+              p50 <= expected.minUs + expected.minUs / 16 + slackUs,
+          name.constData(),
+          QStringLiteral("%1 samples, min %2 us, p50 %3 us (scripted %4 us)")
+              .arg(histogram.count())
+              .arg(histogram.min())
+              .arg(p50)
+              .arg(expected.minUs));
+  }
+  check(a->successes == quint64(runs) && a->failures.isEmpty(),
+        "successes", QStringLiteral("%1 ok, %2 failure reasons")
+                         .arg(a->successes)
+                         .arg(a->failures.size()));
+  check(b->successes == 0 &&
+            b->failures.value(QStringLiteral("fatal_516")) == 3 &&
+            b->failures.value(QStringLiteral("disconnect_2308")) == 2,
+        "failures by reason",
+        QStringLiteral("fatal_516 %1, disconnect_2308 %2")
+            .arg(b->failures.value(QStringLiteral("fatal_516")))
+            .arg(b->failures.value(QStringLiteral("disconnect_2308"))));
+
+  // QML 模型：每个主机的每个有样本的阶段一行
+  RdpMetricsModel model(&sandbox.metrics);
+  waitUntil([&]() { return model.count() > 0; }, 1000);
+  int connectRow = -1;
+  for (int row = 0; row < model.count(); ++row) {
+    const QModelIndex idx = model.index(row);
+    if (idx.data(RdpMetricsModel::HostRole).toString() == good.server &&
+        idx.data(RdpMetricsModel::PhaseRole).toString() ==
+            RdpMetrics::phaseName(RdpMetrics::Connect)) {
+      connectRow = row;
+    }
+  }
+  const QModelIndex connectIndex = model.index(connectRow);
+  check(connectRow >= 0 &&
+            connectIndex.data(RdpMetricsModel::SampleCountRole).toInt() ==
+                runs &&
+            connectIndex.data(RdpMetricsModel::P50Role).toDouble() >=
+                connectMs,
+        "model",
+        QStringLiteral("%1 rows, connect p50 %2 ms")
+            .arg(model.count())
+            .arg(connectIndex.data(RdpMetricsModel::P50Role).toDouble()));
+
+  // /metrics 端点
+  RdpMetricsServer server(&sandbox.metrics);
+  if (!check(server.listen(0), "metrics endpoint listen")) {
+    return;
+  }
+  const QByteArray body = httpGet(server.port(), "/metrics");
+  const QByteArray connectCount =
+      "rdc_connect_phase_seconds_count{host=\"metrics-a.test\","
+      "phase=\"connect\"} " +
+      QByteArray::number(runs);
+  const QByteArray fatalCount =
+      "rdc_connections_failed_total{host=\"metrics-b.test\","
+      "reason=\"fatal_516\"} 3";
+  check(body.startsWith("HTTP/1.") && body.contains(" 200 ") &&
+            body.contains(connectCount) && body.contains(fatalCount),
+        "GET /metrics",
+        QStringLiteral("%1 bytes").arg(body.size()));
+  const QByteArray missing = httpGet(server.port(), "/other");
+  check(missing.contains(" 404 "), "GET /other",
+        QString::fromLatin1(missing.left(missing.indexOf('\r'))));
+}
+
+// 自动重连：断开原因分类、退避延迟，注入瞬时断开后复用控件重连并重新
+// 启动应用，连续失败后放弃，终止性断开不重连
+void RdcSelfTest::testReconnect() {
+  typedef RdpReconnectPolicy Policy;
+  check(Policy::classify(0x904) == Policy::Transient &&
+            Policy::classify(0x108) == Policy::Transient &&
+            Policy::classify(0x3) == Policy::Final &&
+            Policy::classify(0x807) == Policy::Final,
+        "classify", QStringLiteral("0x904/0x108 transient, 0x3/0x807 final"));
+  bool backoffOk = true;
+  for (int attempt = 0; attempt < 8; ++attempt) {
+    const int ceiling = qMin(100 << attempt, 1000);
+    const int low = Policy::backoffDelay(attempt, 100, 1000, 0.0);
+    const int high = Policy::backoffDelay(attempt, 100, 1000, 0.999);
+    backoffOk = backoffOk && low == ceiling / 2 && high <= ceiling &&
+                high >= ceiling - ceiling / 100 - 1;
+  }
+  check(backoffOk, "backoff bounds",
+        QStringLiteral("[ceiling/2, ceiling], ceiling = min(100 * 2^n, 1000)"));
+
+  Sandbox sandbox;
+  const int baseDelayMs = 40;
+  const int maxDelayMs = 400;
+  // 计时器与事件循环的调度误差
+  const int slackMs = 30;
+
+  RdpSettings settings;
+  settings.server = QStringLiteral("reconnect.test");
+  settings.username = QStringLiteral("reconnect");
+  settings.remoteAppMode = true;
+  settings.executablePath = QStringLiteral("C:\\Windows\\notepad.exe");
+
+  int created = 0;
+  FakeRdpControl *control = nullptr;
+  RdpSession *session = sandbox.createSession(settings, [&]() {
+    ++created;
+    control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 10},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 20}});
+    control->setRemoteProgramResult(10, RdpEvent::RailOk);
+    return control;
+  });
+  RdpReconnectPolicy *policy = session->reconnectPolicy();
+  policy->setEnabled(true);
+  policy->setBaseDelay(baseDelayMs);
+  policy->setMaxDelay(maxDelayMs);
+  policy->setMaxAttempts(3);
+
+  QList<qint64> scheduledAt;
+  QElapsedTimer clock;
+  clock.start();
+  QObject::connect(session, &RdpSession::reconnectScheduled,
+                   [&]() { scheduledAt << clock.elapsed(); });
+  int launches = 0;
+  QObject::connect(session, &RdpSession::remoteAppResult,
+                   [&](const RdpRemoteAppResult &result) {
+                     launches += result.ok() ? 1 : 0;
+                   });
+  QString lastError;
+  QObject::connect(session, &RdpSession::connectionError,
+                   [&](const QString &error) { lastError = error; });
+
+  if (!check(connectAndWait(session), "initial connect")) {
+    delete session;
+    return;
+  }
+  FakeRdpControl *firstControl = control;
+
+  // 1. 瞬时断开：同一控件重连，属性不再下发，登录后重新启动应用
+  control->resetCounters();
+  control->injectDisconnect(0x904);
+  waitUntil([&]() { return launches >= 2 && !session->isRestoring(); },
+            maxDelayMs + 2000);
+  const RdpPropertyPlan::Stats &stats = session->lastApplyStats();
+  check(scheduledAt.size() == 1 && launches == 2 && session->connected(),
+        "transient disconnect",
+        QStringLiteral("%1 reconnect(s) scheduled, %2 launch result(s)")
+            .arg(scheduledAt.size())
+            .arg(launches));
+  check(created == 1 && control == firstControl &&
+            control->callCount("Connect") == 1,
+        "control reused",
+        QStringLiteral("%1 control(s) created").arg(created));
+  check(stats.issued == 0 && stats.resolved == 0, "unchanged settings skipped",
+        QStringLiteral("%1 put(s), %2 lookup(s), %3 skipped on reconnect")
+            .arg(stats.issued)
+            .arg(stats.resolved)
+            .arg(stats.skipped));
+  check(control->callCount("ServerStartProgram") +
+                control->callCount("ServerStart") ==
+            1,
+        "remoteapp relaunched",
+        QStringLiteral("%1 ServerStartProgram call(s)")
+            .arg(control->callCount("ServerStartProgram")));
+  const RdpMetrics::HostStats *host =
+      sandbox.metrics.hostStats(settings.server);
+  const qint64 restoreMs = session->lastRestoreMs();
+  check(host && host->phases[RdpMetrics::Restore].count() == 1 &&
+            restoreMs >= baseDelayMs / 2 &&
+            restoreMs <= baseDelayMs + 10 + 20 + 10 + slackMs * 2,
+        "time to restore",
+        QStringLiteral("%1 ms (backoff %2-%3 ms + 40 ms script)")
+            .arg(restoreMs)
+            .arg(baseDelayMs / 2)
+            .arg(baseDelayMs));
+
+  // 2. 重连连续失败：按退避间隔重试 maxAttempts 次后放弃
+  scheduledAt.clear();
+  lastError.clear();
+  const QList<FakeRdpEvent> failing = {
+      FakeRdpEvent{FakeRdpEvent::Disconnected, 10, 0x904}};
+  for (int i = 0; i < policy->maxAttempts(); ++i) {
+    control->queueConnectScript(failing);
+  }
+  clock.restart();
+  control->injectDisconnect(0x904);
+  waitUntil([&]() { return !lastError.isEmpty(); }, 3000);
+  bool intervalsOk = scheduledAt.size() == policy->maxAttempts();
+  QStringList intervals;
+  for (int i = 1; i < scheduledAt.size(); ++i) {
+    // 第 i 次重试前的延迟加上脚本中 10 ms 后的断开
+    const qint64 interval = scheduledAt[i] - scheduledAt[i - 1];
+    const int ceiling = qMin(baseDelayMs << (i - 1), maxDelayMs);
+    intervalsOk = intervalsOk && interval >= ceiling / 2 + 10 &&
+                  interval <= ceiling + 10 + slackMs;
+    intervals << QString::number(interval);
+  }
+  check(intervalsOk && !session->isRestoring() && !session->connected(),
+        "gives up after max attempts",
+        QStringLiteral("%1 attempt(s), intervals %2 ms")
+            .arg(scheduledAt.size())
+            .arg(intervals.join(QLatin1String(", "))));
+  const quint64 gaveUp =
+      host ? host->failures.value(QStringLiteral("reconnect_disconnect_2308"))
+           : 0;
+  check(gaveUp == 1, "failure recorded",
+        QStringLiteral("reconnect_disconnect_2308 %1").arg(gaveUp));
+
+  // 3. 终止性断开（服务器注销）：不重连
+  if (connectAndWait(session)) {
+    scheduledAt.clear();
+    control->injectDisconnect(0x3);
+    waitUntil([&]() { return !session->connected(); }, 1000);
+    waitUntil([]() { return false; }, baseDelayMs * 2);
+    check(scheduledAt.isEmpty() && !session->isRestoring(),
+          "final disconnect not retried",
+          QStringLiteral("%1 reconnect(s) scheduled").arg(scheduledAt.size()));
+  } else {
+    check(false, "final disconnect not retried",
+          QStringLiteral("manual connect failed"));
+  }
+  delete session;
+}
+
+// RemoteApp 会话缓存：按主机、用户与重定向设置复用会话，断开的会话
+// 不复用，最后一个应用关闭后按空闲时间回收并计入 evictions
+void RdcSelfTest::testSessionCache() {
+  Sandbox sandbox;
+  const int connectMs = 20;
+  const int loginMs = 40;
+  const int railMs = 10;
+  const int idleTtlMs = 100;
+  const qint64 earlyMs = 5;
+
+  QList<QPointer<FakeRdpControl>> controls;
+  SessionManager manager;
+  manager.setControlFactory([&]() {
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript(
+        {FakeRdpEvent{FakeRdpEvent::Connected, connectMs},
+         FakeRdpEvent{FakeRdpEvent::LoginComplete, loginMs}});
+    control->setRemoteProgramResult(railMs, RdpEvent::RailOk);
+    controls.append(control);
+    return control;
+  });
+  manager.setSessionSetup([&](RdpSession *session) {
+    session->setMetrics(&sandbox.metrics);
+    session->setCapabilityCache(&sandbox.capabilityCache);
+    session->setBitmapCache(&sandbox.bitmapCache);
+    session->setPreflightEnabled(false);
+    session->reconnectPolicy()->setEnabled(false);
+  });
+  manager.setReapIdleTimeout(-1);
+
+  QHash<int, int> results; // 会话 ID -> 成功的启动结果数
+  QObject::connect(&manager, &SessionManager::remoteAppResult,
+                   [&](int sessionId, int, int result) {
+                     if (result == RdpEvent::RailOk) {
+                       ++results[sessionId];
+                     }
+                   });
+  QHash<int, QString> reaped; // 会话 ID -> 原因
+  QObject::connect(&manager, &SessionManager::sessionReaped,
+                   [&](int sessionId, const QString &reason) {
+                     reaped.insert(sessionId, reason);
+                   });
+
+  // 打开应用并等待启动结果，返回会话 ID，*elapsedMs 为打开到结果的耗时
+  auto open = [&](const QVariantMap &settings, qint64 *elapsedMs) {
+    QElapsedTimer timer;
+    timer.start();
+    const QHash<int, int> previous = results;
+    const int sessionId = manager.openRemoteApp(settings);
+    waitUntil(
+        [&]() {
+          return results.value(sessionId) > previous.value(sessionId);
+        },
+        5000);
+    *elapsedMs = timer.elapsed();
+    return sessionId;
+  };
+
+  // 缓存计数器导出到 SessionManager 使用的全局统计，检查增量
+  RdpMetrics *global = RdpMetrics::instance();
+  const double lookupsBefore = global->counter("session_cache_lookups_total");
+  const double hitsBefore = global->counter("session_cache_hits_total");
+  const double savedBefore =
+      global->counter("session_cache_time_saved_seconds_total");
+  const double evictionsBefore =
+      global->counter("session_cache_evictions_total");
+
+  QVariantMap alice;
+  alice.insert(QStringLiteral("server"), QStringLiteral("cache-a.test"));
+  alice.insert(QStringLiteral("username"), QStringLiteral("Alice"));
+  alice.insert(QStringLiteral("remoteAppMode"), true);
+  alice.insert(QStringLiteral("executablePath"),
+               QStringLiteral("C:\\Windows\\notepad.exe"));
+
+  qint64 coldMs = 0;
+  const int first = open(alice, &coldMs);
+  check(results.value(first) == 1 && controls.size() == 1, "cold open",
+        QStringLiteral("%1 ms, %2 control(s)")
+            .arg(coldMs)
+            .arg(controls.size()));
+
+  // 服务器与用户名的大小写、首尾空白不影响键
+  QVariantMap again = alice;
+  again.insert(QStringLiteral("server"), QStringLiteral(" CACHE-A.test"));
+  again.insert(QStringLiteral("username"), QStringLiteral("alice"));
+  again.insert(QStringLiteral("executablePath"),
+               QStringLiteral("C:\\Windows\\System32\\calc.exe"));
+  qint64 hitMs = 0;
+  const int reused = open(again, &hitMs);
+  FakeRdpControl *firstControl = controls.value(0);
+  check(reused == first && controls.size() == 1, "same host reuses session",
+        QStringLiteral("session %1 -> %2, %3 control(s)")
+            .arg(first)
+            .arg(reused)
+            .arg(controls.size()));
+  check(firstControl && firstControl->callCount("Connect") == 1 &&
+            firstControl->remoteWindowCount() == 2,
+        "reuse skips connect",
+        QStringLiteral("Connect %1, %2 window(s)")
+            .arg(firstControl ? firstControl->callCount("Connect") : -1)
+            .arg(firstControl ? firstControl->remoteWindowCount() : -1));
+  check(hitMs < connectMs + loginMs && coldMs >= connectMs + loginMs - earlyMs,
+        "reuse skips login",
+        QStringLiteral("cold %1 ms, reused %2 ms").arg(coldMs).arg(hitMs));
+
+  // 重定向设置不同、用户不同的请求不复用
+  QVariantMap noClipboard = alice;
+  noClipboard.insert(QStringLiteral("enableClipboard"), false);
+  qint64 ms = 0;
+  const int second = open(noClipboard, &ms);
+  QVariantMap bob = alice;
+  bob.insert(QStringLiteral("username"), QStringLiteral("bob"));
+  const int third = open(bob, &ms);
+  check(second != first && third != first && third != second &&
+            controls.size() == 3,
+        "incompatible settings miss",
+        QStringLiteral("sessions %1 %2 %3, %4 control(s)")
+            .arg(first)
+            .arg(second)
+            .arg(third)
+            .arg(controls.size()));
+
+  // 已断开的会话不再复用
+  manager.disconnectSession(third);
+  const int fourth = open(bob, &ms);
+  check(fourth != third && manager.state(fourth) == SessionManager::Connected,
+        "disconnected session not reused",
+        QStringLiteral("session %1 -> %2").arg(third).arg(fourth));
+  // 断开的会话会先于空闲会话被回收，不参与下面的回收检查
+  manager.removeSession(third);
+
+  QVariantMap stats = manager.sessionCacheStats();
+  const qint64 savedMs =
+      stats.value(QStringLiteral("timeSavedMs")).toLongLong();
+  check(stats.value(QStringLiteral("lookups")).toInt() == 5 &&
+            stats.value(QStringLiteral("hits")).toInt() == 1 &&
+            qFuzzyCompare(stats.value(QStringLiteral("hitRate")).toDouble(),
+                          0.2),
+        "hit rate",
+        QStringLiteral("%1/%2 hit(s), rate %3")
+            .arg(stats.value(QStringLiteral("hits")).toInt())
+            .arg(stats.value(QStringLiteral("lookups")).toInt())
+            .arg(stats.value(QStringLiteral("hitRate")).toDouble()));
+  check(savedMs >= connectMs + loginMs - earlyMs, "time saved",
+        QStringLiteral("%1 ms").arg(savedMs));
+  check(global->counter("session_cache_lookups_total") - lookupsBefore == 5 &&
+            global->counter("session_cache_hits_total") - hitsBefore == 1 &&
+            qAbs((global->counter("session_cache_time_saved_seconds_total") -
+                  savedBefore) * 1000 - savedMs) < 1,
+        "counters exported",
+        QStringLiteral("lookups %1, hits %2")
+            .arg(global->counter("session_cache_lookups_total") -
+                 lookupsBefore)
+            .arg(global->counter("session_cache_hits_total") - hitsBefore));
+
+  // 仍有远程窗口的会话不回收；最后一个应用关闭后过了空闲时间才回收
+  manager.setReapIdleTimeout(idleTtlMs);
+  waitUntil([]() { return false; }, idleTtlMs + 50);
+  const int reapedWhileOpen = manager.reapIdleSessions();
+  check(reapedWhileOpen == 0 && reaped.isEmpty(), "open apps kept",
+        QStringLiteral("%1 reaped").arg(reapedWhileOpen));
+
+  if (firstControl) {
+    firstControl->closeRemoteWindows();
+  }
+  waitUntil([&]() { return manager.session(first)->isRemoteAppIdle(); }, 1000);
+  const int reapedEarly = manager.reapIdleSessions();
+  waitUntil([]() { return false; }, idleTtlMs + 50);
+  const int reapedIdle = manager.reapIdleSessions();
+  stats = manager.sessionCacheStats();
+  check(reapedEarly == 0 && reapedIdle == 1 &&
+            reaped.value(first) == QLatin1String("idle_timeout") &&
+            !manager.session(first),
+        "idle session evicted after ttl",
+        QStringLiteral("before ttl %1, after ttl %2, reason %3")
+            .arg(reapedEarly)
+            .arg(reapedIdle)
+            .arg(reaped.value(first)));
+  check(stats.value(QStringLiteral("evictions")).toInt() == 1 &&
+            stats.value(QStringLiteral("size")).toInt() == 2 &&
+            global->counter("session_cache_evictions_total") -
+                    evictionsBefore ==
+                1,
+        "eviction counted",
+        QStringLiteral("%1 eviction(s), %2 cached")
+            .arg(stats.value(QStringLiteral("evictions")).toInt())
+            .arg(stats.value(QStringLiteral("size")).toInt()));
+
+  // 回收后同一主机的请求重新登录
+  const int fifth = open(alice, &ms);
+  check(fifth != first && controls.size() == 5 &&
+            ms >= connectMs + loginMs - earlyMs,
+        "evicted host reconnects",
+        QStringLiteral("session %1, %2 ms").arg(fifth).arg(ms));
+}
+
+// 工作线程：耗时的非界面调用在 RdcWorker 中执行时 GUI 事件循环保持响应，
+// 结果按提交顺序完成并回到 GUI 线程；RdpClient 的异步导入在工作线程
+// 忙碌时同样不阻塞界面
+void RdcSelfTest::testWorker() {
+  Sandbox sandbox;
+  const int callMs = 50;
+  const int calls = 6;
+  const int tickMs = 10;
+  // 响应良好的上限：远小于一次模拟调用的耗时
+  const qint64 responsiveMs = callMs / 2;
+
+  // 模拟控件的一组耗时调用（探测子对象、读写属性），返回调用次数
+  auto slowCalls = [=]() {
+    FakeRdpControl control;
+    control.setDefaultCallLatency(callMs);
+    for (int i = 0; i < calls / 2; ++i) {
+      control.setValue("DesktopWidth", 1024 + i);
+      control.value("DesktopWidth");
+    }
+    return control.totalCalls();
+  };
+
+  LoopLatencyProbe probe(tickMs);
+
+  // 对照：同样的调用在 GUI 线程上执行时事件循环被阻塞
+  bool done = false;
+  QTimer::singleShot(0, [&]() {
+    probe.reset();
+    slowCalls();
+    done = true;
+  });
+  waitUntil([&]() { return done; }, 5000);
+  waitUntil([]() { return false; }, 3 * tickMs);
+  const qint64 blockedGapMs = probe.maxGapMs();
+  check(blockedGapMs >= calls * callMs - tickMs, "gui thread blocks",
+        QStringLiteral("max loop gap %1 ms").arg(blockedGapMs));
+
+  RdcWorker worker;
+  QThread *guiThread = QThread::currentThread();
+  QElapsedTimer timer;
+  timer.start();
+  probe.reset();
+  int result = -1;
+  bool callbackOnGui = false;
+  QObject context;
+  RdcWorker::whenFinished(
+      worker.run<int>(slowCalls), &context, [&](const QFuture<int> &future) {
+        result = future.result();
+        callbackOnGui = QThread::currentThread() == guiThread;
+      });
+  waitUntil([&]() { return result >= 0; }, 5000);
+  const qint64 workerMs = timer.elapsed();
+  check(result >= calls && workerMs >= calls * callMs - tickMs,
+        "slow calls on worker",
+        QStringLiteral("%1 call(s) in %2 ms").arg(result).arg(workerMs));
+  check(probe.maxGapMs() <= responsiveMs, "event loop responsive",
+        QStringLiteral("max loop gap %1 ms (blocked %2 ms)")
+            .arg(probe.maxGapMs())
+            .arg(blockedGapMs));
+  check(callbackOnGui, "completion on gui thread");
+
+  // 任务按提交顺序执行；抛出异常的任务返回 T()，不影响之后的任务
+  QVector<int> order;
+  QList<QFuture<int>> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures << worker.run<int>([&order, i]() {
+      QThread::msleep(10);
+      order << i;
+      return i + 1;
+    });
+  }
+  futures << worker.run<int>([]() -> int { throw std::runtime_error("fail"); });
+  futures << worker.run<int>([]() { return 5; });
+  const int queued = worker.pendingCount();
+  waitUntil([&]() { return worker.pendingCount() == 0; }, 5000);
+  QStringList results;
+  for (const QFuture<int> &future : qAsConst(futures)) {
+    results << QString::number(future.result());
+  }
+  check(queued >= 4 && order == QVector<int>({0, 1, 2}) &&
+            results.join(QLatin1Char(',')) == QLatin1String("1,2,3,0,5"),
+        "ordered results",
+        QStringLiteral("queued %1, results %2")
+            .arg(queued)
+            .arg(results.join(QLatin1Char(','))));
+
+  // 异步导入排在耗时任务之后，等待期间界面保持响应，完成信号回到 GUI 线程
+  const QString path = sandbox.dir.filePath(QStringLiteral("worker.rdp"));
+  QFile file(path);
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write("full address:s:worker.test:3390\r\nusername:s:bob\r\n");
+    file.close();
+  }
+  RdpClient client;
+  int loadedId = 0;
+  bool loadedOk = false;
+  bool loadedOnGui = false;
+  QObject::connect(&client, &RdpClient::rdpFileLoaded,
+                   [&](int requestId, bool ok) {
+                     loadedId = requestId;
+                     loadedOk = ok;
+                     loadedOnGui = QThread::currentThread() == guiThread;
+                   });
+  timer.restart();
+  probe.reset();
+  RdcWorker::instance()->post([=]() { QThread::msleep(calls * callMs); });
+  const int requestId = client.loadRdpFileAsync(path);
+  waitUntil([&]() { return loadedId == requestId; }, 5000);
+  const qint64 loadMs = timer.elapsed();
+  check(loadedOk && loadedOnGui &&
+            client.server() == QLatin1String("worker.test") &&
+            client.port() == 3390,
+        "async import",
+        QStringLiteral("%1:%2 after %3 ms")
+            .arg(client.server())
+            .arg(client.port())
+            .arg(loadMs));
+  check(probe.maxGapMs() <= responsiveMs, "responsive while importing",
+        QStringLiteral("max loop gap %1 ms").arg(probe.maxGapMs()));
+}
+
+// 会话回收：模拟控件报告合成的内存占用，检查每个会话的内存估算，按内存
+// 预算先释放最久未使用的断开会话、不释放连接中的会话，按空闲时间释放，
+// 以及回收事件、统计与释放后重新连接
+void RdcSelfTest::testReaper() {
+  Sandbox sandbox;
+  const qint64 mb = 1024 * 1024;
+  const qint64 subObjectBytes = 512 * 1024;
+  const int idleTimeoutMs = 100;
+  const int baseControls = FakeRdpControl::liveControls();
+
+  int created = 0;
+  SessionManager manager;
+  manager.setControlFactory([&]() {
+    // 各会话的控件占用不同，便于核对释放的字节数
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 5},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 5}});
+    control->setMemoryFootprint((6 + created) * mb);
+    control->setSubObjectFootprint(subObjectBytes);
+    ++created;
+    return control;
+  });
+  manager.setSessionSetup([&](RdpSession *session) {
+    session->setMetrics(&sandbox.metrics);
+    session->setCapabilityCache(&sandbox.capabilityCache);
+    session->setBitmapCache(&sandbox.bitmapCache);
+    session->setPreflightEnabled(false);
+    session->reconnectPolicy()->setEnabled(false);
+  });
+  manager.setReapIdleTimeout(-1);
+  manager.setMemoryBudgetMb(0);
+
+  QHash<int, QString> reaped; // 会话 ID -> 原因
+  QHash<int, qint64> reapedBytes;
+  QObject::connect(&manager, &SessionManager::sessionReaped,
+                   [&](int sessionId, const QString &reason, qint64 bytes) {
+                     reaped.insert(sessionId, reason);
+                     reapedBytes.insert(sessionId, bytes);
+                   });
+  auto total = [&](int sessionId) {
+    return manager.sessionMemory(sessionId)
+        .value(QStringLiteral("total"))
+        .toLongLong();
+  };
+
+  QVariantMap settings;
+  settings.insert(QStringLiteral("username"), QStringLiteral("reaper"));
+  settings.insert(QStringLiteral("desktopWidth"), 800);
+  settings.insert(QStringLiteral("desktopHeight"), 600);
+  settings.insert(QStringLiteral("colorDepth"), 32);
+
+  // 只登记的会话只计设置
+  settings.insert(QStringLiteral("server"), QStringLiteral("reaper-0.test"));
+  const int registered = manager.addSession(settings);
+  const QVariantMap idle = manager.sessionMemory(registered);
+  check(idle.value(QStringLiteral("control")).toLongLong() == 0 &&
+            idle.value(QStringLiteral("settings")).toLongLong() > 0 &&
+            total(registered) ==
+                idle.value(QStringLiteral("settings")).toLongLong(),
+        "registered session",
+        QStringLiteral("%1 bytes").arg(total(registered)));
+
+  QList<int> ids;
+  for (int i = 1; i <= 4; ++i) {
+    settings.insert(QStringLiteral("server"),
+                    QStringLiteral("reaper-%1.test").arg(i));
+    const int id = manager.openSession(settings);
+    waitUntil(
+        [&]() { return manager.state(id) == SessionManager::Connected; },
+        5000);
+    ids << id;
+  }
+
+  const QVariantMap first = manager.sessionMemory(ids.at(0));
+  const qint64 frameBuffer = 800 * 600 * 4;
+  qint64 parts = 0;
+  for (const char *key :
+       {"control", "frameBuffer", "subObjects", "settings", "window"}) {
+    parts += first.value(QLatin1String(key)).toLongLong();
+  }
+  check(first.value(QStringLiteral("control")).toLongLong() == 6 * mb &&
+            first.value(QStringLiteral("subObjects")).toLongLong() ==
+                subObjectBytes &&
+            first.value(QStringLiteral("frameBuffer")).toLongLong() ==
+                frameBuffer &&
+            parts == total(ids.at(0)),
+        "per-session accounting",
+        QStringLiteral("control %1, sub-objects %2, frame buffer %3, total %4")
+            .arg(first.value(QStringLiteral("control")).toLongLong())
+            .arg(first.value(QStringLiteral("subObjects")).toLongLong())
+            .arg(first.value(QStringLiteral("frameBuffer")).toLongLong())
+            .arg(total(ids.at(0))));
+
+  qint64 sum = total(registered);
+  for (const int id : qAsConst(ids)) {
+    sum += total(id);
+  }
+  const qint64 reported =
+      manager.memoryStats().value(QStringLiteral("total")).toLongLong();
+  check(reported == sum, "total accounting",
+        QStringLiteral("%1 / %2 bytes").arg(reported).arg(sum));
+
+  // 预算只超出一个会话：释放最久未使用的断开会话
+  manager.disconnectSession(ids.at(0));
+  manager.disconnectSession(ids.at(1));
+  waitUntil(
+      [&]() {
+        return !manager.session(ids.at(0))->connected() &&
+               !manager.session(ids.at(1))->connected();
+      },
+      5000);
+  const qint64 lruBytes = total(ids.at(0));
+  const qint64 all =
+      manager.memoryStats().value(QStringLiteral("total")).toLongLong();
+  manager.setMemoryBudgetMb(int((all - lruBytes / 2) / mb));
+  check(reaped.size() == 1 &&
+            reaped.value(ids.at(0)) == QLatin1String("memory_budget") &&
+            reapedBytes.value(ids.at(0)) == lruBytes &&
+            !manager.session(ids.at(0)) && manager.session(ids.at(1)),
+        "budget evicts lru disconnected",
+        QStringLiteral("reaped %1 (%2 bytes)")
+            .arg(QStringList(reaped.values()).join(QLatin1Char(',')))
+            .arg(reapedBytes.value(ids.at(0))));
+
+  // 连接中的会话即使超出预算也不释放
+  manager.setMemoryBudgetMb(1);
+  check(reaped.size() == 2 && reaped.contains(ids.at(1)) &&
+            manager.state(ids.at(2)) == SessionManager::Connected &&
+            manager.state(ids.at(3)) == SessionManager::Connected,
+        "connected sessions kept",
+        QStringLiteral("%1 reaped").arg(reaped.size()));
+  manager.setMemoryBudgetMb(0);
+
+  // 断开超过空闲时间才释放
+  manager.disconnectSession(ids.at(2));
+  manager.setReapIdleTimeout(idleTimeoutMs);
+  const int early = manager.reapIdleSessions();
+  waitUntil([]() { return false; }, idleTimeoutMs + 50);
+  const int late = manager.reapIdleSessions();
+  check(early == 0 && late == 1 &&
+            reaped.value(ids.at(2)) == QLatin1String("idle_timeout") &&
+            manager.state(ids.at(3)) == SessionManager::Connected,
+        "idle timeout",
+        QStringLiteral("before timeout %1, after %2").arg(early).arg(late));
+  manager.setReapIdleTimeout(-1);
+
+  const QVariantMap stats = manager.memoryStats();
+  qint64 freed = 0;
+  for (const qint64 bytes : qAsConst(reapedBytes)) {
+    freed += bytes;
+  }
+  check(stats.value(QStringLiteral("reaped")).toInt() == 3 &&
+            stats.value(QStringLiteral("budgetEvictions")).toInt() == 2 &&
+            stats.value(QStringLiteral("idleTimeouts")).toInt() == 1 &&
+            stats.value(QStringLiteral("bytesFreed")).toLongLong() == freed,
+        "reaper stats",
+        QStringLiteral("%1 reaped, %2 bytes freed")
+            .arg(stats.value(QStringLiteral("reaped")).toInt())
+            .arg(stats.value(QStringLiteral("bytesFreed")).toLongLong()));
+  QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+  check(FakeRdpControl::liveControls() - baseControls == 1, "controls freed",
+        QStringLiteral("%1 live")
+            .arg(FakeRdpControl::liveControls() - baseControls));
+
+  // 释放只归还控件，设置保留，可以重新连接
+  manager.connectSession(ids.at(0));
+  waitUntil(
+      [&]() { return manager.state(ids.at(0)) == SessionManager::Connected; },
+      5000);
+  check(manager.state(ids.at(0)) == SessionManager::Connected &&
+            manager.sessionSettings(ids.at(0))
+                    .value(QStringLiteral("server"))
+                    .toString() == QLatin1String("reaper-1.test") &&
+            created == 5,
+        "reaped session reconnects",
+        QStringLiteral("%1 control(s) created").arg(created));
+}
+
+// 位图缓存：用合成的缓存文件检查主机目录名、命中统计、单主机配额按文件
+// 时间淘汰、总配额按最近使用整个删除主机目录且跳过使用中的目录、后台
+// 淘汰与统计
+void RdcSelfTest::testBitmapCache() {
+  Sandbox sandbox;
+  RdpBitmapCache &cache = sandbox.bitmapCache;
+  const qint64 kb = 1024;
+  const QDateTime now = QDateTime::currentDateTimeUtc();
+  const QString marker = QLatin1String(RdpBitmapCache::markerName());
+
+  const QString key = RdpBitmapCache::hostKey(
+      QStringLiteral("Host.Example"), 3389, QStringLiteral("CORP\\Alice"));
+  const QString ipv6 =
+      RdpBitmapCache::hostKey(QStringLiteral("fe80::1"), 3389, QString());
+  static const QRegularExpression safe(QStringLiteral("^[a-z0-9._-]+$"));
+  check(key == RdpBitmapCache::hostKey(QStringLiteral("host.example"), 3389,
+                                       QStringLiteral("corp\\alice")) &&
+            key != RdpBitmapCache::hostKey(QStringLiteral("host.example"),
+                                           3389, QStringLiteral("bob")) &&
+            safe.match(key).hasMatch() && safe.match(ipv6).hasMatch(),
+        "host keys", key + QLatin1String(", ") + ipv6);
+
+  // 新目录未命中；目录中有缓存文件后再次使用计为命中
+  const QString dir = cache.acquire(QStringLiteral("bitmap-a.test"), 3389,
+                                    QStringLiteral("alice"));
+  const bool created =
+      !dir.isEmpty() && QFileInfo::exists(QDir(dir).filePath(marker));
+  writeSyntheticFile(QDir(dir).filePath(QStringLiteral("Cache0000.bin")),
+                     64 * kb, now);
+  cache.release(dir);
+  const QString again = cache.acquire(QStringLiteral("BITMAP-A.test"), 3389,
+                                      QStringLiteral("Alice"));
+  QVariantMap stats = cache.stats();
+  check(created && again == dir &&
+            stats.value(QStringLiteral("lookups")).toInt() == 2 &&
+            stats.value(QStringLiteral("hits")).toInt() == 1 &&
+            sandbox.metrics.counter("bitmap_cache_hits_total") == 1,
+        "acquire and hit",
+        QStringLiteral("%1/%2 hit(s)")
+            .arg(stats.value(QStringLiteral("hits")).toInt())
+            .arg(stats.value(QStringLiteral("lookups")).toInt()));
+
+  // 使用中的目录标记为最旧，仍不应被淘汰
+  QFile inUseMarker(QDir(dir).filePath(marker));
+  if (inUseMarker.open(QIODevice::ReadWrite)) {
+    inUseMarker.setFileTime(now.addDays(-30),
+                            QFileDevice::FileModificationTime);
+    inUseMarker.close();
+  }
+
+  // 合成主机：old 最久未用，mid 其次，big 最近使用但超出单主机配额
+  const QString root = cache.rootPath();
+  auto host = [&](const char *name, int markerDaysAgo, int files,
+                  qint64 fileBytes) {
+    const QString path = root + QLatin1Char('/') + QLatin1String(name);
+    for (int i = 0; i < files; ++i) {
+      // 文件时间越靠后越新，Cache0000 最旧
+      const QString file =
+          QStringLiteral("/Cache%1.bin").arg(i, 4, 10, QLatin1Char('0'));
+      writeSyntheticFile(path + file, fileBytes,
+                         now.addDays(-markerDaysAgo - 1).addSecs(i * 60));
+    }
+    writeSyntheticFile(path + QLatin1Char('/') + marker, 0,
+                       now.addDays(-markerDaysAgo));
+    return path;
+  };
+  const QString oldHost = host("old-host", 10, 4, 50 * kb);  // 200 KiB
+  const QString midHost = host("mid-host", 5, 4, 50 * kb);   // 200 KiB
+  const QString bigHost = host("big-host", 1, 6, 50 * kb);   // 300 KiB
+
+  cache.setHostQuota(200 * kb);
+  cache.setTotalQuota(0);
+  RdpBitmapCacheEviction result = cache.evict();
+  const QStringList bigFiles = QDir(bigHost).entryList(
+      QStringList() << QStringLiteral("Cache*.bin"), QDir::Files, QDir::Name);
+  check(result.evictedFiles == 2 && result.evictedBytes == 100 * kb &&
+            bigFiles == QStringList({QStringLiteral("Cache0002.bin"),
+                                     QStringLiteral("Cache0003.bin"),
+                                     QStringLiteral("Cache0004.bin"),
+                                     QStringLiteral("Cache0005.bin")}),
+        "host quota evicts oldest files",
+        QStringLiteral("%1 file(s), %2 KiB; kept %3")
+            .arg(result.evictedFiles)
+            .arg(result.evictedBytes / kb)
+            .arg(bigFiles.join(QLatin1Char(','))));
+
+  // 总量 64 + 200 + 200 + 200 KiB 超过 500 KiB：删除最久未用的 old-host，
+  // 标记更旧但使用中的目录保留
+  cache.setHostQuota(0);
+  cache.setTotalQuota(500 * kb);
+  result = cache.evict();
+  check(result.removedHosts == 1 && !QFileInfo::exists(oldHost) &&
+            QFileInfo::exists(midHost) && QFileInfo::exists(dir) &&
+            result.totalBytes == 464 * kb && result.hostCount == 3,
+        "total quota evicts lru host",
+        QStringLiteral("%1 host(s) removed, %2 left, %3 KiB")
+            .arg(result.removedHosts)
+            .arg(result.hostCount)
+            .arg(result.totalBytes / kb));
+  cache.release(dir);
+
+  // 后台淘汰：很多小文件的主机目录在工作线程中扫描，完成后更新统计
+  const int manyFiles = 2000;
+  const QString manyHost = root + QStringLiteral("/many-host");
+  for (int i = 0; i < manyFiles; ++i) {
+    const QString name =
+        QStringLiteral("/Cache%1.bin").arg(i, 5, 10, QLatin1Char('0'));
+    writeSyntheticFile(manyHost + name, kb, now.addDays(-2).addSecs(i));
+  }
+  writeSyntheticFile(manyHost + QLatin1Char('/') + marker, 0, now.addDays(-2));
+  cache.setHostQuota(manyFiles * kb / 2);
+  cache.setTotalQuota(0);
+  int evictedFiles = -1;
+  QObject context;
+  QObject::connect(&cache, &RdpBitmapCache::evicted, &context,
+                   [&](int files) { evictedFiles = files; });
+  QElapsedTimer timer;
+  timer.start();
+  cache.evictInBackground();
+  const bool finished = waitUntil([&]() { return evictedFiles >= 0; }, 30000);
+  stats = cache.stats();
+  check(finished && evictedFiles == manyFiles / 2 &&
+            stats.value(QStringLiteral("evictedFiles")).toInt() ==
+                2 + 4 + manyFiles / 2 &&
+            sandbox.metrics.counter("bitmap_cache_evicted_files_total") ==
+                2 + 4 + manyFiles / 2,
+        "background eviction",
+        QStringLiteral("%1 of %2 file(s) in %3 ms")
+            .arg(evictedFiles)
+            .arg(manyFiles)
+            .arg(timer.elapsed()));
+  check(stats.value(QStringLiteral("hostCount")).toInt() == 4 &&
+            stats.value(QStringLiteral("totalBytes")).toLongLong() ==
+                464 * kb + manyFiles / 2 * kb,
+        "cache stats",
+        QStringLiteral("%1 host(s), %2 KiB")
+            .arg(stats.value(QStringLiteral("hostCount")).toInt())
+            .arg(stats.value(QStringLiteral("totalBytes")).toLongLong() / kb));
+}
+
+// 连接预热：按连接历史预测目标，在预算内预检，连接时复用结果并统计
+// 命中率与节省的时间
+void RdcSelfTest::testWarmup() {
+  Sandbox sandbox;
+  const QString loopback = QStringLiteral("127.0.0.1");
+  const int responseDelayMs = 30;
+  const int budgetMs = 400;
+  // 计时器与事件循环的调度误差
+  const int slackMs = 150;
+
+  // 两个可达的监听器、一个接受连接但不回应的监听器，以及预测之外的目标
+  RdpLoopbackServer first;
+  RdpLoopbackServer second;
+  RdpLoopbackServer silent(RdpLoopbackServer::Silent);
+  RdpLoopbackServer unpredicted;
+  if (!check(first.listenLoopback() && second.listenLoopback() &&
+                 silent.listenLoopback() && unpredicted.listenLoopback(),
+             "loopback listeners")) {
+    return;
+  }
+  first.setResponseDelay(responseDelayMs);
+  second.setResponseDelay(responseDelayMs);
+  auto settingsFor = [&](const RdpLoopbackServer &server) {
+    RdpSettings settings;
+    settings.server = loopback;
+    settings.port = server.serverPort();
+    settings.username = QStringLiteral("warmup");
+    return settings;
+  };
+  auto label = [&](const RdpLoopbackServer &server) {
+    return loopback + QLatin1Char(':') + QString::number(server.serverPort());
+  };
+
+  // 合成的历史：前几天同一时刻连接 first 5 次、second 3 次、silent 2 次，
+  // 一个月前相反时刻连接的目标得分最低
+  RdpConnectionHistory history(
+      sandbox.dir.filePath(QStringLiteral("history.journal")));
+  const QDateTime now = QDateTime::currentDateTime();
+  for (int day = 1; day <= 5; ++day) {
+    const QDateTime when = now.addDays(-day);
+    history.record(RdpHistoryEntry::fromSettings(settingsFor(first), when));
+    if (day <= 3) {
+      history.record(RdpHistoryEntry::fromSettings(settingsFor(second), when));
+    }
+    if (day <= 2) {
+      history.record(RdpHistoryEntry::fromSettings(settingsFor(silent), when));
+    }
+  }
+  RdpSettings stale = settingsFor(first);
+  stale.server = QStringLiteral("stale.warmup.test");
+  for (int i = 0; i < 4; ++i) {
+    history.record(RdpHistoryEntry::fromSettings(
+        stale, now.addDays(-30 - i).addSecs(12 * 3600)));
+  }
+
+  QStringList predicted;
+  for (const RdpHistoryTarget &target : history.predict(now, 3)) {
+    predicted << target.server + QLatin1Char(':') +
+                     QString::number(target.port);
+  }
+  const QStringList expected = {label(first), label(second), label(silent)};
+  check(predicted == expected, "prediction order",
+        predicted.join(QLatin1String(", ")));
+
+  RdpWarmup warmup(&history, &sandbox.metrics);
+  warmup.setCandidates(3);
+  warmup.setBudget(budgetMs);
+  int roundProbed = -1;
+  int roundReachable = -1;
+  QObject::connect(&warmup, &RdpWarmup::finished,
+                   [&](int probed, int reachable) {
+                     roundProbed = probed;
+                     roundReachable = reachable;
+                   });
+
+  // 不回应的目标不拖长整轮预热：预算到达时中止
+  QElapsedTimer timer;
+  timer.start();
+  warmup.warmUp();
+  const bool finished =
+      waitUntil([&]() { return roundProbed >= 0; }, budgetMs + 2000);
+  const qint64 roundMs = timer.elapsed();
+  QVariantMap stats = warmup.stats();
+  check(finished && roundProbed == 3 && roundReachable == 2 &&
+            stats.value(QStringLiteral("predicted")).toStringList() ==
+                expected,
+        "warm-up round",
+        QStringLiteral("%1 probed, %2 reachable")
+            .arg(roundProbed)
+            .arg(roundReachable));
+  check(finished && roundMs <= budgetMs + slackMs && !warmup.isRunning(),
+        "within budget",
+        QStringLiteral("%1 ms (budget %2 ms)").arg(roundMs).arg(budgetMs));
+
+  // 连接到已预热的目标：直接使用预检结果，不再连接监听器
+  auto factory = []() {
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 10},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 20}});
+    return control;
+  };
+  RdpSession *session = sandbox.createSession(settingsFor(first), factory);
+  session->setWarmup(&warmup);
+  session->setPreflightEnabled(true);
+  first.resetCounters();
+  const bool connected = connectAndWait(session);
+  const RdpPreflightResult &reused = session->lastPreflightResult();
+  stats = warmup.stats();
+  const qint64 savedMs = stats.value(QStringLiteral("savedMs")).toLongLong();
+  check(connected && reused.ok() && first.connectionCount() == 0 &&
+            stats.value(QStringLiteral("reused")).toInt() == 1 &&
+            reused.negotiateMs >= responseDelayMs - 5 &&
+            savedMs == qMax<qint64>(0, reused.dnsMs) +
+                           qMax<qint64>(0, reused.connectMs) +
+                           reused.negotiateMs,
+        "reuse warmed result",
+        QStringLiteral("%1 ms saved, %2 connection(s) to the listener")
+            .arg(savedMs)
+            .arg(first.connectionCount()));
+
+  // 结果只复用一次：再次连接时重新预检
+  disconnectAndWait(session);
+  const bool reconnected = connectAndWait(session);
+  check(reconnected && first.connectionCount() == 1 &&
+            warmup.stats().value(QStringLiteral("reused")).toInt() == 1,
+        "result taken once",
+        QStringLiteral("%1 connection(s) to the listener")
+            .arg(first.connectionCount()));
+  disconnectAndWait(session);
+  delete session;
+
+  // 预测之外的目标：照常预检，计为未命中
+  session = sandbox.createSession(settingsFor(unpredicted), factory);
+  session->setWarmup(&warmup);
+  session->setPreflightEnabled(true);
+  const bool missConnected = connectAndWait(session);
+  disconnectAndWait(session);
+  delete session;
+  stats = warmup.stats();
+  check(missConnected && unpredicted.connectionCount() == 1 &&
+            stats.value(QStringLiteral("predictedConnects")).toInt() == 3 &&
+            stats.value(QStringLiteral("predictionHits")).toInt() == 2 &&
+            qAbs(stats.value(QStringLiteral("hitRate")).toDouble() -
+                 2.0 / 3.0) < 1e-9,
+        "hit rate",
+        QStringLiteral("%1/%2 predicted connect(s)")
+            .arg(stats.value(QStringLiteral("predictionHits")).toInt())
+            .arg(stats.value(QStringLiteral("predictedConnects")).toInt()));
+  check(sandbox.metrics.counter("warmup_predicted_connects_total") == 3 &&
+            sandbox.metrics.counter("warmup_prediction_hits_total") == 2 &&
+            sandbox.metrics.counter("warmup_reused_total") == 1 &&
+            sandbox.metrics.counter("warmup_saved_ms_total") ==
+                double(savedMs) &&
+            sandbox.metrics.counter("warmup_probes_total") ==
+                stats.value(QStringLiteral("probes")).toDouble(),
+        "counters exported",
+        QStringLiteral("%1 probe(s), %2 reused")
+            .arg(sandbox.metrics.counter("warmup_probes_total"))
+            .arg(sandbox.metrics.counter("warmup_reused_total")));
+
+  // 下一轮只探测结果已取出或失败的目标，仍新鲜的结果不再探测
+  roundProbed = -1;
+  second.resetCounters();
+  warmup.warmUp();
+  waitUntil([&]() { return roundProbed >= 0; }, budgetMs + 2000);
+  check(roundProbed == 2 && roundReachable == 1 &&
+            second.connectionCount() == 0,
+        "fresh results kept",
+        QStringLiteral("%1 probed, %2 connection(s) to the fresh target")
+            .arg(roundProbed)
+            .arg(second.connectionCount()));
+}
+
+// 动态分辨率：尺寸取整，拖动序列的合并与限速，会话中的下发次数与登录前
+// 的窗口尺寸
+void RdcSelfTest::testDisplay() {
+  const int quietMs = 40;
+  const int maxDelayMs = 250;
+  const int minIntervalMs = 120;
+  const int intervalMs = 5;
+  // 计时器与事件循环的调度误差
+  const int slackMs = 60;
+  auto configure = [&](RdpDisplayDebouncer *debouncer) {
+    debouncer->setQuietPeriod(quietMs);
+    debouncer->setMaxDelay(maxDelayMs);
+    debouncer->setMinInterval(minIntervalMs);
+  };
+  auto sizeText = [](const RdpDisplaySize &size) {
+    return QStringLiteral("%1x%2@%3%")
+        .arg(size.width)
+        .arg(size.height)
+        .arg(size.scaleFactor);
+  };
+  RdpDisplaySize small;
+  small.width = 1024;
+  small.height = 768;
+  RdpDisplaySize large;
+  large.width = 1919;
+  large.height = 1201;
+  large.scaleFactor = 125;
+
+  RdpDisplaySize odd;
+  odd.width = 1023;
+  odd.height = 767;
+  odd.scaleFactor = 90;
+  RdpDisplaySize outOfRange;
+  outOfRange.width = 100;
+  outOfRange.height = 9000;
+  outOfRange.scaleFactor = 600;
+  check(odd.snapped().width == 1022 && odd.snapped().height == 767 &&
+            odd.snapped().scaleFactor == 100 &&
+            outOfRange.snapped().width == 200 &&
+            outOfRange.snapped().height == 8192 &&
+            outOfRange.snapped().scaleFactor == 500,
+        "snapped sizes",
+        sizeText(odd.snapped()) + QLatin1String(", ") +
+            sizeText(outOfRange.snapped()));
+
+  // 1. 单次变化：停止变化 quietPeriod 后下发
+  {
+    RdpDisplayDebouncer debouncer;
+    configure(&debouncer);
+    qint64 settledMs = -1;
+    QElapsedTimer clock;
+    QObject::connect(&debouncer, &RdpDisplayDebouncer::settled,
+                     [&]() { settledMs = clock.elapsed(); });
+    clock.start();
+    debouncer.request(large);
+    waitUntil([&]() { return settledMs >= 0; }, quietMs + 2000);
+    check(settledMs >= quietMs - 1 && settledMs <= quietMs + slackMs &&
+              debouncer.applied() == large.snapped(),
+          "quiet period",
+          QStringLiteral("%1 settled after %2 ms (quiet %3 ms)")
+              .arg(sizeText(debouncer.applied()))
+              .arg(settledMs)
+              .arg(quietMs));
+  }
+
+  // 2. 持续拖动：最迟 maxDelay 下发一次，两次下发至少间隔 minInterval，
+  //    停止后下发最终尺寸
+  {
+    RdpDisplayDebouncer debouncer;
+    configure(&debouncer);
+    debouncer.setApplied(small);
+    QList<qint64> settledAt;
+    QList<RdpDisplaySize> settledSizes;
+    QElapsedTimer clock;
+    QObject::connect(&debouncer, &RdpDisplayDebouncer::settled,
+                     [&](const RdpDisplaySize &size) {
+                       settledAt << clock.elapsed();
+                       settledSizes << size;
+                     });
+    const QVector<RdpDisplaySize> stream = resizeStream(small, large, 100);
+    clock.start();
+    const qint64 streamMs = playResizeStream(&debouncer, stream, intervalMs);
+    waitUntil([&]() { return !debouncer.hasPending(); },
+              maxDelayMs + minIntervalMs + 2000);
+    qint64 minGapMs = -1;
+    for (int i = 1; i < settledAt.size(); ++i) {
+      const qint64 gap = settledAt.at(i) - settledAt.at(i - 1);
+      minGapMs = minGapMs < 0 ? gap : qMin(minGapMs, gap);
+    }
+    const RdpDisplayDebouncer::Stats &stats = debouncer.stats();
+    check(settledAt.size() >= 2 &&
+              settledAt.size() <= streamMs / minIntervalMs + 2 &&
+              settledAt.first() <= maxDelayMs + slackMs &&
+              (minGapMs < 0 || minGapMs >= minIntervalMs - 1),
+          "coalesced drag",
+          QStringLiteral("%1 request(s) over %2 ms, %3 settled, first after "
+                         "%4 ms, min gap %5 ms")
+              .arg(stats.requests)
+              .arg(streamMs)
+              .arg(settledAt.size())
+              .arg(settledAt.value(0))
+              .arg(minGapMs));
+    check(!settledSizes.isEmpty() &&
+              settledSizes.last() == stream.last().snapped() &&
+              stats.requests == quint64(stream.size()) &&
+              stats.settled == quint64(settledAt.size()) &&
+              stats.coalesced + stats.settled == stats.requests,
+          "final size",
+          QStringLiteral("%1, %2 coalesced")
+              .arg(settledSizes.isEmpty() ? QString()
+                                          : sizeText(settledSizes.last()))
+              .arg(stats.coalesced));
+  }
+
+  // 3. 拖回原来的尺寸：不下发
+  {
+    RdpDisplayDebouncer debouncer;
+    configure(&debouncer);
+    debouncer.setApplied(small);
+    int settled = 0;
+    QObject::connect(&debouncer, &RdpDisplayDebouncer::settled,
+                     [&]() { ++settled; });
+    QVector<RdpDisplaySize> stream = resizeStream(small, large, 10);
+    stream += resizeStream(large, small, 10);
+    for (const RdpDisplaySize &size : stream) {
+      debouncer.request(size);
+    }
+    waitUntil([]() { return false; }, quietMs + slackMs);
+    check(settled == 0 && !debouncer.hasPending() &&
+              debouncer.stats().coalesced == quint64(stream.size()),
+          "dragged back",
+          QStringLiteral("%1 settled, %2 coalesced")
+              .arg(settled)
+              .arg(debouncer.stats().coalesced));
+  }
+
+  // 4. 会话：下发次数与 UpdateSessionDisplaySettings 调用一致，远程桌面
+  //    最终为窗口尺寸
+  Sandbox sandbox;
+  RdpSettings settings;
+  settings.server = QStringLiteral("display.test");
+  settings.username = QStringLiteral("display");
+  settings.desktopWidth = small.width;
+  settings.desktopHeight = small.height;
+  FakeRdpControl *control = nullptr;
+  auto factory = [&]() {
+    control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 10},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 20}});
+    return control;
+  };
+  RdpSession *session = sandbox.createSession(settings, factory);
+  RdpDisplayDebouncer *debouncer = session->displayDebouncer();
+  configure(debouncer);
+  if (!check(connectAndWait(session), "connect")) {
+    delete session;
+    return;
+  }
+  control->resetCounters();
+  const QVector<RdpDisplaySize> stream = resizeStream(small, large, 100);
+  playResizeStream(debouncer, stream, intervalMs);
+  waitUntil([&]() { return !debouncer->hasPending(); },
+            maxDelayMs + minIntervalMs + 2000);
+  const int updates = control->callCount("UpdateSessionDisplaySettings");
+  check(updates > 0 && quint64(updates) == debouncer->stats().settled &&
+            sandbox.metrics.counter("display_updates_total") == updates &&
+            session->sessionDisplaySize() == stream.last().snapped() &&
+            control->value("DesktopWidth").toInt() ==
+                stream.last().snapped().width,
+        "session resize",
+        QStringLiteral("%1 request(s), %2 update(s), remote desktop %3")
+            .arg(stream.size())
+            .arg(updates)
+            .arg(sizeText(session->sessionDisplaySize())));
+  disconnectAndWait(session);
+  delete session;
+
+  // 5. 登录前的尺寸直接用于连接，登录后不再调整
+  session = sandbox.createSession(settings, factory);
+  debouncer = session->displayDebouncer();
+  configure(debouncer);
+  RdpDisplaySize window = large;
+  window.scaleFactor = 100;
+  debouncer->request(window);
+  debouncer->flush();
+  const bool connected = connectAndWait(session);
+  check(connected &&
+            control->value("DesktopWidth").toInt() ==
+                window.snapped().width &&
+            control->value("DesktopHeight").toInt() ==
+                window.snapped().height &&
+            control->callCount("UpdateSessionDisplaySettings") == 0,
+        "size before connect",
+        QStringLiteral("connected at %1x%2, %3 update(s)")
+            .arg(control->value("DesktopWidth").toInt())
+            .arg(control->value("DesktopHeight").toInt())
+            .arg(control->callCount("UpdateSessionDisplaySettings")));
+  disconnectAndWait(session);
+  delete session;
+}
+
+// 后台降级：隐藏后延迟降级、获得焦点立即恢复、焦点抖动不切换，以及
+// 会话在切换时下发的属性
+void RdcSelfTest::testThrottle() {
+  const int hiddenDelayMs = 40;
+  const int inactiveDelayMs = 120;
+  const int slackMs = 60;
+
+  // 1. 策略本身：隐藏后延迟降级，获得焦点立即恢复，焦点抖动不切换
+  {
+    RdpThrottlePolicy policy;
+    policy.setHiddenDelay(hiddenDelayMs);
+    policy.setInactiveDelay(inactiveDelayMs);
+    QList<RdpThrottlePolicy::Profile> changes;
+    QObject::connect(&policy, &RdpThrottlePolicy::profileChanged,
+                     [&](RdpThrottlePolicy::Profile profile) {
+                       changes << profile;
+                     });
+
+    QElapsedTimer clock;
+    clock.start();
+    policy.setVisible(false);
+    const bool deferred = changes.isEmpty();
+    waitUntil([&]() { return !changes.isEmpty(); }, hiddenDelayMs + 1000);
+    const qint64 hiddenMs = clock.elapsed();
+    check(deferred && changes == QList<RdpThrottlePolicy::Profile>{
+                                      RdpThrottlePolicy::Background} &&
+              hiddenMs >= hiddenDelayMs &&
+              hiddenMs <= hiddenDelayMs + slackMs,
+          "hidden -> background",
+          QStringLiteral("after %1 ms (delay %2 ms)")
+              .arg(hiddenMs)
+              .arg(hiddenDelayMs));
+
+    // 恢复在调用中同步完成，不等事件循环
+    changes.clear();
+    policy.setVisible(true);
+    check(changes == QList<RdpThrottlePolicy::Profile>{
+                         RdpThrottlePolicy::Full} &&
+              policy.profile() == RdpThrottlePolicy::Full,
+          "instant restore",
+          QStringLiteral("%1 change(s) before returning").arg(changes.size()));
+
+    // 每 inactiveDelay / 4 切换一次焦点：不降级
+    changes.clear();
+    for (int i = 0; i < 8; ++i) {
+      policy.setActive(i % 2 != 0);
+      waitUntil([]() { return false; }, inactiveDelayMs / 4);
+    }
+    const int flapChanges = changes.size();
+    policy.setActive(false);
+    clock.restart();
+    waitUntil([&]() { return !changes.isEmpty(); },
+              inactiveDelayMs + 1000);
+    const qint64 inactiveMs = clock.elapsed();
+    check(flapChanges == 0 && changes.size() == 1 &&
+              inactiveMs >= inactiveDelayMs &&
+              inactiveMs <= inactiveDelayMs + slackMs,
+          "focus flapping",
+          QStringLiteral("%1 change(s) while flapping, background %2 ms "
+                         "after the last blur")
+              .arg(flapChanges)
+              .arg(inactiveMs));
+
+    // 失焦计时中再隐藏：以较短的隐藏延迟为准
+    policy.setActive(true);
+    changes.clear();
+    policy.setActive(false);
+    clock.restart();
+    policy.setVisible(false);
+    waitUntil([&]() { return !changes.isEmpty(); }, inactiveDelayMs + 1000);
+    const qint64 hideMs = clock.elapsed();
+    check(changes.size() == 1 && hideMs <= hiddenDelayMs + slackMs,
+          "hide while inactive",
+          QStringLiteral("background after %1 ms").arg(hideMs));
+  }
+
+  // 2. 会话：模拟控件记录每次切换下发的属性
+  Sandbox sandbox;
+  RdpSettings settings;
+  settings.server = QStringLiteral("throttle.test");
+  settings.username = QStringLiteral("throttle");
+  settings.enableSound = true;
+  settings.enableClipboard = true;
+  FakeRdpControl *control = nullptr;
+  auto factory = [&control]() {
+    control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 5},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 5}});
+    return control;
+  };
+  RdpSession *session = sandbox.createSession(settings, factory);
+  RdpThrottlePolicy *policy = session->throttlePolicy();
+  policy->setHiddenDelay(hiddenDelayMs);
+  policy->setInactiveDelay(inactiveDelayMs);
+  if (!check(connectAndWait(session), "initial connect")) {
+    delete session;
+    return;
+  }
+
+  // 模拟控件默认提供 AdvancedSettings9，会话使用该接口
+  const QByteArray scope("AdvancedSettings9");
+  auto profileText = [&]() {
+    return QStringLiteral("audio %1, clipboard %2, rendering %3")
+        .arg(control->scopedValue(scope, "AudioRedirectionMode").toInt())
+        .arg(control->scopedValue(scope, "RedirectClipboard").toBool())
+        .arg(control->renderingSuspended() ? QStringLiteral("suspended")
+                                           : QStringLiteral("on"));
+  };
+
+  control->resetCounters();
+  policy->setVisible(false);
+  waitUntil([&]() { return control->renderingSuspended(); },
+            hiddenDelayMs + 1000);
+  const int backgroundPuts = control->callCount("AudioRedirectionMode") +
+                             control->callCount("RedirectClipboard");
+  check(control->renderingSuspended() && backgroundPuts == 2 &&
+            control->scopedValue(scope, "AudioRedirectionMode").toInt() == 2 &&
+            !control->scopedValue(scope, "RedirectClipboard").toBool(),
+        "background profile",
+        QStringLiteral("%1 put(s): %2").arg(backgroundPuts).arg(profileText()));
+
+  control->resetCounters();
+  policy->setVisible(true);
+  const int restorePuts = control->callCount("AudioRedirectionMode") +
+                          control->callCount("RedirectClipboard");
+  check(!control->renderingSuspended() && restorePuts == 2 &&
+            control->scopedValue(scope, "AudioRedirectionMode").toInt() == 0 &&
+            control->scopedValue(scope, "RedirectClipboard").toBool(),
+        "full profile restored",
+        QStringLiteral("%1 put(s): %2").arg(restorePuts).arg(profileText()));
+
+  control->resetCounters();
+  for (int i = 0; i < 8; ++i) {
+    policy->setActive(i % 2 != 0);
+    waitUntil([]() { return false; }, inactiveDelayMs / 4);
+  }
+  policy->setActive(true);
+  check(control->callCount("AudioRedirectionMode") == 0 &&
+            control->callCount("RedirectClipboard") == 0 &&
+            !control->renderingSuspended(),
+        "no puts while flapping",
+        QStringLiteral("%1 put(s)")
+            .arg(control->callCount("AudioRedirectionMode") +
+                 control->callCount("RedirectClipboard")));
+
+  disconnectAndWait(session);
+  delete session;
+}
+
+// 链路档位：按表格检查 select() 对各组测量值选择的档位与原因
+void RdcSelfTest::testLinkTuner() {
+  struct Case {
+    const char *name;
+    qint64 rttMs;
+    qint64 throughputKbps;
+    RdpLinkTuner::Profile profile;
+    const char *reasons; // 以 "; " 连接
+  };
+  // 默认阈值：LAN 往返 ≤ 10 ms 且吞吐量 ≥ 50000 kbps，
+  // 低带宽往返 ≥ 150 ms 或吞吐量 < 2000 kbps
+  const Case cases[] = {
+      {"unmeasured", -1, -1, RdpLinkTuner::Lan, "未测量链路，使用默认配置"},
+      {"lan", 2, 100000, RdpLinkTuner::Lan,
+       "往返延迟 2 ms ≤ 10 ms; 吞吐量 100000 kbps ≥ 50000 kbps"},
+      {"lan, rtt only", 5, -1, RdpLinkTuner::Lan,
+       "往返延迟 5 ms ≤ 10 ms; 未测得吞吐量"},
+      {"lan, throughput only", -1, 60000, RdpLinkTuner::Lan,
+       "吞吐量 60000 kbps ≥ 50000 kbps"},
+      {"lan, at thresholds", 10, 50000, RdpLinkTuner::Lan,
+       "往返延迟 10 ms ≤ 10 ms; 吞吐量 50000 kbps ≥ 50000 kbps"},
+      {"wan, rtt", 40, -1, RdpLinkTuner::Wan, "往返延迟 40 ms > 10 ms"},
+      {"wan, throughput", 3, 10000, RdpLinkTuner::Wan,
+       "吞吐量 10000 kbps < 50000 kbps"},
+      {"wan, both", 80, 8000, RdpLinkTuner::Wan,
+       "往返延迟 80 ms > 10 ms; 吞吐量 8000 kbps < 50000 kbps"},
+      {"low bandwidth, rtt", 150, -1, RdpLinkTuner::LowBandwidth,
+       "往返延迟 150 ms ≥ 150 ms"},
+      {"low bandwidth, throughput", 5, 1500, RdpLinkTuner::LowBandwidth,
+       "吞吐量 1500 kbps < 2000 kbps"},
+      {"low bandwidth, both", 300, 500, RdpLinkTuner::LowBandwidth,
+       "往返延迟 300 ms ≥ 150 ms; 吞吐量 500 kbps < 2000 kbps"},
+  };
+
+  for (const Case &c : cases) {
+    RdpLinkMeasurement measurement;
+    measurement.rttMs = c.rttMs;
+    measurement.throughputKbps = c.throughputKbps;
+    const RdpLinkTuner::Selection selection =
+        RdpLinkTuner::select(measurement);
+    const QString reasons = selection.reasons.join(QStringLiteral("; "));
+    check(selection.profile == c.profile &&
+              reasons == QString::fromUtf8(c.reasons),
+          c.name,
+          QStringLiteral("%1: %2")
+              .arg(RdpLinkTuner::profileName(selection.profile), reasons));
+  }
+
+  // 各档位的设置逐档降低
+  const RdpLinkSettings &lan = RdpLinkTuner::settingsFor(RdpLinkTuner::Lan);
+  const RdpLinkSettings &wan = RdpLinkTuner::settingsFor(RdpLinkTuner::Wan);
+  const RdpLinkSettings &low =
+      RdpLinkTuner::settingsFor(RdpLinkTuner::LowBandwidth);
+  check(lan.maxColorDepth == 32 && wan.maxColorDepth == 24 &&
+            low.maxColorDepth == 16 && lan.desktopComposition &&
+            !wan.desktopComposition && !low.desktopComposition &&
+            lan.networkConnectionType > wan.networkConnectionType &&
+            wan.networkConnectionType > low.networkConnectionType,
+        "profile settings",
+        QStringLiteral("color %1/%2/%3, connection type %4/%5/%6")
+            .arg(lan.maxColorDepth)
+            .arg(wan.maxColorDepth)
+            .arg(low.maxColorDepth)
+            .arg(lan.networkConnectionType)
+            .arg(wan.networkConnectionType)
+            .arg(low.networkConnectionType));
+
+  // 自定义阈值与关闭自适应
+  RdpLinkTuner tuner;
+  RdpLinkTuner::Thresholds thresholds;
+  thresholds.lanMaxRttMs = 50;
+  tuner.setThresholds(thresholds);
+  RdpLinkMeasurement wanLink;
+  wanLink.rttMs = 40;
+  tuner.setMeasurement(wanLink);
+  const RdpLinkTuner::Profile custom = tuner.profile();
+  tuner.setEnabled(false);
+  check(custom == RdpLinkTuner::Lan && tuner.profile() == RdpLinkTuner::Lan &&
+            tuner.reasons() ==
+                QStringList{QString::fromUtf8("自适应调整已关闭")},
+        "thresholds and disable",
+        QStringLiteral("%1 with a 50 ms LAN threshold; disabled: %2")
+            .arg(RdpLinkTuner::profileName(custom),
+                 tuner.reasons().join(QStringLiteral("; "))));
+}
+
+// RemoteApp 启动队列：无法确定归属的结果不猜测；登录前排队的多个启动
+// 流水线发出，乱序返回的结果按启动 ID 对应并分别计时
+void RdcSelfTest::testRemoteAppQueue() {
+  // 1. 队列本身：路径对应不上时只在唯一的已发出请求上归属结果
+  {
+    RdpRemoteAppQueue queue;
+    RdpRemoteAppLaunch launch;
+    launch.executablePath = QStringLiteral("C:\\apps\\first.exe");
+    const int first = queue.enqueue(launch);
+    launch.executablePath = QStringLiteral("C:\\apps\\second.exe");
+    const int second = queue.enqueue(launch);
+    queue.takeNext();
+    queue.takeNext();
+    const RdpRemoteAppResult ambiguous = queue.complete(
+        QStringLiteral("C:\\apps\\alias.exe"), RdpEvent::RailOk, true);
+    check(ambiguous.launchId == -1 && ambiguous.latencyUs < 0 &&
+              queue.inFlightCount() == 2,
+          "ambiguous result",
+          QStringLiteral("launch #%1, %2 still in flight")
+              .arg(ambiguous.launchId)
+              .arg(queue.inFlightCount()));
+
+    const RdpRemoteAppResult byPath = queue.complete(
+        QStringLiteral("c:/APPS/second.exe"), RdpEvent::RailOk, true);
+    const RdpRemoteAppResult single = queue.complete(
+        QStringLiteral("C:\\apps\\alias.exe"), RdpEvent::RailOk, true);
+    check(byPath.launchId == second && single.launchId == first &&
+              queue.inFlightCount() == 0,
+          "path and single match",
+          QStringLiteral("#%1 by path, #%2 as the only launch in flight")
+              .arg(byPath.launchId)
+              .arg(single.launchId));
+  }
+
+  // 2. 会话：登录前排队三个启动，结果乱序返回，按启动 ID 对应并分别计时
+  struct App {
+    const char *path;
+    int delayMs; // 发出到 OnRemoteProgramResult 的延迟
+    int launchId;
+  };
+  App apps[] = {{"C:\\apps\\slow.exe", 120, -1},
+                {"C:\\apps\\fast.exe", 20, -1},
+                {"C:\\apps\\medium.exe", 70, -1}};
+  const int slackMs = 40;
+
+  Sandbox sandbox;
+  RdpSettings settings;
+  settings.server = QStringLiteral("remoteapp-queue.test");
+  settings.username = QStringLiteral("queue");
+  settings.remoteAppMode = true;
+  settings.executablePath = QStringLiteral("C:\\apps\\primary.exe");
+  auto factory = [&apps, &settings]() {
+    FakeRdpControl *control = new FakeRdpControl();
+    control->setConnectScript({FakeRdpEvent{FakeRdpEvent::Connected, 5},
+                               FakeRdpEvent{FakeRdpEvent::LoginComplete, 5}});
+    control->setRemoteProgramResult(settings.executablePath, 5,
+                                    RdpEvent::RailOk);
+    for (const App &app : apps) {
+      control->setRemoteProgramResult(QString::fromLatin1(app.path),
+                                      app.delayMs, RdpEvent::RailOk);
+    }
+    return control;
+  };
+  RdpSession *session = sandbox.createSession(settings, factory);
+  QList<RdpRemoteAppResult> results;
+  QObject::connect(session, &RdpSession::remoteAppResult,
+                   [&](const RdpRemoteAppResult &result) {
+                     results << result;
+                   });
+
+  for (App &app : apps) {
+    app.launchId = session->launchRemoteApp(QString::fromLatin1(app.path));
+  }
+  const int queued = session->pendingRemoteAppLaunches();
+  session->connectToServer();
+  // 主应用之后三个启动一起发出，不等待前一个结果
+  int maxInFlight = 0;
+  waitUntil(
+      [&]() {
+        maxInFlight = qMax(maxInFlight, session->inFlightRemoteAppLaunches());
+        return results.size() == 4;
+      },
+      5000);
+  check(queued == 3 && results.size() == 4 && maxInFlight >= 3,
+        "pipelined launches",
+        QStringLiteral("%1 queued before login, %2 result(s), up to %3 in "
+                       "flight")
+            .arg(queued)
+            .arg(results.size())
+            .arg(maxInFlight));
+
+  QStringList order;
+  bool correlated = results.size() == 4;
+  bool timed = correlated;
+  QStringList latencies;
+  for (const RdpRemoteAppResult &result : results) {
+    order << result.executablePath.section(QLatin1Char('\\'), -1);
+    for (const App &app : apps) {
+      if (result.executablePath != QLatin1String(app.path)) {
+        continue;
+      }
+      correlated = correlated && result.launchId == app.launchId &&
+                   result.ok();
+      // 粗精度定时器最多可能提前 5% 触发
+      const qint64 latencyMs = result.latencyUs / 1000;
+      timed = timed && result.queueUs > 0 &&
+              latencyMs >= app.delayMs * 9 / 10 &&
+              latencyMs <= app.delayMs + slackMs;
+      latencies << QStringLiteral("#%1 %2 ms")
+                       .arg(result.launchId)
+                       .arg(latencyMs);
+    }
+  }
+  check(correlated && order.mid(1) == QStringList{QStringLiteral("fast.exe"),
+                                                  QStringLiteral("medium.exe"),
+                                                  QStringLiteral("slow.exe")},
+        "out-of-order results",
+        QStringLiteral("arrived %1").arg(order.join(QStringLiteral(", "))));
+  check(timed, "per-launch latency",
+        latencies.join(QStringLiteral(", ")));
+
+  disconnectAndWait(session);
+  delete session;
+}
+
+// 档案日志：重放保存、改名与删除，跳过写入中断的半行，加载时与显式
+// 压缩后重放出相同的档案
+void RdcSelfTest::testProfileStore() {
+  Sandbox sandbox;
+  const QString path =
+      sandbox.dir.filePath(QStringLiteral("profiles.journal"));
+  auto journalLines = [&path]() {
+    QFile file(path);
+    int lines = 0;
+    if (file.open(QIODevice::ReadOnly)) {
+      while (!file.atEnd()) {
+        lines += file.readLine().trimmed().isEmpty() ? 0 : 1;
+      }
+    }
+    return lines;
+  };
+  auto profile = [](const QString &name, const QString &server) {
+    ConnectionProfile p;
+    p.name = name;
+    p.tags << QStringLiteral("journal");
+    p.settings.server = server;
+    p.settings.username = QStringLiteral("store");
+    return p;
+  };
+
+  // 1. 保存、修改、删除只追加记录，重放后得到最后的状态
+  int ids[3] = {0, 0, 0};
+  {
+    ProfileStore store(path);
+    ids[0] = store.save(profile(QStringLiteral("alpha"),
+                                QStringLiteral("alpha.test")));
+    ids[1] = store.save(profile(QStringLiteral("beta"),
+                                QStringLiteral("beta.test")));
+    ids[2] = store.save(profile(QStringLiteral("gamma"),
+                                QStringLiteral("gamma.test")));
+    ConnectionProfile renamed = *store.find(ids[1]);
+    renamed.name = QStringLiteral("beta-renamed");
+    store.save(renamed);
+    store.remove(ids[2]);
+  }
+  {
+    ProfileStore store(path);
+    const ConnectionProfile *beta = store.find(ids[1]);
+    const int next = store.save(profile(QStringLiteral("delta"),
+                                        QStringLiteral("delta.test")));
+    check(journalLines() == 6 && store.count() == 3 && beta &&
+              beta->name == QLatin1String("beta-renamed") &&
+              !store.find(ids[2]) && next == ids[2] + 1 &&
+              store.search(QStringLiteral("renamed")) ==
+                  QVector<int>{ids[1]},
+          "replay",
+          QStringLiteral("%1 record(s), %2 profile(s), next id %3")
+              .arg(journalLines())
+              .arg(store.count())
+              .arg(next));
+  }
+
+  // 2. 写入中途退出留下的半行：跳过，之后的记录另起一行
+  {
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Append);
+    file.write("{\"op\":\"put\",\"profile\":{\"profileId\":99,\"na");
+  }
+  {
+    ProfileStore store(path);
+    store.save(profile(QStringLiteral("epsilon"),
+                       QStringLiteral("epsilon.test")));
+  }
+  {
+    ProfileStore store(path);
+    check(store.count() == 4 && !store.find(99) &&
+              !store.search(QStringLiteral("epsilon")).isEmpty(),
+          "torn record",
+          QStringLiteral("%1 profile(s) after a truncated record")
+              .arg(store.count()));
+  }
+
+  // 3. 冗余记录过多时加载时压缩为每个档案一条
+  {
+    ProfileStore store(path);
+    ConnectionProfile edited = *store.find(ids[0]);
+    for (int i = 0; i < 100; ++i) {
+      edited.settings.port = 3390 + i;
+      store.save(edited);
+    }
+  }
+  const int beforeCompaction = journalLines();
+  int compactedCount = 0;
+  int compactedPort = 0;
+  {
+    ProfileStore store(path);
+    compactedCount = store.count();
+    compactedPort = store.find(ids[0]) ? store.find(ids[0])->settings.port : 0;
+  }
+  const int afterCompaction = journalLines();
+  check(beforeCompaction > 100 && afterCompaction == compactedCount &&
+            compactedPort == 3489,
+        "compaction on load",
+        QStringLiteral("%1 -> %2 record(s), port %3")
+            .arg(beforeCompaction)
+            .arg(afterCompaction)
+            .arg(compactedPort));
+
+  // 4. 压缩后的日志重放出相同的档案，删除后显式压缩也只保留存活的档案
+  {
+    ProfileStore store(path);
+    const bool same = store.count() == compactedCount &&
+                      store.find(ids[1]) &&
+                      store.find(ids[1])->name ==
+                          QLatin1String("beta-renamed");
+    store.remove(ids[1]);
+    const bool compacted = store.compact();
+    check(same && compacted && journalLines() == store.count() &&
+              !store.find(ids[1]) && store.find(ids[0]),
+          "explicit compact",
+          QStringLiteral("%1 record(s) for %2 profile(s)")
+              .arg(journalLines())
+              .arg(store.count()));
+  }
+  {
+    ProfileStore store(path);
+    check(store.count() == compactedCount - 1 && !store.find(ids[1]),
+          "replay after compact",
+          QStringLiteral("%1 profile(s)").arg(store.count()));
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef RDCSELFTEST_H
+#define RDCSELFTEST_H
+
+#include "RdpBitmapCache.h"
+#include "RdpCapabilityCache.h"
+#include "RdpControl.h"
+#include "RdpMetrics.h"
+#include <QStringList>
+#include <QTemporaryDir>
+
+class QCommandLineParser;
+class QTextStream;
+class RdpSession;
+struct RdpSettings;
+
+// 场景测试
+// 用模拟控件（必要时加上本机回环监听器替身）在进程内驱动会话，检查各个
+// 模块的行为与耗时，不需要 ActiveX 或远程桌面服务，可在 Linux 上运行。
+// 每组测试使用独立的统计、能力缓存与位图缓存目录，不影响用户数据。
+class RdcSelfTest {
+public:
+  // 向 parser 添加 --self-test 选项
+  static void addOptions(QCommandLineParser &parser);
+  // 未指定 --self-test 时返回 false；值为逗号分隔的测试组名或 all
+  static bool readOptions(const QCommandLineParser &parser,
+                          QStringList *suites);
+  static QStringList suiteNames();
+  // 依次运行各组测试，返回失败的检查数
+  static int run(const QStringList &suites, QTextStream &out);
+
+private:
+  struct Suite {
+    const char *name;
+    void (RdcSelfTest::*run)();
+  };
+  static const Suite kSuites[];
+
+  // 一组测试的隔离环境
+  struct Sandbox {
+    Sandbox();
+    // 关闭预检与自动重连、使用本环境缓存的会话
+    RdpSession *createSession(const RdpSettings &settings,
+                              const RdpControlFactory &factory);
+
+    QTemporaryDir dir;
+    RdpMetrics metrics;
+    RdpCapabilityCache capabilityCache;
+    RdpBitmapCache bitmapCache;
+  };
+
+  explicit RdcSelfTest(QTextStream &out);
+
+  bool check(bool ok, const char *name, const QString &detail = QString());
+  // 连接并等待登录完成（RemoteApp 会话为第一个启动结果）
+  bool connectAndWait(RdpSession *session, int timeoutMs = 5000);
+  // 断开并等待断开事件送达
+  bool disconnectAndWait(RdpSession *session, int timeoutMs = 5000);
+
+  void testControlPool();
+  void testCapabilityCache();
+  void testPropertyPlan();
+  void testMetrics();
+  void testReconnect();
+  void testSessionCache();
+  void testWorker();
+  void testReaper();
+  void testBitmapCache();
+  void testWarmup();
+  void testDisplay();
+  void testThrottle();
+  void testLinkTuner();
+  void testRemoteAppQueue();
+  void testProfileStore();
+
+  QTextStream &m_out;
+  int m_failures;
+};
+
+#endif // RDCSELFTEST_H
@@ -0,0 +1,234 @@
+#include "RdcStartupProfiler.h"
+#include "RdcLog.h"
+#include "RdpMetrics.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QQuickWindow>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+QElapsedTimer RdcStartupProfiler::s_clock;
+
+void RdcStartupProfiler::start() { s_clock.start(); }
+
+qint64 RdcStartupProfiler::elapsedNs() {
+  return s_clock.isValid() ? s_clock.nsecsElapsed() : 0;
+}
+
+RdcStartupProfiler *RdcStartupProfiler::instance() {
+  static RdcStartupProfiler profiler;
+  return &profiler;
+}
+
+const char *RdcStartupProfiler::markName(Mark mark) {
+  switch (mark) {
+  case AppConstructed:
+    return "app_constructed";
+  case TypesRegistered:
+    return "types_registered";
+  case EngineLoaded:
+    return "engine_loaded";
+  case FirstFrame:
+    return "first_frame";
+  case Interactive:
+    return "interactive";
+  case FirstInput:
+    return "first_input";
+  default:
+    return "unknown";
+  }
+}
+
+RdcStartupProfiler::RdcStartupProfiler(QObject *parent)
+    : QObject(parent), m_window(nullptr), m_quitWhenInteractive(false) {
+  for (auto &ns : m_marksNs) {
+    ns.store(-1);
+  }
+  if (QCoreApplication::instance()) {
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this,
+            &RdcStartupProfiler::writeOutput);
+  }
+}
+
+void RdcStartupProfiler::mark(Mark mark) {
+  qint64 unset = -1;
+  m_marksNs[mark].compare_exchange_strong(unset, elapsedNs());
+}
+
+double RdcStartupProfiler::markMs(Mark mark) const {
+  const qint64 ns = m_marksNs[mark].load();
+  return ns < 0 ? -1 : ns / 1e6;
+}
+
+void RdcStartupProfiler::addMark(const QByteArray &name, qint64 ns) {
+  for (const auto &mark : qAsConst(m_namedMarksNs)) {
+    if (mark.first == name) {
+      return;
+    }
+  }
+  m_namedMarksNs.append(qMakePair(name, ns));
+}
+
+void RdcStartupProfiler::watchWindow(QQuickWindow *window) {
+  if (!window || m_window) {
+    return;
+  }
+  m_window = window;
+  // frameSwapped 在渲染线程发出：在该线程记下时间，其余处理排队回 GUI 线程
+  connect(
+      window, &QQuickWindow::frameSwapped, this,
+      [this]() { mark(FirstFrame); }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::frameSwapped, this,
+          &RdcStartupProfiler::onFirstFrame, Qt::QueuedConnection);
+  window->installEventFilter(this);
+}
+
+void RdcStartupProfiler::onFirstFrame() {
+  if (!m_window) {
+    return;
+  }
+  disconnect(m_window, &QQuickWindow::frameSwapped, this, nullptr);
+
+  // 首帧之后事件循环第一次空闲，即界面可以响应输入的时刻
+  QTimer::singleShot(0, this, [this]() {
+    mark(Interactive);
+    RDC_LOG_INFO(RdcLog::General, 0, "Startup interactive after %1 ms",
+                 markMs(Interactive));
+    emit interactive();
+    if (m_quitWhenInteractive) {
+      QCoreApplication::quit();
+    }
+  });
+}
+
+bool RdcStartupProfiler::eventFilter(QObject *watched, QEvent *event) {
+  switch (event->type()) {
+  case QEvent::MouseButtonPress:
+  case QEvent::KeyPress:
+  case QEvent::TouchBegin:
+    mark(FirstInput);
+    watched->removeEventFilter(this);
+    break;
+  default:
+    break;
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+QByteArray RdcStartupProfiler::toJson() const {
+  QJsonObject object;
+  for (int i = 0; i < MarkCount; ++i) {
+    const double ms = markMs(Mark(i));
+    if (ms >= 0) {
+      object.insert(QLatin1String(markName(Mark(i))) + QLatin1String("_ms"),
+                    ms);
+    }
+  }
+  for (const auto &mark : m_namedMarksNs) {
+    object.insert(QLatin1String(mark.first) + QLatin1String("_ms"),
+                  mark.second / 1e6);
+  }
+  return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+void RdcStartupProfiler::writeOutput() {
+  if (m_outputFile.isEmpty()) {
+    return;
+  }
+  QFile file(m_outputFile);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot write startup profile: %1",
+                    file.errorString());
+    return;
+  }
+  file.write(toJson() + '\n');
+}
+
+int RdcStartupProfiler::runBenchmark(const QString &program,
+                                     const QStringList &arguments, int runs,
+                                     QTextStream &out) {
+  QTemporaryDir dir;
+  if (!dir.isValid()) {
+    out << "startup benchmark: cannot create temporary directory\n";
+    return 0;
+  }
+  const QString profilePath = dir.filePath(QStringLiteral("startup.jsonl"));
+  const QStringList childArguments =
+      QStringList(arguments) << QStringLiteral("--startup-profile")
+                             << profilePath << QStringLiteral("--startup-exit");
+
+  for (int run = 0; run < runs; ++run) {
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.start(program, childArguments);
+    if (!process.waitForFinished(60000) ||
+        process.exitStatus() != QProcess::NormalExit) {
+      process.kill();
+      process.waitForFinished();
+      out << "run " << run + 1 << ": did not finish\n";
+    }
+  }
+
+  // 与连接阶段使用相同的直方图，分位数按微秒统计。界面路径的时间点在前，
+  // 其余（快速启动）按首次出现的顺序
+  QStringList names;
+  for (int i = 0; i < MarkCount; ++i) {
+    names << QLatin1String(markName(Mark(i)));
+  }
+  QHash<QString, RdpLatencyHistogram> histograms;
+  QFile file(profilePath);
+  int completed = 0;
+  if (file.open(QIODevice::ReadOnly)) {
+    while (!file.atEnd()) {
+      const QJsonObject object =
+          QJsonDocument::fromJson(file.readLine()).object();
+      if (object.isEmpty()) {
+        continue;
+      }
+      ++completed;
+      for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        if (!it.key().endsWith(QLatin1String("_ms")) ||
+            !it.value().isDouble()) {
+          continue;
+        }
+        const QString name = it.key().chopped(3);
+        if (!names.contains(name)) {
+          names << name;
+        }
+        histograms[name].record(qint64(it.value().toDouble() * 1000));
+      }
+    }
+  }
+
+  out << "startup benchmark: " << completed << "/" << runs
+      << " runs (ms since main)\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5 %6\n")
+             .arg(QStringLiteral("mark"), -18)
+             .arg(QStringLiteral("p50"), 8)
+             .arg(QStringLiteral("p90"), 8)
+             .arg(QStringLiteral("p99"), 8)
+             .arg(QStringLiteral("min"), 8)
+             .arg(QStringLiteral("max"), 8);
+  for (const QString &name : qAsConst(names)) {
+    const auto found = histograms.constFind(name);
+    if (found == histograms.constEnd()) {
+      continue;
+    }
+    const RdpLatencyHistogram &h = found.value();
+    out << QStringLiteral("  %1 %2 %3 %4 %5 %6\n")
+               .arg(name, -18)
+               .arg(h.percentile(50) / 1000.0, 8, 'f', 1)
+               .arg(h.percentile(90) / 1000.0, 8, 'f', 1)
+               .arg(h.percentile(99) / 1000.0, 8, 'f', 1)
+               .arg(h.min() / 1000.0, 8, 'f', 1)
+               .arg(h.max() / 1000.0, 8, 'f', 1);
+  }
+  out.flush();
+  return completed;
+}
@@ -0,0 +1,87 @@
+#ifndef RDCSTARTUPPROFILER_H
+#define RDCSTARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+class QQuickWindow;
+class QTextStream;
+
+// 启动耗时分析
+// 以 main() 开始为零点记录 QApplication 构造、QML 类型注册、engine.load、
+// 首帧、可交互（首帧后事件循环第一次空闲）与首次用户输入的时间点，
+// 退出时以 JSON 行追加到输出文件。基准模式重复启动本程序，汇总各时间点的
+// 中位数与分位数。
+class RdcStartupProfiler : public QObject {
+  Q_OBJECT
+
+public:
+  enum Mark {
+    AppConstructed,
+    TypesRegistered,
+    EngineLoaded,
+    FirstFrame,
+    Interactive,
+    FirstInput,
+    MarkCount
+  };
+
+  // 在 main() 的第一行调用，作为所有时间点的起点
+  static void start();
+  // 距 start() 的纳秒数，可在任意线程调用
+  static qint64 elapsedNs();
+
+  static RdcStartupProfiler *instance();
+  static const char *markName(Mark mark);
+
+  void mark(Mark mark);
+  // 相对 main() 开始的耗时（毫秒），未到达为 -1
+  double markMs(Mark mark) const;
+  // 其他启动路径的时间点（如快速启动的控件创建与 Connect 发出），与上面的
+  // 时间点一起写入输出文件；同名只记录第一次，只在 GUI 线程调用
+  void addMark(const QByteArray &name, qint64 ns);
+
+  // 监听首帧与首次输入
+  void watchWindow(QQuickWindow *window);
+
+  // 退出时把本次的时间点追加到 path（JSON 行），为空则不写
+  QString outputFile() const { return m_outputFile; }
+  void setOutputFile(const QString &path) { m_outputFile = path; }
+  // 到达可交互后立即退出（基准模式的子进程）
+  void setQuitWhenInteractive(bool quit) { m_quitWhenInteractive = quit; }
+
+  // 单行 JSON：{"app_constructed_ms":..., ...}，未到达的时间点省略
+  QByteArray toJson() const;
+
+  // 以 arguments 重复启动 program runs 次，每次到达可交互（快速启动为
+  // 连接完成）后退出；把各时间点的中位数与分位数写入 out。返回成功的次数
+  static int runBenchmark(const QString &program, const QStringList &arguments,
+                          int runs, QTextStream &out);
+
+signals:
+  void interactive();
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+  void onFirstFrame();
+  void writeOutput();
+
+private:
+  explicit RdcStartupProfiler(QObject *parent = nullptr);
+
+  static QElapsedTimer s_clock;
+
+  std::atomic<qint64> m_marksNs[MarkCount];
+  QVector<QPair<QByteArray, qint64>> m_namedMarksNs;
+  QQuickWindow *m_window;
+  QString m_outputFile;
+  bool m_quitWhenInteractive;
+};
+
+#endif // RDCSTARTUPPROFILER_H
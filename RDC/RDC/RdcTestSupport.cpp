@@ -0,0 +1,19 @@
+#include "RdcTestSupport.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace RdcTestSupport {
+
+bool waitUntil(const std::function<bool()> &done, int timeoutMs) {
+  QTimer tick;
+  tick.start(10);
+  QElapsedTimer timer;
+  timer.start();
+  while (!done() && timer.elapsed() < timeoutMs) {
+    QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+  }
+  return done();
+}
+
+} // namespace RdcTestSupport
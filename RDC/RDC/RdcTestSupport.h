@@ -0,0 +1,15 @@
+#ifndef RDCTESTSUPPORT_H
+#define RDCTESTSUPPORT_H
+
+#include <functional>
+
+// 场景测试与负载测试共用的辅助函数
+namespace RdcTestSupport {
+
+// 处理事件直到 done() 为真或超时，返回最后一次 done() 的结果；
+// 定时唤醒，没有其他事件时也能按时检查超时
+bool waitUntil(const std::function<bool()> &done, int timeoutMs);
+
+} // namespace RdcTestSupport
+
+#endif // RDCTESTSUPPORT_H
@@ -0,0 +1,65 @@
+#include "RdcWorker.h"
+#include "RdcLog.h"
+
+#ifdef Q_OS_WIN
+#include <objbase.h>
+#endif
+
+RdcWorker::RdcWorker(QObject *parent)
+    : QObject(parent), m_context(new QObject), m_pending(0) {
+  m_thread.setObjectName(QStringLiteral("RdcWorker"));
+  m_context->moveToThread(&m_thread);
+
+  // started / finished 在工作线程中发出，直接连接使 COM 初始化在该线程完成
+#ifdef Q_OS_WIN
+  connect(
+      &m_thread, &QThread::started, m_context,
+      []() { CoInitializeEx(nullptr, COINIT_MULTITHREADED); },
+      Qt::DirectConnection);
+  connect(
+      &m_thread, &QThread::finished, m_context, []() { CoUninitialize(); },
+      Qt::DirectConnection);
+#endif
+  m_thread.start();
+}
+
+RdcWorker::~RdcWorker() {
+  // 退出请求排在已提交的任务之后，保证它们的 future 都能完成
+  QThread *thread = &m_thread;
+  QMetaObject::invokeMethod(
+      m_context, [thread]() { thread->quit(); }, Qt::QueuedConnection);
+  m_thread.wait();
+  delete m_context;
+}
+
+RdcWorker *RdcWorker::instance() {
+  static RdcWorker worker;
+  return &worker;
+}
+
+QFuture<void> RdcWorker::post(const std::function<void()> &task) {
+  QFutureInterface<void> promise;
+  promise.reportStarted();
+  const QFuture<void> future = promise.future();
+  enqueue([promise, task]() mutable {
+    try {
+      task();
+    } catch (...) {
+      RDC_LOG_WARNING(RdcLog::General, 0, "Exception in worker task");
+    }
+    promise.reportFinished();
+  });
+  return future;
+}
+
+void RdcWorker::enqueue(const std::function<void()> &job) {
+  ++m_pending;
+  std::atomic<int> *pending = &m_pending;
+  QMetaObject::invokeMethod(
+      m_context,
+      [job, pending]() {
+        job();
+        --*pending;
+      },
+      Qt::QueuedConnection);
+}
@@ -0,0 +1,75 @@
+#ifndef RDCWORKER_H
+#define RDCWORKER_H
+
+#include <QDebug>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <functional>
+
+// 非界面工作的专用工作线程
+// 文件读写、.rdp 解析等不涉及控件的工作在这里按提交顺序依次执行，
+// 结果以 QFuture 返回；whenFinished 把完成回调排队回调用方所在线程。
+// Windows 下工作线程以 MTA 初始化 COM。MsTscAx 控件及其子对象属于
+// GUI 线程的 STA，不能在这里调用。
+class RdcWorker : public QObject {
+  Q_OBJECT
+
+public:
+  explicit RdcWorker(QObject *parent = nullptr);
+  // 执行完已提交的任务后退出线程
+  ~RdcWorker();
+
+  static RdcWorker *instance();
+
+  // 已提交但尚未执行完的任务数
+  int pendingCount() const { return m_pending.load(); }
+  bool isWorkerThread() const {
+    return QThread::currentThread() == &m_thread;
+  }
+
+  QFuture<void> post(const std::function<void()> &task);
+
+  // 任务抛出异常时结果为 T()
+  template <typename T> QFuture<T> run(const std::function<T()> &task) {
+    QFutureInterface<T> promise;
+    promise.reportStarted();
+    const QFuture<T> future = promise.future();
+    enqueue([promise, task]() mutable {
+      try {
+        promise.reportResult(task());
+      } catch (...) {
+        qWarning() << "Exception in worker task";
+        promise.reportResult(T());
+      }
+      promise.reportFinished();
+    });
+    return future;
+  }
+
+  // future 完成后在 context 所在线程调用 callback(future)；
+  // context 先被销毁时不再调用
+  template <typename T, typename Callback>
+  static void whenFinished(const QFuture<T> &future, QObject *context,
+                           Callback callback) {
+    QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context,
+                     [watcher, callback]() {
+                       callback(watcher->future());
+                       watcher->deleteLater();
+                     });
+    watcher->setFuture(future);
+  }
+
+private:
+  void enqueue(const std::function<void()> &job);
+
+  QThread m_thread;
+  QObject *m_context; // 属于工作线程，任务在其事件中执行
+  std::atomic<int> m_pending;
+};
+
+#endif // RDCWORKER_H
@@ -0,0 +1,293 @@
+#include "RdpBitmapCache.h"
+#include "RdcLog.h"
+#include "RdcWorker.h"
+#include "RdpMetrics.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+qint64 megabytesFromEnv(const char *name, qint64 fallback) {
+  bool ok = false;
+  const int mb = qEnvironmentVariableIntValue(name, &ok);
+  return ok ? qint64(mb) * 1024 * 1024 : fallback;
+}
+
+struct HostDirectory {
+  QString name;
+  QString path;
+  qint64 bytes = 0;
+  QDateTime lastUsed;
+  QList<QFileInfo> files;
+};
+
+} // namespace
+
+RdpBitmapCache::RdpBitmapCache(const QString &rootPath, RdpMetrics *metrics,
+                               QObject *parent)
+    : QObject(parent), m_rootPath(rootPath),
+      m_metrics(metrics ? metrics : RdpMetrics::instance()),
+      m_hostQuota(megabytesFromEnv("RDC_BITMAP_CACHE_HOST_MB", 100LL << 20)),
+      m_totalQuota(megabytesFromEnv("RDC_BITMAP_CACHE_TOTAL_MB", 1LL << 30)),
+      m_lookups(0), m_hits(0), m_hostCount(-1), m_totalBytes(-1),
+      m_evictedFiles(0), m_evictedBytes(0) {
+  if (m_rootPath.isEmpty()) {
+    m_rootPath = qEnvironmentVariable("RDC_BITMAP_CACHE_DIR");
+  }
+  if (m_rootPath.isEmpty()) {
+    m_rootPath =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        QStringLiteral("/bitmap");
+  }
+}
+
+RdpBitmapCache *RdpBitmapCache::instance() {
+  static RdpBitmapCache cache;
+  return &cache;
+}
+
+QString RdpBitmapCache::hostKey(const QString &server, int port,
+                                const QString &username) {
+  const QString identity = QStringLiteral("%1:%2:%3")
+                               .arg(server.toLower())
+                               .arg(port)
+                               .arg(username.toLower());
+  QString readable = QStringLiteral("%1_%2_%3")
+                         .arg(server.toLower())
+                         .arg(port)
+                         .arg(username.toLower());
+  // DOMAIN\user、IPv6 地址等含有不能用作文件名的字符
+  static const QRegularExpression unsafe(QStringLiteral("[^a-z0-9._-]"));
+  readable.replace(unsafe, QStringLiteral("_"));
+  readable.truncate(64);
+  const QByteArray digest =
+      QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1);
+  return readable + QLatin1Char('-') +
+         QString::fromLatin1(digest.toHex().left(8));
+}
+
+QString RdpBitmapCache::acquire(const QString &server, int port,
+                                const QString &username) {
+  const QString key = hostKey(server, port, username);
+  QDir root(m_rootPath);
+  if (!root.mkpath(key)) {
+    RDC_LOG_WARNING(RdcLog::General, 0,
+                    "Cannot create bitmap cache directory %1",
+                    root.filePath(key));
+    return QString();
+  }
+  const QDir dir(root.filePath(key));
+
+  // 除标记文件外已有缓存文件即为命中
+  const QStringList files =
+      dir.entryList(QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+  const bool hit = files.size() > (files.contains(QLatin1String(markerName()))
+                                       ? 1
+                                       : 0);
+  ++m_lookups;
+  m_metrics->addToCounter("bitmap_cache_lookups_total");
+  if (hit) {
+    ++m_hits;
+    m_metrics->addToCounter("bitmap_cache_hits_total");
+  }
+
+  QFile marker(dir.filePath(QLatin1String(markerName())));
+  if (marker.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    marker.write(QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toLatin1());
+  }
+  ++m_inUse[key];
+  return QDir::toNativeSeparators(dir.absolutePath());
+}
+
+void RdpBitmapCache::release(const QString &directory) {
+  const QString key =
+      QFileInfo(QDir::fromNativeSeparators(directory)).fileName();
+  auto it = m_inUse.find(key);
+  if (it != m_inUse.end() && --it.value() <= 0) {
+    m_inUse.erase(it);
+  }
+}
+
+bool RdpBitmapCache::isInUse(const QString &directory) const {
+  return m_inUse.contains(
+      QFileInfo(QDir::fromNativeSeparators(directory)).fileName());
+}
+
+RdpBitmapCacheEviction RdpBitmapCache::evict() {
+  const QList<QString> keys = m_inUse.keys();
+  const QSet<QString> inUse(keys.begin(), keys.end());
+  const RdpBitmapCacheEviction result =
+      evictDirectory(m_rootPath, m_hostQuota, m_totalQuota, inUse,
+                     QDateTime::currentDateTimeUtc().addSecs(-2));
+  applyEviction(result);
+  return result;
+}
+
+void RdpBitmapCache::evictInBackground() {
+  const QString rootPath = m_rootPath;
+  const qint64 hostQuota = m_hostQuota;
+  const qint64 totalQuota = m_totalQuota;
+  const QList<QString> keys = m_inUse.keys();
+  const QSet<QString> inUse(keys.begin(), keys.end());
+  // 之后 acquire 的目录标记时间不早于此，淘汰时跳过；
+  // 留出文件系统时间戳精度的余量
+  const QDateTime startedAt = QDateTime::currentDateTimeUtc().addSecs(-2);
+  const QFuture<RdpBitmapCacheEviction> future =
+      RdcWorker::instance()->run<RdpBitmapCacheEviction>(
+          [rootPath, hostQuota, totalQuota, inUse, startedAt]() {
+            return evictDirectory(rootPath, hostQuota, totalQuota, inUse,
+                                  startedAt);
+          });
+  RdcWorker::whenFinished(
+      future, this, [this](const QFuture<RdpBitmapCacheEviction> &done) {
+        applyEviction(done.result());
+      });
+}
+
+QVariantMap RdpBitmapCache::stats() const {
+  QVariantMap result;
+  result.insert(QStringLiteral("lookups"), m_lookups);
+  result.insert(QStringLiteral("hits"), m_hits);
+  result.insert(QStringLiteral("hitRate"),
+                m_lookups ? double(m_hits) / double(m_lookups) : 0.0);
+  result.insert(QStringLiteral("hostCount"), m_hostCount);
+  result.insert(QStringLiteral("totalBytes"), m_totalBytes);
+  result.insert(QStringLiteral("evictedFiles"), m_evictedFiles);
+  result.insert(QStringLiteral("evictedBytes"), m_evictedBytes);
+  result.insert(QStringLiteral("hostQuota"), m_hostQuota);
+  result.insert(QStringLiteral("totalQuota"), m_totalQuota);
+  return result;
+}
+
+void RdpBitmapCache::applyEviction(const RdpBitmapCacheEviction &result) {
+  m_hostCount = result.hostCount;
+  m_totalBytes = result.totalBytes;
+  m_evictedFiles += result.evictedFiles;
+  m_evictedBytes += result.evictedBytes;
+  if (result.evictedFiles > 0) {
+    m_metrics->addToCounter("bitmap_cache_evicted_files_total",
+                            result.evictedFiles);
+    m_metrics->addToCounter("bitmap_cache_evicted_bytes_total",
+                            double(result.evictedBytes));
+  }
+  RDC_LOG_DEBUG(RdcLog::General, 0,
+                "Bitmap cache: %1 hosts, %2 KiB; evicted %3 files, %4 KiB, "
+                "%5 hosts",
+                result.hostCount, result.totalBytes / 1024, result.evictedFiles,
+                result.evictedBytes / 1024, result.removedHosts);
+  emit evicted(result.evictedFiles, result.evictedBytes);
+}
+
+RdpBitmapCacheEviction RdpBitmapCache::evictDirectory(
+    const QString &rootPath, qint64 hostQuota, qint64 totalQuota,
+    const QSet<QString> &inUse, const QDateTime &startedAt) {
+  RdpBitmapCacheEviction result;
+  const QDir root(rootPath);
+  if (!root.exists()) {
+    return result;
+  }
+
+  const QString marker = QLatin1String(markerName());
+  QList<HostDirectory> hosts;
+  const QFileInfoList dirs =
+      root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (const QFileInfo &dirInfo : dirs) {
+    HostDirectory host;
+    host.name = dirInfo.fileName();
+    host.path = dirInfo.absoluteFilePath();
+    // 没有标记文件时以最新的缓存文件为最近使用时间
+    host.lastUsed = dirInfo.lastModified();
+    bool hasMarker = false;
+    QDirIterator it(host.path, QDir::Files | QDir::Hidden,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      it.next();
+      const QFileInfo file = it.fileInfo();
+      if (file.fileName() == marker) {
+        host.lastUsed = file.lastModified();
+        hasMarker = true;
+        continue;
+      }
+      if (!hasMarker && file.lastModified() > host.lastUsed) {
+        host.lastUsed = file.lastModified();
+      }
+      host.bytes += file.size();
+      host.files.append(file);
+    }
+    hosts.append(host);
+  }
+
+  auto busy = [&inUse, &startedAt, &marker](const HostDirectory &host) {
+    if (inUse.contains(host.name)) {
+      return true;
+    }
+    // 扫描之后才被使用的目录
+    const QFileInfo markerInfo(host.path + QLatin1Char('/') + marker);
+    return markerInfo.exists() && markerInfo.lastModified() >= startedAt;
+  };
+
+  // 单个主机超出配额：删除其中最旧的文件
+  if (hostQuota > 0) {
+    for (HostDirectory &host : hosts) {
+      if (host.bytes <= hostQuota || busy(host)) {
+        continue;
+      }
+      std::sort(host.files.begin(), host.files.end(),
+                [](const QFileInfo &a, const QFileInfo &b) {
+                  return a.lastModified() < b.lastModified();
+                });
+      for (const QFileInfo &file : qAsConst(host.files)) {
+        if (host.bytes <= hostQuota) {
+          break;
+        }
+        if (QFile::remove(file.absoluteFilePath())) {
+          host.bytes -= file.size();
+          ++result.evictedFiles;
+          result.evictedBytes += file.size();
+        }
+      }
+    }
+  }
+
+  qint64 total = 0;
+  for (const HostDirectory &host : qAsConst(hosts)) {
+    total += host.bytes;
+  }
+
+  // 总量超出配额：整个删除最久未用的主机目录
+  int remaining = hosts.size();
+  if (totalQuota > 0 && total > totalQuota) {
+    std::sort(hosts.begin(), hosts.end(),
+              [](const HostDirectory &a, const HostDirectory &b) {
+                return a.lastUsed < b.lastUsed;
+              });
+    for (const HostDirectory &host : qAsConst(hosts)) {
+      if (total <= totalQuota) {
+        break;
+      }
+      if (busy(host)) {
+        continue;
+      }
+      if (!QDir(host.path).removeRecursively()) {
+        RDC_LOG_WARNING(RdcLog::General, 0,
+                        "Cannot remove bitmap cache directory %1", host.path);
+        continue;
+      }
+      total -= host.bytes;
+      result.evictedFiles += host.files.size();
+      result.evictedBytes += host.bytes;
+      ++result.removedHosts;
+      --remaining;
+    }
+  }
+
+  result.hostCount = remaining;
+  result.totalBytes = total;
+  return result;
+}
@@ -0,0 +1,95 @@
+#ifndef RDPBITMAPCACHE_H
+#define RDPBITMAPCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+
+class RdpMetrics;
+
+// 一次按配额淘汰的结果
+struct RdpBitmapCacheEviction {
+  int evictedFiles = 0;
+  qint64 evictedBytes = 0;
+  int removedHosts = 0; // 因总配额整个删除的主机目录
+  int hostCount = 0;    // 淘汰后剩余的主机目录
+  qint64 totalBytes = 0; // 淘汰后的总大小
+};
+
+// 持久化位图缓存目录管理
+// 每个主机 / 用户一个子目录，作为控件的 PersistCacheDirectory；目录中的
+// 标记文件记录最近使用时间。按配额淘汰：单个主机超出时先删其中最旧的
+// 文件，总量超出时按最近使用时间整个删除最久未用的主机目录。正在使用的
+// 目录不淘汰。只使用 QDir / QFileInfo，与平台无关。
+class RdpBitmapCache : public QObject {
+  Q_OBJECT
+
+public:
+  // 默认目录为 QStandardPaths::CacheLocation/bitmap，可由
+  // RDC_BITMAP_CACHE_DIR 指定；配额可由 RDC_BITMAP_CACHE_HOST_MB、
+  // RDC_BITMAP_CACHE_TOTAL_MB 指定。metrics 默认为 RdpMetrics::instance()
+  explicit RdpBitmapCache(const QString &rootPath = QString(),
+                          RdpMetrics *metrics = nullptr,
+                          QObject *parent = nullptr);
+
+  static RdpBitmapCache *instance();
+
+  QString rootPath() const { return m_rootPath; }
+  // 单个主机目录与全部目录的大小上限，小于等于 0 表示不限
+  qint64 hostQuota() const { return m_hostQuota; }
+  void setHostQuota(qint64 bytes) { m_hostQuota = bytes; }
+  qint64 totalQuota() const { return m_totalQuota; }
+  void setTotalQuota(qint64 bytes) { m_totalQuota = bytes; }
+
+  // 连接开始使用主机的缓存：创建目录并更新最近使用时间，目录中已有
+  // 缓存文件计为命中。返回目录的本地路径，无法创建时返回空
+  QString acquire(const QString &server, int port, const QString &username);
+  // 与 acquire 成对调用；目录在使用期间不会被淘汰
+  void release(const QString &directory);
+  bool isInUse(const QString &directory) const;
+
+  // 在调用线程中按配额淘汰
+  RdpBitmapCacheEviction evict();
+  // 在 RdcWorker 中淘汰，完成后更新统计并发出 evicted
+  void evictInBackground();
+
+  // lookups / hits / hitRate / hostCount / totalBytes / evictedFiles /
+  // evictedBytes / hostQuota / totalQuota
+  QVariantMap stats() const;
+
+  // 主机目录名：可读的主机、端口、用户加上区分大小写与特殊字符的哈希
+  static QString hostKey(const QString &server, int port,
+                         const QString &username);
+  // 目录中记录最近使用时间的标记文件
+  static const char *markerName() { return ".rdc-last-used"; }
+
+signals:
+  void evicted(int files, qint64 bytes);
+
+private:
+  // 只访问文件系统，可在任意线程执行；最近使用时间不早于 startedAt 的
+  // 目录视为刚被使用，不淘汰
+  static RdpBitmapCacheEviction evictDirectory(const QString &rootPath,
+                                               qint64 hostQuota,
+                                               qint64 totalQuota,
+                                               const QSet<QString> &inUse,
+                                               const QDateTime &startedAt);
+  void applyEviction(const RdpBitmapCacheEviction &result);
+
+  QString m_rootPath;
+  RdpMetrics *m_metrics;
+  qint64 m_hostQuota;
+  qint64 m_totalQuota;
+  QHash<QString, int> m_inUse; // 主机目录名 -> 使用数
+  quint64 m_lookups;
+  quint64 m_hits;
+  int m_hostCount;
+  qint64 m_totalBytes;
+  quint64 m_evictedFiles;
+  qint64 m_evictedBytes;
+};
+
+#endif // RDPBITMAPCACHE_H
@@ -0,0 +1,144 @@
+#include "RdpCapabilityCache.h"
+#include "RdcLog.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+RdpCapabilityCache::RdpCapabilityCache(const QString &filePath)
+    : m_filePath(filePath), m_loaded(false), m_probeCount(0) {
+  if (m_filePath.isEmpty()) {
+    m_filePath =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        QStringLiteral("/rdp_capabilities.json");
+  }
+}
+
+RdpCapabilityCache *RdpCapabilityCache::instance() {
+  static RdpCapabilityCache cache;
+  return &cache;
+}
+
+RdpCapabilities RdpCapabilityCache::capabilities(RdpControl *control) {
+  if (!control) {
+    return RdpCapabilities();
+  }
+
+  if (!m_loaded) {
+    load();
+  }
+
+  // 取不到版本号时不做持久化，每次都重新探测
+  const QString version = control->version();
+  if (!version.isEmpty() && m_cached.version == version) {
+    return m_cached;
+  }
+
+  RDC_LOG_DEBUG(RdcLog::Control, 0,
+                "Probing RDP control capabilities, version: %1", version);
+  RdpCapabilities caps = probe(control, version);
+  if (!version.isEmpty()) {
+    // 版本变化：旧的探测结果作废
+    m_cached = caps;
+    save();
+  }
+  return caps;
+}
+
+void RdpCapabilityCache::clear() {
+  m_cached = RdpCapabilities();
+  m_loaded = true;
+  QFile::remove(m_filePath);
+}
+
+RdpCapabilities RdpCapabilityCache::probe(RdpControl *control,
+                                          const QString &version) {
+  RdpCapabilities caps;
+  caps.version = version;
+  caps.advancedSettingsInterface = probeSubObject(
+      control, QList<QByteArray>() << "AdvancedSettings9"
+                                   << "AdvancedSettings");
+  caps.remoteProgramInterface = probeSubObject(
+      control, QList<QByteArray>() << "RemoteProgram2"
+                                   << "RemoteProgram");
+
+  // RDP v11 的 RemoteProgram 上是 ServerStart 而不是 ServerStartProgram
+  caps.startProgramMethod = "ServerStartProgram";
+  if (!caps.remoteProgramInterface.isEmpty()) {
+    RdpDispatch *remoteProgram =
+        control->querySubObject(caps.remoteProgramInterface.constData());
+    ++m_probeCount;
+    if (remoteProgram) {
+      ++m_probeCount;
+      if (remoteProgram->dispatchId("ServerStartProgram") < 0) {
+        ++m_probeCount;
+        if (remoteProgram->dispatchId("ServerStart") >= 0) {
+          caps.startProgramMethod = "ServerStart";
+        }
+      }
+      delete remoteProgram;
+    }
+  }
+
+  RDC_LOG_DEBUG(RdcLog::Control, 0, "RDP capabilities: %1 %2 %3",
+                caps.advancedSettingsInterface, caps.remoteProgramInterface,
+                caps.startProgramMethod);
+  return caps;
+}
+
+QByteArray
+RdpCapabilityCache::probeSubObject(RdpDispatch *object,
+                                   const QList<QByteArray> &candidates) {
+  for (const QByteArray &name : candidates) {
+    ++m_probeCount;
+    RdpDispatch *subObject = object->querySubObject(name.constData());
+    if (subObject) {
+      delete subObject;
+      return name;
+    }
+  }
+  return QByteArray();
+}
+
+void RdpCapabilityCache::load() {
+  m_loaded = true;
+
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+  m_cached.version = root.value(QStringLiteral("version")).toString();
+  m_cached.advancedSettingsInterface =
+      root.value(QStringLiteral("advancedSettings")).toString().toLatin1();
+  m_cached.remoteProgramInterface =
+      root.value(QStringLiteral("remoteProgram")).toString().toLatin1();
+  m_cached.startProgramMethod =
+      root.value(QStringLiteral("startProgram")).toString().toLatin1();
+}
+
+void RdpCapabilityCache::save() const {
+  QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+  QJsonObject root;
+  root.insert(QStringLiteral("version"), m_cached.version);
+  root.insert(QStringLiteral("advancedSettings"),
+              QString::fromLatin1(m_cached.advancedSettingsInterface));
+  root.insert(QStringLiteral("remoteProgram"),
+              QString::fromLatin1(m_cached.remoteProgramInterface));
+  root.insert(QStringLiteral("startProgram"),
+              QString::fromLatin1(m_cached.startProgramMethod));
+
+  QSaveFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    RDC_LOG_WARNING(RdcLog::Control, 0, "Cannot write capability cache: %1",
+                    m_filePath);
+    return;
+  }
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  file.commit();
+}
@@ -0,0 +1,51 @@
+#ifndef RDPCAPABILITYCACHE_H
+#define RDPCAPABILITYCACHE_H
+
+#include "RdpControl.h"
+#include <QList>
+#include <QString>
+
+// 某个控件版本上实际存在的接口与方法
+struct RdpCapabilities {
+  QString version;
+  QByteArray advancedSettingsInterface; // AdvancedSettings9 / AdvancedSettings
+  QByteArray remoteProgramInterface;    // RemoteProgram2 / RemoteProgram
+  QByteArray startProgramMethod;        // ServerStartProgram / ServerStart
+
+  bool isValid() const { return !version.isEmpty(); }
+};
+
+// 控件能力探测缓存
+// 每个控件版本只探测一次（含所有失败的回退探测），结果写入磁盘，
+// 之后的启动直接读取；控件版本变化时缓存失效并重新探测。
+class RdpCapabilityCache {
+public:
+  // 默认缓存文件位于 QStandardPaths::CacheLocation
+  explicit RdpCapabilityCache(const QString &filePath = QString());
+
+  static RdpCapabilityCache *instance();
+
+  // 返回控件的能力，未缓存时探测并持久化
+  RdpCapabilities capabilities(RdpControl *control);
+
+  // 清空内存与磁盘缓存
+  void clear();
+
+  QString filePath() const { return m_filePath; }
+  // 累计的探测调用次数（querySubObject / 方法名解析）
+  int probeCount() const { return m_probeCount; }
+
+private:
+  RdpCapabilities probe(RdpControl *control, const QString &version);
+  QByteArray probeSubObject(RdpDispatch *object,
+                            const QList<QByteArray> &candidates);
+  void load();
+  void save() const;
+
+  QString m_filePath;
+  RdpCapabilities m_cached;
+  bool m_loaded;
+  int m_probeCount;
+};
+
+#endif // RDPCAPABILITYCACHE_H
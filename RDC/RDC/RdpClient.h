@@ -1,15 +1,22 @@
 #ifndef RDPCLIENT_H
 #define RDPCLIENT_H
 
-#include <QAxObject>
-#include <QAxWidget>
+#include "RdpFile.h"
+#include "RdpLinkTuner.h"
+#include "RdpSessionReaper.h"
+#include "RdpSettings.h"
 #include <QObject>
 #include <QWidget>
 
+class QTextStream;
+class RdpSession;
 class RdpWindow;
 
 class RdpClient : public QObject {
   Q_OBJECT
+  // 连接设置：读写由 RDP_SETTINGS_FIELDS 生成的 getter/setter，每个属性
+  // 有自己的变化信号。moc 不展开宏，属性与信号声明需与字段表保持一致
+  // （RdpClient.cpp 按字段表发出 <name>Changed，缺少的信号会编译失败）。
   Q_PROPERTY(QString server READ server WRITE setServer NOTIFY serverChanged)
   Q_PROPERTY(
       QString username READ username WRITE setUsername NOTIFY usernameChanged)
@@ -24,6 +31,8 @@ class RdpClient : public QObject {
                  setFullScreenTitle NOTIFY fullScreenTitleChanged)
   Q_PROPERTY(bool fullScreen READ fullScreen WRITE setFullScreen NOTIFY
                  fullScreenChanged)
+  Q_PROPERTY(bool dynamicResolution READ dynamicResolution WRITE
+                 setDynamicResolution NOTIFY dynamicResolutionChanged)
   Q_PROPERTY(bool enableSound READ enableSound WRITE setEnableSound NOTIFY
                  enableSoundChanged)
   Q_PROPERTY(bool enableClipboard READ enableClipboard WRITE setEnableClipboard
@@ -31,6 +40,8 @@ class RdpClient : public QObject {
   Q_PROPERTY(bool enablePrinter READ enablePrinter WRITE setEnablePrinter NOTIFY
                  enablePrinterChanged)
   Q_PROPERTY(bool connected READ connected NOTIFY connectedChanged)
+  // 链路档位及选择原因
+  Q_PROPERTY(RdpLinkTuner *linkTuner READ linkTuner CONSTANT)
   
   // RemoteApp properties
   Q_PROPERTY(bool remoteAppMode READ remoteAppMode WRITE setRemoteAppMode NOTIFY
@@ -54,59 +65,52 @@ public:
   explicit RdpClient(QObject *parent = nullptr);
   ~RdpClient();
 
-  // Property getters
-  QString server() const { return m_server; }
-  QString username() const { return m_username; }
-  int port() const { return m_port; }
-  int desktopWidth() const { return m_desktopWidth; }
-  int desktopHeight() const { return m_desktopHeight; }
-  int colorDepth() const { return m_colorDepth; }
-  QString fullScreenTitle() const { return m_fullScreenTitle; }
-  bool fullScreen() const { return m_fullScreen; }
-  bool enableSound() const { return m_enableSound; }
-  bool enableClipboard() const { return m_enableClipboard; }
-  bool enablePrinter() const { return m_enablePrinter; }
-  bool connected() const { return m_connected; }
-  
-  // RemoteApp getters
-  bool remoteAppMode() const { return m_remoteAppMode; }
-  QString executablePath() const { return m_executablePath; }
-  QString filePath() const { return m_filePath; }
-  QString workingDirectory() const { return m_workingDirectory; }
-  bool expandEnvVarInWorkingDirectory() const { return m_expandEnvVarInWorkingDirectory; }
-  QString arguments() const { return m_arguments; }
-  bool expandEnvVarInArguments() const { return m_expandEnvVarInArguments; }
-
-  // Property setters
-  void setServer(const QString &server);
-  void setUsername(const QString &username);
-  void setPort(int port);
-  void setDesktopWidth(int width);
-  void setDesktopHeight(int height);
-  void setColorDepth(int depth);
-  void setFullScreenTitle(const QString &title);
-  void setFullScreen(bool fullScreen);
-  void setEnableSound(bool enable);
-  void setEnableClipboard(bool enable);
-  void setEnablePrinter(bool enable);
-  
-  // RemoteApp setters
-  void setRemoteAppMode(bool enable);
-  void setExecutablePath(const QString &path);
-  void setFilePath(const QString &path);
-  void setWorkingDirectory(const QString &dir);
-  void setExpandEnvVarInWorkingDirectory(bool expand);
-  void setArguments(const QString &args);
-  void setExpandEnvVarInArguments(bool expand);
+  // 设置的 getter / setter（setter 只在值变化时通知）
+#define RDP_CLIENT_ACCESSORS(type, name, setter, def)                          \
+  type name() const { return m_settings.name; }                               \
+  void setter(const type &value);
+  RDP_SETTINGS_FIELDS(RDP_CLIENT_ACCESSORS)
+#undef RDP_CLIENT_ACCESSORS
+
+  bool connected() const;
+  RdpLinkTuner *linkTuner() const;
+
+  // 批量修改设置：先校验全部键值，任一无效则不做任何修改并发出
+  // connectionError；全部有效时一次写入，有变化时只发出一次
+  // settingsChanged（不逐字段发出 <name>Changed）。需要跟随批量修改的
+  // QML 绑定应监听 settingsChanged，并用 lastChangedSettings() 取变化字段
+  Q_INVOKABLE bool applySettings(const QVariantMap &settings);
+  Q_INVOKABLE QVariantMap settingsMap() const {
+    return m_settings.toVariantMap();
+  }
+  // 最近一次修改中变化的属性名
+  Q_INVOKABLE QStringList lastChangedSettings() const {
+    return RdpSettings::fieldNames(m_lastChanged);
+  }
 
   void __demo__();
 
+  // 基准测试：在两份各字段都不同的配置间来回切换，比较逐个写入属性
+  // （QML 赋值的路径）与 applySettings 的耗时、变化通知数与分配次数
+  static void runBenchmark(int iterations, QTextStream &out);
+
 public slots:
   // RDP操作
   bool connectToServer();
   void disconnectFromServer();
   QWidget *getWidget();
 
+  // .rdp 文件导入导出（path 可以是本地路径或 file:// URL）
+  bool loadRdpFile(const QString &path);
+  bool saveRdpFile(const QString &path);
+  // 在 RdcWorker 中读写文件，立即返回请求 ID，完成时发出
+  // rdpFileLoaded / rdpFileSaved（失败另发 connectionError）
+  int loadRdpFileAsync(const QString &path);
+  int saveRdpFileAsync(const QString &path);
+
+  // 无界面会话引擎
+  RdpSession *session() const { return m_session; }
+
 signals:
   void serverChanged();
   void usernameChanged();
@@ -116,9 +120,13 @@ signals:
   void colorDepthChanged();
   void fullScreenTitleChanged();
   void fullScreenChanged();
+  void dynamicResolutionChanged();
   void enableSoundChanged();
   void enableClipboardChanged();
   void enablePrinterChanged();
+  // 批量修改（applySettings、导入 .rdp）只发出这一个信号，变化的字段见
+  // lastChangedSettings()；单个 setter 只发出自己的 <name>Changed
+  void settingsChanged();
   void connectedChanged();
   void connectionError(const QString &error);
   void connectionSuccess();
@@ -134,47 +142,32 @@ signals:
   void remoteAppStarted();
   void remoteAppError(const QString &error);
 
+  void rdpFileLoaded(int requestId, bool ok);
+  void rdpFileSaved(int requestId, bool ok);
+  // 断开或空闲后控件与窗口已被 RdpSessionReaper 回收；reason 为
+  // idle_timeout 或 memory_budget，bytes 为回收前的内存估算
+  void sessionReaped(const QString &reason, qint64 bytes);
+
 private slots:
-  void onConnected();
-  void onDisconnected();
-  void onLoginComplete();
-  void onFatalError(int errorCode);
-  void onRemoteProgramResult(QString bstrExecutablePath, QVariant errorVariant, bool isExecutable);
+  void showWindow(QWidget *widget);
+  void detachWidget(QWidget *widget);
+  void updateReapState();
 
 private:
-  void initializeControl();
-  void configureClient();
-  void configureRemoteApp();
-  void startRemoteApp();
-  QAxBase *getRdpControl();
-  void setRdpProperty(const char *name, const QVariant &value);
-
-  QAxWidget *m_axWidget;
-  QAxObject *m_rdpClient;
-  RdpWindow *m_rdpWindow;
+  // 整体替换设置，只为变化的字段发出通知
+  void assignSettings(const RdpSettings &settings);
+  void emitChanged(RdpSettings::FieldMask changed);
+  RdpMemoryUsage memoryUsage() const;
+  void reap(RdpSessionReaper::Reason reason);
 
-  QString m_server;
-  QString m_username;
-  int m_port;
-  int m_desktopWidth;
-  int m_desktopHeight;
-  int m_colorDepth;
-  QString m_fullScreenTitle;
-  bool m_fullScreen;
-  bool m_enableSound;
-  bool m_enableClipboard;
-  bool m_enablePrinter;
-  bool m_connected;
-  
-  // RemoteApp members
-  bool m_remoteAppMode;
-  QString m_executablePath;
-  QString m_filePath;
-  QString m_workingDirectory;
-  bool m_expandEnvVarInWorkingDirectory;
-  QString m_arguments;
-  bool m_expandEnvVarInArguments;
-  QAxObject *m_remoteProgram;  // RemoteProgram 接口对象
+  RdpSession *m_session;
+  RdpWindow *m_rdpWindow;
+  RdpSettings m_settings;
+  RdpSettings::FieldMask m_lastChanged;
+  RdpFile m_rdpFile; // 最近导入的文件，导出时保留其中未识别的键
+  int m_nextRequestId;
+  RdpSessionReaper *m_reaper; // 子对象，只回收本客户端的会话
+  int m_reapId;               // m_reaper 中的 ID
 };
 
 #endif // RDPCLIENT_H
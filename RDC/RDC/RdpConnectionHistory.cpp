@@ -0,0 +1,251 @@
+#include "RdpConnectionHistory.h"
+#include "RdcLog.h"
+#include "RdcWorker.h"
+#include "RdpSettings.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const QString kServer = QStringLiteral("server");
+const QString kPort = QStringLiteral("port");
+const QString kUsername = QStringLiteral("username");
+const QString kRemoteApp = QStringLiteral("remoteApp");
+const QString kTime = QStringLiteral("time");
+const QString kMinute = QStringLiteral("minute");
+
+QString targetKeyOf(const QString &server, int port, const QString &username,
+                    bool remoteApp) {
+  return QStringLiteral("%1|%2|%3|%4")
+      .arg(server.toLower())
+      .arg(port)
+      .arg(username.toLower())
+      .arg(remoteApp ? 1 : 0);
+}
+
+int minuteOfDay(const QDateTime &when) {
+  return when.toLocalTime().time().msecsSinceStartOfDay() / 60000;
+}
+
+} // namespace
+
+QString RdpHistoryEntry::targetKey() const {
+  return targetKeyOf(server, port, username, remoteApp);
+}
+
+RdpHistoryEntry RdpHistoryEntry::fromSettings(const RdpSettings &settings,
+                                              const QDateTime &when) {
+  RdpHistoryEntry entry;
+  entry.server = settings.server;
+  entry.port = settings.port;
+  entry.username = settings.username;
+  entry.remoteApp = settings.remoteAppMode;
+  entry.timestampMs = when.toMSecsSinceEpoch();
+  entry.minuteOfDay = minuteOfDay(when);
+  return entry;
+}
+
+QJsonObject RdpHistoryEntry::toJson() const {
+  QJsonObject object;
+  object.insert(kServer, server);
+  object.insert(kPort, port);
+  object.insert(kUsername, username);
+  object.insert(kRemoteApp, remoteApp);
+  object.insert(kTime, double(timestampMs));
+  object.insert(kMinute, minuteOfDay);
+  return object;
+}
+
+RdpHistoryEntry RdpHistoryEntry::fromJson(const QJsonObject &object) {
+  RdpHistoryEntry entry;
+  entry.server = object.value(kServer).toString();
+  entry.port = object.value(kPort).toInt(3389);
+  entry.username = object.value(kUsername).toString();
+  entry.remoteApp = object.value(kRemoteApp).toBool();
+  entry.timestampMs = qint64(object.value(kTime).toDouble());
+  entry.minuteOfDay = qBound(0, object.value(kMinute).toInt(), 24 * 60 - 1);
+  return entry;
+}
+
+QString RdpHistoryTarget::targetKey() const {
+  return targetKeyOf(server, port, username, remoteApp);
+}
+
+RdpConnectionHistory::RdpConnectionHistory(const QString &journalPath)
+    : m_path(journalPath), m_worker(nullptr), m_journalRecords(0),
+      m_maxEntries(500), m_halfLifeHours(7 * 24) {
+  if (m_path.isEmpty()) {
+    m_path =
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+        QStringLiteral("/history.journal");
+  }
+  load();
+}
+
+RdpConnectionHistory::~RdpConnectionHistory() {
+  waitForWrites();
+  m_journal.close();
+}
+
+RdpConnectionHistory *RdpConnectionHistory::instance() {
+  // 工作线程先于历史创建，退出时后销毁
+  RdcWorker *worker = RdcWorker::instance();
+  static RdpConnectionHistory history;
+  history.setWorker(worker);
+  return &history;
+}
+
+void RdpConnectionHistory::waitForWrites() { m_lastWrite.waitForFinished(); }
+
+void RdpConnectionHistory::setMaxEntries(int count) {
+  m_maxEntries = qMax(1, count);
+  if (m_entries.size() > m_maxEntries) {
+    m_entries.remove(0, m_entries.size() - m_maxEntries);
+  }
+}
+
+void RdpConnectionHistory::load() {
+  QFile file(m_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  while (!file.atEnd()) {
+    const QByteArray line = file.readLine().trimmed();
+    if (line.isEmpty()) {
+      continue;
+    }
+    ++m_journalRecords;
+    const QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) {
+      // 写入中途退出留下的半行
+      continue;
+    }
+    const RdpHistoryEntry entry = RdpHistoryEntry::fromJson(doc.object());
+    if (!entry.server.isEmpty()) {
+      m_entries.append(entry);
+    }
+  }
+  file.close();
+
+  if (m_entries.size() > m_maxEntries) {
+    m_entries.remove(0, m_entries.size() - m_maxEntries);
+  }
+  if (m_journalRecords > m_maxEntries * 2) {
+    compact();
+  }
+}
+
+void RdpConnectionHistory::record(const RdpHistoryEntry &entry) {
+  m_entries.append(entry);
+  if (m_entries.size() > m_maxEntries) {
+    m_entries.remove(0, m_entries.size() - m_maxEntries);
+  }
+
+  QByteArray line = QJsonDocument(entry.toJson()).toJson(QJsonDocument::Compact);
+  line.append('\n');
+  ++m_journalRecords;
+  if (m_worker) {
+    m_lastWrite = m_worker->post([this, line]() { writeJournal(line); });
+  } else {
+    writeJournal(line);
+  }
+}
+
+void RdpConnectionHistory::clear() {
+  m_entries.clear();
+  compact();
+}
+
+bool RdpConnectionHistory::compact() {
+  // 重写前让排队中的追加写入落盘，之后由这里独占日志文件
+  waitForWrites();
+  QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+  QSaveFile file(m_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot compact connection history: %1",
+                    m_path);
+    return false;
+  }
+  for (const RdpHistoryEntry &entry : qAsConst(m_entries)) {
+    file.write(QJsonDocument(entry.toJson()).toJson(QJsonDocument::Compact));
+    file.write("\n");
+  }
+  m_journal.close();
+  if (!file.commit()) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot compact connection history: %1",
+                    file.errorString());
+    return false;
+  }
+  m_journalRecords = m_entries.size();
+  return true;
+}
+
+bool RdpConnectionHistory::writeJournal(const QByteArray &line) {
+  if (!m_journal.isOpen()) {
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    m_journal.setFileName(m_path);
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      RDC_LOG_WARNING(RdcLog::General, 0,
+                      "Cannot open connection history: %1 %2", m_path,
+                      m_journal.errorString());
+      return false;
+    }
+  }
+  if (m_journal.write(line) != line.size() || !m_journal.flush()) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot write connection history: %1",
+                    m_journal.errorString());
+    return false;
+  }
+  return true;
+}
+
+QVector<RdpHistoryTarget> RdpConnectionHistory::predict(const QDateTime &now,
+                                                        int count) const {
+  const qint64 nowMs = now.toMSecsSinceEpoch();
+  const int nowMinute = minuteOfDay(now);
+
+  QHash<QString, RdpHistoryTarget> targets;
+  for (const RdpHistoryEntry &entry : m_entries) {
+    const double ageHours = qMax<qint64>(0, nowMs - entry.timestampMs) / 3.6e6;
+    const double recency = std::pow(0.5, ageHours / m_halfLifeHours);
+    int distance = qAbs(entry.minuteOfDay - nowMinute);
+    distance = qMin(distance, 24 * 60 - distance);
+    const double affinity = 1.0 + 2.0 * qMax(0.0, 1.0 - distance / 180.0);
+
+    RdpHistoryTarget &target = targets[entry.targetKey()];
+    if (!target.connects) {
+      target.server = entry.server;
+      target.port = entry.port;
+      target.username = entry.username;
+      target.remoteApp = entry.remoteApp;
+    }
+    target.score += recency * affinity;
+    ++target.connects;
+    target.lastUsedMs = qMax(target.lastUsedMs, entry.timestampMs);
+  }
+
+  QVector<RdpHistoryTarget> ranked;
+  ranked.reserve(targets.size());
+  for (const RdpHistoryTarget &target : qAsConst(targets)) {
+    ranked.append(target);
+  }
+  std::sort(ranked.begin(), ranked.end(),
+            [](const RdpHistoryTarget &a, const RdpHistoryTarget &b) {
+              if (a.score != b.score) {
+                return a.score > b.score;
+              }
+              return a.lastUsedMs > b.lastUsedMs;
+            });
+  if (ranked.size() > count) {
+    ranked.resize(qMax(0, count));
+  }
+  return ranked;
+}
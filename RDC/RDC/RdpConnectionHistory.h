@@ -0,0 +1,91 @@
+#ifndef RDPCONNECTIONHISTORY_H
+#define RDPCONNECTIONHISTORY_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QFuture>
+#include <QString>
+#include <QVector>
+
+class QJsonObject;
+class RdcWorker;
+struct RdpSettings;
+
+// 一次连接记录
+struct RdpHistoryEntry {
+  QString server;
+  int port = 3389;
+  QString username;
+  bool remoteApp = false;
+  qint64 timestampMs = 0; // UTC 毫秒
+  int minuteOfDay = 0;    // 连接时的本地时间（0~1439）
+
+  // 主机、端口、用户与模式相同即为同一目标
+  QString targetKey() const;
+
+  static RdpHistoryEntry fromSettings(const RdpSettings &settings,
+                                      const QDateTime &when);
+  QJsonObject toJson() const;
+  static RdpHistoryEntry fromJson(const QJsonObject &object);
+};
+
+// 预测的下一个连接目标
+struct RdpHistoryTarget {
+  QString server;
+  int port = 3389;
+  QString username;
+  bool remoteApp = false;
+  double score = 0;
+  int connects = 0;         // 历史中的连接次数
+  qint64 lastUsedMs = 0;
+
+  QString targetKey() const;
+};
+
+// 连接历史
+// 每次连接追加一行 JSON 到 AppDataLocation/history.journal，只保留最近
+// maxEntries 条，冗余过多时启动重写一次。predict 按历史为目标打分：
+// 每条记录按距今时间指数衰减（半衰期 halfLifeHours），连接时间与当前
+// 时刻相近（前后 3 小时内）的记录额外加权，得分高的目标在前。
+class RdpConnectionHistory {
+public:
+  explicit RdpConnectionHistory(const QString &journalPath = QString());
+  ~RdpConnectionHistory();
+
+  // 默认的全局实例，写入由 RdcWorker::instance() 执行
+  static RdpConnectionHistory *instance();
+
+  // 设置后追加写入在工作线程中执行；为 nullptr（默认）时同步写入
+  void setWorker(RdcWorker *worker) { m_worker = worker; }
+  void waitForWrites();
+
+  QString journalPath() const { return m_path; }
+  int maxEntries() const { return m_maxEntries; }
+  void setMaxEntries(int count);
+  double halfLifeHours() const { return m_halfLifeHours; }
+  void setHalfLifeHours(double hours) { m_halfLifeHours = qMax(0.1, hours); }
+
+  void record(const RdpHistoryEntry &entry);
+  // 按时间先后
+  const QVector<RdpHistoryEntry> &entries() const { return m_entries; }
+  void clear();
+
+  // 返回 now 时刻最可能的 count 个目标
+  QVector<RdpHistoryTarget> predict(const QDateTime &now, int count) const;
+
+private:
+  void load();
+  bool compact();
+  bool writeJournal(const QByteArray &line);
+
+  QString m_path;
+  RdcWorker *m_worker;
+  QFile m_journal; // 只在执行写入的线程中访问
+  QFuture<void> m_lastWrite;
+  QVector<RdpHistoryEntry> m_entries;
+  int m_journalRecords;
+  int m_maxEntries;
+  double m_halfLifeHours;
+};
+
+#endif // RDPCONNECTIONHISTORY_H
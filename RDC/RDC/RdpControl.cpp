@@ -0,0 +1,36 @@
+#include "RdpControl.h"
+#include "FakeRdpControl.h"
+#include "RdcLog.h"
+#ifdef Q_OS_WIN
+#include "AxRdpControl.h"
+#endif
+
+RdpControl *RdpControl::createDefault() {
+#ifdef Q_OS_WIN
+  if (qEnvironmentVariableIsEmpty("RDC_FAKE_CONTROL")) {
+    AxRdpControl *control = new AxRdpControl();
+    if (control->isNull()) {
+      delete control;
+      return nullptr;
+    }
+    return control;
+  }
+#endif
+  RDC_LOG_INFO(RdcLog::Control, 0, "Using in-process fake RDP control");
+  return new FakeRdpControl();
+}
+
+void RdpControl::postEvent(RdpEvent event) {
+  if (!m_eventRouter) {
+    return;
+  }
+  event.sessionId = m_eventSessionId;
+  m_eventRouter->post(std::move(event));
+}
+
+void RdpControl::postEvent(RdpEvent::Type type, int code) {
+  RdpEvent event;
+  event.type = type;
+  event.code = code;
+  postEvent(std::move(event));
+}
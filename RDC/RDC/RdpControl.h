@@ -0,0 +1,81 @@
+#ifndef RDPCONTROL_H
+#define RDPCONTROL_H
+
+#include "RdpEventRouter.h"
+#include <QObject>
+#include <QVariant>
+#include <QWidget>
+#include <functional>
+
+// 后期绑定（IDispatch 风格）的对象接口
+// 对应 QAxBase 的 setProperty / property / dynamicCall / querySubObject，
+// 但不依赖 QAxContainer，使会话逻辑可以脱离 Windows 运行。
+class RdpDispatch {
+public:
+  virtual ~RdpDispatch() {}
+
+  virtual bool setValue(const char *name, const QVariant &value) = 0;
+  virtual QVariant value(const char *name) = 0;
+  virtual QVariant dynamicCall(const char *function,
+                               const QVariantList &args = QVariantList()) = 0;
+  // 返回的子对象由调用方负责 delete，不支持时返回 nullptr
+  virtual RdpDispatch *querySubObject(const char *name) = 0;
+
+  // 解析属性的调度标识（IDispatch DISPID），不支持或不存在时返回 -1
+  virtual int dispatchId(const char *name) {
+    Q_UNUSED(name);
+    return -1;
+  }
+  // 按已解析的调度标识设置属性，省去每次调用的名称查找
+  virtual bool setValueById(int dispId, const char *name,
+                            const QVariant &value) {
+    Q_UNUSED(dispId);
+    return setValue(name, value);
+  }
+
+  // 对象本身占用内存的估算（字节），用于会话内存统计
+  virtual qint64 memoryFootprint() const { return 0; }
+};
+
+// RDP 控件后端：MsTscAx ActiveX 控件（AxRdpControl）或进程内模拟控件（FakeRdpControl）
+class RdpControl : public QObject, public RdpDispatch {
+  Q_OBJECT
+
+public:
+  explicit RdpControl(QObject *parent = nullptr)
+      : QObject(parent), m_eventRouter(nullptr), m_eventSessionId(0) {}
+
+  // 用于嵌入 RdpWindow 的可视控件，无界面后端返回 nullptr
+  virtual QWidget *widget() = 0;
+
+  // 断开后恢复到可复用的初始状态（由 RdpControlPool 在归还时调用）
+  virtual void reset() {}
+
+  // 暂停/恢复界面重绘，用于后台会话降级；不支持的后端忽略
+  virtual void setRenderingSuspended(bool suspended) { Q_UNUSED(suspended); }
+
+  // 控件版本标识（CLSID + 版本号），用作能力探测缓存的键
+  virtual QString version() { return QString(); }
+
+  // 默认后端：Windows 下为 MsTscAx，其它平台或设置了 RDC_FAKE_CONTROL 时为模拟控件
+  static RdpControl *createDefault();
+
+  // 之后的事件以 sessionId 投递到 router；router 为 nullptr 时丢弃事件
+  void setEventTarget(RdpEventRouter *router, int sessionId) {
+    m_eventRouter = router;
+    m_eventSessionId = sessionId;
+  }
+
+protected:
+  // 由后端在控件事件回调中调用
+  void postEvent(RdpEvent event);
+  void postEvent(RdpEvent::Type type, int code = 0);
+
+private:
+  RdpEventRouter *m_eventRouter;
+  int m_eventSessionId;
+};
+
+typedef std::function<RdpControl *()> RdpControlFactory;
+
+#endif // RDPCONTROL_H
@@ -0,0 +1,108 @@
+#include "RdpControlPool.h"
+#include "RdcLog.h"
+#include <QTimer>
+
+static RdpControlPool *s_instance = nullptr;
+
+RdpControlPool::RdpControlPool(const RdpControlFactory &factory,
+                               QObject *parent)
+    : QObject(parent), m_factory(factory), m_size(1), m_lowWatermark(1),
+      m_highWatermark(2), m_hits(0), m_misses(0), m_refillScheduled(false) {
+  if (!s_instance) {
+    s_instance = this;
+  }
+}
+
+RdpControlPool::~RdpControlPool() {
+  qDeleteAll(m_idle);
+  m_idle.clear();
+  if (s_instance == this) {
+    s_instance = nullptr;
+  }
+}
+
+RdpControlPool *RdpControlPool::instance() { return s_instance; }
+
+void RdpControlPool::setSize(int size) {
+  m_size = qMax(0, size);
+  m_highWatermark = qMax(m_highWatermark, m_size);
+  m_lowWatermark = qMin(m_lowWatermark, m_size);
+}
+
+void RdpControlPool::setLowWatermark(int count) {
+  m_lowWatermark = qBound(0, count, m_size);
+}
+
+void RdpControlPool::setHighWatermark(int count) {
+  m_highWatermark = qMax(count, m_size);
+}
+
+void RdpControlPool::warmUp() {
+  RDC_LOG_DEBUG(RdcLog::Control, 0,
+                "Warming up RDP control pool, target size: %1", m_size);
+  scheduleRefill();
+}
+
+RdpControl *RdpControlPool::acquire() {
+  RdpControl *control = nullptr;
+  if (!m_idle.isEmpty()) {
+    control = m_idle.takeFirst();
+    control->setParent(nullptr);
+    ++m_hits;
+  } else {
+    ++m_misses;
+    control = m_factory ? m_factory() : nullptr;
+  }
+
+  if (m_idle.size() < m_lowWatermark) {
+    scheduleRefill();
+  }
+  emit statsChanged();
+  return control;
+}
+
+void RdpControlPool::release(RdpControl *control) {
+  if (!control) {
+    return;
+  }
+
+  control->disconnect();
+  control->reset();
+  if (m_idle.size() >= m_highWatermark) {
+    delete control;
+  } else {
+    control->setParent(this);
+    m_idle.append(control);
+  }
+  emit statsChanged();
+}
+
+void RdpControlPool::scheduleRefill() {
+  if (m_refillScheduled || !m_factory) {
+    return;
+  }
+  m_refillScheduled = true;
+  QTimer::singleShot(0, this, &RdpControlPool::createNext);
+}
+
+void RdpControlPool::createNext() {
+  m_refillScheduled = false;
+  if (m_idle.size() >= m_size) {
+    return;
+  }
+
+  RdpControl *control = m_factory();
+  if (!control) {
+    RDC_LOG_WARNING(RdcLog::Control, 0,
+                    "RDP control pool failed to create a control");
+    return;
+  }
+  control->setParent(this);
+  m_idle.append(control);
+  emit statsChanged();
+
+  // 每次只创建一个，让出事件循环以免阻塞界面
+  if (m_idle.size() < m_size) {
+    scheduleRefill();
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef RDPCONTROLPOOL_H
+#define RDPCONTROLPOOL_H
+
+#include "RdpControl.h"
+#include <QList>
+#include <QObject>
+
+// 预热的 RDP 控件池
+// COM 控件的实例化是连接延迟中最大的一块，池在空闲时逐个预先创建控件，
+// connectToServer 直接取用，断开后控件被重置并归还，而不是销毁。
+// 控件必须在 GUI 线程创建，所以"后台"创建是在事件循环空闲时每次创建一个。
+class RdpControlPool : public QObject {
+  Q_OBJECT
+
+public:
+  explicit RdpControlPool(const RdpControlFactory &factory,
+                          QObject *parent = nullptr);
+  ~RdpControlPool();
+
+  // 进程内第一个创建的池，未创建时为 nullptr
+  static RdpControlPool *instance();
+
+  // 预热的目标数量
+  int size() const { return m_size; }
+  void setSize(int size);
+  // 空闲控件低于低水位时在后台补充到 size
+  int lowWatermark() const { return m_lowWatermark; }
+  void setLowWatermark(int count);
+  // 归还时空闲控件已达高水位则直接销毁
+  int highWatermark() const { return m_highWatermark; }
+  void setHighWatermark(int count);
+
+  int idleCount() const { return m_idle.size(); }
+  // 空闲控件低于低水位，断开的会话应归还控件
+  bool needsControls() const { return m_idle.size() < m_lowWatermark; }
+  // 空闲控件低于高水位，归还的控件会被保留而不是销毁
+  bool acceptsControls() const { return m_idle.size() < m_highWatermark; }
+  int hits() const { return m_hits; }
+  int misses() const { return m_misses; }
+
+  // 开始在后台创建控件，直到空闲数量达到 size
+  void warmUp();
+
+  // 取出一个控件（调用方拥有），池为空时同步创建，失败返回 nullptr
+  RdpControl *acquire();
+  // 重置控件并放回池中
+  void release(RdpControl *control);
+
+signals:
+  void statsChanged();
+
+private slots:
+  void createNext();
+
+private:
+  void scheduleRefill();
+
+  RdpControlFactory m_factory;
+  QList<RdpControl *> m_idle;
+  int m_size;
+  int m_lowWatermark;
+  int m_highWatermark;
+  int m_hits;
+  int m_misses;
+  bool m_refillScheduled;
+};
+
+#endif // RDPCONTROLPOOL_H
@@ -0,0 +1,109 @@
+#include "RdpDisplayDebouncer.h"
+
+RdpDisplaySize RdpDisplaySize::snapped() const {
+  RdpDisplaySize size;
+  size.width = qBound(200, width, 8192) & ~1;
+  size.height = qBound(200, height, 8192);
+  size.scaleFactor = qBound(100, scaleFactor, 500);
+  return size;
+}
+
+RdpDisplayDebouncer::RdpDisplayDebouncer(QObject *parent)
+    : QObject(parent), m_hasPending(false), m_firstRequestMs(0),
+      m_lastRequestMs(0), m_lastSettledMs(-1), m_quietPeriodMs(300),
+      m_maxDelayMs(3000), m_minIntervalMs(1000) {
+  m_clock.start();
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this, &RdpDisplayDebouncer::onTimeout);
+}
+
+void RdpDisplayDebouncer::setApplied(const RdpDisplaySize &size) {
+  m_applied = size.snapped();
+  // 待定的请求正好是会话当前尺寸时不必再下发
+  if (m_hasPending && m_pending == m_applied) {
+    cancel();
+  }
+}
+
+void RdpDisplayDebouncer::cancel() {
+  if (m_hasPending) {
+    ++m_stats.coalesced;
+  }
+  m_hasPending = false;
+  m_timer.stop();
+}
+
+void RdpDisplayDebouncer::requestSize(const QSize &size, int scaleFactor) {
+  RdpDisplaySize display;
+  display.width = size.width();
+  display.height = size.height();
+  display.scaleFactor = scaleFactor;
+  request(display);
+}
+
+void RdpDisplayDebouncer::request(const RdpDisplaySize &size) {
+  if (!size.isValid()) {
+    return;
+  }
+  ++m_stats.requests;
+  const RdpDisplaySize snapped = size.snapped();
+  const qint64 now = m_clock.elapsed();
+
+  if (m_hasPending) {
+    // 被新的请求覆盖
+    ++m_stats.coalesced;
+  } else {
+    m_firstRequestMs = now;
+  }
+  m_lastRequestMs = now;
+
+  // 拖回原来的尺寸：不需要下发
+  if (snapped == m_applied) {
+    ++m_stats.coalesced;
+    m_hasPending = false;
+    m_timer.stop();
+    return;
+  }
+
+  m_pending = snapped;
+  m_hasPending = true;
+  schedule();
+}
+
+void RdpDisplayDebouncer::flush() {
+  if (!m_hasPending) {
+    return;
+  }
+  m_timer.stop();
+  m_hasPending = false;
+  m_applied = m_pending;
+  m_lastSettledMs = m_clock.elapsed();
+  ++m_stats.settled;
+  emit settled(m_applied);
+}
+
+qint64 RdpDisplayDebouncer::dueTime() const {
+  // 停止变化后下发，但持续变化时不无限推迟
+  qint64 due = qMin(m_lastRequestMs + m_quietPeriodMs,
+                    m_firstRequestMs + m_maxDelayMs);
+  if (m_lastSettledMs >= 0) {
+    due = qMax(due, m_lastSettledMs + m_minIntervalMs);
+  }
+  return due;
+}
+
+void RdpDisplayDebouncer::schedule() {
+  const qint64 wait = dueTime() - m_clock.elapsed();
+  m_timer.start(int(qMax<qint64>(0, wait)));
+}
+
+void RdpDisplayDebouncer::onTimeout() {
+  if (!m_hasPending) {
+    return;
+  }
+  if (dueTime() > m_clock.elapsed()) {
+    schedule();
+    return;
+  }
+  flush();
+}
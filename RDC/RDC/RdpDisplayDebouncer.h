@@ -0,0 +1,94 @@
+#ifndef RDPDISPLAYDEBOUNCER_H
+#define RDPDISPLAYDEBOUNCER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSize>
+#include <QTimer>
+
+// 远程桌面的显示尺寸（像素）与缩放
+struct RdpDisplaySize {
+  int width = 0;
+  int height = 0;
+  int scaleFactor = 100; // 桌面缩放百分比
+
+  bool isValid() const { return width > 0 && height > 0; }
+  bool operator==(const RdpDisplaySize &other) const {
+    return width == other.width && height == other.height &&
+           scaleFactor == other.scaleFactor;
+  }
+  bool operator!=(const RdpDisplaySize &other) const {
+    return !(*this == other);
+  }
+
+  // 服务端接受的尺寸：宽高在 200~8192 之间且宽为偶数（向下取偶），
+  // 缩放在 100~500 之间
+  RdpDisplaySize snapped() const;
+};
+
+// 窗口尺寸变化的合并与限速
+// 拖动窗口边框会在一秒内产生上百次尺寸变化，每次都重新协商分辨率会让
+// 远程桌面反复重排。请求先按服务端规则取整，停止变化 quietPeriod 后才
+// 下发；持续变化时最迟 maxDelay 下发一次；两次下发至少间隔 minInterval。
+// 与已下发尺寸相同的请求被丢弃。
+class RdpDisplayDebouncer : public QObject {
+  Q_OBJECT
+
+public:
+  struct Stats {
+    quint64 requests = 0;  // 收到的尺寸变化
+    quint64 coalesced = 0; // 被后续请求覆盖或与已下发尺寸相同
+    quint64 settled = 0;   // 实际下发
+  };
+
+  explicit RdpDisplayDebouncer(QObject *parent = nullptr);
+
+  int quietPeriod() const { return m_quietPeriodMs; }
+  void setQuietPeriod(int ms) { m_quietPeriodMs = qMax(0, ms); }
+  int maxDelay() const { return m_maxDelayMs; }
+  void setMaxDelay(int ms) { m_maxDelayMs = qMax(0, ms); }
+  int minInterval() const { return m_minIntervalMs; }
+  void setMinInterval(int ms) { m_minIntervalMs = qMax(0, ms); }
+
+  bool hasPending() const { return m_hasPending; }
+  RdpDisplaySize pending() const { return m_pending; }
+  // 最近下发（或会话当前）的尺寸，相同的请求不再下发
+  RdpDisplaySize applied() const { return m_applied; }
+  // 会话以 size 建立连接或重连后调用；不清除待定的请求
+  void setApplied(const RdpDisplaySize &size);
+  // 丢弃待定的请求
+  void cancel();
+  const Stats &stats() const { return m_stats; }
+
+public slots:
+  void request(const RdpDisplaySize &size);
+  // RdpWindow::displaySizeChanged 的参数形式
+  void requestSize(const QSize &size, int scaleFactor);
+  // 立即下发待定的请求（忽略等待与限速）
+  void flush();
+
+signals:
+  void settled(const RdpDisplaySize &size);
+
+private slots:
+  void onTimeout();
+
+private:
+  qint64 dueTime() const;
+  void schedule();
+
+  QTimer m_timer;
+  QElapsedTimer m_clock;
+  RdpDisplaySize m_pending;
+  RdpDisplaySize m_applied;
+  bool m_hasPending;
+  qint64 m_firstRequestMs; // 本轮第一个请求
+  qint64 m_lastRequestMs;
+  qint64 m_lastSettledMs;  // -1 表示尚未下发
+  int m_quietPeriodMs;
+  int m_maxDelayMs;
+  int m_minIntervalMs;
+  Stats m_stats;
+};
+
+#endif // RDPDISPLAYDEBOUNCER_H
@@ -0,0 +1,142 @@
+#include "RdpEventRouter.h"
+#include <QCoreApplication>
+#include <QTextStream>
+
+RdpEvent::RailResult RdpEvent::railResult() const {
+  if (type != RemoteProgramResult || code < RailOk || code > RailHookNotLoaded) {
+    return RailUnknown;
+  }
+  return RailResult(code);
+}
+
+const char *RdpEvent::typeName(Type type) {
+  switch (type) {
+  case Connected:
+    return "connected";
+  case Disconnected:
+    return "disconnected";
+  case LoginComplete:
+    return "login_complete";
+  case FatalError:
+    return "fatal_error";
+  case RemoteProgramResult:
+    return "remote_program_result";
+  case RemoteWindowDisplayed:
+    return "remote_window_displayed";
+  default:
+    return "unknown";
+  }
+}
+
+RdpEventRouter::RdpEventRouter(QObject *parent)
+    : QObject(parent), m_drainScheduled(false), m_dispatched(0),
+      m_dropped(0) {
+  m_clock.start();
+}
+
+RdpEventRouter *RdpEventRouter::instance() {
+  static RdpEventRouter router;
+  return &router;
+}
+
+void RdpEventRouter::attach(int sessionId, RdpEventHandler *handler) {
+  m_handlers.insert(sessionId, handler);
+}
+
+void RdpEventRouter::detach(int sessionId) { m_handlers.remove(sessionId); }
+
+void RdpEventRouter::post(RdpEvent event) {
+  event.timestampNs = m_clock.nsecsElapsed();
+  m_queue.append(std::move(event));
+  if (!m_drainScheduled) {
+    m_drainScheduled = true;
+    QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+  }
+}
+
+void RdpEventRouter::drain() {
+  m_drainScheduled = false;
+  // 处理者中投递的事件进入下一轮；处理者进入嵌套事件循环时也不会重复分发
+  QVector<RdpEvent> batch;
+  batch.swap(m_queue);
+  for (const RdpEvent &event : qAsConst(batch)) {
+    // 每个事件重新查表：前面的事件可能已使会话注销或销毁
+    RdpEventHandler *handler = m_handlers.value(event.sessionId);
+    if (!handler) {
+      ++m_dropped;
+      continue;
+    }
+    m_queueUs.record((m_clock.nsecsElapsed() - event.timestampNs) / 1000);
+    ++m_dispatched;
+    handler->handleEvent(event);
+  }
+}
+
+namespace {
+
+class CountingHandler : public RdpEventHandler {
+public:
+  void handleEvent(const RdpEvent &event) override {
+    ++count;
+    lastCode = event.code;
+  }
+
+  quint64 count = 0;
+  int lastCode = 0;
+};
+
+} // namespace
+
+void RdpEventRouter::runBenchmark(int events, QTextStream &out) {
+  // 每轮事件循环到达的事件数，接近多个会话同时断开或登录的情况
+  const int batchSize = 64;
+  const int sessionCounts[] = {1, 10, 100, 1000, 10000};
+
+  out << "event dispatch benchmark: " << events << " events per run\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+             .arg(QStringLiteral("sessions"), -10)
+             .arg(QStringLiteral("events/s"), 12)
+             .arg(QStringLiteral("ns/event"), 10)
+             .arg(QStringLiteral("p50 us"), 10)
+             .arg(QStringLiteral("p99 us"), 10);
+
+  for (const int sessions : sessionCounts) {
+    RdpEventRouter router;
+    QVector<CountingHandler> handlers(sessions);
+    for (int i = 0; i < sessions; ++i) {
+      router.attach(i + 1, &handlers[i]);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < events; ++i) {
+      RdpEvent event;
+      event.type = RdpEvent::Type(i % (RdpEvent::RemoteWindowDisplayed + 1));
+      // 打散会话顺序，避免只命中相邻的哈希桶
+      event.sessionId = int(quint32(i) * 2654435761u % quint32(sessions)) + 1;
+      event.code = i;
+      router.post(event);
+      if ((i + 1) % batchSize == 0 || i + 1 == events) {
+        QCoreApplication::sendPostedEvents(&router, QEvent::MetaCall);
+      }
+    }
+    const qint64 elapsedNs = timer.nsecsElapsed();
+
+    quint64 handled = 0;
+    for (const CountingHandler &handler : qAsConst(handlers)) {
+      handled += handler.count;
+    }
+    if (handled != quint64(events)) {
+      out << "  " << sessions << " sessions: only " << handled << " of "
+          << events << " events dispatched\n";
+    }
+    const double seconds = elapsedNs / 1e9;
+    out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+               .arg(sessions, -10)
+               .arg(seconds > 0 ? events / seconds : 0.0, 12, 'f', 0)
+               .arg(double(elapsedNs) / qMax(1, events), 10, 'f', 1)
+               .arg(router.queueLatency().percentile(50), 10)
+               .arg(router.queueLatency().percentile(99), 10);
+  }
+  out.flush();
+}
@@ -0,0 +1,100 @@
+#ifndef RDPEVENTROUTER_H
+#define RDPEVENTROUTER_H
+
+#include "RdpMetrics.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class QTextStream;
+
+// 规范化后的控件事件
+// 控件后端在事件回调中只填写这个结构并排队，会话在事件循环中处理。
+struct RdpEvent {
+  enum Type : quint8 {
+    Connected,
+    Disconnected,
+    LoginComplete,
+    FatalError,
+    RemoteProgramResult,
+    RemoteWindowDisplayed
+  };
+
+  // OnRemoteProgramResult 的 RemoteProgramResult 枚举
+  enum RailResult : qint8 {
+    RailUnknown = -1,
+    RailOk = 0,
+    RailLocked,
+    RailProtocolError,
+    RailNotInWhitelist,
+    RailNetworkPathDenied,
+    RailFileNotFound,
+    RailFailure,
+    RailHookNotLoaded
+  };
+
+  Type type = Connected;
+  bool flag = false; // RemoteProgramResult: 是否可执行；RemoteWindowDisplayed: 是否可见
+  int sessionId = 0;
+  int code = 0; // Disconnected 原因 / FatalError 错误码 / RemoteProgramResult 原始结果
+  qint64 timestampNs = 0; // 控件发出事件的时间（RdpEventRouter 时钟）
+  qlonglong windowId = 0;    // RemoteWindowDisplayed
+  QString executablePath;    // RemoteProgramResult
+
+  RailResult railResult() const;
+  static const char *typeName(Type type);
+};
+Q_DECLARE_TYPEINFO(RdpEvent, Q_MOVABLE_TYPE);
+
+// 按会话接收事件
+class RdpEventHandler {
+public:
+  virtual ~RdpEventHandler() {}
+  virtual void handleEvent(const RdpEvent &event) = 0;
+};
+
+// 控件事件队列
+// 一轮事件循环中投递的事件合并为一次排队调用，按投递顺序经会话 ID 查表
+// 分发给对应的处理者，分发开销与会话数量无关。未注册（已释放控件或已
+// 销毁）的会话的事件被丢弃。只在 GUI 线程使用。
+class RdpEventRouter : public QObject {
+  Q_OBJECT
+
+public:
+  explicit RdpEventRouter(QObject *parent = nullptr);
+
+  static RdpEventRouter *instance();
+
+  void attach(int sessionId, RdpEventHandler *handler);
+  void detach(int sessionId);
+  int sessionCount() const { return m_handlers.size(); }
+
+  // 记下时间并排队
+  void post(RdpEvent event);
+  qint64 nowNs() const { return m_clock.nsecsElapsed(); }
+
+  int pendingCount() const { return m_queue.size(); }
+  quint64 dispatchedCount() const { return m_dispatched; }
+  quint64 droppedCount() const { return m_dropped; }
+  // 事件从投递到交给处理者的延迟（微秒）
+  const RdpLatencyHistogram &queueLatency() const { return m_queueUs; }
+
+  // 用模拟事件源测量不同会话数下的分发吞吐量
+  static void runBenchmark(int events, QTextStream &out);
+
+private slots:
+  void drain();
+
+private:
+  QElapsedTimer m_clock;
+  QHash<int, RdpEventHandler *> m_handlers;
+  QVector<RdpEvent> m_queue;
+  bool m_drainScheduled;
+  quint64 m_dispatched;
+  quint64 m_dropped;
+  RdpLatencyHistogram m_queueUs;
+};
+
+#endif // RDPEVENTROUTER_H
@@ -0,0 +1,632 @@
+#include "RdpFile.h"
+#include "RdcLog.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QUrl>
+
+namespace {
+
+const QString kFullAddress = QStringLiteral("full address");
+const QString kServerPort = QStringLiteral("server port");
+const QString kUsername = QStringLiteral("username");
+const QString kDesktopWidth = QStringLiteral("desktopwidth");
+const QString kDesktopHeight = QStringLiteral("desktopheight");
+const QString kSessionBpp = QStringLiteral("session bpp");
+const QString kScreenMode = QStringLiteral("screen mode id");
+const QString kDynamicResolution = QStringLiteral("dynamic resolution");
+const QString kAudioMode = QStringLiteral("audiomode");
+const QString kRedirectClipboard = QStringLiteral("redirectclipboard");
+const QString kRedirectPrinters = QStringLiteral("redirectprinters");
+const QString kRemoteAppMode = QStringLiteral("remoteapplicationmode");
+const QString kRemoteAppProgram = QStringLiteral("remoteapplicationprogram");
+const QString kRemoteAppFile = QStringLiteral("remoteapplicationfile");
+const QString kRemoteAppCmdLine = QStringLiteral("remoteapplicationcmdline");
+const QString kRemoteAppExpandCmdLine =
+    QStringLiteral("remoteapplicationexpandcmdline");
+const QString kRemoteAppExpandWorkingDir =
+    QStringLiteral("remoteapplicationexpandworkingdir");
+const QString kWorkingDirectory = QStringLiteral("shell working directory");
+
+// 按行扫描 .rdp 内容，Char 为 char（UTF-8）或 ushort（UTF-16LE）。
+// 回调拿到的是指向原始缓冲区的指针，不做任何拷贝。
+template <typename Char, typename Callback>
+void scanLines(const Char *data, qint64 size, Callback callback) {
+  const Char *end = data + size;
+  const Char *line = data;
+  while (line < end) {
+    const Char *lineEnd = line;
+    while (lineEnd < end && lineEnd[0] != Char('\n')) {
+      ++lineEnd;
+    }
+    const Char *next = lineEnd < end ? lineEnd + 1 : end;
+    while (lineEnd > line &&
+           (lineEnd[-1] == Char('\r') || lineEnd[-1] == Char(' '))) {
+      --lineEnd;
+    }
+
+    // key:type:value，key 中不含 ':'，value 中可以含 ':'
+    const Char *colon = line;
+    while (colon < lineEnd && *colon != Char(':')) {
+      ++colon;
+    }
+    if (colon > line && lineEnd - colon >= 3 && colon[2] == Char(':')) {
+      callback(line, int(colon - line), colon[1], colon + 3,
+               int(lineEnd - (colon + 3)));
+    }
+    line = next;
+  }
+}
+
+QString toQString(const char *text, int length) {
+  return QString::fromUtf8(text, length);
+}
+
+QString toQString(const ushort *text, int length) {
+  return QString::fromUtf16(text, length);
+}
+
+// 大小写不敏感地比较原始键与 ASCII 小写字面量
+template <typename Char>
+bool keyEquals(const Char *key, int length, const char *literal) {
+  int i = 0;
+  for (; i < length; ++i) {
+    if (!literal[i]) {
+      return false;
+    }
+    Char c = key[i];
+    if (c >= Char('A') && c <= Char('Z')) {
+      c = Char(c - 'A' + 'a');
+    }
+    if (c != Char(literal[i])) {
+      return false;
+    }
+  }
+  return !literal[i];
+}
+
+// 检测编码，返回正文起始偏移
+RdpFile::Encoding detectEncoding(const uchar *data, qint64 size,
+                                 qint64 *offset) {
+  if (size >= 2 && data[0] == 0xff && data[1] == 0xfe) {
+    *offset = 2;
+    return RdpFile::Utf16Le;
+  }
+  if (size >= 3 && data[0] == 0xef && data[1] == 0xbb && data[2] == 0xbf) {
+    *offset = 3;
+    return RdpFile::Utf8;
+  }
+  *offset = 0;
+  // 无 BOM 的 UTF-16LE：ASCII 字符的高字节为 0
+  if (size >= 2 && data[0] != 0 && data[1] == 0) {
+    return RdpFile::Utf16Le;
+  }
+  return RdpFile::Utf8;
+}
+
+// 以 Callback(key, keyLength, type, value, valueLength) 遍历任意编码的内容
+template <typename Callback>
+RdpFile::Encoding scanBuffer(const uchar *data, qint64 size,
+                             Callback callback) {
+  qint64 offset = 0;
+  const RdpFile::Encoding encoding = detectEncoding(data, size, &offset);
+  if (encoding == RdpFile::Utf16Le) {
+    scanLines(reinterpret_cast<const ushort *>(data + offset),
+              (size - offset) / 2, callback);
+  } else {
+    scanLines(reinterpret_cast<const char *>(data + offset), size - offset,
+              callback);
+  }
+  return encoding;
+}
+
+// "host"、"host:port" 或 "[v6]:port"
+void splitAddress(const QString &address, QString *host, int *port) {
+  *host = address;
+  if (address.startsWith(QLatin1Char('['))) {
+    const int close = address.indexOf(QLatin1Char(']'));
+    if (close > 0) {
+      *host = address.mid(1, close - 1);
+      if (address.midRef(close + 1).startsWith(QLatin1Char(':'))) {
+        bool ok = false;
+        const int value = address.midRef(close + 2).toInt(&ok);
+        if (ok) {
+          *port = value;
+        }
+      }
+    }
+    return;
+  }
+  const int colon = address.indexOf(QLatin1Char(':'));
+  if (colon > 0 && address.indexOf(QLatin1Char(':'), colon + 1) < 0) {
+    bool ok = false;
+    const int value = address.midRef(colon + 1).toInt(&ok);
+    if (ok) {
+      *host = address.left(colon);
+      *port = value;
+    }
+  }
+}
+
+} // namespace
+
+RdpFile RdpFile::parse(const QByteArray &data) {
+  RdpFile file;
+  file.m_encoding = scanBuffer(
+      reinterpret_cast<const uchar *>(data.constData()), data.size(),
+      [&file](const auto *key, int keyLength, auto type, const auto *value,
+              int valueLength) {
+        file.setValue(toQString(key, keyLength), QChar(ushort(type)),
+                      toQString(value, valueLength));
+      });
+  return file;
+}
+
+RdpFile RdpFile::load(const QString &path, QString *error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = QString::fromUtf8("无法打开文件 %1: %2")
+                   .arg(path, file.errorString());
+    }
+    return RdpFile();
+  }
+
+  const qint64 size = file.size();
+  uchar *data = size > 0 ? file.map(0, size) : nullptr;
+  if (!data) {
+    return parse(file.readAll());
+  }
+  // 直接在映射内存上解析，解析结果只持有各个值的拷贝
+  RdpFile result =
+      parse(QByteArray::fromRawData(reinterpret_cast<const char *>(data),
+                                    int(size)));
+  file.unmap(data);
+  return result;
+}
+
+bool RdpFile::save(const QString &path, QString *error) const {
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(serialize()) < 0 ||
+      !file.commit()) {
+    if (error) {
+      *error = QString::fromUtf8("无法保存文件 %1: %2")
+                   .arg(path, file.errorString());
+    }
+    return false;
+  }
+  return true;
+}
+
+QByteArray RdpFile::serialize() const {
+  QString text;
+  for (const RdpFileEntry &entry : m_entries) {
+    text += entry.key;
+    text += QLatin1Char(':');
+    text += entry.type;
+    text += QLatin1Char(':');
+    text += entry.value;
+    text += QLatin1String("\r\n");
+  }
+
+  if (m_encoding == Utf8) {
+    return text.toUtf8();
+  }
+  // 与 mstsc 保存的文件一致：带 BOM 的 UTF-16LE
+  QByteArray data("\xff\xfe", 2);
+  data.reserve(2 + text.size() * 2);
+  for (const QChar c : text) {
+    data.append(char(c.unicode() & 0xff));
+    data.append(char(c.unicode() >> 8));
+  }
+  return data;
+}
+
+QString RdpFile::localPath(const QString &pathOrUrl) {
+  const QUrl url(pathOrUrl);
+  return url.isLocalFile() ? url.toLocalFile() : pathOrUrl;
+}
+
+bool RdpFile::contains(const QString &key) const {
+  return m_index.contains(key.toLower());
+}
+
+QString RdpFile::value(const QString &key, const QString &defaultValue) const {
+  const auto it = m_index.constFind(key.toLower());
+  return it == m_index.constEnd() ? defaultValue : m_entries[*it].value;
+}
+
+int RdpFile::intValue(const QString &key, int defaultValue) const {
+  const auto it = m_index.constFind(key.toLower());
+  if (it == m_index.constEnd()) {
+    return defaultValue;
+  }
+  bool ok = false;
+  const int value = m_entries[*it].value.toInt(&ok);
+  return ok ? value : defaultValue;
+}
+
+void RdpFile::setString(const QString &key, const QString &value) {
+  setValue(key, QLatin1Char('s'), value);
+}
+
+void RdpFile::setInt(const QString &key, int value) {
+  setValue(key, QLatin1Char('i'), QString::number(value));
+}
+
+void RdpFile::setValue(const QString &key, QChar type, const QString &value) {
+  const QString lower = key.toLower();
+  const auto it = m_index.constFind(lower);
+  if (it != m_index.constEnd()) {
+    // 重复的键以最后一次出现为准，位置保持不变
+    RdpFileEntry &entry = m_entries[*it];
+    entry.type = type;
+    entry.value = value;
+    return;
+  }
+  m_index.insert(lower, m_entries.size());
+  m_entries.append(RdpFileEntry{key, type, value});
+}
+
+RdpSettings RdpFile::toSettings(const RdpSettings &base) const {
+  RdpSettings settings = base;
+
+  settings.port = intValue(kServerPort, settings.port);
+  if (contains(kFullAddress)) {
+    splitAddress(value(kFullAddress), &settings.server, &settings.port);
+  }
+  settings.username = value(kUsername, settings.username);
+  settings.desktopWidth = intValue(kDesktopWidth, settings.desktopWidth);
+  settings.desktopHeight = intValue(kDesktopHeight, settings.desktopHeight);
+  settings.colorDepth = intValue(kSessionBpp, settings.colorDepth);
+  if (contains(kScreenMode)) {
+    settings.fullScreen = intValue(kScreenMode, 1) == 2;
+  }
+  settings.dynamicResolution =
+      intValue(kDynamicResolution, settings.dynamicResolution) != 0;
+  if (contains(kAudioMode)) {
+    // 0: 本地播放 1: 在远程计算机播放 2: 不播放
+    settings.enableSound = intValue(kAudioMode, 0) == 0;
+  }
+  settings.enableClipboard =
+      intValue(kRedirectClipboard, settings.enableClipboard) != 0;
+  settings.enablePrinter =
+      intValue(kRedirectPrinters, settings.enablePrinter) != 0;
+
+  settings.remoteAppMode = intValue(kRemoteAppMode, settings.remoteAppMode) != 0;
+  settings.executablePath = value(kRemoteAppProgram, settings.executablePath);
+  settings.filePath = value(kRemoteAppFile, settings.filePath);
+  settings.arguments = value(kRemoteAppCmdLine, settings.arguments);
+  settings.expandEnvVarInArguments =
+      intValue(kRemoteAppExpandCmdLine, settings.expandEnvVarInArguments) != 0;
+  settings.workingDirectory =
+      value(kWorkingDirectory, settings.workingDirectory);
+  settings.expandEnvVarInWorkingDirectory =
+      intValue(kRemoteAppExpandWorkingDir,
+               settings.expandEnvVarInWorkingDirectory) != 0;
+  return settings;
+}
+
+void RdpFile::updateFrom(const RdpSettings &settings) {
+  setString(kFullAddress, settings.server);
+  setInt(kServerPort, settings.port);
+  setString(kUsername, settings.username);
+  setInt(kDesktopWidth, settings.desktopWidth);
+  setInt(kDesktopHeight, settings.desktopHeight);
+  setInt(kSessionBpp, settings.colorDepth);
+  setInt(kScreenMode, settings.fullScreen ? 2 : 1);
+  setInt(kDynamicResolution, settings.dynamicResolution ? 1 : 0);
+  // 关闭声音时保留文件中原有的非本地模式（1 或 2）
+  if (settings.enableSound) {
+    setInt(kAudioMode, 0);
+  } else if (intValue(kAudioMode, 0) == 0) {
+    setInt(kAudioMode, 2);
+  }
+  setInt(kRedirectClipboard, settings.enableClipboard ? 1 : 0);
+  setInt(kRedirectPrinters, settings.enablePrinter ? 1 : 0);
+
+  setInt(kRemoteAppMode, settings.remoteAppMode ? 1 : 0);
+  if (settings.remoteAppMode || contains(kRemoteAppProgram)) {
+    setString(kRemoteAppProgram, settings.executablePath);
+    setString(kRemoteAppFile, settings.filePath);
+    setString(kRemoteAppCmdLine, settings.arguments);
+    setInt(kRemoteAppExpandCmdLine, settings.expandEnvVarInArguments ? 1 : 0);
+    setString(kWorkingDirectory, settings.workingDirectory);
+    setInt(kRemoteAppExpandWorkingDir,
+           settings.expandEnvVarInWorkingDirectory ? 1 : 0);
+  }
+}
+
+QVector<RdpFileSummary> RdpFileIndexer::indexDirectory(const QString &dirPath,
+                                                       bool recursive) {
+  QElapsedTimer timer;
+  timer.start();
+  m_fileCount = 0;
+  m_failedCount = 0;
+  m_bytesScanned = 0;
+
+  QVector<RdpFileSummary> summaries;
+  QDirIterator it(dirPath, QStringList() << QStringLiteral("*.rdp"),
+                  QDir::Files | QDir::Readable,
+                  recursive ? QDirIterator::Subdirectories
+                            : QDirIterator::NoIteratorFlags);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    RdpFileSummary summary;
+    if (summarize(path, &summary)) {
+      summaries.append(summary);
+      ++m_fileCount;
+      m_bytesScanned += it.fileInfo().size();
+    } else {
+      ++m_failedCount;
+    }
+  }
+
+  m_elapsedMs = timer.elapsed();
+  RDC_LOG_DEBUG(RdcLog::General, 0,
+                "Indexed %1 .rdp files from %2 in %3 ms, %4 bytes, %5 failed",
+                m_fileCount, dirPath, m_elapsedMs, m_bytesScanned,
+                m_failedCount);
+  return summaries;
+}
+
+bool RdpFileIndexer::summarize(const QString &path, RdpFileSummary *summary) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Cannot open %1: %2", path,
+                    file.errorString());
+    return false;
+  }
+
+  const qint64 size = file.size();
+  summary->path = path;
+  if (size == 0) {
+    return true;
+  }
+
+  // 映射失败（如某些网络文件系统）时退回一次性读取
+  QByteArray fallback;
+  const uchar *data = file.map(0, size);
+  if (!data) {
+    fallback = file.readAll();
+    data = reinterpret_cast<const uchar *>(fallback.constData());
+  }
+
+  int serverPort = -1;
+  QString address;
+  scanBuffer(data, size,
+             [&](const auto *key, int keyLength, auto, const auto *value,
+                 int valueLength) {
+               if (keyEquals(key, keyLength, "full address")) {
+                 address = toQString(value, valueLength);
+               } else if (keyEquals(key, keyLength, "server port")) {
+                 serverPort = toQString(value, valueLength).toInt();
+               } else if (keyEquals(key, keyLength, "username")) {
+                 summary->username = toQString(value, valueLength);
+               } else if (keyEquals(key, keyLength,
+                                    "remoteapplicationprogram")) {
+                 summary->remoteProgram = toQString(value, valueLength);
+               }
+             });
+
+  if (serverPort > 0) {
+    summary->port = serverPort;
+  }
+  splitAddress(address, &summary->server, &summary->port);
+
+  if (fallback.isNull()) {
+    file.unmap(const_cast<uchar *>(data));
+  }
+  return true;
+}
+
+namespace {
+
+// mstsc 保存的典型文件：已知的键之外还有三十多个本程序不识别的键
+RdpFile benchmarkFile(int i) {
+  RdpFile file;
+  file.setInt(QStringLiteral("screen mode id"), 2);
+  file.setInt(QStringLiteral("use multimon"), 0);
+  file.setInt(QStringLiteral("desktopwidth"), 1920);
+  file.setInt(QStringLiteral("desktopheight"), 1080);
+  file.setInt(QStringLiteral("session bpp"), 32);
+  file.setString(QStringLiteral("winposstr"), QStringLiteral("0,3,0,0,800,600"));
+  file.setInt(QStringLiteral("compression"), 1);
+  file.setInt(QStringLiteral("keyboardhook"), 2);
+  file.setInt(QStringLiteral("audiocapturemode"), 0);
+  file.setInt(QStringLiteral("videoplaybackmode"), 1);
+  file.setInt(QStringLiteral("connection type"), 7);
+  file.setInt(QStringLiteral("networkautodetect"), 1);
+  file.setInt(QStringLiteral("bandwidthautodetect"), 1);
+  file.setInt(QStringLiteral("displayconnectionbar"), 1);
+  file.setInt(QStringLiteral("enableworkspacereconnect"), 0);
+  file.setInt(QStringLiteral("disable wallpaper"), 0);
+  file.setInt(QStringLiteral("allow font smoothing"), 0);
+  file.setInt(QStringLiteral("allow desktop composition"), 0);
+  file.setInt(QStringLiteral("disable full window drag"), 1);
+  file.setInt(QStringLiteral("disable menu anims"), 1);
+  file.setInt(QStringLiteral("disable themes"), 0);
+  file.setInt(QStringLiteral("disable cursor setting"), 0);
+  file.setInt(QStringLiteral("bitmapcachepersistenable"), 1);
+  file.setString(QStringLiteral("full address"),
+                 QStringLiteral("host-%1.corp.example:3390").arg(i));
+  file.setInt(QStringLiteral("audiomode"), 0);
+  file.setInt(QStringLiteral("redirectprinters"), 1);
+  file.setInt(QStringLiteral("redirectcomports"), 0);
+  file.setInt(QStringLiteral("redirectsmartcards"), 1);
+  file.setInt(QStringLiteral("redirectclipboard"), 1);
+  file.setInt(QStringLiteral("redirectposdevices"), 0);
+  file.setInt(QStringLiteral("autoreconnection enabled"), 1);
+  file.setInt(QStringLiteral("authentication level"), 2);
+  file.setInt(QStringLiteral("prompt for credentials"), 0);
+  file.setInt(QStringLiteral("negotiate security layer"), 1);
+  file.setString(QStringLiteral("alternate shell"), QString());
+  file.setString(QStringLiteral("shell working directory"), QString());
+  file.setString(QStringLiteral("gatewayhostname"),
+                 QStringLiteral("gateway.corp.example"));
+  file.setInt(QStringLiteral("gatewayusagemethod"), 4);
+  file.setInt(QStringLiteral("gatewaycredentialssource"), 4);
+  file.setInt(QStringLiteral("gatewayprofileusagemethod"), 0);
+  file.setInt(QStringLiteral("promptcredentialonce"), 0);
+  file.setInt(QStringLiteral("use redirection server name"), 0);
+  file.setInt(QStringLiteral("rdgiskdcproxy"), 0);
+  file.setString(QStringLiteral("kdcproxyname"), QString());
+  file.setString(QStringLiteral("drivestoredirect"), QString());
+  file.setString(QStringLiteral("username"),
+                 QStringLiteral("CORP\\user%1").arg(i % 100));
+  if (i % 2) {
+    file.setInt(QStringLiteral("remoteapplicationmode"), 1);
+    file.setString(QStringLiteral("remoteapplicationprogram"),
+                   QStringLiteral("||app%1").arg(i % 10));
+    file.setString(QStringLiteral("remoteapplicationcmdline"),
+                   QStringLiteral("/open \"C:\\Data\\%1.xlsx\"").arg(i));
+  }
+  return file;
+}
+
+} // namespace
+
+int RdpFile::runBenchmark(int files, QTextStream &out) {
+  int failures = 0;
+  QVector<QByteArray> blobs;
+  blobs.reserve(files);
+  qint64 totalBytes = 0;
+  for (int i = 0; i < files; ++i) {
+    RdpFile file = benchmarkFile(i);
+    // mstsc 写 UTF-16LE，其他工具生成的文件多为 UTF-8
+    file.setEncoding(i % 4 == 3 ? Utf8 : Utf16Le);
+    blobs.append(file.serialize());
+    totalBytes += blobs.last().size();
+  }
+
+  out << ".rdp benchmark: " << files << " files, "
+      << QString::number(totalBytes / 1024.0 / qMax(1, files), 'f', 1)
+      << " KiB average\n";
+  out << QStringLiteral("  %1 %2 %3 %4\n")
+             .arg(QStringLiteral("mode"), -24)
+             .arg(QStringLiteral("ms"), 8)
+             .arg(QStringLiteral("files/s"), 12)
+             .arg(QStringLiteral("MB/s"), 8);
+  auto row = [&](const char *mode, qint64 ns, int count, qint64 bytes) {
+    const double seconds = ns / 1e9;
+    out << QStringLiteral("  %1 %2 %3 %4\n")
+               .arg(QLatin1String(mode), -24)
+               .arg(ns / 1e6, 8, 'f', 1)
+               .arg(seconds > 0 ? count / seconds : 0.0, 12, 'f', 0)
+               .arg(seconds > 0 ? bytes / seconds / 1e6 : 0.0, 8, 'f', 1);
+    out.flush();
+  };
+
+  QElapsedTimer timer;
+  timer.start();
+  int parsed = 0;
+  for (const QByteArray &blob : blobs) {
+    parsed += parse(blob).entries().isEmpty() ? 0 : 1;
+  }
+  row("parse (memory)", timer.nsecsElapsed(), parsed, totalBytes);
+
+  timer.restart();
+  int remoteApps = 0;
+  for (const QByteArray &blob : blobs) {
+    remoteApps += parse(blob).toSettings().remoteAppMode ? 1 : 0;
+  }
+  row("parse + toSettings", timer.nsecsElapsed(), files, totalBytes);
+
+  // 导出后再解析：键、类型、值与顺序不变；经 RdpSettings 写回时
+  // 原有的键保持顺序，未识别的键的值不变
+  const QSet<QString> mapped = {
+      kFullAddress, kServerPort, kUsername, kDesktopWidth, kDesktopHeight,
+      kSessionBpp, kScreenMode, kDynamicResolution, kAudioMode,
+      kRedirectClipboard, kRedirectPrinters, kRemoteAppMode, kRemoteAppProgram,
+      kRemoteAppFile, kRemoteAppCmdLine, kRemoteAppExpandCmdLine,
+      kRemoteAppExpandWorkingDir, kWorkingDirectory};
+  int roundTripErrors = 0;
+  int exportErrors = 0;
+  for (int i = 0; i < files; ++i) {
+    const RdpFile original = parse(blobs.at(i));
+    const QVector<RdpFileEntry> &a = original.entries();
+
+    const RdpFile copy = parse(original.serialize());
+    const QVector<RdpFileEntry> &b = copy.entries();
+    bool same = a.size() == b.size();
+    for (int k = 0; same && k < a.size(); ++k) {
+      same = a[k].key == b[k].key && a[k].type == b[k].type &&
+             a[k].value == b[k].value;
+    }
+    roundTripErrors += same ? 0 : 1;
+
+    RdpFile exported = original;
+    exported.updateFrom(original.toSettings());
+    const QVector<RdpFileEntry> c = parse(exported.serialize()).entries();
+    bool preserved = c.size() >= a.size();
+    for (int k = 0; preserved && k < a.size(); ++k) {
+      preserved = c[k].key == a[k].key &&
+                  (mapped.contains(a[k].key) || c[k].value == a[k].value);
+    }
+    exportErrors += preserved ? 0 : 1;
+  }
+
+  QTemporaryDir dir;
+  for (int i = 0; i < files; ++i) {
+    // 每个子目录 1000 个文件，与共享目录的常见布局相近
+    const QString subdir = dir.filePath(QString::number(i / 1000));
+    QDir().mkpath(subdir);
+    QFile file(QStringLiteral("%1/%2.rdp").arg(subdir).arg(i));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(blobs.at(i)) != blobs.at(i).size()) {
+      out << "cannot write benchmark files to " << dir.path() << "\n";
+      return failures + 1;
+    }
+  }
+
+  timer.restart();
+  int loaded = 0;
+  QDirIterator it(dir.path(), QStringList() << QStringLiteral("*.rdp"),
+                  QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    loaded += load(it.next()).contains(QStringLiteral("full address")) ? 1 : 0;
+  }
+  row("load (mapped, full)", timer.nsecsElapsed(), loaded, totalBytes);
+
+  timer.restart();
+  RdpFileIndexer indexer;
+  const QVector<RdpFileSummary> summaries = indexer.indexDirectory(dir.path());
+  row("indexDirectory", timer.nsecsElapsed(), summaries.size(), totalBytes);
+
+  int indexErrors = 0;
+  for (const RdpFileSummary &summary : summaries) {
+    const int i = QFileInfo(summary.path).baseName().toInt();
+    if (summary.server != QStringLiteral("host-%1.corp.example").arg(i) ||
+        summary.port != 3390 ||
+        summary.remoteProgram.isEmpty() == bool(i % 2)) {
+      ++indexErrors;
+    }
+  }
+
+  auto check = [&](const char *name, bool ok, const QString &detail) {
+    out << (ok ? "  ok    " : "  FAIL  ") << QLatin1String(name).leftJustified(22)
+        << detail << "\n";
+    failures += ok ? 0 : 1;
+  };
+  check("remoteapp mapping", remoteApps == files / 2,
+        QStringLiteral("%1 of %2 files").arg(remoteApps).arg(files));
+  check("serialize round trip", roundTripErrors == 0,
+        QStringLiteral("%1 mismatched").arg(roundTripErrors));
+  check("unknown keys kept", exportErrors == 0,
+        QStringLiteral("%1 mismatched").arg(exportErrors));
+  check("load", loaded == files,
+        QStringLiteral("%1 of %2 files").arg(loaded).arg(files));
+  check("index", summaries.size() == files && indexErrors == 0,
+        QStringLiteral("%1 of %2 files, %3 wrong")
+            .arg(summaries.size())
+            .arg(files)
+            .arg(indexErrors));
+  out.flush();
+  return failures;
+}
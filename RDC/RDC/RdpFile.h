@@ -0,0 +1,88 @@
+#ifndef RDPFILE_H
+#define RDPFILE_H
+
+#include "RdpSettings.h"
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class QTextStream;
+
+// .rdp 文件中的一行："key:type:value"，type 为 s / i / b
+struct RdpFileEntry {
+  QString key;
+  QChar type;
+  QString value;
+};
+
+// .rdp 文件读写
+// 保留所有键的原始顺序，未识别的键在导出时原样写回；
+// 已知的键映射到 RdpSettings（即 RdpClient 的属性）。
+class RdpFile {
+public:
+  enum Encoding { Utf16Le, Utf8 };
+
+  static RdpFile parse(const QByteArray &data);
+  static RdpFile load(const QString &path, QString *error = nullptr);
+  bool save(const QString &path, QString *error = nullptr) const;
+  QByteArray serialize() const;
+  // QML 传来的 file:// URL 转为本地路径，其余原样返回
+  static QString localPath(const QString &pathOrUrl);
+
+  bool contains(const QString &key) const;
+  QString value(const QString &key, const QString &defaultValue = QString()) const;
+  int intValue(const QString &key, int defaultValue) const;
+  void setString(const QString &key, const QString &value);
+  void setInt(const QString &key, int value);
+
+  RdpSettings toSettings(const RdpSettings &base = RdpSettings()) const;
+  void updateFrom(const RdpSettings &settings);
+
+  const QVector<RdpFileEntry> &entries() const { return m_entries; }
+  Encoding encoding() const { return m_encoding; }
+  void setEncoding(Encoding encoding) { m_encoding = encoding; }
+
+  // 用 files 份合成的 mstsc 风格文件（含未识别的键）测量内存解析、
+  // 解析并映射到 RdpSettings、逐个 load 与 RdpFileIndexer 目录索引的
+  // 吞吐量，并检查导出后再解析保持键与顺序不变；返回失败的检查数
+  static int runBenchmark(int files, QTextStream &out);
+
+private:
+  void setValue(const QString &key, QChar type, const QString &value);
+
+  QVector<RdpFileEntry> m_entries;
+  QHash<QString, int> m_index; // 小写键 -> m_entries 下标
+  Encoding m_encoding = Utf16Le;
+};
+
+// 目录批量索引中每个文件的摘要
+struct RdpFileSummary {
+  QString path;
+  QString server;
+  int port = 3389;
+  QString username;
+  QString remoteProgram;
+};
+
+// .rdp 文件批量索引
+// 文件以内存映射方式读取，直接在映射内存上扫描需要的键，
+// 只为命中的值创建 QString，不解码整份文件。
+class RdpFileIndexer {
+public:
+  QVector<RdpFileSummary> indexDirectory(const QString &dirPath,
+                                         bool recursive = true);
+  static bool summarize(const QString &path, RdpFileSummary *summary);
+
+  int fileCount() const { return m_fileCount; }
+  int failedCount() const { return m_failedCount; }
+  qint64 bytesScanned() const { return m_bytesScanned; }
+  qint64 elapsedMs() const { return m_elapsedMs; }
+
+private:
+  int m_fileCount = 0;
+  int m_failedCount = 0;
+  qint64 m_bytesScanned = 0;
+  qint64 m_elapsedMs = 0;
+};
+
+#endif // RDPFILE_H
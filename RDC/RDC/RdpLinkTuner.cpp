@@ -0,0 +1,166 @@
+#include "RdpLinkTuner.h"
+#include "RdcLog.h"
+#include "RdpPreflight.h"
+
+namespace {
+
+// TS_PERF_* 体验标志
+enum {
+  PerfDisableWallpaper = 0x01,
+  PerfDisableFullWindowDrag = 0x02,
+  PerfDisableMenuAnimations = 0x04,
+  PerfDisableTheming = 0x08,
+  PerfDisableCursorShadow = 0x20,
+  PerfDisableCursorSettings = 0x40,
+  PerfEnableFontSmoothing = 0x80,
+  PerfEnableDesktopComposition = 0x100
+};
+
+// NetworkConnectionType 取值
+enum {
+  ConnectionLowSpeedBroadband = 2,
+  ConnectionWan = 5,
+  ConnectionLan = 6
+};
+
+const RdpLinkSettings kProfiles[] = {
+    // LAN：保留全部视觉效果
+    {32, true, true, true,
+     PerfEnableFontSmoothing | PerfEnableDesktopComposition, ConnectionLan},
+    // WAN：关闭壁纸、拖动显示内容与动画，保留字体平滑
+    {24, true, true, false,
+     PerfDisableWallpaper | PerfDisableFullWindowDrag |
+         PerfDisableMenuAnimations | PerfDisableCursorShadow |
+         PerfEnableFontSmoothing,
+     ConnectionWan},
+    // 低带宽：16 位色并关闭所有可选效果
+    {16, true, true, false,
+     PerfDisableWallpaper | PerfDisableFullWindowDrag |
+         PerfDisableMenuAnimations | PerfDisableTheming |
+         PerfDisableCursorShadow | PerfDisableCursorSettings,
+     ConnectionLowSpeedBroadband},
+};
+
+} // namespace
+
+RdpLinkMeasurement
+RdpLinkMeasurement::fromPreflight(const RdpPreflightResult &result) {
+  RdpLinkMeasurement measurement;
+  if (result.connectMs >= 0) {
+    measurement.rttMs = result.connectMs;
+  } else if (result.negotiateMs >= 0) {
+    measurement.rttMs = result.negotiateMs;
+  }
+  return measurement;
+}
+
+RdpLinkTuner::RdpLinkTuner(QObject *parent)
+    : QObject(parent), m_enabled(true), m_logId(0) {
+  reselect();
+}
+
+RdpLinkTuner::Selection
+RdpLinkTuner::select(const RdpLinkMeasurement &m, const Thresholds &t) {
+  Selection selection;
+  if (!m.isValid()) {
+    selection.profile = Lan;
+    selection.reasons << QString::fromUtf8("未测量链路，使用默认配置");
+    return selection;
+  }
+
+  // 任一指标落入低带宽区间即降到最低档
+  if (m.rttMs >= t.lowBandwidthMinRttMs) {
+    selection.reasons << QString::fromUtf8("往返延迟 %1 ms ≥ %2 ms")
+                             .arg(m.rttMs)
+                             .arg(t.lowBandwidthMinRttMs);
+  }
+  if (m.throughputKbps >= 0 &&
+      m.throughputKbps < t.lowBandwidthMaxThroughputKbps) {
+    selection.reasons << QString::fromUtf8("吞吐量 %1 kbps < %2 kbps")
+                             .arg(m.throughputKbps)
+                             .arg(t.lowBandwidthMaxThroughputKbps);
+  }
+  if (!selection.reasons.isEmpty()) {
+    selection.profile = LowBandwidth;
+    return selection;
+  }
+
+  // LAN 要求所有已测得的指标都达标
+  const bool lanRtt = m.rttMs >= 0 && m.rttMs <= t.lanMaxRttMs;
+  const bool lanThroughput = m.throughputKbps < 0 ||
+                             m.throughputKbps >= t.lanMinThroughputKbps;
+  if ((m.rttMs < 0 || lanRtt) && lanThroughput) {
+    selection.profile = Lan;
+    if (m.rttMs >= 0) {
+      selection.reasons << QString::fromUtf8("往返延迟 %1 ms ≤ %2 ms")
+                               .arg(m.rttMs)
+                               .arg(t.lanMaxRttMs);
+    }
+    if (m.throughputKbps >= 0) {
+      selection.reasons << QString::fromUtf8("吞吐量 %1 kbps ≥ %2 kbps")
+                               .arg(m.throughputKbps)
+                               .arg(t.lanMinThroughputKbps);
+    } else {
+      selection.reasons << QString::fromUtf8("未测得吞吐量");
+    }
+    return selection;
+  }
+
+  selection.profile = Wan;
+  if (!lanRtt && m.rttMs >= 0) {
+    selection.reasons << QString::fromUtf8("往返延迟 %1 ms > %2 ms")
+                             .arg(m.rttMs)
+                             .arg(t.lanMaxRttMs);
+  }
+  if (!lanThroughput) {
+    selection.reasons << QString::fromUtf8("吞吐量 %1 kbps < %2 kbps")
+                             .arg(m.throughputKbps)
+                             .arg(t.lanMinThroughputKbps);
+  }
+  return selection;
+}
+
+const RdpLinkSettings &RdpLinkTuner::settingsFor(Profile profile) {
+  return kProfiles[profile];
+}
+
+QString RdpLinkTuner::profileName(Profile profile) {
+  switch (profile) {
+  case Lan:
+    return QStringLiteral("LAN");
+  case Wan:
+    return QStringLiteral("WAN");
+  case LowBandwidth:
+    return QString::fromUtf8("低带宽");
+  }
+  return QString();
+}
+
+void RdpLinkTuner::setEnabled(bool enabled) {
+  if (m_enabled != enabled) {
+    m_enabled = enabled;
+    reselect();
+  }
+}
+
+void RdpLinkTuner::setThresholds(const Thresholds &thresholds) {
+  m_thresholds = thresholds;
+  reselect();
+}
+
+void RdpLinkTuner::setMeasurement(const RdpLinkMeasurement &measurement) {
+  m_measurement = measurement;
+  reselect();
+}
+
+void RdpLinkTuner::reselect() {
+  if (m_enabled) {
+    m_selection = select(m_measurement, m_thresholds);
+  } else {
+    m_selection = Selection();
+    m_selection.reasons << QString::fromUtf8("自适应调整已关闭");
+  }
+  RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Link profile: %1 (%2)",
+                profileName(), m_selection.reasons);
+  emit changed();
+}
@@ -0,0 +1,99 @@
+#ifndef RDPLINKTUNER_H
+#define RDPLINKTUNER_H
+
+#include <QObject>
+#include <QStringList>
+
+struct RdpPreflightResult;
+
+// 链路测量值，未测得的项为负数
+struct RdpLinkMeasurement {
+  qint64 rttMs = -1;
+  qint64 throughputKbps = -1;
+
+  bool isValid() const { return rttMs >= 0 || throughputKbps >= 0; }
+  // 以预检的 TCP 握手（退而求其次用 X.224 往返）作为 RTT
+  static RdpLinkMeasurement fromPreflight(const RdpPreflightResult &result);
+};
+
+// 各链路档位对应的控件设置
+struct RdpLinkSettings {
+  int maxColorDepth;        // 与用户设置取较小值
+  bool compress;
+  bool bitmapPersistence;
+  bool desktopComposition;
+  int performanceFlags;     // AdvancedSettings.PerformanceFlags (TS_PERF_*)
+  int networkConnectionType; // AdvancedSettings.NetworkConnectionType
+};
+
+// 根据测得的 RTT / 吞吐量在 LAN / WAN / 低带宽三档之间选择显示与性能设置
+// 选择逻辑为纯函数 select()，可直接注入测量值验证。
+class RdpLinkTuner : public QObject {
+  Q_OBJECT
+  Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY changed)
+  Q_PROPERTY(Profile profile READ profile NOTIFY changed)
+  Q_PROPERTY(QString profileName READ profileName NOTIFY changed)
+  Q_PROPERTY(QStringList reasons READ reasons NOTIFY changed)
+  Q_PROPERTY(qint64 rttMs READ rttMs NOTIFY changed)
+  Q_PROPERTY(qint64 throughputKbps READ throughputKbps NOTIFY changed)
+
+public:
+  enum Profile { Lan, Wan, LowBandwidth };
+  Q_ENUM(Profile)
+
+  struct Thresholds {
+    qint64 lanMaxRttMs = 10;
+    qint64 lanMinThroughputKbps = 50000;
+    qint64 lowBandwidthMinRttMs = 150;
+    qint64 lowBandwidthMaxThroughputKbps = 2000;
+  };
+
+  struct Selection {
+    Profile profile = Lan;
+    QStringList reasons;
+  };
+
+  explicit RdpLinkTuner(QObject *parent = nullptr);
+
+  static Selection select(const RdpLinkMeasurement &measurement,
+                          const Thresholds &thresholds = Thresholds());
+  static const RdpLinkSettings &settingsFor(Profile profile);
+  static QString profileName(Profile profile);
+
+  // 日志中的会话编号
+  void setLogId(int id) { m_logId = id; }
+
+  // 关闭时固定使用 LAN 档（与未测量时相同）
+  bool enabled() const { return m_enabled; }
+  void setEnabled(bool enabled);
+
+  const Thresholds &thresholds() const { return m_thresholds; }
+  void setThresholds(const Thresholds &thresholds);
+
+  // 注入测量值并重新选择档位
+  void setMeasurement(const RdpLinkMeasurement &measurement);
+  const RdpLinkMeasurement &measurement() const { return m_measurement; }
+
+  Profile profile() const { return m_selection.profile; }
+  QString profileName() const { return profileName(m_selection.profile); }
+  QStringList reasons() const { return m_selection.reasons; }
+  qint64 rttMs() const { return m_measurement.rttMs; }
+  qint64 throughputKbps() const { return m_measurement.throughputKbps; }
+  const RdpLinkSettings &settings() const {
+    return settingsFor(m_selection.profile);
+  }
+
+signals:
+  void changed();
+
+private:
+  void reselect();
+
+  bool m_enabled;
+  Thresholds m_thresholds;
+  RdpLinkMeasurement m_measurement;
+  Selection m_selection;
+  int m_logId;
+};
+
+#endif // RDPLINKTUNER_H
@@ -0,0 +1,101 @@
+#include "RdpLoopbackServer.h"
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <memory>
+
+namespace {
+
+const int kTpktHeaderSize = 4;
+
+QByteArray le32(quint32 value) {
+  QByteArray bytes(4, 0);
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = char((value >> (8 * i)) & 0xff);
+  }
+  return bytes;
+}
+
+} // namespace
+
+RdpLoopbackServer::RdpLoopbackServer(Mode mode, QObject *parent)
+    : QTcpServer(parent), m_mode(mode), m_responseDelayMs(0),
+      m_selectedProtocol(1), m_connections(0), m_requests(0), m_open(0),
+      m_pending(0), m_maxPending(0) {}
+
+bool RdpLoopbackServer::listenLoopback() {
+  return listen(QHostAddress::LocalHost, 0);
+}
+
+void RdpLoopbackServer::resetCounters() {
+  m_connections = 0;
+  m_requests = 0;
+  m_maxPending = m_pending;
+}
+
+QByteArray RdpLoopbackServer::response() const {
+  switch (m_mode) {
+  case Rdp:
+  case NegotiationFailure: {
+    // TPKT + X.224 Connection Confirm + RDP_NEG_RSP / RDP_NEG_FAILURE
+    QByteArray data;
+    data.append("\x03\x00\x00\x13", 4);
+    data.append("\x0e\xd0\x00\x00\x12\x34\x00", 7);
+    data.append(m_mode == Rdp ? "\x02\x00\x08\x00" : "\x03\x00\x08\x00", 4);
+    data.append(le32(m_mode == Rdp ? m_selectedProtocol : 5));
+    return data;
+  }
+  case NotRdp:
+    return QByteArrayLiteral("HTTP/1.1 400 Bad Request\r\n\r\n");
+  default:
+    return QByteArray();
+  }
+}
+
+void RdpLoopbackServer::incomingConnection(qintptr socketDescriptor) {
+  QTcpSocket *socket = new QTcpSocket(this);
+  if (!socket->setSocketDescriptor(socketDescriptor)) {
+    delete socket;
+    return;
+  }
+  ++m_connections;
+  ++m_open;
+  connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+    --m_open;
+    socket->deleteLater();
+  });
+
+  if (m_mode == CloseImmediately) {
+    socket->disconnectFromHost();
+    return;
+  }
+
+  // 每个连接读满一个 TPKT 请求后回应一次
+  std::shared_ptr<QByteArray> request = std::make_shared<QByteArray>();
+  connect(socket, &QTcpSocket::readyRead, this, [this, socket, request]() {
+    request->append(socket->readAll());
+    if (request->size() < kTpktHeaderSize) {
+      return;
+    }
+    const int length = (quint8(request->at(2)) << 8) | quint8(request->at(3));
+    if (request->size() < length) {
+      return;
+    }
+    request->clear();
+    ++m_requests;
+
+    const QByteArray data = response();
+    if (data.isEmpty()) {
+      return;
+    }
+    ++m_pending;
+    m_maxPending = qMax(m_maxPending, m_pending);
+    QPointer<QTcpSocket> guard(socket);
+    QTimer::singleShot(m_responseDelayMs, this, [this, guard, data]() {
+      --m_pending;
+      if (guard) {
+        guard->write(data);
+      }
+    });
+  });
+}
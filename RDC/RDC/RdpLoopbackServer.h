@@ -0,0 +1,56 @@
+#ifndef RDPLOOPBACKSERVER_H
+#define RDPLOOPBACKSERVER_H
+
+#include <QTcpServer>
+
+// 本机回环上的 RDP 监听器替身：按模式回应 X.224 Connection Request，
+// 用于在没有远程桌面服务的环境（含 Linux）中测试预检与预热
+class RdpLoopbackServer : public QTcpServer {
+  Q_OBJECT
+
+public:
+  enum Mode {
+    Rdp,                // Connection Confirm + RDP_NEG_RSP
+    NegotiationFailure, // Connection Confirm + RDP_NEG_FAILURE
+    NotRdp,             // 回应非 TPKT 数据
+    Silent,             // 接受连接但不回应
+    CloseImmediately    // 接受连接后立即关闭
+  };
+
+  explicit RdpLoopbackServer(Mode mode = Rdp, QObject *parent = nullptr);
+
+  // 在 127.0.0.1 的随机端口上监听
+  bool listenLoopback();
+
+  Mode mode() const { return m_mode; }
+  void setMode(Mode mode) { m_mode = mode; }
+  // 收到完整请求后延迟回应，模拟服务端处理耗时
+  void setResponseDelay(int ms) { m_responseDelayMs = ms; }
+  // RDP_NEG_RSP 中选择的协议（默认 1，TLS）
+  void setSelectedProtocol(quint32 protocol) { m_selectedProtocol = protocol; }
+
+  int connectionCount() const { return m_connections; }
+  int requestCount() const { return m_requests; }
+  int openConnections() const { return m_open; }
+  // 已收到、尚未回应的请求数的峰值（客户端关闭连接的事件可能晚到，
+  // 同时打开的连接数会略高于客户端的并发数）
+  int maxPendingRequests() const { return m_maxPending; }
+  void resetCounters();
+
+protected:
+  void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+  QByteArray response() const;
+
+  Mode m_mode;
+  int m_responseDelayMs;
+  quint32 m_selectedProtocol;
+  int m_connections;
+  int m_requests;
+  int m_open;
+  int m_pending;
+  int m_maxPending;
+};
+
+#endif // RDPLOOPBACKSERVER_H
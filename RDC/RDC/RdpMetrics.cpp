@@ -0,0 +1,219 @@
+#include "RdpMetrics.h"
+#include <QtAlgorithms>
+#include <cmath>
+
+namespace {
+
+const int kSubBucketBits = 4;
+const int kSubBuckets = 1 << kSubBucketBits;
+
+// Prometheus 直方图的 le 边界（秒）
+const double kPrometheusBounds[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                    0.5,   1,    2.5,   5,    10,  30};
+
+QByteArray escapeLabel(const QString &value) {
+  QByteArray escaped = value.toUtf8();
+  escaped.replace('\\', "\\\\");
+  escaped.replace('"', "\\\"");
+  escaped.replace('\n', "\\n");
+  return escaped;
+}
+
+QByteArray seconds(qint64 us) { return QByteArray::number(us / 1e6, 'g', 9); }
+
+} // namespace
+
+int RdpLatencyHistogram::bucketOf(qint64 us) {
+  if (us < kSubBuckets) {
+    return int(qMax<qint64>(0, us));
+  }
+  const int msb = 63 - qCountLeadingZeroBits(quint64(us));
+  const int shift = msb - kSubBucketBits;
+  const int mantissa = int((us >> shift) & (kSubBuckets - 1));
+  return kSubBuckets + shift * kSubBuckets + mantissa;
+}
+
+qint64 RdpLatencyHistogram::bucketUpperBound(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int shift = (bucket - kSubBuckets) / kSubBuckets;
+  const int mantissa = (bucket - kSubBuckets) % kSubBuckets;
+  return ((qint64(kSubBuckets + mantissa) + 1) << shift) - 1;
+}
+
+void RdpLatencyHistogram::record(qint64 us) {
+  us = qMax<qint64>(0, us);
+  const int bucket = bucketOf(us);
+  if (bucket >= m_buckets.size()) {
+    m_buckets.resize(bucket + 1);
+  }
+  ++m_buckets[bucket];
+
+  m_min = m_count ? qMin(m_min, us) : us;
+  m_max = qMax(m_max, us);
+  m_sum += us;
+  ++m_count;
+}
+
+qint64 RdpLatencyHistogram::percentile(double p) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  const quint64 target =
+      qMax<quint64>(1, quint64(std::ceil(qBound(0.0, p, 100.0) / 100.0 *
+                                         double(m_count))));
+  quint64 seen = 0;
+  for (int bucket = 0; bucket < m_buckets.size(); ++bucket) {
+    seen += m_buckets.at(bucket);
+    if (seen >= target) {
+      return qMin(bucketUpperBound(bucket), m_max);
+    }
+  }
+  return m_max;
+}
+
+quint64 RdpLatencyHistogram::countAtOrBelow(qint64 us) const {
+  if (us >= m_max) {
+    return m_count;
+  }
+  // 只统计上界不超过 us 的整桶，跨界的桶按不满足计
+  quint64 result = 0;
+  for (int bucket = 0; bucket < m_buckets.size(); ++bucket) {
+    if (bucketUpperBound(bucket) > us) {
+      break;
+    }
+    result += m_buckets.at(bucket);
+  }
+  return result;
+}
+
+RdpMetrics::RdpMetrics(QObject *parent) : QObject(parent) {}
+
+RdpMetrics *RdpMetrics::instance() {
+  static RdpMetrics metrics;
+  return &metrics;
+}
+
+QString RdpMetrics::phaseName(Phase phase) {
+  switch (phase) {
+  case Preflight:
+    return QStringLiteral("preflight");
+  case ControlCreate:
+    return QStringLiteral("control_create");
+  case Configure:
+    return QStringLiteral("configure");
+  case Connect:
+    return QStringLiteral("connect");
+  case Login:
+    return QStringLiteral("login");
+  case RemoteAppStart:
+    return QStringLiteral("remoteapp_start");
+  case Total:
+    return QStringLiteral("total");
+  case Restore:
+    return QStringLiteral("restore");
+  default:
+    return QString();
+  }
+}
+
+void RdpMetrics::recordPhase(const QString &host, Phase phase, qint64 us) {
+  if (phase < 0 || phase >= PhaseCount) {
+    return;
+  }
+  m_hosts[host.toLower()].phases[phase].record(us);
+  emit updated();
+}
+
+void RdpMetrics::recordSuccess(const QString &host) {
+  ++m_hosts[host.toLower()].successes;
+  emit updated();
+}
+
+void RdpMetrics::recordFailure(const QString &host, const QString &reason) {
+  ++m_hosts[host.toLower()].failures[reason];
+  emit updated();
+}
+
+void RdpMetrics::addToCounter(const QByteArray &name, double value) {
+  m_counters[name] += value;
+  emit updated();
+}
+
+void RdpMetrics::clear() {
+  m_hosts.clear();
+  m_counters.clear();
+  emit updated();
+}
+
+QStringList RdpMetrics::hosts() const {
+  QStringList result = m_hosts.keys();
+  result.sort();
+  return result;
+}
+
+const RdpMetrics::HostStats *RdpMetrics::hostStats(const QString &host) const {
+  const auto it = m_hosts.constFind(host.toLower());
+  return it == m_hosts.constEnd() ? nullptr : &it.value();
+}
+
+QByteArray RdpMetrics::prometheusText() const {
+  QByteArray out;
+  const QStringList hostList = hosts();
+
+  out += "# HELP rdc_connect_phase_seconds Duration of each connection phase.\n"
+         "# TYPE rdc_connect_phase_seconds histogram\n";
+  for (const QString &host : hostList) {
+    const HostStats &stats = m_hosts[host];
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+      const RdpLatencyHistogram &histogram = stats.phases[phase];
+      if (histogram.count() == 0) {
+        continue;
+      }
+      const QByteArray labels = "host=\"" + escapeLabel(host) +
+                                "\",phase=\"" +
+                                phaseName(Phase(phase)).toLatin1() + "\"";
+      for (double bound : kPrometheusBounds) {
+        out += "rdc_connect_phase_seconds_bucket{" + labels + ",le=\"" +
+               QByteArray::number(bound) + "\"} " +
+               QByteArray::number(
+                   histogram.countAtOrBelow(qint64(bound * 1e6))) +
+               "\n";
+      }
+      out += "rdc_connect_phase_seconds_bucket{" + labels + ",le=\"+Inf\"} " +
+             QByteArray::number(histogram.count()) + "\n";
+      out += "rdc_connect_phase_seconds_sum{" + labels + "} " +
+             seconds(histogram.sum()) + "\n";
+      out += "rdc_connect_phase_seconds_count{" + labels + "} " +
+             QByteArray::number(histogram.count()) + "\n";
+    }
+  }
+
+  out += "# HELP rdc_connections_succeeded_total Connections that completed "
+         "login.\n"
+         "# TYPE rdc_connections_succeeded_total counter\n";
+  for (const QString &host : hostList) {
+    out += "rdc_connections_succeeded_total{host=\"" + escapeLabel(host) +
+           "\"} " + QByteArray::number(m_hosts[host].successes) + "\n";
+  }
+
+  out += "# HELP rdc_connections_failed_total Failed connections by reason.\n"
+         "# TYPE rdc_connections_failed_total counter\n";
+  for (const QString &host : hostList) {
+    const HostStats &stats = m_hosts[host];
+    for (auto it = stats.failures.constBegin(); it != stats.failures.constEnd();
+         ++it) {
+      out += "rdc_connections_failed_total{host=\"" + escapeLabel(host) +
+             "\",reason=\"" + escapeLabel(it.key()) + "\"} " +
+             QByteArray::number(it.value()) + "\n";
+    }
+  }
+
+  for (auto it = m_counters.constBegin(); it != m_counters.constEnd(); ++it) {
+    out += "# TYPE rdc_" + it.key() + " counter\n";
+    out += "rdc_" + it.key() + " " + QByteArray::number(it.value(), 'g', 12) +
+           "\n";
+  }
+  return out;
+}
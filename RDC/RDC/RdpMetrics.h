@@ -0,0 +1,89 @@
+#ifndef RDPMETRICS_H
+#define RDPMETRICS_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+// 对数-线性分桶的延迟直方图（HDR 风格）
+// 小于 16 us 的值精确计数，之后每个 2 的幂区间再分 16 个子桶，
+// 相对误差不超过 1/16，内存与记录数无关。
+class RdpLatencyHistogram {
+public:
+  void record(qint64 us);
+
+  quint64 count() const { return m_count; }
+  qint64 min() const { return m_count ? m_min : 0; }
+  qint64 max() const { return m_max; }
+  qint64 sum() const { return m_sum; }
+  // p 取 0~100，返回所在桶的上界（不超过最大值）
+  qint64 percentile(double p) const;
+  quint64 countAtOrBelow(qint64 us) const;
+
+private:
+  static int bucketOf(qint64 us);
+  static qint64 bucketUpperBound(int bucket);
+
+  QVector<quint64> m_buckets;
+  quint64 m_count = 0;
+  qint64 m_min = 0;
+  qint64 m_max = 0;
+  qint64 m_sum = 0;
+};
+
+// 连接各阶段耗时与结果的汇总（按主机）
+class RdpMetrics : public QObject {
+  Q_OBJECT
+
+public:
+  enum Phase {
+    Preflight,      // DNS / TCP / X.224 预检
+    ControlCreate,  // 创建或取出控件
+    Configure,      // configureClient / configureRemoteApp
+    Connect,        // Connect() -> OnConnected
+    Login,          // OnConnected -> OnLoginComplete
+    RemoteAppStart, // ServerStartProgram -> OnRemoteProgramResult
+    Total,          // connectToServer() -> 登录完成或应用启动结果
+    Restore,        // 瞬时断线 -> 自动重连后登录完成或应用重新启动
+    PhaseCount
+  };
+  Q_ENUM(Phase)
+
+  struct HostStats {
+    RdpLatencyHistogram phases[PhaseCount];
+    quint64 successes = 0;
+    QMap<QString, quint64> failures; // 原因（致命错误码等） -> 次数
+  };
+
+  explicit RdpMetrics(QObject *parent = nullptr);
+
+  static RdpMetrics *instance();
+  static QString phaseName(Phase phase);
+
+  void recordPhase(const QString &host, Phase phase, qint64 us);
+  void recordSuccess(const QString &host);
+  void recordFailure(const QString &host, const QString &reason);
+  // 其它模块的累计计数，导出为 rdc_<name>（name 应以 _total 结尾）
+  void addToCounter(const QByteArray &name, double value = 1);
+  double counter(const QByteArray &name) const {
+    return m_counters.value(name);
+  }
+  void clear();
+
+  QStringList hosts() const;
+  const HostStats *hostStats(const QString &host) const;
+
+  // Prometheus 文本格式 (version 0.0.4)
+  QByteArray prometheusText() const;
+
+signals:
+  void updated();
+
+private:
+  QHash<QString, HostStats> m_hosts;
+  QMap<QByteArray, double> m_counters;
+};
+
+#endif // RDPMETRICS_H
@@ -0,0 +1,99 @@
+#include "RdpMetricsModel.h"
+
+namespace {
+
+double toMs(qint64 us) { return us / 1000.0; }
+
+quint64 failureCount(const RdpMetrics::HostStats &stats) {
+  quint64 total = 0;
+  for (quint64 count : stats.failures) {
+    total += count;
+  }
+  return total;
+}
+
+} // namespace
+
+RdpMetricsModel::RdpMetricsModel(QObject *parent)
+    : RdpMetricsModel(RdpMetrics::instance(), parent) {}
+
+RdpMetricsModel::RdpMetricsModel(RdpMetrics *metrics, QObject *parent)
+    : QAbstractListModel(parent), m_metrics(metrics) {
+  m_refreshTimer.setSingleShot(true);
+  m_refreshTimer.setInterval(0);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &RdpMetricsModel::refresh);
+  connect(m_metrics, &RdpMetrics::updated, &m_refreshTimer,
+          static_cast<void (QTimer::*)()>(&QTimer::start));
+  refresh();
+}
+
+int RdpMetricsModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant RdpMetricsModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_rows.size()) {
+    return QVariant();
+  }
+
+  const Row &row = m_rows.at(index.row());
+  const RdpMetrics::HostStats *stats = m_metrics->hostStats(row.host);
+  if (!stats) {
+    return QVariant();
+  }
+  const RdpLatencyHistogram &histogram = stats->phases[row.phase];
+  switch (role) {
+  case Qt::DisplayRole:
+  case HostRole:
+    return row.host;
+  case PhaseRole:
+    return RdpMetrics::phaseName(row.phase);
+  case SampleCountRole:
+    return quint64(histogram.count());
+  case P50Role:
+    return toMs(histogram.percentile(50));
+  case P90Role:
+    return toMs(histogram.percentile(90));
+  case P99Role:
+    return toMs(histogram.percentile(99));
+  case MaxRole:
+    return toMs(histogram.max());
+  case SuccessCountRole:
+    return quint64(stats->successes);
+  case FailureCountRole:
+    return failureCount(*stats);
+  default:
+    return QVariant();
+  }
+}
+
+QHash<int, QByteArray> RdpMetricsModel::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles.insert(HostRole, "host");
+  roles.insert(PhaseRole, "phase");
+  roles.insert(SampleCountRole, "sampleCount");
+  roles.insert(P50Role, "p50");
+  roles.insert(P90Role, "p90");
+  roles.insert(P99Role, "p99");
+  roles.insert(MaxRole, "max");
+  roles.insert(SuccessCountRole, "successCount");
+  roles.insert(FailureCountRole, "failureCount");
+  return roles;
+}
+
+void RdpMetricsModel::clear() { m_metrics->clear(); }
+
+void RdpMetricsModel::refresh() {
+  beginResetModel();
+  m_rows.clear();
+  for (const QString &host : m_metrics->hosts()) {
+    const RdpMetrics::HostStats *stats = m_metrics->hostStats(host);
+    for (int phase = 0; phase < RdpMetrics::PhaseCount; ++phase) {
+      if (stats->phases[phase].count() > 0) {
+        m_rows.append({host, RdpMetrics::Phase(phase)});
+      }
+    }
+  }
+  endResetModel();
+  emit countChanged();
+}
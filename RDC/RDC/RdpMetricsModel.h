@@ -0,0 +1,57 @@
+#ifndef RDPMETRICSMODEL_H
+#define RDPMETRICSMODEL_H
+
+#include "RdpMetrics.h"
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QVector>
+
+// 连接阶段耗时的列表视图（QML 中为 RdpMetricsModel）
+// 每行对应一个主机的一个阶段；RdpMetrics 更新后合并到下一个事件循环再刷新。
+class RdpMetricsModel : public QAbstractListModel {
+  Q_OBJECT
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+  enum Roles {
+    HostRole = Qt::UserRole + 1,
+    PhaseRole,
+    SampleCountRole,
+    P50Role, // 毫秒
+    P90Role,
+    P99Role,
+    MaxRole,
+    SuccessCountRole,
+    FailureCountRole
+  };
+
+  explicit RdpMetricsModel(QObject *parent = nullptr);
+  // 使用指定的指标；默认为 RdpMetrics::instance()
+  explicit RdpMetricsModel(RdpMetrics *metrics, QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  int count() const { return m_rows.size(); }
+
+  Q_INVOKABLE void clear();
+
+signals:
+  void countChanged();
+
+private slots:
+  void refresh();
+
+private:
+  struct Row {
+    QString host;
+    RdpMetrics::Phase phase;
+  };
+
+  RdpMetrics *m_metrics;
+  QVector<Row> m_rows;
+  QTimer m_refreshTimer;
+};
+
+#endif // RDPMETRICSMODEL_H
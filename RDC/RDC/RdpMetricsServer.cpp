@@ -0,0 +1,86 @@
+#include "RdpMetricsServer.h"
+#include "RdcLog.h"
+#include "RdpMetrics.h"
+#include <QTcpSocket>
+
+namespace {
+
+// 请求头最多读取的字节数，超出视为无效请求
+const int kMaxRequestSize = 8192;
+
+} // namespace
+
+RdpMetricsServer::RdpMetricsServer(RdpMetrics *metrics, QObject *parent)
+    : QObject(parent),
+      m_metrics(metrics ? metrics : RdpMetrics::instance()) {
+  connect(&m_server, &QTcpServer::newConnection, this,
+          &RdpMetricsServer::onNewConnection);
+}
+
+bool RdpMetricsServer::listen(quint16 port) {
+  if (!m_server.listen(QHostAddress::LocalHost, port)) {
+    RDC_LOG_WARNING(RdcLog::General, 0,
+                    "Metrics endpoint failed to listen on port %1: %2", port,
+                    m_server.errorString());
+    return false;
+  }
+  RDC_LOG_INFO(RdcLog::General, 0,
+               "Metrics endpoint listening on http://127.0.0.1:%1/metrics",
+               m_server.serverPort());
+  return true;
+}
+
+void RdpMetricsServer::onNewConnection() {
+  while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+    connect(socket, &QTcpSocket::readyRead, this,
+            &RdpMetricsServer::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, socket,
+            &QObject::deleteLater);
+  }
+}
+
+void RdpMetricsServer::onReadyRead() {
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  if (!socket) {
+    return;
+  }
+
+  // 只需要请求行；等到请求头结束再处理
+  QByteArray request = socket->property("request").toByteArray();
+  request += socket->readAll();
+  if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) {
+    if (request.size() > kMaxRequestSize) {
+      respond(socket, "400 Bad Request", "text/plain", "bad request\n");
+    } else {
+      socket->setProperty("request", request);
+    }
+    return;
+  }
+
+  const QList<QByteArray> requestLine =
+      request.left(request.indexOf('\n')).trimmed().split(' ');
+  const QByteArray method = requestLine.value(0);
+  QByteArray path = requestLine.value(1);
+  path = path.left(path.indexOf('?') >= 0 ? path.indexOf('?') : path.size());
+
+  if (method != "GET" && method != "HEAD") {
+    respond(socket, "405 Method Not Allowed", "text/plain",
+            "method not allowed\n");
+  } else if (path == "/metrics") {
+    respond(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8",
+            method == "HEAD" ? QByteArray() : m_metrics->prometheusText());
+  } else {
+    respond(socket, "404 Not Found", "text/plain", "not found\n");
+  }
+}
+
+void RdpMetricsServer::respond(QTcpSocket *socket, const QByteArray &status,
+                               const QByteArray &contentType,
+                               const QByteArray &body) {
+  socket->disconnect(this);
+  socket->write("HTTP/1.1 " + status +
+                "\r\nContent-Type: " + contentType +
+                "\r\nContent-Length: " + QByteArray::number(body.size()) +
+                "\r\nConnection: close\r\n\r\n" + body);
+  socket->disconnectFromHost();
+}
@@ -0,0 +1,37 @@
+#ifndef RDPMETRICSSERVER_H
+#define RDPMETRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+
+class RdpMetrics;
+class QTcpSocket;
+
+// 仅监听本机回环地址的指标抓取端点
+// GET /metrics 返回 Prometheus 文本格式，其余路径返回 404。
+class RdpMetricsServer : public QObject {
+  Q_OBJECT
+
+public:
+  // 使用指定的指标；默认为 RdpMetrics::instance()
+  explicit RdpMetricsServer(RdpMetrics *metrics = nullptr,
+                            QObject *parent = nullptr);
+
+  bool listen(quint16 port);
+  void close() { m_server.close(); }
+  bool isListening() const { return m_server.isListening(); }
+  quint16 port() const { return m_server.serverPort(); }
+
+private slots:
+  void onNewConnection();
+  void onReadyRead();
+
+private:
+  void respond(QTcpSocket *socket, const QByteArray &status,
+               const QByteArray &contentType, const QByteArray &body);
+
+  RdpMetrics *m_metrics;
+  QTcpServer m_server;
+};
+
+#endif // RDPMETRICSSERVER_H
@@ -0,0 +1,440 @@
+#include "RdpPreflight.h"
+#include "RdcLog.h"
+#include "RdpLoopbackServer.h"
+#include <QEventLoop>
+#include <QHostInfo>
+#include <QTcpSocket>
+#include <QTextStream>
+
+namespace {
+
+// TPKT + X.224 Connection Request + RDP_NEG_REQ（请求 TLS | CredSSP）
+const char kConnectionRequest[] = {
+    0x03, 0x00, 0x00, 0x13,             // TPKT: version 3, length 19
+    0x0e, char(0xe0), 0x00, 0x00, 0x00, // X.224: LI 14, CR, DST-REF
+    0x00, 0x00,                         //        SRC-REF, class 0
+    0x01, 0x00, 0x08, 0x00,             // RDP_NEG_REQ, flags, length 8
+    0x03, 0x00, 0x00, 0x00              // requestedProtocols
+};
+
+const int kTpktHeaderSize = 4;
+
+quint32 readLe32(const QByteArray &data, int offset) {
+  return quint8(data[offset]) | (quint8(data[offset + 1]) << 8) |
+         (quint8(data[offset + 2]) << 16) |
+         (quint32(quint8(data[offset + 3])) << 24);
+}
+
+} // namespace
+
+RdpPreflight::RdpPreflight(QObject *parent)
+    : QObject(parent), m_socket(nullptr), m_lookupId(-1), m_timeoutMs(5000),
+      m_logId(0), m_running(false) {
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this, &RdpPreflight::onTimeout);
+}
+
+RdpPreflight::~RdpPreflight() { cleanup(); }
+
+void RdpPreflight::probe(const QString &host, int port) {
+  abort();
+
+  m_result = RdpPreflightResult();
+  m_result.host = host;
+  m_result.port = port;
+  m_response.clear();
+  m_addresses.clear();
+  m_running = true;
+  m_timer.start(m_timeoutMs);
+  m_phase.start();
+
+  QHostAddress literal;
+  if (literal.setAddress(host)) {
+    // IP 地址无需解析
+    QHostInfo info;
+    info.setAddresses(QList<QHostAddress>() << literal);
+    onHostResolved(info);
+    return;
+  }
+  m_lookupId = QHostInfo::lookupHost(host, this, &RdpPreflight::onHostResolved);
+}
+
+void RdpPreflight::abort() {
+  if (m_running) {
+    finish(RdpPreflightResult::Aborted, QString());
+  }
+}
+
+void RdpPreflight::onHostResolved(const QHostInfo &info) {
+  m_lookupId = -1;
+  if (!m_running) {
+    return;
+  }
+
+  m_result.dnsMs = m_phase.elapsed();
+  m_addresses = info.addresses();
+  if (info.error() != QHostInfo::NoError || m_addresses.isEmpty()) {
+    finish(RdpPreflightResult::DnsFailed,
+           QString::fromUtf8("无法解析主机名: %1").arg(m_result.host));
+    return;
+  }
+
+  m_phase.start();
+  connectNext();
+}
+
+void RdpPreflight::connectNext() {
+  if (m_socket) {
+    m_socket->disconnect(this);
+    m_socket->abort();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+  }
+
+  if (m_addresses.isEmpty()) {
+    finish(RdpPreflightResult::ConnectFailed,
+           QString::fromUtf8("无法连接到 %1:%2")
+               .arg(m_result.host)
+               .arg(m_result.port));
+    return;
+  }
+
+  m_result.address = m_addresses.takeFirst();
+  m_socket = new QTcpSocket(this);
+  connect(m_socket, &QTcpSocket::connected, this, &RdpPreflight::onConnected);
+  connect(m_socket, &QTcpSocket::readyRead, this, &RdpPreflight::onReadyRead);
+  connect(m_socket, &QAbstractSocket::errorOccurred, this,
+          &RdpPreflight::onSocketError);
+  m_socket->connectToHost(m_result.address, quint16(m_result.port));
+}
+
+void RdpPreflight::onConnected() {
+  m_result.connectMs = m_phase.elapsed();
+  m_phase.start();
+  m_socket->write(kConnectionRequest, sizeof(kConnectionRequest));
+}
+
+void RdpPreflight::onSocketError() {
+  if (!m_running || !m_socket) {
+    return;
+  }
+
+  if (m_result.connectMs < 0) {
+    // 连接阶段失败：尝试下一个解析到的地址
+    RDC_LOG_DEBUG(RdcLog::Preflight, m_logId,
+                  "Preflight connect to %1 failed: %2",
+                  m_result.address.toString(), m_socket->errorString());
+    if (!m_addresses.isEmpty()) {
+      connectNext();
+      return;
+    }
+    finish(RdpPreflightResult::ConnectFailed,
+           QString::fromUtf8("无法连接到 %1:%2（%3）")
+               .arg(m_result.host)
+               .arg(m_result.port)
+               .arg(m_socket->errorString()));
+    return;
+  }
+
+  // 已连接但在协商响应前断开
+  finish(RdpPreflightResult::NotRdp,
+         QString::fromUtf8("%1:%2 未响应 RDP 协商，可能不是远程桌面服务")
+             .arg(m_result.host)
+             .arg(m_result.port));
+}
+
+void RdpPreflight::onReadyRead() {
+  m_response.append(m_socket->readAll());
+  if (m_response.size() < kTpktHeaderSize) {
+    return;
+  }
+
+  const int length = (quint8(m_response[2]) << 8) | quint8(m_response[3]);
+  if (quint8(m_response[0]) != 0x03 || length < 7) {
+    finish(RdpPreflightResult::NotRdp,
+           QString::fromUtf8("%1:%2 不是远程桌面服务")
+               .arg(m_result.host)
+               .arg(m_result.port));
+    return;
+  }
+  if (m_response.size() < length) {
+    return;
+  }
+
+  // X.224 Connection Confirm
+  if ((quint8(m_response[5]) & 0xf0) != 0xd0) {
+    finish(RdpPreflightResult::NotRdp,
+           QString::fromUtf8("%1:%2 不是远程桌面服务")
+               .arg(m_result.host)
+               .arg(m_result.port));
+    return;
+  }
+
+  // RDP_NEG_RSP (0x02) 携带服务端选择的协议；RDP_NEG_FAILURE (0x03)
+  // 同样说明对端是 RDP 服务，具体失败原因交给控件处理
+  if (length >= 19 && quint8(m_response[11]) == 0x02) {
+    m_result.selectedProtocol = int(readLe32(m_response, 15));
+  }
+  m_result.negotiateMs = m_phase.elapsed();
+  finish(RdpPreflightResult::Ok, QString());
+}
+
+void RdpPreflight::onTimeout() {
+  finish(RdpPreflightResult::Timeout,
+         QString::fromUtf8("连接 %1:%2 超时")
+             .arg(m_result.host)
+             .arg(m_result.port));
+}
+
+void RdpPreflight::finish(RdpPreflightResult::Status status,
+                          const QString &error) {
+  m_result.status = status;
+  m_result.error = error;
+  cleanup();
+
+  const RdpPreflightResult result = m_result;
+  emit finished(result);
+}
+
+void RdpPreflight::cleanup() {
+  m_running = false;
+  m_timer.stop();
+  if (m_lookupId >= 0) {
+    QHostInfo::abortHostLookup(m_lookupId);
+    m_lookupId = -1;
+  }
+  if (m_socket) {
+    m_socket->disconnect(this);
+    m_socket->abort();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+  }
+}
+
+RdpPreflightBatch::RdpPreflightBatch(QObject *parent)
+    : QObject(parent), m_maxInFlight(8), m_timeoutMs(5000) {}
+
+void RdpPreflightBatch::addTarget(const QString &host, int port) {
+  m_pending.append(qMakePair(host, port));
+}
+
+void RdpPreflightBatch::start() {
+  m_results.clear();
+  while (m_running.size() < m_maxInFlight && !m_pending.isEmpty()) {
+    startNext();
+  }
+  if (m_running.isEmpty()) {
+    emit finished();
+  }
+}
+
+void RdpPreflightBatch::abort() {
+  m_pending.clear();
+  const QList<RdpPreflight *> running = m_running;
+  m_running.clear();
+  for (RdpPreflight *preflight : running) {
+    preflight->disconnect(this);
+    preflight->abort();
+    preflight->deleteLater();
+  }
+}
+
+void RdpPreflightBatch::startNext() {
+  const QPair<QString, int> target = m_pending.takeFirst();
+  RdpPreflight *preflight = new RdpPreflight(this);
+  preflight->setTimeout(m_timeoutMs);
+  m_running.append(preflight);
+
+  connect(preflight, &RdpPreflight::finished, this,
+          [this, preflight](const RdpPreflightResult &result) {
+            m_running.removeOne(preflight);
+            preflight->deleteLater();
+            m_results.append(result);
+            emit resultReady(result);
+
+            if (!m_pending.isEmpty()) {
+              startNext();
+            } else if (m_running.isEmpty()) {
+              emit finished();
+            }
+          });
+  preflight->probe(target.first, target.second);
+}
+
+namespace {
+
+const char *statusName(RdpPreflightResult::Status status) {
+  switch (status) {
+  case RdpPreflightResult::Ok:
+    return "ok";
+  case RdpPreflightResult::DnsFailed:
+    return "dns_failed";
+  case RdpPreflightResult::ConnectFailed:
+    return "connect_failed";
+  case RdpPreflightResult::Timeout:
+    return "timeout";
+  case RdpPreflightResult::NotRdp:
+    return "not_rdp";
+  default:
+    return "aborted";
+  }
+}
+
+// 同步执行一次预检
+RdpPreflightResult probeAndWait(const QString &host, int port, int timeoutMs,
+                                qint64 *elapsedMs) {
+  RdpPreflight preflight;
+  preflight.setTimeout(timeoutMs);
+  RdpPreflightResult result;
+  QEventLoop loop;
+  QObject::connect(&preflight, &RdpPreflight::finished, &loop,
+                   [&](const RdpPreflightResult &finished) {
+                     result = finished;
+                     loop.quit();
+                   });
+  QElapsedTimer timer;
+  timer.start();
+  preflight.probe(host, port);
+  if (preflight.isRunning()) {
+    loop.exec();
+  }
+  *elapsedMs = timer.elapsed();
+  return result;
+}
+
+} // namespace
+
+int RdpPreflight::runSelfTest(QTextStream &out) {
+  int failures = 0;
+  auto check = [&](const char *name, bool ok, const QString &detail) {
+    out << (ok ? "  ok    " : "  FAIL  ") << QLatin1String(name).leftJustified(22)
+        << detail << "\n";
+    out.flush();
+    failures += ok ? 0 : 1;
+  };
+
+  const QString loopback = QStringLiteral("127.0.0.1");
+  const int timeoutMs = 2000;
+  RdpLoopbackServer server;
+  if (!server.listenLoopback()) {
+    out << "preflight self-test: cannot listen on loopback: "
+        << server.errorString() << "\n";
+    return 1;
+  }
+  const int port = server.serverPort();
+  out << "preflight self-test: loopback listener on port " << port << "\n";
+
+  struct Case {
+    const char *name;
+    RdpLoopbackServer::Mode mode;
+    RdpPreflightResult::Status expected;
+    int selectedProtocol;
+  };
+  const Case cases[] = {
+      {"rdp listener", RdpLoopbackServer::Rdp, RdpPreflightResult::Ok, 1},
+      {"negotiation failure", RdpLoopbackServer::NegotiationFailure,
+       RdpPreflightResult::Ok, -1},
+      {"not rdp", RdpLoopbackServer::NotRdp, RdpPreflightResult::NotRdp, -1},
+      {"closed after accept", RdpLoopbackServer::CloseImmediately,
+       RdpPreflightResult::NotRdp, -1},
+  };
+  for (const Case &c : cases) {
+    server.setMode(c.mode);
+    qint64 elapsedMs = 0;
+    const RdpPreflightResult result =
+        probeAndWait(loopback, port, timeoutMs, &elapsedMs);
+    check(c.name,
+          result.status == c.expected &&
+              result.selectedProtocol == c.selectedProtocol,
+          QStringLiteral("%1 protocol %2 in %3 ms")
+              .arg(QLatin1String(statusName(result.status)))
+              .arg(result.selectedProtocol)
+              .arg(elapsedMs));
+  }
+
+  // 接受连接但不回应：在超时时间到达时失败，而不是更晚
+  {
+    server.setMode(RdpLoopbackServer::Silent);
+    const int shortTimeoutMs = 300;
+    qint64 elapsedMs = 0;
+    const RdpPreflightResult result =
+        probeAndWait(loopback, port, shortTimeoutMs, &elapsedMs);
+    check("silent listener",
+          result.status == RdpPreflightResult::Timeout &&
+              elapsedMs < shortTimeoutMs + 500,
+          QStringLiteral("%1 in %2 ms (timeout %3 ms)")
+              .arg(QLatin1String(statusName(result.status)))
+              .arg(elapsedMs)
+              .arg(shortTimeoutMs));
+  }
+
+  // 端口未监听：回环上立即被拒绝
+  {
+    RdpLoopbackServer closed;
+    closed.listenLoopback();
+    const int closedPort = closed.serverPort();
+    closed.close();
+    qint64 elapsedMs = 0;
+    const RdpPreflightResult result =
+        probeAndWait(loopback, closedPort, timeoutMs, &elapsedMs);
+    check("port not listening",
+          result.status == RdpPreflightResult::ConnectFailed &&
+              elapsedMs < timeoutMs,
+          QStringLiteral("%1 in %2 ms")
+              .arg(QLatin1String(statusName(result.status)))
+              .arg(elapsedMs));
+  }
+
+  // .invalid 保证无法解析（RFC 6761）
+  {
+    qint64 elapsedMs = 0;
+    const RdpPreflightResult result = probeAndWait(
+        QStringLiteral("rdc-preflight-test.invalid"), port, 5000, &elapsedMs);
+    check("dns failure", result.status == RdpPreflightResult::DnsFailed,
+          QStringLiteral("%1 in %2 ms")
+              .arg(QLatin1String(statusName(result.status)))
+              .arg(elapsedMs));
+  }
+
+  // 批量探测：监听器上同时等待回应的请求不超过 maxInFlight
+  {
+    const int targets = 64;
+    const int maxInFlight = 8;
+    const int delayMs = 20;
+    server.setMode(RdpLoopbackServer::Rdp);
+    server.setResponseDelay(delayMs);
+    server.resetCounters();
+
+    RdpPreflightBatch batch;
+    batch.setMaxInFlight(maxInFlight);
+    batch.setTimeout(timeoutMs);
+    for (int i = 0; i < targets; ++i) {
+      batch.addTarget(loopback, port);
+    }
+    QEventLoop loop;
+    QObject::connect(&batch, &RdpPreflightBatch::finished, &loop,
+                     &QEventLoop::quit);
+    QElapsedTimer timer;
+    timer.start();
+    batch.start();
+    loop.exec();
+    const qint64 elapsedMs = timer.elapsed();
+
+    int ok = 0;
+    for (const RdpPreflightResult &result : batch.results()) {
+      ok += result.ok() ? 1 : 0;
+    }
+    check("batch", ok == targets && server.maxPendingRequests() <= maxInFlight,
+          QStringLiteral("%1/%2 ok, peak %3 in flight (limit %4), %5 ms")
+              .arg(ok)
+              .arg(targets)
+              .arg(server.maxPendingRequests())
+              .arg(maxInFlight)
+              .arg(elapsedMs));
+  }
+
+  out << (failures ? "preflight self-test: FAILED\n"
+                   : "preflight self-test: ok\n");
+  out.flush();
+  return failures;
+}
@@ -0,0 +1,115 @@
+#ifndef RDPPREFLIGHT_H
+#define RDPPREFLIGHT_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class QHostInfo;
+class QTcpSocket;
+class QTextStream;
+
+// 预检结果
+struct RdpPreflightResult {
+  enum Status { Ok, DnsFailed, ConnectFailed, Timeout, NotRdp, Aborted };
+
+  QString host;
+  int port = 0;
+  Status status = Aborted;
+  QString error;          // 面向用户的错误说明
+  QHostAddress address;   // 实际连接的地址
+  qint64 dnsMs = -1;
+  qint64 connectMs = -1;
+  qint64 negotiateMs = -1;
+  int selectedProtocol = -1; // RDP_NEG_RSP 中服务端选择的协议
+
+  bool ok() const { return status == Ok; }
+};
+
+// 连接前预检：解析 DNS、建立 TCP 连接并发送 X.224 Connection Request，
+// 确认对端是 RDP 监听器。不可达的主机在这里快速失败，而不必等待控件超时。
+class RdpPreflight : public QObject {
+  Q_OBJECT
+
+public:
+  explicit RdpPreflight(QObject *parent = nullptr);
+  ~RdpPreflight();
+
+  // 整个预检的超时时间
+  int timeout() const { return m_timeoutMs; }
+  void setTimeout(int ms) { m_timeoutMs = ms; }
+
+  bool isRunning() const { return m_running; }
+  // 日志中的会话编号
+  void setLogId(int id) { m_logId = id; }
+
+  // 开始预检，完成后发出 finished；正在进行的预检会被中止
+  void probe(const QString &host, int port);
+  void abort();
+
+  // 对本机回环上的 RdpLoopbackServer 检查各种结果（RDP、协商失败、非 RDP、
+  // 无响应、端口未监听、DNS 失败）以及批量探测的并发上限；返回失败数
+  static int runSelfTest(QTextStream &out);
+
+signals:
+  void finished(const RdpPreflightResult &result);
+
+private slots:
+  void onHostResolved(const QHostInfo &info);
+  void onConnected();
+  void onSocketError();
+  void onReadyRead();
+  void onTimeout();
+
+private:
+  void connectNext();
+  void finish(RdpPreflightResult::Status status, const QString &error);
+  void cleanup();
+
+  QTcpSocket *m_socket;
+  QTimer m_timer;
+  QElapsedTimer m_phase;
+  QList<QHostAddress> m_addresses;
+  QByteArray m_response;
+  RdpPreflightResult m_result;
+  int m_lookupId;
+  int m_timeoutMs;
+  int m_logId;
+  bool m_running;
+};
+
+// 并发探测一组主机，同时进行的探测数不超过 maxInFlight
+class RdpPreflightBatch : public QObject {
+  Q_OBJECT
+
+public:
+  explicit RdpPreflightBatch(QObject *parent = nullptr);
+
+  int maxInFlight() const { return m_maxInFlight; }
+  void setMaxInFlight(int count) { m_maxInFlight = qMax(1, count); }
+  int timeout() const { return m_timeoutMs; }
+  void setTimeout(int ms) { m_timeoutMs = ms; }
+
+  void addTarget(const QString &host, int port);
+  void start();
+  void abort();
+
+  const QList<RdpPreflightResult> &results() const { return m_results; }
+
+signals:
+  void resultReady(const RdpPreflightResult &result);
+  void finished();
+
+private:
+  void startNext();
+
+  QList<QPair<QString, int>> m_pending;
+  QList<RdpPreflight *> m_running;
+  QList<RdpPreflightResult> m_results;
+  int m_maxInFlight;
+  int m_timeoutMs;
+};
+
+#endif // RDPPREFLIGHT_H
@@ -0,0 +1,191 @@
+#include "RdpPropertyPlan.h"
+#include "FakeRdpControl.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <memory>
+
+namespace {
+
+struct BenchmarkProperty {
+  RdpPropertyPlan::Target target;
+  const char *name;
+  QVariant value;
+};
+
+// 与 RdpSession::configureClient 下发的属性相同
+QVector<BenchmarkProperty> benchmarkProperties() {
+  typedef RdpPropertyPlan P;
+  return {
+      {P::Control, "Server", QStringLiteral("bench.example.test")},
+      {P::AdvancedSettings, "RDPPort", 3389},
+      {P::Control, "UserName", QStringLiteral("bench")},
+      {P::Control, "DesktopWidth", 1920},
+      {P::Control, "DesktopHeight", 1080},
+      {P::Control, "ColorDepth", 32},
+      {P::Control, "FullScreenTitle", QStringLiteral("VirWork Client")},
+      {P::Control, "FullScreen", false},
+      {P::AdvancedSettings, "Compress", 1},
+      {P::AdvancedSettings, "PersistCacheDirectory",
+       QStringLiteral("C:\\Users\\bench\\AppData\\Local\\RDC\\bitmap")},
+      {P::AdvancedSettings, "BitmapPersistence", 1},
+      {P::AdvancedSettings, "allowDesktopComposition", true},
+      {P::AdvancedSettings, "PerformanceFlags", 0x80},
+      {P::AdvancedSettings, "NetworkConnectionType", 6},
+      {P::AdvancedSettings, "AudioRedirectionMode", 0},
+      {P::AdvancedSettings, "RedirectClipboard", true},
+      {P::AdvancedSettings, "RedirectPrinters", false},
+  };
+}
+
+} // namespace
+
+void RdpPropertyPlan::set(Target target, const char *name,
+                          const QVariant &value) {
+  for (Entry &entry : m_entries) {
+    if (entry.target == target && entry.name == name) {
+      entry.value = value;
+      return;
+    }
+  }
+  m_entries.append(Entry{target, QByteArray(name), value});
+}
+
+RdpPropertyPlan::Stats RdpPropertyPlan::apply(RdpDispatch *control,
+                                              RdpDispatch *advanced) {
+  QElapsedTimer timer;
+  timer.start();
+
+  Stats stats;
+  for (const Entry &entry : m_entries) {
+    RdpDispatch *object = entry.target == Control ? control : advanced;
+    if (!object) {
+      continue;
+    }
+
+    QHash<QByteArray, QVariant> &applied = m_applied[entry.target];
+    auto last = applied.constFind(entry.name);
+    if (last != applied.constEnd() && last.value() == entry.value) {
+      ++stats.skipped;
+      continue;
+    }
+
+    QHash<QByteArray, int> &ids = m_dispatchIds[entry.target];
+    auto id = ids.constFind(entry.name);
+    if (id == ids.constEnd()) {
+      id = ids.insert(entry.name, object->dispatchId(entry.name.constData()));
+      ++stats.resolved;
+    }
+
+    ++stats.issued;
+    const bool ok =
+        id.value() >= 0
+            ? object->setValueById(id.value(), entry.name.constData(),
+                                   entry.value)
+            : object->setValue(entry.name.constData(), entry.value);
+    if (ok) {
+      applied.insert(entry.name, entry.value);
+    } else {
+      applied.remove(entry.name);
+    }
+  }
+
+  stats.elapsedUs = timer.nsecsElapsed() / 1000;
+  m_lastStats = stats;
+  return stats;
+}
+
+void RdpPropertyPlan::invalidate() {
+  for (int i = 0; i < TargetCount; ++i) {
+    m_dispatchIds[i].clear();
+  }
+  forgetApplied();
+}
+
+void RdpPropertyPlan::forgetApplied() {
+  for (int i = 0; i < TargetCount; ++i) {
+    m_applied[i].clear();
+  }
+}
+
+void RdpPropertyPlan::clear() {
+  m_entries.clear();
+  invalidate();
+}
+
+void RdpPropertyPlan::runBenchmark(int iterations, QTextStream &out) {
+  const QVector<BenchmarkProperty> properties = benchmarkProperties();
+  // 进程内 GetIDsOfNames 约 1 us；控件在另一个套间时每次名称解析都要
+  // 跨套间往返
+  const int lookupCosts[] = {0, 1, 10};
+  enum Mode { ByName, FirstApply, CachedIds, Unchanged, ModeCount };
+  const char *const modeNames[] = {"by name (setProperty)",
+                                   "plan, first apply", "plan, cached DISPIDs",
+                                   "plan, unchanged"};
+
+  out << "property put benchmark: " << properties.size()
+      << " properties per apply, " << iterations << " applies per row\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+             .arg(QStringLiteral("lookup us"), -10)
+             .arg(QStringLiteral("path"), -24)
+             .arg(QStringLiteral("us/apply"), 10)
+             .arg(QStringLiteral("ns/put"), 10)
+             .arg(QStringLiteral("lookups"), 8);
+
+  for (const int lookupUs : lookupCosts) {
+    FakeRdpControl control;
+    control.setNameLookupCost(lookupUs);
+    std::unique_ptr<RdpDispatch> advanced(
+        control.querySubObject("AdvancedSettings9"));
+
+    for (int mode = 0; mode < ModeCount; ++mode) {
+      RdpPropertyPlan plan;
+      for (const BenchmarkProperty &property : properties) {
+        plan.set(property.target, property.name, property.value);
+      }
+      if (mode == CachedIds || mode == Unchanged) {
+        plan.apply(&control, advanced.get());
+      }
+      control.resetCounters();
+
+      int puts = 0;
+      QElapsedTimer timer;
+      timer.start();
+      for (int i = 0; i < iterations; ++i) {
+        switch (mode) {
+        case ByName:
+          for (const BenchmarkProperty &property : properties) {
+            RdpDispatch *object =
+                property.target == Control ? &control : advanced.get();
+            object->setValue(property.name, property.value);
+            ++puts;
+          }
+          break;
+        case FirstApply:
+          plan.invalidate();
+          puts += plan.apply(&control, advanced.get()).issued;
+          break;
+        case CachedIds:
+          plan.forgetApplied();
+          puts += plan.apply(&control, advanced.get()).issued;
+          break;
+        default:
+          puts += plan.apply(&control, advanced.get()).issued;
+          break;
+        }
+      }
+      const qint64 elapsedNs = timer.nsecsElapsed();
+
+      out << QStringLiteral("  %1 %2 %3 %4 %5\n")
+                 .arg(lookupUs, -10)
+                 .arg(QLatin1String(modeNames[mode]), -24)
+                 .arg(elapsedNs / 1000.0 / qMax(1, iterations), 10, 'f', 2)
+                 .arg(puts ? QString::number(double(elapsedNs) / puts, 'f', 0)
+                           : QStringLiteral("-"),
+                      10)
+                 .arg(double(control.callCount("GetIDsOfNames")) /
+                          qMax(1, iterations),
+                      8, 'f', 1);
+    }
+  }
+  out.flush();
+}
@@ -0,0 +1,59 @@
+#ifndef RDPPROPERTYPLAN_H
+#define RDPPROPERTYPLAN_H
+
+#include "RdpControl.h"
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+class QTextStream;
+
+// 控件属性的应用计划
+// 每个属性的 DISPID 在每个控件接口上只解析一次并缓存；
+// 记录上次成功应用的值，重连时只下发发生变化的属性。
+class RdpPropertyPlan {
+public:
+  enum Target { Control = 0, AdvancedSettings = 1, TargetCount };
+
+  struct Stats {
+    int issued = 0;   // 实际下发的属性调用
+    int skipped = 0;  // 与上次相同而跳过的属性
+    int resolved = 0; // 本次新解析的 DISPID
+    qint64 elapsedUs = 0;
+  };
+
+  // 设置目标值（同名属性覆盖，保持首次加入的顺序）
+  void set(Target target, const char *name, const QVariant &value);
+
+  // 应用与上次快照不同的属性；advanced 为空时跳过该目标的属性
+  Stats apply(RdpDispatch *control, RdpDispatch *advanced);
+
+  // 控件或其接口被替换/重置后调用，清空 DISPID 缓存和快照
+  void invalidate();
+  // 只清空快照，下次 apply 全量下发
+  void forgetApplied();
+  // 换用另一个控件时调用：连同属性条目一起清空，之后由调用方按新控件的
+  // 能力重新 set（避免旧控件才有的属性名，如 BitmapPeristence，被下发到
+  // 新控件）
+  void clear();
+
+  const Stats &lastStats() const { return m_lastStats; }
+
+  // 在模拟控件上比较按名称设置属性（QAxBase::setProperty 的路径）与按
+  // DISPID 设置属性的单次下发耗时，名称解析耗时取几个不同的值
+  static void runBenchmark(int iterations, QTextStream &out);
+
+private:
+  struct Entry {
+    Target target;
+    QByteArray name;
+    QVariant value;
+  };
+
+  QVector<Entry> m_entries;
+  QHash<QByteArray, int> m_dispatchIds[TargetCount];
+  QHash<QByteArray, QVariant> m_applied[TargetCount];
+  Stats m_lastStats;
+};
+
+#endif // RDPPROPERTYPLAN_H
@@ -0,0 +1,67 @@
+#include "RdpReconnectPolicy.h"
+#include <QRandomGenerator>
+
+RdpReconnectPolicy::RdpReconnectPolicy(QObject *parent)
+    : QObject(parent), m_enabled(true), m_maxAttempts(5), m_baseDelayMs(1000),
+      m_maxDelayMs(30000), m_attempts(0) {
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this, &RdpReconnectPolicy::onTimeout);
+}
+
+RdpReconnectPolicy::Disposition RdpReconnectPolicy::classify(int reason) {
+  // 安全层错误（认证失败、密码过期、账户锁定等）低字节为 0x07，重试无意义
+  if ((reason & 0xff) == 0x07) {
+    return Final;
+  }
+
+  switch (reason) {
+  case 0x104: // DNS 查找失败
+  case 0x108: // 连接超时
+  case 0x204: // 无法建立连接
+  case 0x208: // 找不到主机
+  case 0x304: // Windows Sockets send 失败
+  case 0x404: // Windows Sockets recv 失败
+  case 0x904: // 套接字被关闭（网络中断）
+    return Transient;
+  default:
+    // 0x1 本地断开、0x2 远程用户断开、0x3 服务器断开（注销/管理员踢出）等
+    return Final;
+  }
+}
+
+int RdpReconnectPolicy::backoffDelay(int attempt, int baseDelayMs,
+                                     int maxDelayMs, double random) {
+  qint64 ceiling = baseDelayMs;
+  for (int i = 0; i < attempt && ceiling < maxDelayMs; ++i) {
+    ceiling *= 2;
+  }
+  ceiling = qMin<qint64>(ceiling, maxDelayMs);
+  // 保留一半的确定延迟，另一半随机，避免多个会话同时重连
+  return int(ceiling / 2 + qint64(random * double(ceiling - ceiling / 2)));
+}
+
+void RdpReconnectPolicy::setEnabled(bool enabled) {
+  m_enabled = enabled;
+  if (!enabled) {
+    m_timer.stop();
+  }
+}
+
+bool RdpReconnectPolicy::schedule() {
+  if (!m_enabled || m_attempts >= m_maxAttempts) {
+    return false;
+  }
+  const int delay =
+      backoffDelay(m_attempts, m_baseDelayMs, m_maxDelayMs,
+                   QRandomGenerator::global()->generateDouble());
+  ++m_attempts;
+  m_timer.start(delay);
+  return true;
+}
+
+void RdpReconnectPolicy::reset() {
+  m_timer.stop();
+  m_attempts = 0;
+}
+
+void RdpReconnectPolicy::onTimeout() { emit retry(m_attempts); }
@@ -0,0 +1,61 @@
+#ifndef RDPRECONNECTPOLICY_H
+#define RDPRECONNECTPOLICY_H
+
+#include <QObject>
+#include <QTimer>
+
+// 自动重连策略
+// 按断开原因区分网络抖动等瞬时故障与用户/服务端主动断开、认证失败等
+// 终止性断开；瞬时故障按带抖动的指数退避安排重试，超过次数后放弃。
+class RdpReconnectPolicy : public QObject {
+  Q_OBJECT
+
+public:
+  enum Disposition { Final, Transient };
+  Q_ENUM(Disposition)
+
+  explicit RdpReconnectPolicy(QObject *parent = nullptr);
+
+  // OnDisconnected 的 discReason
+  static Disposition classify(int reason);
+  // 第 attempt 次（从 0 开始）重试的延迟；random 取 [0, 1)
+  // 上限为 min(maxDelay, baseDelay * 2^attempt)，实际延迟在上限的一半到上限之间
+  static int backoffDelay(int attempt, int baseDelayMs, int maxDelayMs,
+                          double random);
+
+  bool isEnabled() const { return m_enabled; }
+  void setEnabled(bool enabled);
+  int maxAttempts() const { return m_maxAttempts; }
+  void setMaxAttempts(int attempts) { m_maxAttempts = attempts; }
+  int baseDelay() const { return m_baseDelayMs; }
+  void setBaseDelay(int ms) { m_baseDelayMs = ms; }
+  int maxDelay() const { return m_maxDelayMs; }
+  void setMaxDelay(int ms) { m_maxDelayMs = ms; }
+
+  // 已安排的重试次数（本轮断线以来）
+  int attempts() const { return m_attempts; }
+  bool isPending() const { return m_timer.isActive(); }
+
+  // 安排下一次重试；未启用或次数用尽时返回 false
+  bool schedule();
+  // 取消待定的重试，保留已用次数
+  void cancel() { m_timer.stop(); }
+  // 恢复成功或放弃后清零
+  void reset();
+
+signals:
+  void retry(int attempt);
+
+private slots:
+  void onTimeout();
+
+private:
+  QTimer m_timer;
+  bool m_enabled;
+  int m_maxAttempts;
+  int m_baseDelayMs;
+  int m_maxDelayMs;
+  int m_attempts;
+};
+
+#endif // RDPRECONNECTPOLICY_H
@@ -0,0 +1,134 @@
+#include "RdpRemoteAppQueue.h"
+#include "RdpSettings.h"
+
+RdpRemoteAppLaunch RdpRemoteAppLaunch::fromSettings(const RdpSettings &settings) {
+  RdpRemoteAppLaunch launch;
+  launch.executablePath = settings.executablePath;
+  launch.filePath = settings.filePath;
+  launch.workingDirectory = settings.workingDirectory;
+  launch.arguments = settings.arguments;
+  launch.expandEnvVarInWorkingDirectory =
+      settings.expandEnvVarInWorkingDirectory;
+  launch.expandEnvVarInArguments = settings.expandEnvVarInArguments;
+  return launch;
+}
+
+QString RdpRemoteAppResult::description() const {
+  if (callFailed) {
+    return QString::fromUtf8("错误 - 调用 ServerStartProgram 失败");
+  }
+  return RdpRemoteAppQueue::describe(railResult);
+}
+
+RdpRemoteAppQueue::RdpRemoteAppQueue() : m_nextId(1) { m_clock.start(); }
+
+QString RdpRemoteAppQueue::describe(RdpEvent::RailResult railResult) {
+  switch (railResult) {
+  case RdpEvent::RailOk:
+    return QString::fromUtf8("成功 (RemoteAppResultOk)");
+  case RdpEvent::RailLocked:
+    return QString::fromUtf8("错误 - 远程会话已锁定");
+  case RdpEvent::RailProtocolError:
+    return QString::fromUtf8("错误 - RAIL 协议错误");
+  case RdpEvent::RailNotInWhitelist:
+    return QString::fromUtf8(
+        "错误 - 程序不在允许列表中 (通常是服务端注册表没开白名单)");
+  case RdpEvent::RailNetworkPathDenied:
+    return QString::fromUtf8("错误 - 不允许从网络路径启动");
+  case RdpEvent::RailFileNotFound:
+    return QString::fromUtf8("错误 - 文件未找到 (通常是路径不对)");
+  case RdpEvent::RailFailure:
+    return QString::fromUtf8("错误 - 服务端启动程序失败");
+  case RdpEvent::RailHookNotLoaded:
+    return QString::fromUtf8("错误 - 服务端 RemoteApp 挂钩未加载");
+  default:
+    return QString::fromUtf8("未知错误");
+  }
+}
+
+int RdpRemoteAppQueue::enqueue(RdpRemoteAppLaunch launch, bool front) {
+  launch.id = m_nextId++;
+  Entry entry;
+  entry.launch = launch;
+  entry.queuedNs = m_clock.nsecsElapsed();
+  if (front) {
+    m_pending.prepend(entry);
+  } else {
+    m_pending.append(entry);
+  }
+  return launch.id;
+}
+
+RdpRemoteAppLaunch RdpRemoteAppQueue::takeNext() {
+  if (m_pending.isEmpty()) {
+    return RdpRemoteAppLaunch();
+  }
+  Entry entry = m_pending.takeFirst();
+  entry.issuedNs = m_clock.nsecsElapsed();
+  m_inFlight.append(entry);
+  return entry.launch;
+}
+
+RdpRemoteAppResult RdpRemoteAppQueue::fail(int launchId) {
+  for (int i = 0; i < m_inFlight.size(); ++i) {
+    if (m_inFlight.at(i).launch.id == launchId) {
+      RdpRemoteAppResult result =
+          finish(i, m_inFlight.at(i).launch.executablePath,
+                 RdpEvent::RailUnknown, false);
+      result.callFailed = true;
+      return result;
+    }
+  }
+  RdpRemoteAppResult result;
+  result.callFailed = true;
+  return result;
+}
+
+RdpRemoteAppResult RdpRemoteAppQueue::complete(const QString &executablePath,
+                                               RdpEvent::RailResult railResult,
+                                               bool isExecutable) {
+  const QString path = normalizedPath(executablePath);
+  for (int i = 0; i < m_inFlight.size(); ++i) {
+    if (normalizedPath(m_inFlight.at(i).launch.executablePath) == path) {
+      return finish(i, executablePath, railResult, isExecutable);
+    }
+  }
+  // 服务端可能返回别名或展开后的路径：只有一个已发出的请求时可以确定
+  // 对应关系；有多个时无法判断，不猜测，结果的 launchId 为 -1，这些请求
+  // 仍留在已发出列表中等待各自的结果
+  if (m_inFlight.size() == 1) {
+    return finish(0, executablePath, railResult, isExecutable);
+  }
+
+  RdpRemoteAppResult result;
+  result.executablePath = executablePath;
+  result.railResult = railResult;
+  result.isExecutable = isExecutable;
+  return result;
+}
+
+void RdpRemoteAppQueue::clear() {
+  m_pending.clear();
+  m_inFlight.clear();
+}
+
+QString RdpRemoteAppQueue::normalizedPath(const QString &path) {
+  QString normalized = path.trimmed().toLower();
+  normalized.replace(QLatin1Char('/'), QLatin1Char('\\'));
+  return normalized;
+}
+
+RdpRemoteAppResult RdpRemoteAppQueue::finish(int index,
+                                             const QString &executablePath,
+                                             RdpEvent::RailResult railResult,
+                                             bool isExecutable) {
+  const Entry entry = m_inFlight.takeAt(index);
+  RdpRemoteAppResult result;
+  result.launchId = entry.launch.id;
+  result.executablePath = executablePath;
+  result.railResult = railResult;
+  result.isExecutable = isExecutable;
+  result.queueUs = (entry.issuedNs - entry.queuedNs) / 1000;
+  result.latencyUs = (m_clock.nsecsElapsed() - entry.issuedNs) / 1000;
+  return result;
+}
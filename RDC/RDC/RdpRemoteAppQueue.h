@@ -0,0 +1,85 @@
+#ifndef RDPREMOTEAPPQUEUE_H
+#define RDPREMOTEAPPQUEUE_H
+
+#include "RdpEventRouter.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+struct RdpSettings;
+
+// 一次 RemoteApp 启动请求（ServerStartProgram 的参数）
+struct RdpRemoteAppLaunch {
+  int id = -1;
+  QString executablePath;
+  QString filePath;
+  QString workingDirectory;
+  QString arguments;
+  bool expandEnvVarInWorkingDirectory = false;
+  bool expandEnvVarInArguments = false;
+
+  static RdpRemoteAppLaunch fromSettings(const RdpSettings &settings);
+};
+
+// 启动请求对应的 OnRemoteProgramResult
+struct RdpRemoteAppResult {
+  int launchId = -1; // 无法对应到请求时为 -1
+  QString executablePath;
+  RdpEvent::RailResult railResult = RdpEvent::RailUnknown;
+  bool callFailed = false; // 调用 ServerStartProgram 失败，没有 RailResult
+  bool isExecutable = false;
+  qint64 queueUs = -1;   // 排队到发出的时间
+  qint64 latencyUs = -1; // 发出到收到结果的时间
+
+  bool ok() const { return !callFailed && railResult == RdpEvent::RailOk; }
+  QString description() const;
+};
+
+// RemoteApp 启动队列
+// 登录前的请求先排队；登录后依次发出，不等待前一个结果（流水线）。
+// 结果按可执行文件路径对应到最早发出的同路径请求；路径对应不上时，
+// 只有一个已发出的请求才归给它，否则结果的 launchId 为 -1。
+class RdpRemoteAppQueue {
+public:
+  RdpRemoteAppQueue();
+
+  // RemoteProgramResult 枚举的说明
+  static QString describe(RdpEvent::RailResult railResult);
+
+  // 返回分配的启动 ID；front 为 true 时排在所有待发请求之前
+  int enqueue(RdpRemoteAppLaunch launch, bool front = false);
+  bool hasPending() const { return !m_pending.isEmpty(); }
+  int pendingCount() const { return m_pending.size(); }
+  int inFlightCount() const { return m_inFlight.size(); }
+
+  // 取出下一个待发请求并记为已发出
+  RdpRemoteAppLaunch takeNext();
+  // 发出失败：从已发出列表移除，返回失败结果
+  RdpRemoteAppResult fail(int launchId);
+  // 把结果对应到已发出的请求，无法确定对应的请求时 launchId 为 -1
+  RdpRemoteAppResult complete(const QString &executablePath,
+                              RdpEvent::RailResult railResult,
+                              bool isExecutable);
+
+  // 连接断开后已发出的请求不会再有结果
+  void dropInFlight() { m_inFlight.clear(); }
+  void clear();
+
+private:
+  struct Entry {
+    RdpRemoteAppLaunch launch;
+    qint64 queuedNs = 0;
+    qint64 issuedNs = 0;
+  };
+
+  static QString normalizedPath(const QString &path);
+  RdpRemoteAppResult finish(int index, const QString &executablePath,
+                            RdpEvent::RailResult railResult, bool isExecutable);
+
+  QList<Entry> m_pending;
+  QList<Entry> m_inFlight; // 按发出顺序
+  QElapsedTimer m_clock;
+  int m_nextId;
+};
+
+#endif // RDPREMOTEAPPQUEUE_H
@@ -0,0 +1,1210 @@
+#include "RdpSession.h"
+#include "RdcLog.h"
+#include "RdpBitmapCache.h"
+#include "RdpControlPool.h"
+#include "RdpWarmup.h"
+#include "FakeRdpControl.h"
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+RdpSession::RdpSession(QObject *parent)
+    : QObject(parent), m_controlFactory(&RdpControl::createDefault),
+      m_controlPool(nullptr), m_capabilityCache(nullptr), m_metrics(nullptr),
+      m_eventRouter(nullptr), m_bitmapCache(nullptr), m_warmup(nullptr),
+      m_control(nullptr), m_remoteProgram(nullptr), m_advancedSettings(nullptr),
+      m_preflightEnabled(true), m_connected(false), m_connecting(false),
+      m_loggedIn(false), m_restoring(false), m_primaryLaunchId(-1),
+      m_lastConnectLatencyMs(-1), m_lastRemoteAppLatencyMs(-1),
+      m_tracing(false), m_phaseStartNs(0), m_lastRestoreMs(-1),
+      m_logId(nextLogId()), m_routeId(0) {
+  std::fill_n(m_phaseUs, int(RdpMetrics::PhaseCount), qint64(-1));
+  setLogId(m_logId);
+  connect(&m_throttlePolicy, &RdpThrottlePolicy::profileChanged, this,
+          &RdpSession::applyThrottleProfile);
+  connect(&m_preflight, &RdpPreflight::finished, this,
+          &RdpSession::onPreflightFinished);
+  connect(&m_reconnectPolicy, &RdpReconnectPolicy::retry, this,
+          &RdpSession::onReconnectRetry);
+  connect(&m_displayDebouncer, &RdpDisplayDebouncer::settled, this,
+          &RdpSession::applyDisplaySize);
+}
+
+RdpSession::~RdpSession() {
+  // 先断开连接
+  if (m_connected && m_control) {
+    try {
+      m_control->dynamicCall("Disconnect()");
+    } catch (...) {
+      RDC_LOG_WARNING(RdcLog::Connect, m_logId,
+                      "Exception during disconnect in destructor");
+    }
+    m_connected = false;
+  }
+
+  // 清理子对象
+  delete m_remoteProgram;
+  m_remoteProgram = nullptr;
+  releaseAdvancedSettings();
+
+  // 最后归还或删除控件
+  detachControlEvents();
+  RdpControlPool *pool =
+      m_controlPool ? m_controlPool : RdpControlPool::instance();
+  if (pool && m_control) {
+    pool->release(m_control);
+  } else {
+    delete m_control;
+  }
+  m_control = nullptr;
+  releaseBitmapCache();
+}
+
+namespace {
+
+QString preflightFailureReason(RdpPreflightResult::Status status) {
+  switch (status) {
+  case RdpPreflightResult::DnsFailed:
+    return QStringLiteral("preflight_dns");
+  case RdpPreflightResult::ConnectFailed:
+    return QStringLiteral("preflight_connect");
+  case RdpPreflightResult::Timeout:
+    return QStringLiteral("preflight_timeout");
+  case RdpPreflightResult::NotRdp:
+    return QStringLiteral("preflight_not_rdp");
+  default:
+    return QStringLiteral("preflight");
+  }
+}
+
+int nextRouteId() {
+  static std::atomic<int> counter(0);
+  return ++counter;
+}
+
+} // namespace
+
+int RdpSession::nextLogId() {
+  static std::atomic<int> counter(0);
+  return ++counter;
+}
+
+void RdpSession::setControlFactory(const RdpControlFactory &factory) {
+  m_controlFactory = factory;
+}
+
+QWidget *RdpSession::widget() const {
+  return m_control ? m_control->widget() : nullptr;
+}
+
+void RdpSession::initializeControl() {
+  if (m_control) {
+    RDC_LOG_DEBUG(RdcLog::Control, m_logId, "RDP Control already initialized");
+    return;
+  }
+
+  try {
+    RdpControlPool *pool =
+        m_controlPool ? m_controlPool : RdpControlPool::instance();
+    if (pool) {
+      m_control = pool->acquire();
+    } else {
+      m_control = m_controlFactory ? m_controlFactory() : nullptr;
+    }
+    if (!m_control) {
+      RDC_LOG_CRITICAL(RdcLog::Control, m_logId, "Failed to create RDP control");
+      emit connectionError(QString::fromUtf8("无法创建RDP控件"));
+      return;
+    }
+
+    m_routeId = nextRouteId();
+    eventRouter()->attach(m_routeId, this);
+    m_control->setEventTarget(eventRouter(), m_routeId);
+
+    // 新控件：属性条目、DISPID 与已应用的属性都需要重新建立
+    m_propertyPlan.clear();
+
+    // 同一控件版本只探测一次接口，之后直接使用缓存结果
+    RdpCapabilityCache *cache =
+        m_capabilityCache ? m_capabilityCache : RdpCapabilityCache::instance();
+    m_capabilities = cache->capabilities(m_control);
+
+    RDC_LOG_DEBUG(RdcLog::Control, m_logId,
+                  "RDP Control initialized successfully");
+  } catch (...) {
+    RDC_LOG_CRITICAL(RdcLog::Control, m_logId,
+                     "Exception occurred while initializing RDP control");
+    emit connectionError(QString::fromUtf8("初始化RDP控件时发生异常"));
+    detachControlEvents();
+    delete m_control;
+    m_control = nullptr;
+  }
+}
+
+void RdpSession::configureClient() {
+  if (!m_control) {
+    RDC_LOG_CRITICAL(RdcLog::Connect, m_logId, "RDP control not initialized");
+    return;
+  }
+
+  try {
+    if (!m_advancedSettings &&
+        !m_capabilities.advancedSettingsInterface.isEmpty()) {
+      m_advancedSettings = m_control->querySubObject(
+          m_capabilities.advancedSettingsInterface.constData());
+    }
+    if (!m_advancedSettings) {
+      RDC_LOG_WARNING(RdcLog::Connect, m_logId,
+                      "Failed to get AdvancedSettings object");
+      return;
+    }
+
+    // 服务器、用户名、分辨率、色彩深度、全屏
+    m_propertyPlan.set(RdpPropertyPlan::Control, "Server", m_settings.server);
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "RDPPort",
+                       m_settings.port);
+    m_propertyPlan.set(RdpPropertyPlan::Control, "UserName",
+                       m_settings.username);
+    // 窗口已调整过尺寸时直接以窗口尺寸连接，登录后不必再调整
+    m_sessionDisplaySize.width = m_settings.desktopWidth;
+    m_sessionDisplaySize.height = m_settings.desktopHeight;
+    m_sessionDisplaySize.scaleFactor = 100;
+    if (dynamicResolutionEnabled() && m_displaySize.isValid()) {
+      // 缩放只能在登录后调整
+      m_sessionDisplaySize.width = m_displaySize.width;
+      m_sessionDisplaySize.height = m_displaySize.height;
+    }
+    m_displayDebouncer.setApplied(m_sessionDisplaySize);
+    m_propertyPlan.set(RdpPropertyPlan::Control, "DesktopWidth",
+                       m_sessionDisplaySize.width);
+    m_propertyPlan.set(RdpPropertyPlan::Control, "DesktopHeight",
+                       m_sessionDisplaySize.height);
+    m_propertyPlan.set(RdpPropertyPlan::Control, "ColorDepth",
+                       tunedColorDepth());
+    m_propertyPlan.set(RdpPropertyPlan::Control, "FullScreenTitle",
+                       m_settings.fullScreenTitle);
+    m_propertyPlan.set(RdpPropertyPlan::Control, "FullScreen",
+                       m_settings.fullScreen);
+
+    // 压缩、位图缓存、桌面组合与体验标志取自链路档位
+    const RdpLinkSettings &link = m_linkTuner.settings();
+    RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Using %1 link profile: %2",
+                  m_linkTuner.profileName(), m_linkTuner.reasons());
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "Compress",
+                       link.compress ? 1 : 0);
+    // 持久化位图缓存放在按主机 / 用户划分、按配额淘汰的目录中；
+    // 旧的 IMsTscAdvancedSettings 拼写为 BitmapPeristence，
+    // IMsRdpClientAdvancedSettings 起为 BitmapPersistence
+    QString cacheDir;
+    if (link.bitmapPersistence) {
+      cacheDir = bitmapCache()->acquire(m_settings.server, m_settings.port,
+                                        m_settings.username);
+    }
+    if (!m_bitmapCacheDir.isEmpty()) {
+      bitmapCache()->release(m_bitmapCacheDir);
+    }
+    m_bitmapCacheDir = cacheDir;
+    if (!cacheDir.isEmpty()) {
+      m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings,
+                         "PersistCacheDirectory", cacheDir);
+    }
+    const bool legacySettings =
+        m_capabilities.advancedSettingsInterface == "AdvancedSettings";
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings,
+                       legacySettings ? "BitmapPeristence"
+                                      : "BitmapPersistence",
+                       cacheDir.isEmpty() ? 0 : 1);
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings,
+                       "allowDesktopComposition", link.desktopComposition);
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "PerformanceFlags",
+                       link.performanceFlags);
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings,
+                       "NetworkConnectionType", link.networkConnectionType);
+
+    // 音频设置 (0=本地播放, 1=远程播放, 2=不播放)
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings,
+                       "AudioRedirectionMode", m_settings.enableSound ? 0 : 2);
+    // 剪贴板、打印机重定向
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "RedirectClipboard",
+                       m_settings.enableClipboard);
+    m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "RedirectPrinters",
+                       m_settings.enablePrinter);
+
+    // 只下发与上次不同的属性
+    m_configureStats = m_propertyPlan.apply(m_control, m_advancedSettings);
+    const RdpPropertyPlan::Stats &stats = m_configureStats;
+    RDC_LOG_DEBUG(RdcLog::Connect, m_logId,
+                  "RDP properties applied: %1 issued, %2 unchanged, "
+                  "%3 resolved in %4 us",
+                  stats.issued, stats.skipped, stats.resolved,
+                  stats.elapsedUs);
+  } catch (...) {
+    RDC_LOG_CRITICAL(RdcLog::Connect, m_logId,
+                     "Exception occurred while configuring RDP client");
+  }
+}
+
+bool RdpSession::connectToServer() {
+  if (m_settings.server.isEmpty()) {
+    emit connectionError(QString::fromUtf8("服务器地址不能为空"));
+    return false;
+  }
+
+  if (m_settings.username.isEmpty()) {
+    emit connectionError(QString::fromUtf8("用户名不能为空"));
+    return false;
+  }
+
+  // 手动重新连接取代待定的自动重连
+  m_reconnectPolicy.reset();
+  m_restoring = false;
+
+  m_connectTimer.start();
+  m_connecting = true;
+  m_lastConnectLatencyMs = -1;
+  m_lastRemoteAppLatencyMs = -1;
+  std::fill_n(m_phaseUs, int(RdpMetrics::PhaseCount), qint64(-1));
+  m_tracing = true;
+  beginPhase();
+
+  RdpWarmup *warmup = m_warmup ? m_warmup : RdpWarmup::instance();
+  if (warmup) {
+    warmup->recordConnect(m_settings);
+  }
+
+  if (m_preflightEnabled) {
+    // 预热时已预检过的目标直接使用结果
+    RdpPreflightResult warmed;
+    if (warmup && warmup->takeResult(m_settings.server, m_settings.port,
+                                     &warmed)) {
+      RDC_LOG_DEBUG(RdcLog::Preflight, m_logId,
+                    "Using warmed preflight result for %1", warmed.host);
+      onPreflightFinished(warmed);
+      return m_connecting || m_connected;
+    }
+    // 预检通过后在 onPreflightFinished 中继续连接
+    m_preflight.probe(m_settings.server, m_settings.port);
+    return true;
+  }
+  return continueConnect();
+}
+
+void RdpSession::onPreflightFinished(const RdpPreflightResult &result) {
+  m_lastPreflightResult = result;
+  if (result.status == RdpPreflightResult::Aborted) {
+    m_tracing = false;
+    return;
+  }
+
+  finishPhase(RdpMetrics::Preflight);
+  if (!result.ok()) {
+    RDC_LOG_WARNING(RdcLog::Preflight, m_logId, "RDP preflight failed: %1",
+                    result.error);
+    m_connecting = false;
+    finishTrace(false, preflightFailureReason(result.status));
+    emit connectionError(result.error);
+    return;
+  }
+
+  RDC_LOG_DEBUG(RdcLog::Preflight, m_logId,
+                "RDP preflight ok: %1 dns %2 ms, connect %3 ms, negotiate %4 ms",
+                result.address.toString(), result.dnsMs, result.connectMs,
+                result.negotiateMs);
+  m_linkTuner.setMeasurement(RdpLinkMeasurement::fromPreflight(result));
+  continueConnect();
+}
+
+bool RdpSession::continueConnect() {
+  // 延迟初始化控件；已持有控件时不计入控件创建阶段
+  if (!m_control) {
+    beginPhase();
+    initializeControl();
+    if (m_control) {
+      finishPhase(RdpMetrics::ControlCreate);
+    }
+  }
+
+  if (!m_control) {
+    m_connecting = false;
+    finishTrace(false, QStringLiteral("control_create"));
+    emit connectionError(QString::fromUtf8("RDP控件未初始化"));
+    return false;
+  }
+
+  beginPhase();
+  configureClient();
+
+  // 如果是 RemoteApp 模式，配置 RemoteApp
+  if (m_settings.remoteAppMode) {
+    RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Connecting in RemoteApp mode");
+    configureRemoteApp();
+    // 如果是 RemoteApp 模式，在登录完成后启动应用
+    if (!m_remoteProgram) {
+      RDC_LOG_CRITICAL(
+          RdcLog::RemoteApp, m_logId,
+          "Cannot get RemoteProgram object - RemoteApp not supported");
+      emit remoteAppError(
+          QString::fromUtf8("无法获取RemoteProgram对象\n\n"
+                            "此RDP客户端版本可能不支持RemoteApp功能。\n"
+                            "建议使用 .rdp 文件方式或 mstsc.exe。"));
+      m_connecting = false;
+      finishTrace(false, QStringLiteral("remoteapp_unsupported"));
+      return false;
+    }
+
+    // 注意：不在这里启动 RemoteApp，而是在 onLoginComplete() 中启动
+  } else {
+    // 桌面模式：确保 RemoteApp 模式被禁用
+    RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Connecting in Desktop mode");
+    RdpDispatch *remoteProgram =
+        m_capabilities.remoteProgramInterface.isEmpty()
+            ? nullptr
+            : m_control->querySubObject(
+                  m_capabilities.remoteProgramInterface.constData());
+    if (remoteProgram) {
+      try {
+        remoteProgram->setValue("RemoteProgramMode", false);
+        RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId,
+                      "RemoteProgramMode disabled for Desktop mode");
+      } catch (...) {
+        RDC_LOG_WARNING(RdcLog::RemoteApp, m_logId,
+                        "Exception while disabling RemoteApp mode");
+      }
+      delete remoteProgram;
+    }
+  }
+
+  finishPhase(RdpMetrics::Configure);
+
+  // 由界面层创建并显示 RDP 窗口
+  emit aboutToConnect(m_control->widget());
+
+  try {
+    // 发起连接，Connect 阶段到 OnConnected 为止
+    beginPhase();
+    m_control->dynamicCall("Connect()");
+    RDC_LOG_INFO(RdcLog::Connect, m_logId, "RDP connection initiated to %1",
+                 m_settings.server);
+    return true;
+  } catch (...) {
+    m_connecting = false;
+    finishTrace(false, QStringLiteral("connect_call"));
+    emit connectionError(QString::fromUtf8("连接失败：无法调用Connect方法"));
+    return false;
+  }
+}
+
+void RdpSession::disconnectFromServer() {
+  RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Disconnecting from server...");
+
+  if (m_preflight.isRunning()) {
+    m_preflight.abort();
+    m_connecting = false;
+  }
+
+  // 主动断开不触发自动重连，排队的启动请求一并取消
+  m_loggedIn = false;
+  m_launchQueue.clear();
+  if (m_restoring) {
+    m_reconnectPolicy.reset();
+    m_restoring = false;
+    if (m_control && m_connecting) {
+      try {
+        m_control->dynamicCall("Disconnect()");
+      } catch (...) {
+        RDC_LOG_WARNING(RdcLog::Connect, m_logId,
+                        "Exception while cancelling reconnect");
+      }
+    }
+    m_connecting = false;
+    // 重连等待期间保留的 RemoteApp 对象与控件在此释放
+    releaseRemoteProgram();
+    QMetaObject::invokeMethod(this, "releaseControl", Qt::QueuedConnection);
+  }
+
+  if (m_control && m_connected) {
+    try {
+      m_control->dynamicCall("Disconnect()");
+      RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "RDP disconnected");
+    } catch (...) {
+      RDC_LOG_WARNING(RdcLog::Connect, m_logId,
+                      "Exception occurred while disconnecting");
+    }
+  }
+
+  m_connected = false;
+}
+
+RdpBitmapCache *RdpSession::bitmapCache() const {
+  return m_bitmapCache ? m_bitmapCache : RdpBitmapCache::instance();
+}
+
+void RdpSession::releaseBitmapCache() {
+  if (!m_bitmapCacheDir.isEmpty()) {
+    bitmapCache()->release(m_bitmapCacheDir);
+    m_bitmapCacheDir.clear();
+  }
+}
+
+RdpEventRouter *RdpSession::eventRouter() const {
+  return m_eventRouter ? m_eventRouter : RdpEventRouter::instance();
+}
+
+void RdpSession::detachControlEvents() {
+  if (m_control) {
+    m_control->setEventTarget(nullptr, 0);
+  }
+  if (m_routeId) {
+    eventRouter()->detach(m_routeId);
+    m_routeId = 0;
+  }
+}
+
+// RDP 控件事件
+void RdpSession::handleEvent(const RdpEvent &event) {
+  switch (event.type) {
+  case RdpEvent::Connected:
+    onConnected();
+    break;
+  case RdpEvent::Disconnected:
+    onDisconnected(event.code);
+    break;
+  case RdpEvent::LoginComplete:
+    onLoginComplete();
+    break;
+  case RdpEvent::FatalError:
+    onFatalError(event.code);
+    break;
+  case RdpEvent::RemoteProgramResult:
+    onRemoteProgramResult(event.executablePath, event.railResult(), event.flag);
+    break;
+  case RdpEvent::RemoteWindowDisplayed:
+    onRemoteWindowDisplayed(event.flag, event.windowId);
+    break;
+  }
+}
+
+void RdpSession::onConnected() {
+  m_connected = true;
+  m_connecting = false;
+  if (!m_restoring) {
+    m_lastConnectLatencyMs = m_connectTimer.elapsed();
+  }
+  finishPhase(RdpMetrics::Connect);
+  emit connectedChanged();
+  emit connectionSuccess();
+  RDC_LOG_INFO(RdcLog::Connect, m_logId, "RDP Connected successfully in %1 ms",
+               m_lastConnectLatencyMs);
+}
+
+void RdpSession::onDisconnected(int reason) {
+  // 连接完成前断开（主机不可达、被拒绝、认证失败）是连接失败的常见形式
+  m_connecting = false;
+  m_connected = false;
+  const bool wasLoggedIn = m_loggedIn;
+  m_loggedIn = false;
+  RDC_LOG_INFO(RdcLog::Connect, m_logId, "RDP Disconnected, reason: %1",
+               reason);
+
+  // 已发出的启动请求不会再有结果，远程窗口随连接关闭
+  m_launchQueue.dropInFlight();
+  m_remoteWindows.clear();
+  emit remoteAppActivityChanged();
+
+  // 已登录的会话（或重连中的再次失败）遇到瞬时断开：保留控件与
+  // RemoteApp 对象，等待退避后重连
+  if ((wasLoggedIn || m_restoring) && scheduleReconnect(reason)) {
+    emit connectedChanged();
+    return;
+  }
+  if (m_restoring) {
+    abandonRestore(QStringLiteral("disconnect_%1").arg(reason));
+    emit connectionError(
+        QString::fromUtf8("连接已断开，自动重连失败（原因代码: %1）")
+            .arg(reason));
+  }
+  emit connectedChanged();
+  // 登录完成前断开视为连接失败
+  finishTrace(false, QStringLiteral("disconnect_%1").arg(reason));
+
+  // 断开连接后清理 RemoteApp 状态
+  m_launchQueue.clear();
+  releaseRemoteProgram();
+
+  // 不在控件自身的事件回调中归还控件
+  QMetaObject::invokeMethod(this, "releaseControl", Qt::QueuedConnection);
+}
+
+void RdpSession::onLoginComplete() {
+  RDC_LOG_INFO(RdcLog::Connect, m_logId, "RDP Login completed");
+  m_loggedIn = true;
+  finishPhase(RdpMetrics::Login);
+  // 连接期间窗口尺寸发生过变化
+  updateSessionDisplay();
+
+  // 如果是 RemoteApp 模式，在登录完成后启动应用
+  if (m_settings.remoteAppMode && m_remoteProgram) {
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId,
+                  "Login complete, starting RemoteApp...");
+    startRemoteApps();
+    emit remoteAppActivityChanged();
+  } else {
+    finishTrace(true);
+  }
+}
+
+void RdpSession::onFatalError(int errorCode) {
+  m_connected = false;
+  m_connecting = false;
+  m_loggedIn = false;
+  m_launchQueue.clear();
+  if (m_restoring) {
+    abandonRestore(QStringLiteral("fatal_%1").arg(errorCode));
+  }
+  finishTrace(false, QStringLiteral("fatal_%1").arg(errorCode));
+  // 先报告错误：SessionManager 收到 connectedChanged 时已是失败状态
+  emit connectionError(
+      QString::fromUtf8("致命错误，错误代码: %1").arg(errorCode));
+  emit connectedChanged();
+  RDC_LOG_CRITICAL(RdcLog::Connect, m_logId, "RDP Fatal error: %1",
+                   errorCode);
+}
+
+bool RdpSession::scheduleReconnect(int reason) {
+  if (RdpReconnectPolicy::classify(reason) != RdpReconnectPolicy::Transient ||
+      !m_reconnectPolicy.schedule()) {
+    return false;
+  }
+  if (!m_restoring) {
+    m_restoring = true;
+    m_restoreTimer.start();
+  }
+  m_connecting = false;
+  RDC_LOG_INFO(RdcLog::Connect, m_logId,
+               "Transient disconnect (reason %1), reconnect attempt %2 "
+               "scheduled",
+               reason, m_reconnectPolicy.attempts());
+  emit reconnectScheduled(m_reconnectPolicy.attempts());
+  return true;
+}
+
+void RdpSession::onReconnectRetry(int attempt) {
+  if (!m_restoring) {
+    return;
+  }
+  RDC_LOG_INFO(RdcLog::Connect, m_logId,
+               "Reconnect attempt %1, %2 ms since disconnect", attempt,
+               m_restoreTimer.elapsed());
+
+  // 不做预检、不重建控件：configureClient 只下发与上次不同的属性，
+  // RemoteApp 在 onLoginComplete 中重新启动
+  m_connecting = true;
+  if (!continueConnect()) {
+    abandonRestore(QStringLiteral("reconnect_failed"));
+  }
+}
+
+void RdpSession::completeRestore() {
+  const int attempts = m_reconnectPolicy.attempts();
+  m_restoring = false;
+  m_reconnectPolicy.reset();
+  m_lastRestoreMs = m_restoreTimer.elapsed();
+  metrics()->recordPhase(m_settings.server, RdpMetrics::Restore,
+                         m_restoreTimer.nsecsElapsed() / 1000);
+  RDC_LOG_INFO(RdcLog::Connect, m_logId,
+               "Session restored after %1 attempt(s) in %2 ms", attempts,
+               m_lastRestoreMs);
+}
+
+void RdpSession::abandonRestore(const QString &reason) {
+  RDC_LOG_WARNING(RdcLog::Connect, m_logId,
+                  "Giving up reconnect after %1 attempt(s): %2",
+                  m_reconnectPolicy.attempts(), reason);
+  m_restoring = false;
+  m_connecting = false;
+  m_reconnectPolicy.reset();
+  metrics()->recordFailure(m_settings.server,
+                           QStringLiteral("reconnect_") + reason);
+}
+
+void RdpSession::releaseControl() {
+  RdpControlPool *pool =
+      m_controlPool ? m_controlPool : RdpControlPool::instance();
+  // 重置后归还，直到池中空闲控件达到高水位；池已满时保留已配置的控件，
+  // 重连只需下发变化的属性。期间又发起了连接则不归还
+  if (!pool || !pool->acceptsControls() || !m_control || m_connected ||
+      m_connecting || m_restoring) {
+    return;
+  }
+
+  discardControl(pool);
+  RDC_LOG_DEBUG(RdcLog::Control, m_logId, "RDP control returned to pool");
+}
+
+bool RdpSession::releaseIdleControl() {
+  if (!m_control || m_connected || m_connecting || m_restoring) {
+    return false;
+  }
+  m_launchQueue.clear();
+  discardControl(m_controlPool ? m_controlPool : RdpControlPool::instance());
+  RDC_LOG_DEBUG(RdcLog::Control, m_logId, "Idle RDP control released");
+  return true;
+}
+
+void RdpSession::discardControl(RdpControlPool *pool) {
+  releaseRemoteProgram();
+  releaseAdvancedSettings();
+  emit aboutToReleaseControl(m_control->widget());
+  detachControlEvents();
+  if (pool) {
+    pool->release(m_control);
+  } else {
+    delete m_control;
+  }
+  m_control = nullptr;
+  releaseBitmapCache();
+}
+
+RdpMemoryUsage RdpSession::memoryUsage() const {
+  RdpMemoryUsage usage;
+  usage.settings = m_settings.memoryFootprint();
+  if (!m_control) {
+    return usage;
+  }
+  usage.control = m_control->memoryFootprint();
+  if (m_connected && !m_settings.remoteAppMode) {
+    // 桌面会话按分辨率与色彩深度计一份帧缓冲；RemoteApp 的窗口由本地绘制
+    const qint64 bytesPerPixel = (qMax(8, m_settings.colorDepth) + 7) / 8;
+    usage.frameBuffer = qint64(m_settings.desktopWidth) *
+                        m_settings.desktopHeight * bytesPerPixel;
+  }
+  if (m_advancedSettings) {
+    usage.subObjects += m_advancedSettings->memoryFootprint();
+  }
+  if (m_remoteProgram) {
+    usage.subObjects += m_remoteProgram->memoryFootprint();
+  }
+  return usage;
+}
+
+void RdpSession::applyThrottleProfile(RdpThrottlePolicy::Profile profile) {
+  if (!m_control || !m_advancedSettings) {
+    return;
+  }
+
+  // 后台会话：关闭音频与剪贴板、暂停重绘。色彩深度只在连接前生效，
+  // 会话中修改会被控件拒绝，因此不在这里切换。
+  // ActiveX 控件在会话中可能拒绝部分属性，被拒绝的属性在下次连接时重新下发。
+  const bool background = profile == RdpThrottlePolicy::Background;
+  m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "AudioRedirectionMode",
+                     background || !m_settings.enableSound ? 2 : 0);
+  m_propertyPlan.set(RdpPropertyPlan::AdvancedSettings, "RedirectClipboard",
+                     background ? false : m_settings.enableClipboard);
+  const RdpPropertyPlan::Stats stats =
+      m_propertyPlan.apply(m_control, m_advancedSettings);
+  m_control->setRenderingSuspended(background);
+
+  RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Session %1 %2, %3 properties changed",
+                m_settings.server,
+                background ? "moved to background profile"
+                           : "restored to full profile",
+                stats.issued);
+}
+
+bool RdpSession::dynamicResolutionEnabled() const {
+  // RemoteApp 的窗口由本地绘制，全屏时由控件自行适配显示器
+  return m_settings.dynamicResolution && !m_settings.remoteAppMode &&
+         !m_settings.fullScreen;
+}
+
+void RdpSession::applyDisplaySize(const RdpDisplaySize &size) {
+  if (!dynamicResolutionEnabled()) {
+    return;
+  }
+  m_displaySize = size;
+  updateSessionDisplay();
+}
+
+void RdpSession::updateSessionDisplay() {
+  if (!m_control || !m_connected || !m_loggedIn ||
+      !dynamicResolutionEnabled() || !m_displaySize.isValid() ||
+      m_displaySize == m_sessionDisplaySize) {
+    return;
+  }
+
+  // IMsRdpClient9 起才有此方法；较旧的控件只能重新连接
+  if (m_control->dispatchId("UpdateSessionDisplaySettings") < 0) {
+    RDC_LOG_DEBUG(RdcLog::Control, m_logId,
+                  "Control does not support dynamic resolution");
+    return;
+  }
+
+  const RdpDisplaySize size = m_displaySize;
+  // 物理尺寸（毫米）按缩放对应的 DPI 估算；设备缩放只接受 100/140/180
+  const double dpi = 96.0 * size.scaleFactor / 100.0;
+  const uint physicalWidth = uint(size.width * 25.4 / dpi + 0.5);
+  const uint physicalHeight = uint(size.height * 25.4 / dpi + 0.5);
+  const uint deviceScale =
+      size.scaleFactor < 120 ? 100 : size.scaleFactor < 160 ? 140 : 180;
+  try {
+    m_control->dynamicCall(
+        "UpdateSessionDisplaySettings(uint,uint,uint,uint,uint,uint,uint)",
+        QVariantList() << uint(size.width) << uint(size.height)
+                       << physicalWidth << physicalHeight << 0u
+                       << uint(size.scaleFactor) << deviceScale);
+  } catch (...) {
+    RDC_LOG_WARNING(RdcLog::Control, m_logId,
+                    "Exception while updating session display settings");
+    metrics()->addToCounter("display_update_failures_total");
+    return;
+  }
+
+  RDC_LOG_DEBUG(RdcLog::Control, m_logId,
+                "Session display resized from %1x%2 to %3x%4 at %5%",
+                m_sessionDisplaySize.width, m_sessionDisplaySize.height,
+                size.width, size.height, size.scaleFactor);
+  m_sessionDisplaySize = size;
+  metrics()->addToCounter("display_updates_total");
+}
+
+int RdpSession::tunedColorDepth() const {
+  return qMin(m_settings.colorDepth, m_linkTuner.settings().maxColorDepth);
+}
+
+RdpMetrics *RdpSession::metrics() const {
+  return m_metrics ? m_metrics : RdpMetrics::instance();
+}
+
+void RdpSession::beginPhase() {
+  m_phaseStartNs = m_connectTimer.nsecsElapsed();
+}
+
+void RdpSession::finishPhase(RdpMetrics::Phase phase) {
+  if (!m_tracing) {
+    return;
+  }
+  const qint64 now = m_connectTimer.nsecsElapsed();
+  m_phaseUs[phase] = (now - m_phaseStartNs) / 1000;
+  m_phaseStartNs = now;
+  metrics()->recordPhase(m_settings.server, phase, m_phaseUs[phase]);
+}
+
+void RdpSession::finishTrace(bool success, const QString &failureReason) {
+  // 重连后已重新登录：无论应用是否启动成功，连接都已恢复
+  if (m_restoring && m_connected) {
+    completeRestore();
+  }
+  if (!m_tracing) {
+    return;
+  }
+  m_tracing = false;
+  if (!success) {
+    metrics()->recordFailure(m_settings.server, failureReason);
+    RDC_LOG_DEBUG(RdcLog::Connect, m_logId, "Connect trace failed: %1",
+                  failureReason);
+    return;
+  }
+
+  m_phaseUs[RdpMetrics::Total] = m_connectTimer.nsecsElapsed() / 1000;
+  metrics()->recordPhase(m_settings.server, RdpMetrics::Total,
+                         m_phaseUs[RdpMetrics::Total]);
+  metrics()->recordSuccess(m_settings.server);
+  RDC_LOG_DEBUG(RdcLog::Connect, m_logId,
+                "Connect trace (us): preflight %1, control %2, configure %3, "
+                "connect %4, login %5, total %6",
+                m_phaseUs[RdpMetrics::Preflight],
+                m_phaseUs[RdpMetrics::ControlCreate],
+                m_phaseUs[RdpMetrics::Configure],
+                m_phaseUs[RdpMetrics::Connect], m_phaseUs[RdpMetrics::Login],
+                m_phaseUs[RdpMetrics::Total]);
+}
+
+void RdpSession::releaseAdvancedSettings() {
+  delete m_advancedSettings;
+  m_advancedSettings = nullptr;
+  // 计划属于这个控件，控件归还或删除后不再保留
+  m_propertyPlan.clear();
+}
+
+void RdpSession::releaseRemoteProgram() {
+  if (m_remoteProgram) {
+    try {
+      // 禁用 RemoteApp 模式
+      m_remoteProgram->setValue("RemoteProgramMode", false);
+    } catch (...) {
+      RDC_LOG_WARNING(RdcLog::RemoteApp, m_logId,
+                      "Exception while disabling RemoteApp mode");
+    }
+    delete m_remoteProgram;
+    m_remoteProgram = nullptr;
+  }
+}
+
+// RemoteApp configuration
+void RdpSession::configureRemoteApp() {
+  if (!m_control || !m_settings.remoteAppMode)
+    return;
+
+  RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId, "Configuring RemoteApp");
+  try {
+    // 使用探测到的 RemoteProgram2 / RemoteProgram 接口
+    if (!m_remoteProgram && !m_capabilities.remoteProgramInterface.isEmpty()) {
+      m_remoteProgram = m_control->querySubObject(
+          m_capabilities.remoteProgramInterface.constData());
+    }
+    if (!m_remoteProgram) {
+      RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId,
+                       "Failed to get RemoteProgram interface");
+      emit remoteAppError(
+          QString::fromUtf8("无法获取 RemoteProgram 接口。\n\n"
+                            "此 RDP 客户端版本可能不支持 RemoteApp 功能。\n"
+                            "建议使用 .rdp 文件方式或 mstsc.exe。"));
+      return;
+    }
+
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId,
+                  "RemoteProgram interface obtained successfully");
+
+    // 启用 RemoteApp 模式
+    m_remoteProgram->setValue("RemoteProgramMode", true);
+
+    // 验证模式是否设置成功
+    bool modeSet = m_remoteProgram->value("RemoteProgramMode").toBool();
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId, "RemoteProgramMode set to: %1",
+                  modeSet);
+
+    if (!modeSet) {
+      RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId,
+                       "Failed to enable RemoteProgramMode");
+      emit remoteAppError(QString::fromUtf8("无法启用 RemoteApp 模式"));
+    }
+
+  } catch (...) {
+    RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId,
+                     "Exception occurred while configuring RemoteApp");
+    emit remoteAppError(
+        QString::fromUtf8("配置 RemoteApp 时发生异常。\n\n"
+                          "此 RDP 客户端版本可能不支持 RemoteApp 功能。\n"
+                          "建议使用 .rdp 文件方式或 mstsc.exe。"));
+  }
+}
+
+// Start RemoteApp after login
+void RdpSession::startRemoteApps() {
+  if (!m_remoteProgram) {
+    RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId,
+                     "RemoteProgram object not initialized");
+    finishTrace(false, QStringLiteral("remoteapp_start"));
+    emit remoteAppError(QString::fromUtf8("RemoteProgram对象未初始化"));
+    return;
+  }
+
+  // 连接设置中的应用排在登录前排队的请求之前，作为本次连接的主应用
+  m_primaryLaunchId = -1;
+  if (!m_settings.executablePath.isEmpty()) {
+    m_launchQueue.enqueue(RdpRemoteAppLaunch::fromSettings(m_settings), true);
+  }
+  if (!m_launchQueue.hasPending()) {
+    RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId, "Executable path is empty");
+    finishTrace(false, QStringLiteral("remoteapp_start"));
+    emit remoteAppError(QString::fromUtf8("可执行文件路径不能为空"));
+    return;
+  }
+
+  // 依次发出，不等待前一个 OnRemoteProgramResult
+  while (m_launchQueue.hasPending()) {
+    issueLaunch(m_launchQueue.takeNext());
+  }
+}
+
+int RdpSession::launchRemoteApp(const QString &executablePath,
+                                const QString &filePath,
+                                const QString &workingDirectory,
+                                const QString &arguments,
+                                bool expandEnvVarInWorkingDirectory,
+                                bool expandEnvVarInArguments) {
+  if (!m_settings.remoteAppMode) {
+    RDC_LOG_WARNING(RdcLog::RemoteApp, m_logId,
+                    "launchRemoteApp called on a Desktop mode session");
+    emit remoteAppError(QString::fromUtf8("当前会话不是 RemoteApp 模式"));
+    return -1;
+  }
+  if (executablePath.isEmpty()) {
+    emit remoteAppError(QString::fromUtf8("可执行文件路径不能为空"));
+    return -1;
+  }
+
+  RdpRemoteAppLaunch launch;
+  launch.executablePath = executablePath;
+  launch.filePath = filePath;
+  launch.workingDirectory = workingDirectory;
+  launch.arguments = arguments;
+  launch.expandEnvVarInWorkingDirectory = expandEnvVarInWorkingDirectory;
+  launch.expandEnvVarInArguments = expandEnvVarInArguments;
+  const int launchId = m_launchQueue.enqueue(launch);
+  emit remoteAppActivityChanged();
+
+  // 已登录则立即发出，否则在 onLoginComplete 中与主应用一起发出
+  if (m_loggedIn && m_remoteProgram) {
+    issueLaunch(m_launchQueue.takeNext());
+  } else {
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId,
+                  "RemoteApp #%1 queued until login: %2", launchId,
+                  executablePath);
+  }
+  return launchId;
+}
+
+void RdpSession::issueLaunch(const RdpRemoteAppLaunch &launch) {
+  if (m_primaryLaunchId < 0) {
+    m_primaryLaunchId = launch.id;
+  }
+  const bool primary = launch.id == m_primaryLaunchId;
+
+  RDC_LOG_INFO(RdcLog::RemoteApp, m_logId,
+               "Starting RemoteApp #%1: executable=%2 file=%3 workDir=%4 "
+               "arguments=%5",
+               launch.id, launch.executablePath, launch.filePath,
+               launch.workingDirectory, launch.arguments);
+
+  try {
+    if (m_capabilities.startProgramMethod == "ServerStart") {
+      // RDP v11：只接受可执行文件路径
+      m_remoteProgram->dynamicCall("ServerStart(QString)",
+                                   QVariantList() << launch.executablePath);
+    } else {
+      // 使用 ServerStartProgram 方法启动 RemoteApp
+      // 参数：可执行文件路径、文件路径、工作目录、是否展开工作目录环境变量、参数、是否展开参数环境变量
+      m_remoteProgram->dynamicCall(
+          "ServerStartProgram(QString, QString, QString, bool, QString, bool)",
+          QVariantList() << launch.executablePath << launch.filePath
+                         << launch.workingDirectory
+                         << launch.expandEnvVarInWorkingDirectory
+                         << launch.arguments
+                         << launch.expandEnvVarInArguments);
+    }
+
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId, "%1 called successfully",
+                  m_capabilities.startProgramMethod);
+    if (primary) {
+      m_lastRemoteAppLatencyMs = m_connectTimer.elapsed();
+      emit remoteAppStarted();
+    }
+
+  } catch (...) {
+    RDC_LOG_CRITICAL(RdcLog::RemoteApp, m_logId,
+                     "Exception occurred while starting RemoteApp #%1",
+                     launch.id);
+    emit remoteAppResult(m_launchQueue.fail(launch.id));
+    if (primary) {
+      finishTrace(false, QStringLiteral("remoteapp_start"));
+    }
+    emit remoteAppError(QString::fromUtf8("启动RemoteApp时发生异常"));
+  }
+}
+
+void RdpSession::onRemoteProgramResult(const QString &executablePath,
+                                       RdpEvent::RailResult result,
+                                       bool isExecutable) {
+  // 按路径对应到已发出的启动请求
+  const RdpRemoteAppResult launchResult =
+      m_launchQueue.complete(executablePath, result, isExecutable);
+  RDC_LOG(launchResult.ok() ? RdcLog::Info : RdcLog::Warning,
+          RdcLog::RemoteApp,
+          m_logId,
+          "RemoteApp #%1 启动结果: 程序路径=%2 是否可执行=%3 错误码=%4 "
+          "结果: %5 耗时 %6 us",
+          launchResult.launchId, executablePath, isExecutable, int(result),
+          launchResult.description(), launchResult.latencyUs);
+
+  if (launchResult.latencyUs >= 0) {
+    metrics()->recordPhase(m_settings.server, RdpMetrics::RemoteAppStart,
+                           launchResult.latencyUs);
+  }
+  emit remoteAppResult(launchResult);
+  emit remoteAppActivityChanged();
+
+  if (launchResult.launchId >= 0 && launchResult.launchId == m_primaryLaunchId) {
+    m_phaseUs[RdpMetrics::RemoteAppStart] = launchResult.latencyUs;
+    finishTrace(launchResult.ok(), QStringLiteral("rail_%1").arg(int(result)));
+  }
+}
+
+void RdpSession::onRemoteWindowDisplayed(bool visible, qlonglong windowId) {
+  const int before = m_remoteWindows.size();
+  if (visible) {
+    m_remoteWindows.insert(windowId);
+  } else {
+    m_remoteWindows.remove(windowId);
+  }
+  if (m_remoteWindows.size() != before) {
+    RDC_LOG_DEBUG(RdcLog::RemoteApp, m_logId,
+                  "Remote window %1 %2, %3 window(s) open", windowId,
+                  visible ? "shown" : "closed", m_remoteWindows.size());
+    emit remoteAppActivityChanged();
+  }
+}
+
+bool RdpSession::isRemoteAppIdle() const {
+  return m_settings.remoteAppMode && m_loggedIn && m_remoteWindows.isEmpty() &&
+         !m_launchQueue.hasPending() && m_launchQueue.inFlightCount() == 0;
+}
+
+void RdpSession::runBenchmark(int runs, QTextStream &out) {
+  // 脚本中的服务器耗时：连接、登录、应用启动结果
+  const int connectMs = 20;
+  const int loginMs = 30;
+  const int railMs = 10;
+  // 控件在另一个套间时每次名称解析的往返耗时
+  const int nameLookupUs = 10;
+  const int timeoutMs = 5000;
+
+  QTemporaryDir cacheDir;
+  RdpMetrics metrics;
+  RdpEventRouter router;
+  RdpCapabilityCache capabilityCache(
+      cacheDir.filePath(QStringLiteral("capabilities.json")));
+  RdpBitmapCache bitmapCache(cacheDir.filePath(QStringLiteral("bitmap")),
+                             &metrics);
+
+  out << "connect latency benchmark: " << runs << " runs per row, script "
+      << connectMs << "+" << loginMs << " ms (+" << railMs
+      << " ms RemoteApp), name lookup " << nameLookupUs << " us\n";
+  out << QStringLiteral("  %1 %2 %3 %4 %5 %6 %7 %8\n")
+             .arg(QStringLiteral("mode"), -22)
+             .arg(QStringLiteral("p50 ms"), 8)
+             .arg(QStringLiteral("p90 ms"), 8)
+             .arg(QStringLiteral("p99 ms"), 8)
+             .arg(QStringLiteral("max ms"), 8)
+             .arg(QStringLiteral("engine us"), 10)
+             .arg(QStringLiteral("config us"), 10)
+             .arg(QStringLiteral("calls"), 6);
+
+  for (const bool remoteApp : {false, true}) {
+    for (const bool reuseControl : {false, true}) {
+      const qint64 scriptedUs =
+          qint64(connectMs + loginMs + (remoteApp ? railMs : 0)) * 1000;
+      RdpLatencyHistogram total;
+      RdpLatencyHistogram engine;
+      RdpLatencyHistogram configure;
+      quint64 calls = 0;
+      int failures = 0;
+
+      std::unique_ptr<RdpSession> session;
+      for (int i = 0; i < runs; ++i) {
+        if (!session || !reuseControl) {
+          session.reset(new RdpSession);
+          session->setMetrics(&metrics);
+          session->setEventRouter(&router);
+          session->setCapabilityCache(&capabilityCache);
+          session->setBitmapCache(&bitmapCache);
+          session->setPreflightEnabled(false);
+          session->reconnectPolicy()->setEnabled(false);
+          session->setControlFactory([=]() {
+            FakeRdpControl *control = new FakeRdpControl();
+            control->setNameLookupCost(nameLookupUs);
+            control->setConnectScript(
+                {FakeRdpEvent{FakeRdpEvent::Connected, connectMs},
+                 FakeRdpEvent{FakeRdpEvent::LoginComplete, loginMs}});
+            control->setRemoteProgramResult(railMs, RdpEvent::RailOk);
+            return control;
+          });
+          RdpSettings settings;
+          settings.server = QStringLiteral("bench.example.test");
+          settings.username = QStringLiteral("bench");
+          settings.remoteAppMode = remoteApp;
+          if (remoteApp) {
+            settings.executablePath = QStringLiteral("C:\\Windows\\notepad.exe");
+          }
+          session->setSettings(settings);
+        }
+
+        QEventLoop loop;
+        bool succeeded = false;
+        const QMetaObject::Connection done =
+            remoteApp
+                ? connect(session.get(), &RdpSession::remoteAppResult, &loop,
+                          [&](const RdpRemoteAppResult &result) {
+                            succeeded = result.ok();
+                            loop.quit();
+                          })
+                : connect(session.get(), &RdpSession::connectionSuccess, &loop,
+                          [&]() {
+                            succeeded = true;
+                            loop.quit();
+                          });
+        const QMetaObject::Connection failed =
+            connect(session.get(), &RdpSession::connectionError, &loop,
+                    &QEventLoop::quit);
+        QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+        QElapsedTimer timer;
+        timer.start();
+        if (session->connectToServer()) {
+          loop.exec();
+        }
+        const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+        disconnect(done);
+        disconnect(failed);
+
+        if (succeeded) {
+          total.record(elapsedUs);
+          engine.record(qMax<qint64>(0, elapsedUs - scriptedUs));
+          configure.record(
+              qMax<qint64>(0, session->lastPhaseUs(RdpMetrics::Configure)));
+          if (FakeRdpControl *control =
+                  qobject_cast<FakeRdpControl *>(session->control())) {
+            calls += control->totalCalls();
+          }
+        } else {
+          ++failures;
+        }
+
+        // 等待断开事件送达，复用控件时下一次连接只下发变化的属性
+        QEventLoop closed;
+        const QMetaObject::Connection changed =
+            connect(session.get(), &RdpSession::connectedChanged, &closed,
+                    [&]() {
+                      if (!session->connected()) {
+                        closed.quit();
+                      }
+                    });
+        QTimer::singleShot(timeoutMs, &closed, &QEventLoop::quit);
+        if (session->connected()) {
+          session->disconnectFromServer();
+          closed.exec();
+        }
+        disconnect(changed);
+        if (FakeRdpControl *control =
+                qobject_cast<FakeRdpControl *>(session->control())) {
+          control->resetCounters();
+        }
+      }
+      session.reset();
+
+      const QString mode =
+          QStringLiteral("%1, %2")
+              .arg(QLatin1String(remoteApp ? "remoteapp" : "desktop"),
+                   QLatin1String(reuseControl ? "reconnect" : "cold"));
+      out << QStringLiteral("  %1 %2 %3 %4 %5 %6 %7 %8")
+                 .arg(mode, -22)
+                 .arg(total.percentile(50) / 1000.0, 8, 'f', 1)
+                 .arg(total.percentile(90) / 1000.0, 8, 'f', 1)
+                 .arg(total.percentile(99) / 1000.0, 8, 'f', 1)
+                 .arg(total.max() / 1000.0, 8, 'f', 1)
+                 .arg(engine.percentile(50), 10)
+                 .arg(configure.percentile(50), 10)
+                 .arg(total.count() ? double(calls) / total.count() : 0.0, 6,
+                      'f', 1);
+      if (failures > 0) {
+        out << "  (" << failures << " failed)";
+      }
+      out << "\n";
+      out.flush();
+    }
+  }
+}
@@ -0,0 +1,255 @@
+#ifndef RDPSESSION_H
+#define RDPSESSION_H
+
+#include "RdpCapabilityCache.h"
+#include "RdpControl.h"
+#include "RdpDisplayDebouncer.h"
+#include "RdpEventRouter.h"
+#include "RdpLinkTuner.h"
+#include "RdpMetrics.h"
+#include "RdpPreflight.h"
+#include "RdpPropertyPlan.h"
+#include "RdpReconnectPolicy.h"
+#include "RdpRemoteAppQueue.h"
+#include "RdpSessionReaper.h"
+#include "RdpSettings.h"
+#include "RdpThrottlePolicy.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSet>
+
+class QTextStream;
+class RdpBitmapCache;
+class RdpControlPool;
+class RdpWarmup;
+
+// 无界面的 RDP 会话引擎：连接 / 登录 / RemoteApp 状态机
+// 只通过 RdpControl 接口访问控件，不依赖 QAxContainer 和窗口；
+// 控件事件经 RdpEventRouter 排队送达 handleEvent。
+class RdpSession : public QObject, private RdpEventHandler {
+  Q_OBJECT
+
+public:
+  explicit RdpSession(QObject *parent = nullptr);
+  ~RdpSession();
+
+  // 替换控件工厂（默认为 RdpControl::createDefault）
+  void setControlFactory(const RdpControlFactory &factory);
+  // 优先从控件池取控件，断开后归还（默认为 RdpControlPool::instance()）
+  void setControlPool(RdpControlPool *pool) { m_controlPool = pool; }
+  // 控件能力探测缓存（默认为 RdpCapabilityCache::instance()）
+  void setCapabilityCache(RdpCapabilityCache *cache) {
+    m_capabilityCache = cache;
+  }
+  // 连接阶段耗时与结果的汇总（默认为 RdpMetrics::instance()）
+  void setMetrics(RdpMetrics *metrics) { m_metrics = metrics; }
+  // 控件事件队列（默认为 RdpEventRouter::instance()），需在连接前设置
+  void setEventRouter(RdpEventRouter *router) { m_eventRouter = router; }
+  // 持久化位图缓存目录（默认为 RdpBitmapCache::instance()）
+  void setBitmapCache(RdpBitmapCache *cache) { m_bitmapCache = cache; }
+  // 记录连接历史并复用预热的预检结果（默认为 RdpWarmup::instance()，
+  // 未创建预热器时不记录）
+  void setWarmup(RdpWarmup *warmup) { m_warmup = warmup; }
+
+  const RdpSettings &settings() const { return m_settings; }
+  void setSettings(const RdpSettings &settings) { m_settings = settings; }
+
+  // 日志记录中的会话 ID，默认按创建顺序分配
+  int logId() const { return m_logId; }
+  void setLogId(int id) {
+    m_logId = id;
+    m_linkTuner.setLogId(id);
+    m_preflight.setLogId(id);
+  }
+
+  bool connected() const { return m_connected; }
+  bool connecting() const { return m_connecting; }
+  RdpControl *control() const { return m_control; }
+  QWidget *widget() const;
+
+  // 连接前先做 DNS / TCP / X.224 预检，不可达时在创建控件前快速失败
+  bool preflightEnabled() const { return m_preflightEnabled; }
+  void setPreflightEnabled(bool enabled) { m_preflightEnabled = enabled; }
+  const RdpPreflightResult &lastPreflightResult() const {
+    return m_lastPreflightResult;
+  }
+
+  // 根据预检测得的链路质量选择色彩深度、压缩与体验标志；
+  // 关闭预检时可直接向其注入测量值
+  RdpLinkTuner *linkTuner() { return &m_linkTuner; }
+
+  // 根据窗口可见性与焦点切换完整/低开销配置
+  RdpThrottlePolicy *throttlePolicy() { return &m_throttlePolicy; }
+
+  // 窗口尺寸与 DPI 变化经合并、限速后调整远程桌面分辨率
+  // （settings.dynamicResolution 为 true 的桌面会话）；登录前的请求在
+  // 登录后下发，之后的连接也直接使用该尺寸
+  RdpDisplayDebouncer *displayDebouncer() { return &m_displayDebouncer; }
+  // 远程桌面当前的尺寸
+  RdpDisplaySize sessionDisplaySize() const { return m_sessionDisplaySize; }
+
+  // 登录后因网络等瞬时原因断开时自动重连：保留已配置的控件与 RemoteApp
+  // 对象，重连只下发变化的属性，登录后重新启动应用
+  RdpReconnectPolicy *reconnectPolicy() { return &m_reconnectPolicy; }
+  bool isRestoring() const { return m_restoring; }
+  // 最近一次从断线到恢复（登录完成或应用重新启动）的耗时，未发生为 -1
+  qint64 lastRestoreMs() const { return m_lastRestoreMs; }
+
+  // 最近一次 connectToServer() 到 connectionSuccess / remoteAppStarted 的耗时，未完成为 -1
+  qint64 lastConnectLatencyMs() const { return m_lastConnectLatencyMs; }
+  qint64 lastRemoteAppLatencyMs() const { return m_lastRemoteAppLatencyMs; }
+  // 最近一次连接中各阶段的耗时（微秒），未经过的阶段为 -1
+  qint64 lastPhaseUs(RdpMetrics::Phase phase) const {
+    return m_phaseUs[phase];
+  }
+  // 控件、帧缓冲、子对象与设置的内存估算（不含界面层的窗口）
+  RdpMemoryUsage memoryUsage() const;
+  // 未连接时立即释放控件与子对象（归还控件池或删除），之后连接会重新
+  // 创建控件；连接中、重连中返回 false
+  bool releaseIdleControl();
+
+  // 最近一次 configureClient 下发的属性调用数与耗时
+  // （不含后台档位切换时的下发）
+  const RdpPropertyPlan::Stats &lastApplyStats() const {
+    return m_configureStats;
+  }
+
+  // RemoteApp 启动队列：登录前调用时排队，登录后立即发出；同一连接上的
+  // 多个启动不等待前一个结果。结果通过 remoteAppResult 按启动 ID 返回。
+  // 会话不是 RemoteApp 模式或路径为空时返回 -1
+  int launchRemoteApp(const QString &executablePath,
+                      const QString &filePath = QString(),
+                      const QString &workingDirectory = QString(),
+                      const QString &arguments = QString(),
+                      bool expandEnvVarInWorkingDirectory = false,
+                      bool expandEnvVarInArguments = false);
+  int pendingRemoteAppLaunches() const { return m_launchQueue.pendingCount(); }
+  int inFlightRemoteAppLaunches() const {
+    return m_launchQueue.inFlightCount();
+  }
+  // 当前显示的 RemoteApp 窗口数
+  int remoteWindowCount() const { return m_remoteWindows.size(); }
+  // 已登录的 RemoteApp 会话没有窗口、也没有待发或未返回的启动请求
+  bool isRemoteAppIdle() const;
+
+  // 在脚本化的模拟控件上测量 connectToServer() 到登录完成 / 应用启动结果
+  // 的延迟，扣除脚本中的等待后得到引擎自身的开销；首次连接与复用控件的
+  // 重连各 runs 次
+  static void runBenchmark(int runs, QTextStream &out);
+
+public slots:
+  bool connectToServer();
+  void disconnectFromServer();
+
+signals:
+  void connectedChanged();
+  void connectionError(const QString &error);
+  void connectionSuccess();
+  void remoteAppStarted();
+  void remoteAppError(const QString &error);
+  // 每个启动请求的 OnRemoteProgramResult（或调用失败）
+  void remoteAppResult(const RdpRemoteAppResult &result);
+  // RemoteApp 窗口或启动请求变化，isRemoteAppIdle() 可能改变
+  void remoteAppActivityChanged();
+  // 即将调用 Connect()，界面层在此嵌入并显示控件
+  void aboutToConnect(QWidget *widget);
+  // 控件即将归还控件池，界面层需从窗口中移除控件
+  void aboutToReleaseControl(QWidget *widget);
+  // 瞬时断线后已安排第 attempt 次自动重连
+  void reconnectScheduled(int attempt);
+
+private slots:
+  void releaseControl();
+  void onPreflightFinished(const RdpPreflightResult &result);
+  void applyThrottleProfile(RdpThrottlePolicy::Profile profile);
+  void onReconnectRetry(int attempt);
+  void applyDisplaySize(const RdpDisplaySize &size);
+
+private:
+  // 控件事件
+  void handleEvent(const RdpEvent &event) override;
+  void onConnected();
+  void onDisconnected(int reason);
+  void onLoginComplete();
+  void onFatalError(int errorCode);
+  void onRemoteProgramResult(const QString &executablePath,
+                             RdpEvent::RailResult result, bool isExecutable);
+  void onRemoteWindowDisplayed(bool visible, qlonglong windowId);
+  RdpEventRouter *eventRouter() const;
+  // 停止接收当前控件的事件（释放或删除控件前调用）
+  void detachControlEvents();
+  // 释放子对象并归还（pool 非空）或删除控件
+  void discardControl(RdpControlPool *pool);
+  RdpBitmapCache *bitmapCache() const;
+  // 归还当前连接使用的位图缓存目录，之后可被淘汰
+  void releaseBitmapCache();
+
+  static int nextLogId();
+  bool continueConnect();
+  void initializeControl();
+  void configureClient();
+  void configureRemoteApp();
+  void startRemoteApps();
+  void issueLaunch(const RdpRemoteAppLaunch &launch);
+  void releaseRemoteProgram();
+  void releaseAdvancedSettings();
+  bool dynamicResolutionEnabled() const;
+  // 登录后远程桌面尺寸与目标不同时调用 UpdateSessionDisplaySettings
+  void updateSessionDisplay();
+  int tunedColorDepth() const;
+  RdpMetrics *metrics() const;
+  void beginPhase();
+  void finishPhase(RdpMetrics::Phase phase);
+  // 连接流程结束（登录完成或应用启动有结果）时调用：记录总耗时与成功，
+  // 或按原因记录失败；自动重连中则记录恢复耗时
+  void finishTrace(bool success, const QString &failureReason = QString());
+  bool scheduleReconnect(int reason);
+  void completeRestore();
+  void abandonRestore(const QString &reason);
+
+  RdpControlFactory m_controlFactory;
+  RdpControlPool *m_controlPool;
+  RdpCapabilityCache *m_capabilityCache;
+  RdpMetrics *m_metrics;
+  RdpEventRouter *m_eventRouter;
+  RdpBitmapCache *m_bitmapCache;
+  QString m_bitmapCacheDir; // 当前连接使用的位图缓存目录
+  RdpWarmup *m_warmup;
+  RdpControl *m_control;
+  RdpCapabilities m_capabilities;
+  RdpDispatch *m_remoteProgram;    // RemoteProgram 接口对象
+  RdpDispatch *m_advancedSettings; // AdvancedSettings 接口对象，随控件缓存
+  RdpPropertyPlan m_propertyPlan;
+  RdpPropertyPlan::Stats m_configureStats; // 最近一次 configureClient 的下发
+  RdpThrottlePolicy m_throttlePolicy;
+  RdpDisplayDebouncer m_displayDebouncer;
+  RdpDisplaySize m_displaySize;        // 窗口要求的尺寸，未调整过时无效
+  RdpDisplaySize m_sessionDisplaySize; // 连接时设置或最近下发的尺寸
+  RdpReconnectPolicy m_reconnectPolicy;
+  RdpRemoteAppQueue m_launchQueue;
+  QSet<qlonglong> m_remoteWindows;
+  RdpLinkTuner m_linkTuner;
+  RdpPreflight m_preflight;
+  RdpPreflightResult m_lastPreflightResult;
+  bool m_preflightEnabled;
+  RdpSettings m_settings;
+  bool m_connected;
+  bool m_connecting;
+  bool m_loggedIn;
+  bool m_restoring; // 瞬时断线后等待或正在自动重连
+  int m_primaryLaunchId; // 本次登录后第一个发出的启动，决定连接计时的结束
+
+  QElapsedTimer m_connectTimer;
+  qint64 m_lastConnectLatencyMs;
+  qint64 m_lastRemoteAppLatencyMs;
+  bool m_tracing;        // 本次连接的阶段计时是否仍在进行
+  qint64 m_phaseStartNs; // 当前阶段起点，相对 m_connectTimer
+  qint64 m_phaseUs[RdpMetrics::PhaseCount];
+  QElapsedTimer m_restoreTimer;
+  qint64 m_lastRestoreMs;
+  int m_logId;
+  // 事件路由 ID，每次取得控件时重新分配，已释放控件的滞留事件不会送达
+  int m_routeId;
+};
+
+#endif // RDPSESSION_H
@@ -0,0 +1,80 @@
+#include "RdpSessionCache.h"
+#include "RdpMetrics.h"
+#include "RdpSettings.h"
+
+RdpSessionKey RdpSessionKey::fromSettings(const RdpSettings &settings) {
+  RdpSessionKey key;
+  key.server = settings.server.trimmed().toLower();
+  key.port = settings.port;
+  key.username = settings.username.trimmed().toLower();
+  key.enableSound = settings.enableSound;
+  key.enableClipboard = settings.enableClipboard;
+  key.enablePrinter = settings.enablePrinter;
+  return key;
+}
+
+bool RdpSessionKey::operator==(const RdpSessionKey &other) const {
+  return port == other.port && enableSound == other.enableSound &&
+         enableClipboard == other.enableClipboard &&
+         enablePrinter == other.enablePrinter && server == other.server &&
+         username == other.username;
+}
+
+uint qHash(const RdpSessionKey &key, uint seed) {
+  const uint flags = (key.enableSound ? 1u : 0u) |
+                     (key.enableClipboard ? 2u : 0u) |
+                     (key.enablePrinter ? 4u : 0u);
+  return qHash(key.server, seed) ^ qHash(key.username, seed) ^
+         qHash(key.port, seed) ^ (flags << 24);
+}
+
+RdpSessionCache::RdpSessionCache(RdpMetrics *metrics, QObject *parent)
+    : QObject(parent), m_metrics(metrics ? metrics : RdpMetrics::instance()) {}
+
+int RdpSessionCache::lookup(const RdpSessionKey &key) {
+  ++m_stats.lookups;
+  m_metrics->addToCounter("session_cache_lookups_total");
+  const int sessionId = m_sessions.value(key, -1);
+  if (sessionId >= 0) {
+    ++m_stats.hits;
+    m_metrics->addToCounter("session_cache_hits_total");
+  }
+  return sessionId;
+}
+
+void RdpSessionCache::insert(const RdpSessionKey &key, int sessionId) {
+  remove(sessionId);
+  const int previous = m_sessions.value(key, -1);
+  if (previous >= 0) {
+    remove(previous);
+  }
+  m_sessions.insert(key, sessionId);
+  m_keys.insert(sessionId, key);
+}
+
+void RdpSessionCache::remove(int sessionId) {
+  const auto it = m_keys.find(sessionId);
+  if (it == m_keys.end()) {
+    return;
+  }
+  m_sessions.remove(it.value());
+  m_keys.erase(it);
+}
+
+void RdpSessionCache::evict(int sessionId) {
+  if (!m_keys.contains(sessionId)) {
+    return;
+  }
+  remove(sessionId);
+  ++m_stats.evictions;
+  m_metrics->addToCounter("session_cache_evictions_total");
+}
+
+void RdpSessionCache::recordSaved(qint64 savedMs) {
+  if (savedMs <= 0) {
+    return;
+  }
+  m_stats.timeSavedMs += savedMs;
+  m_metrics->addToCounter("session_cache_time_saved_seconds_total",
+                          savedMs / 1000.0);
+}
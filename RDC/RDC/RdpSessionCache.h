@@ -0,0 +1,69 @@
+#ifndef RDPSESSIONCACHE_H
+#define RDPSESSIONCACHE_H
+
+#include <QHash>
+#include <QObject>
+
+class RdpMetrics;
+struct RdpSettings;
+
+// 可复用连接的键：同一服务器、端口、用户且重定向设置相同的
+// RemoteApp 请求可以共用一个已登录的会话
+struct RdpSessionKey {
+  QString server; // 小写
+  int port = 0;
+  QString username; // 小写
+  bool enableSound = false;
+  bool enableClipboard = false;
+  bool enablePrinter = false;
+
+  static RdpSessionKey fromSettings(const RdpSettings &settings);
+  bool operator==(const RdpSessionKey &other) const;
+  bool operator!=(const RdpSessionKey &other) const {
+    return !(*this == other);
+  }
+};
+
+uint qHash(const RdpSessionKey &key, uint seed = 0);
+
+// RemoteApp 会话缓存
+// 按 RdpSessionKey 记录活动会话，只负责复用。空闲会话何时断开由
+// RdpSessionReaper 决定，回收时 SessionManager 调用 evict。
+// 命中率与节省的登录时间导出为 RdpMetrics 计数器。
+class RdpSessionCache : public QObject {
+  Q_OBJECT
+
+public:
+  struct Stats {
+    quint64 lookups = 0;
+    quint64 hits = 0;
+    quint64 evictions = 0;
+    qint64 timeSavedMs = 0;
+  };
+
+  // 使用指定的指标；默认为 RdpMetrics::instance()
+  explicit RdpSessionCache(RdpMetrics *metrics = nullptr,
+                           QObject *parent = nullptr);
+
+  // 返回缓存的会话 ID，未命中返回 -1（均计入统计）
+  int lookup(const RdpSessionKey &key);
+  void insert(const RdpSessionKey &key, int sessionId);
+  void remove(int sessionId);
+  // 会话因空闲或内存预算被回收：移除并计入 evictions
+  void evict(int sessionId);
+  bool contains(int sessionId) const { return m_keys.contains(sessionId); }
+  int size() const { return m_keys.size(); }
+
+  // 命中后复用的会话省去了一次完整登录，savedMs 为该次登录的耗时
+  void recordSaved(qint64 savedMs);
+
+  const Stats &stats() const { return m_stats; }
+
+private:
+  RdpMetrics *m_metrics;
+  QHash<RdpSessionKey, int> m_sessions;
+  QHash<int, RdpSessionKey> m_keys;
+  Stats m_stats;
+};
+
+#endif // RDPSESSIONCACHE_H
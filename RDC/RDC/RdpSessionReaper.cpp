@@ -0,0 +1,234 @@
+#include "RdpSessionReaper.h"
+#include "RdcLog.h"
+
+RdpMemoryUsage &RdpMemoryUsage::operator+=(const RdpMemoryUsage &other) {
+  control += other.control;
+  frameBuffer += other.frameBuffer;
+  subObjects += other.subObjects;
+  settings += other.settings;
+  window += other.window;
+  return *this;
+}
+
+QVariantMap RdpMemoryUsage::toVariantMap() const {
+  QVariantMap map;
+  map.insert(QStringLiteral("control"), control);
+  map.insert(QStringLiteral("frameBuffer"), frameBuffer);
+  map.insert(QStringLiteral("subObjects"), subObjects);
+  map.insert(QStringLiteral("settings"), settings);
+  map.insert(QStringLiteral("window"), window);
+  map.insert(QStringLiteral("total"), total());
+  return map;
+}
+
+RdpSessionReaper::RdpSessionReaper(QObject *parent)
+    : QObject(parent), m_idleTimeoutMs(10 * 60 * 1000), m_memoryBudget(0),
+      m_nextId(0), m_useCounter(0) {
+  bool ok = false;
+  const int idleTimeout = qEnvironmentVariableIntValue("RDC_REAP_IDLE_MS", &ok);
+  if (ok) {
+    m_idleTimeoutMs = idleTimeout;
+  }
+  const int budgetMb =
+      qEnvironmentVariableIntValue("RDC_MEMORY_BUDGET_MB", &ok);
+  if (ok) {
+    m_memoryBudget = qint64(budgetMb) * 1024 * 1024;
+  }
+
+  m_clock.start();
+  m_timer.setInterval(5000);
+  connect(&m_timer, &QTimer::timeout, this, &RdpSessionReaper::sweep);
+}
+
+void RdpSessionReaper::setIdleTimeout(int ms) {
+  m_idleTimeoutMs = ms;
+  updateTimer();
+}
+
+void RdpSessionReaper::setMemoryBudget(qint64 bytes) {
+  m_memoryBudget = bytes;
+  updateTimer();
+  // 调低预算后立即生效
+  if (m_memoryBudget > 0) {
+    sweep();
+  }
+}
+
+void RdpSessionReaper::setCheckInterval(int ms) {
+  m_timer.setInterval(qMax(1, ms));
+}
+
+int RdpSessionReaper::track(int logId, const QString &label,
+                            const UsageFunction &usage,
+                            const ReleaseFunction &release) {
+  Tracked tracked;
+  tracked.logId = logId;
+  tracked.label = label;
+  tracked.usage = usage;
+  tracked.release = release;
+  tracked.lastUsed = ++m_useCounter;
+  const int id = ++m_nextId;
+  m_tracked.insert(id, tracked);
+  return id;
+}
+
+void RdpSessionReaper::untrack(int id) {
+  m_tracked.remove(id);
+  updateTimer();
+}
+
+void RdpSessionReaper::setState(int id, State state) {
+  auto it = m_tracked.find(id);
+  if (it == m_tracked.end() || it->state == state) {
+    return;
+  }
+  it->state = state;
+  if (state == Idle || state == Disconnected) {
+    it->idleSinceMs = m_clock.elapsed();
+  }
+  updateTimer();
+}
+
+void RdpSessionReaper::touch(int id) {
+  auto it = m_tracked.find(id);
+  if (it == m_tracked.end()) {
+    return;
+  }
+  it->lastUsed = ++m_useCounter;
+  it->idleSinceMs = m_clock.elapsed();
+}
+
+RdpSessionReaper::State RdpSessionReaper::state(int id) const {
+  auto it = m_tracked.constFind(id);
+  return it == m_tracked.constEnd() ? Released : it->state;
+}
+
+RdpMemoryUsage RdpSessionReaper::usage(int id) const {
+  auto it = m_tracked.constFind(id);
+  return it == m_tracked.constEnd() || !it->usage ? RdpMemoryUsage()
+                                                  : it->usage();
+}
+
+RdpMemoryUsage RdpSessionReaper::totalUsage() const {
+  RdpMemoryUsage total;
+  for (const Tracked &tracked : m_tracked) {
+    if (tracked.usage) {
+      total += tracked.usage();
+    }
+  }
+  return total;
+}
+
+QString RdpSessionReaper::reasonName(Reason reason) {
+  switch (reason) {
+  case IdleTimeout:
+    return QStringLiteral("idle_timeout");
+  case MemoryBudget:
+    return QStringLiteral("memory_budget");
+  default:
+    return QStringLiteral("unknown");
+  }
+}
+
+int RdpSessionReaper::sweep() {
+  int released = 0;
+
+  if (m_idleTimeoutMs >= 0) {
+    const qint64 now = m_clock.elapsed();
+    // 释放函数可能注销其它会话，逐个按 ID 重新查找
+    const QList<int> ids = m_tracked.keys();
+    for (const int id : ids) {
+      auto it = m_tracked.constFind(id);
+      if (it == m_tracked.constEnd() ||
+          (it->state != Idle && it->state != Disconnected) ||
+          now - it->idleSinceMs < m_idleTimeoutMs) {
+        continue;
+      }
+      release(id, IdleTimeout, usage(id).total());
+      ++released;
+    }
+  }
+
+  if (m_memoryBudget > 0) {
+    qint64 total = totalUsage().total();
+    while (total > m_memoryBudget) {
+      int victim = leastRecentlyUsed(Disconnected);
+      if (!victim) {
+        victim = leastRecentlyUsed(Idle);
+      }
+      if (!victim) {
+        RDC_LOG_WARNING(RdcLog::General, 0,
+                        "Session memory %1 KiB over budget %2 KiB, "
+                        "no idle session to release",
+                        total / 1024, m_memoryBudget / 1024);
+        break;
+      }
+      const qint64 bytes = usage(victim).total();
+      release(victim, MemoryBudget, bytes);
+      ++released;
+      total -= bytes;
+    }
+  }
+
+  if (released) {
+    emit statsChanged();
+  }
+  return released;
+}
+
+int RdpSessionReaper::leastRecentlyUsed(State state) const {
+  int victim = 0;
+  quint64 oldest = 0;
+  for (auto it = m_tracked.constBegin(); it != m_tracked.constEnd(); ++it) {
+    if (it->state == state && (!victim || it->lastUsed < oldest)) {
+      victim = it.key();
+      oldest = it->lastUsed;
+    }
+  }
+  return victim;
+}
+
+void RdpSessionReaper::release(int id, Reason reason, qint64 bytes) {
+  auto it = m_tracked.find(id);
+  if (it == m_tracked.end()) {
+    return;
+  }
+  // 释放函数中可能更新状态或注销，先复制需要的内容
+  it->state = Released;
+  const QString label = it->label;
+  const int logId = it->logId;
+  const ReleaseFunction releaseFunction = it->release;
+
+  ++m_stats.reaped;
+  if (reason == IdleTimeout) {
+    ++m_stats.idleTimeouts;
+  } else {
+    ++m_stats.budgetEvictions;
+  }
+  m_stats.bytesFreed += bytes;
+  RDC_LOG_INFO(RdcLog::General, logId, "Reaping session %1 (%2, %3 KiB)", label,
+               reasonName(reason), bytes / 1024);
+
+  if (releaseFunction) {
+    releaseFunction(reason);
+  }
+  emit reaped(id, label, reason, bytes);
+  updateTimer();
+}
+
+void RdpSessionReaper::updateTimer() {
+  bool waiting = false;
+  if (m_idleTimeoutMs >= 0 || m_memoryBudget > 0) {
+    for (const Tracked &tracked : qAsConst(m_tracked)) {
+      if (tracked.state == Idle || tracked.state == Disconnected) {
+        waiting = true;
+        break;
+      }
+    }
+  }
+  if (waiting && !m_timer.isActive()) {
+    m_timer.start();
+  } else if (!waiting) {
+    m_timer.stop();
+  }
+}
@@ -0,0 +1,123 @@
+#ifndef RDPSESSIONREAPER_H
+#define RDPSESSIONREAPER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+
+// 会话占用内存的估算（字节）
+struct RdpMemoryUsage {
+  qint64 control = 0;     // 控件本身（由后端报告）
+  qint64 frameBuffer = 0; // 连接中的桌面帧缓冲
+  qint64 subObjects = 0;  // AdvancedSettings / RemoteProgram 子对象
+  qint64 settings = 0;    // 缓存的连接设置
+  qint64 window = 0;      // RdpWindow 及其后备存储
+
+  qint64 total() const {
+    return control + frameBuffer + subObjects + settings + window;
+  }
+  RdpMemoryUsage &operator+=(const RdpMemoryUsage &other);
+  QVariantMap toVariantMap() const;
+};
+
+// 空闲会话回收
+// 会话的持有者（SessionManager、RdpClient）各自拥有一个回收器，登记会话的
+// 内存估算与释放函数，并在会话状态变化时更新。空闲会话何时释放只由
+// 回收器决定（RdpSessionCache 只负责复用）。定时检查：断开或空闲超过 idleTimeout 的会话
+// 被释放；总占用超过 memoryBudget 时按最久未使用先释放断开的会话，再释放
+// 空闲的会话。连接中或有活动的会话不回收。释放只归还控件、窗口与子对象，
+// 会话设置保留，之后可以重新连接。
+class RdpSessionReaper : public QObject {
+  Q_OBJECT
+
+public:
+  enum State {
+    Active,       // 连接中、已连接或正在重连
+    Idle,         // 已连接但没有活动（RemoteApp 没有窗口与启动请求）
+    Disconnected, // 已断开，仍持有控件或窗口
+    Released      // 不持有控件与窗口
+  };
+  Q_ENUM(State)
+
+  enum Reason { IdleTimeout, MemoryBudget };
+  Q_ENUM(Reason)
+
+  struct Stats {
+    quint64 reaped = 0;
+    quint64 idleTimeouts = 0;
+    quint64 budgetEvictions = 0;
+    qint64 bytesFreed = 0;
+  };
+
+  typedef std::function<RdpMemoryUsage()> UsageFunction;
+  typedef std::function<void(Reason reason)> ReleaseFunction;
+
+  // 默认策略可由 RDC_REAP_IDLE_MS、RDC_MEMORY_BUDGET_MB 指定
+  explicit RdpSessionReaper(QObject *parent = nullptr);
+
+  // 断开或空闲会话保留的时间，小于 0 表示不按时间回收
+  int idleTimeout() const { return m_idleTimeoutMs; }
+  void setIdleTimeout(int ms);
+  // 所有登记会话的内存上限，小于等于 0 表示不限制
+  qint64 memoryBudget() const { return m_memoryBudget; }
+  void setMemoryBudget(qint64 bytes);
+  int checkInterval() const { return m_timer.interval(); }
+  void setCheckInterval(int ms);
+
+  // 登记会话，返回回收器中的 ID；初始状态为 Released。
+  // logId 为会话在 RdcLog 中的 ID
+  int track(int logId, const QString &label, const UsageFunction &usage,
+            const ReleaseFunction &release);
+  void untrack(int id);
+  // 状态离开 Active 时开始计时
+  void setState(int id, State state);
+  // 会话被使用（连接、显示、启动应用）时调用，更新最近使用顺序
+  void touch(int id);
+
+  State state(int id) const;
+  RdpMemoryUsage usage(int id) const;
+  RdpMemoryUsage totalUsage() const;
+  int trackedCount() const { return m_tracked.size(); }
+  const Stats &stats() const { return m_stats; }
+
+  static QString reasonName(Reason reason);
+
+public slots:
+  // 立即按策略检查一次，返回释放的会话数
+  int sweep();
+
+signals:
+  void reaped(int id, const QString &label, RdpSessionReaper::Reason reason,
+              qint64 bytes);
+  void statsChanged();
+
+private:
+  struct Tracked {
+    int logId = 0;
+    QString label;
+    UsageFunction usage;
+    ReleaseFunction release;
+    State state = Released;
+    qint64 idleSinceMs = 0;
+    quint64 lastUsed = 0;
+  };
+
+  // 同一状态中最久未使用的会话，没有时返回 0
+  int leastRecentlyUsed(State state) const;
+  void release(int id, Reason reason, qint64 bytes);
+  void updateTimer();
+
+  QHash<int, Tracked> m_tracked;
+  QElapsedTimer m_clock;
+  QTimer m_timer;
+  int m_idleTimeoutMs;
+  qint64 m_memoryBudget;
+  int m_nextId;
+  quint64 m_useCounter;
+  Stats m_stats;
+};
+
+#endif // RDPSESSIONREAPER_H
@@ -0,0 +1,164 @@
+#include "RdpSettings.h"
+
+static_assert(RdpSettings::FieldCount <= 32,
+              "RdpSettings::FieldMask 需要容纳所有字段");
+
+namespace {
+
+template <typename T> bool convertible(const QVariant &value) {
+  return value.canConvert<T>();
+}
+
+template <> bool convertible<int>(const QVariant &value) {
+  bool ok = false;
+  value.toInt(&ok);
+  return ok;
+}
+
+bool checkRange(RdpSettings::Field field, const QVariant &value,
+                QString *error) {
+  const int number = value.toInt();
+  switch (field) {
+  case RdpSettings::portField:
+    if (number < 1 || number > 65535) {
+      *error = QString::fromUtf8("端口必须在 1 到 65535 之间");
+      return false;
+    }
+    return true;
+  case RdpSettings::desktopWidthField:
+  case RdpSettings::desktopHeightField:
+    // MsTscAx 接受的桌面尺寸范围
+    if (number < 200 || number > 8192) {
+      *error = QString::fromUtf8("分辨率必须在 200 到 8192 之间");
+      return false;
+    }
+    return true;
+  case RdpSettings::colorDepthField:
+    if (number != 8 && number != 15 && number != 16 && number != 24 &&
+        number != 32) {
+      *error = QString::fromUtf8("色彩深度必须是 8、15、16、24 或 32");
+      return false;
+    }
+    return true;
+  default:
+    return true;
+  }
+}
+
+} // namespace
+
+const char *RdpSettings::fieldName(Field field) {
+  switch (field) {
+#define RDP_SETTINGS_NAME(type, name, setter, def)                             \
+  case name##Field:                                                            \
+    return #name;
+    RDP_SETTINGS_FIELDS(RDP_SETTINGS_NAME)
+#undef RDP_SETTINGS_NAME
+  default:
+    return nullptr;
+  }
+}
+
+RdpSettings::Field RdpSettings::fieldOf(const QString &name) {
+  for (int field = 0; field < FieldCount; ++field) {
+    if (name == QLatin1String(fieldName(Field(field)))) {
+      return Field(field);
+    }
+  }
+  return FieldCount;
+}
+
+QStringList RdpSettings::fieldNames(FieldMask mask) {
+  QStringList names;
+  for (int field = 0; field < FieldCount; ++field) {
+    if (mask & (FieldMask(1) << field)) {
+      names << QLatin1String(fieldName(Field(field)));
+    }
+  }
+  return names;
+}
+
+RdpSettings::FieldMask RdpSettings::diff(const RdpSettings &other) const {
+  FieldMask mask = 0;
+#define RDP_SETTINGS_DIFF(type, name, setter, def)                             \
+  if (name != other.name) {                                                    \
+    mask |= FieldMask(1) << name##Field;                                       \
+  }
+  RDP_SETTINGS_FIELDS(RDP_SETTINGS_DIFF)
+#undef RDP_SETTINGS_DIFF
+  return mask;
+}
+
+bool RdpSettings::validate(const QVariantMap &map, QString *error) {
+  QString message;
+  for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+    const Field field = fieldOf(it.key());
+    bool ok = true;
+    switch (field) {
+#define RDP_SETTINGS_CHECK(type, name, setter, def)                            \
+  case name##Field:                                                            \
+    ok = convertible<type>(it.value());                                        \
+    break;
+      RDP_SETTINGS_FIELDS(RDP_SETTINGS_CHECK)
+#undef RDP_SETTINGS_CHECK
+    default:
+      message = QString::fromUtf8("未知的设置项: %1").arg(it.key());
+      break;
+    }
+    if (message.isEmpty() && !ok) {
+      message = QString::fromUtf8("设置项 %1 的值无效").arg(it.key());
+    }
+    if (message.isEmpty()) {
+      checkRange(field, it.value(), &message);
+    }
+    if (!message.isEmpty()) {
+      if (error) {
+        *error = message;
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+RdpSettings RdpSettings::fromVariantMap(const QVariantMap &map,
+                                        const RdpSettings &base) {
+  RdpSettings s = base;
+  QVariantMap::const_iterator it;
+#define RDP_SETTINGS_READ(type, name, setter, def)                             \
+  it = map.constFind(QStringLiteral(#name));                                   \
+  if (it != map.constEnd()) {                                                  \
+    s.name = it.value().value<type>();                                         \
+  }
+  RDP_SETTINGS_FIELDS(RDP_SETTINGS_READ)
+#undef RDP_SETTINGS_READ
+  return s;
+}
+
+QVariantMap RdpSettings::toVariantMap() const {
+  QVariantMap map;
+#define RDP_SETTINGS_WRITE(type, name, setter, def)                            \
+  map.insert(QStringLiteral(#name), name);
+  RDP_SETTINGS_FIELDS(RDP_SETTINGS_WRITE)
+#undef RDP_SETTINGS_WRITE
+  return map;
+}
+
+namespace {
+
+qint64 fieldFootprint(const QString &value) {
+  return qint64(value.capacity()) * qint64(sizeof(QChar));
+}
+
+template <typename T> qint64 fieldFootprint(const T &) { return 0; }
+
+} // namespace
+
+qint64 RdpSettings::memoryFootprint() const {
+  qint64 bytes = sizeof(RdpSettings);
+#define RDP_SETTINGS_FOOTPRINT(type, name, setter, def)                        \
+  bytes += fieldFootprint(name);
+  RDP_SETTINGS_FIELDS(RDP_SETTINGS_FOOTPRINT)
+#undef RDP_SETTINGS_FOOTPRINT
+  return bytes;
+}
@@ -0,0 +1,73 @@
+#ifndef RDPSETTINGS_H
+#define RDPSETTINGS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+// 设置字段表：类型、名称（即 RdpClient 的属性名与 QVariantMap 的键）、
+// setter 名称、默认值。成员、字段枚举、变更检测、序列化与 RdpClient 的
+// getter/setter 都由此表生成，新增设置只需在这里加一行（以及 RdpClient
+// 中供 moc 使用的 Q_PROPERTY 声明）。
+#define RDP_SETTINGS_FIELDS(X)                                                 \
+  X(QString, server, setServer, QString())                                     \
+  X(QString, username, setUsername, QString())                                 \
+  X(int, port, setPort, 3389)                                                  \
+  X(int, desktopWidth, setDesktopWidth, 1920)                                  \
+  X(int, desktopHeight, setDesktopHeight, 1080)                                \
+  X(int, colorDepth, setColorDepth, 32)                                        \
+  X(QString, fullScreenTitle, setFullScreenTitle,                              \
+    QStringLiteral("VirWork Client"))                                          \
+  X(bool, fullScreen, setFullScreen, false)                                    \
+  /* 窗口尺寸或 DPI 变化时调整远程桌面分辨率 */                                \
+  X(bool, dynamicResolution, setDynamicResolution, true)                       \
+  X(bool, enableSound, setEnableSound, true)                                   \
+  X(bool, enableClipboard, setEnableClipboard, true)                           \
+  X(bool, enablePrinter, setEnablePrinter, false)                              \
+  /* RemoteApp */                                                              \
+  X(bool, remoteAppMode, setRemoteAppMode, false)                              \
+  X(QString, executablePath, setExecutablePath, QString())                     \
+  X(QString, filePath, setFilePath, QString())                                 \
+  X(QString, workingDirectory, setWorkingDirectory, QString())                 \
+  X(bool, expandEnvVarInWorkingDirectory, setExpandEnvVarInWorkingDirectory,   \
+    false)                                                                     \
+  X(QString, arguments, setArguments, QString())                               \
+  X(bool, expandEnvVarInArguments, setExpandEnvVarInArguments, false)
+
+// 一次连接所需的全部配置（与 RdpClient 的 Q_PROPERTY 一一对应）
+struct RdpSettings {
+#define RDP_SETTINGS_MEMBER(type, name, setter, def) type name = def;
+  RDP_SETTINGS_FIELDS(RDP_SETTINGS_MEMBER)
+#undef RDP_SETTINGS_MEMBER
+
+  enum Field {
+#define RDP_SETTINGS_ENUM(type, name, setter, def) name##Field,
+    RDP_SETTINGS_FIELDS(RDP_SETTINGS_ENUM)
+#undef RDP_SETTINGS_ENUM
+    FieldCount
+  };
+  // 按 Field 取位的字段集合
+  typedef quint32 FieldMask;
+
+  static const char *fieldName(Field field);
+  // 未知名称返回 FieldCount
+  static Field fieldOf(const QString &name);
+  static QStringList fieldNames(FieldMask mask);
+
+  // 与 other 不同的字段
+  FieldMask diff(const RdpSettings &other) const;
+
+  // 检查 map 中的键是否都是已知字段、值能否转换为字段类型、数值是否在
+  // 控件接受的范围内；失败时 error 为面向用户的说明
+  static bool validate(const QVariantMap &map, QString *error = nullptr);
+
+  // 与 RdpClient 属性同名的键，缺少的键保留 base 中的值
+  static RdpSettings fromVariantMap(const QVariantMap &map,
+                                    const RdpSettings &base = RdpSettings());
+  QVariantMap toVariantMap() const;
+
+  // 设置本身与字符串内容占用的字节数
+  qint64 memoryFootprint() const;
+};
+
+#endif // RDPSETTINGS_H
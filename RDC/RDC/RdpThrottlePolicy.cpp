@@ -0,0 +1,56 @@
+#include "RdpThrottlePolicy.h"
+
+RdpThrottlePolicy::RdpThrottlePolicy(QObject *parent)
+    : QObject(parent), m_profile(Full), m_visible(true), m_active(true),
+      m_hiddenDelayMs(1000), m_inactiveDelayMs(30000) {
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this,
+          &RdpThrottlePolicy::enterBackground);
+}
+
+void RdpThrottlePolicy::setVisible(bool visible) {
+  if (m_visible != visible) {
+    m_visible = visible;
+    evaluate();
+  }
+}
+
+void RdpThrottlePolicy::setActive(bool active) {
+  if (m_active != active) {
+    m_active = active;
+    evaluate();
+  }
+}
+
+void RdpThrottlePolicy::evaluate() {
+  if (m_visible && m_active) {
+    // 用户正在使用：取消待定的降级并立即恢复
+    m_timer.stop();
+    if (m_profile != Full) {
+      m_profile = Full;
+      emit profileChanged(m_profile);
+    }
+    return;
+  }
+
+  if (m_profile == Background) {
+    return;
+  }
+
+  const int delay = m_visible ? m_inactiveDelayMs : m_hiddenDelayMs;
+  if (delay < 0) {
+    m_timer.stop();
+    return;
+  }
+  // 已在计时则以更短的延迟为准，隐藏不应等待失焦的长延迟
+  if (!m_timer.isActive() || m_timer.remainingTime() > delay) {
+    m_timer.start(delay);
+  }
+}
+
+void RdpThrottlePolicy::enterBackground() {
+  if (m_profile != Background && !(m_visible && m_active)) {
+    m_profile = Background;
+    emit profileChanged(m_profile);
+  }
+}
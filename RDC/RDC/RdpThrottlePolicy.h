@@ -0,0 +1,53 @@
+#ifndef RDPTHROTTLEPOLICY_H
+#define RDPTHROTTLEPOLICY_H
+
+#include <QObject>
+#include <QTimer>
+
+// 后台会话降级策略
+// 根据窗口可见性与焦点决定会话使用完整配置还是低开销配置：
+// 获得焦点立即恢复；隐藏/最小化、或可见但失去焦点超过一定时间才降级，
+// 在延迟内焦点来回切换不会引起配置抖动。
+class RdpThrottlePolicy : public QObject {
+  Q_OBJECT
+
+public:
+  enum Profile { Full, Background };
+  Q_ENUM(Profile)
+
+  explicit RdpThrottlePolicy(QObject *parent = nullptr);
+
+  Profile profile() const { return m_profile; }
+
+  // 隐藏或最小化后多久降级
+  int hiddenDelay() const { return m_hiddenDelayMs; }
+  void setHiddenDelay(int ms) { m_hiddenDelayMs = ms; }
+  // 可见但失去焦点后多久降级，小于 0 表示不因失焦降级
+  int inactiveDelay() const { return m_inactiveDelayMs; }
+  void setInactiveDelay(int ms) { m_inactiveDelayMs = ms; }
+
+  bool isVisible() const { return m_visible; }
+  bool isActive() const { return m_active; }
+
+public slots:
+  void setVisible(bool visible);
+  void setActive(bool active);
+
+signals:
+  void profileChanged(RdpThrottlePolicy::Profile profile);
+
+private slots:
+  void enterBackground();
+
+private:
+  void evaluate();
+
+  QTimer m_timer;
+  Profile m_profile;
+  bool m_visible;
+  bool m_active;
+  int m_hiddenDelayMs;
+  int m_inactiveDelayMs;
+};
+
+#endif // RDPTHROTTLEPOLICY_H
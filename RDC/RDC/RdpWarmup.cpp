@@ -0,0 +1,190 @@
+#include "RdpWarmup.h"
+#include "RdcLog.h"
+#include "RdpConnectionHistory.h"
+#include "RdpControlPool.h"
+#include "RdpMetrics.h"
+#include "RdpSettings.h"
+#include <QDateTime>
+
+static RdpWarmup *s_instance = nullptr;
+
+RdpWarmup::RdpWarmup(RdpConnectionHistory *history, RdpMetrics *metrics,
+                     QObject *parent)
+    : QObject(parent),
+      m_history(history ? history : RdpConnectionHistory::instance()),
+      m_metrics(metrics ? metrics : RdpMetrics::instance()), m_batch(nullptr),
+      m_candidates(3), m_budgetMs(2000), m_resultTtlMs(2 * 60 * 1000),
+      m_roundProbed(0), m_roundReachable(0), m_predictedConnects(0),
+      m_predictionHits(0), m_probes(0), m_reachable(0), m_reused(0),
+      m_savedMs(0) {
+  if (!s_instance) {
+    s_instance = this;
+  }
+  bool ok = false;
+  const int candidates =
+      qEnvironmentVariableIntValue("RDC_WARMUP_CANDIDATES", &ok);
+  if (ok) {
+    setCandidates(candidates);
+  }
+  const int budget = qEnvironmentVariableIntValue("RDC_WARMUP_BUDGET_MS", &ok);
+  if (ok) {
+    setBudget(budget);
+  }
+
+  m_clock.start();
+  m_deadline.setSingleShot(true);
+  connect(&m_deadline, &QTimer::timeout, this, &RdpWarmup::finish);
+}
+
+RdpWarmup::~RdpWarmup() {
+  if (m_batch) {
+    m_batch->abort();
+  }
+  if (s_instance == this) {
+    s_instance = nullptr;
+  }
+}
+
+RdpWarmup *RdpWarmup::instance() { return s_instance; }
+
+QString RdpWarmup::resultKey(const QString &host, int port) {
+  return host.toLower() + QLatin1Char(':') + QString::number(port);
+}
+
+void RdpWarmup::warmUp() {
+  if (m_batch || m_candidates <= 0) {
+    return;
+  }
+
+  // 预热也补充控件池，省去连接时创建控件
+  if (RdpControlPool *pool = RdpControlPool::instance()) {
+    pool->warmUp();
+  }
+
+  const QVector<RdpHistoryTarget> targets =
+      m_history->predict(QDateTime::currentDateTime(), m_candidates);
+  m_predicted.clear();
+  m_predictedLabels.clear();
+  if (targets.isEmpty()) {
+    return;
+  }
+
+  const qint64 now = m_clock.elapsed();
+  m_batch = new RdpPreflightBatch(this);
+  m_batch->setMaxInFlight(m_candidates);
+  m_batch->setTimeout(m_budgetMs);
+  QSet<QString> queued;
+  for (const RdpHistoryTarget &target : targets) {
+    m_predicted.insert(target.targetKey());
+    m_predictedLabels.append(target.server + QLatin1Char(':') +
+                             QString::number(target.port));
+    // 同一主机的多个用户只探测一次；结果仍新鲜的不再探测
+    const QString key = resultKey(target.server, target.port);
+    auto it = m_results.constFind(key);
+    if (queued.contains(key) ||
+        (it != m_results.constEnd() &&
+         now - it->probedAtMs < m_resultTtlMs)) {
+      continue;
+    }
+    queued.insert(key);
+    m_batch->addTarget(target.server, target.port);
+  }
+
+  m_roundProbed = queued.size();
+  m_roundReachable = 0;
+  if (queued.isEmpty()) {
+    m_batch->deleteLater();
+    m_batch = nullptr;
+    return;
+  }
+
+  connect(m_batch, &RdpPreflightBatch::resultReady, this,
+          &RdpWarmup::onResult);
+  connect(m_batch, &RdpPreflightBatch::finished, this, &RdpWarmup::finish);
+  m_deadline.start(m_budgetMs);
+  m_batch->start();
+}
+
+void RdpWarmup::onResult(const RdpPreflightResult &result) {
+  ++m_probes;
+  m_metrics->addToCounter("warmup_probes_total");
+  if (!result.ok()) {
+    m_results.remove(resultKey(result.host, result.port));
+    return;
+  }
+  ++m_reachable;
+  ++m_roundReachable;
+  Warmed warmed;
+  warmed.result = result;
+  warmed.probedAtMs = m_clock.elapsed();
+  m_results.insert(resultKey(result.host, result.port), warmed);
+}
+
+void RdpWarmup::finish() {
+  if (!m_batch) {
+    return;
+  }
+  m_deadline.stop();
+  // 超出预算时中止尚未完成的探测，已完成的结果保留
+  m_batch->abort();
+  m_batch->deleteLater();
+  m_batch = nullptr;
+  RDC_LOG_DEBUG(RdcLog::Preflight, 0,
+                "Warm-up probed %1 predicted targets, %2 reachable: %3",
+                m_roundProbed, m_roundReachable, m_predictedLabels);
+  emit finished(m_roundProbed, m_roundReachable);
+}
+
+void RdpWarmup::recordConnect(const RdpSettings &settings) {
+  const RdpHistoryEntry entry =
+      RdpHistoryEntry::fromSettings(settings, QDateTime::currentDateTime());
+  if (!m_predicted.isEmpty()) {
+    ++m_predictedConnects;
+    m_metrics->addToCounter("warmup_predicted_connects_total");
+    if (m_predicted.contains(entry.targetKey())) {
+      ++m_predictionHits;
+      m_metrics->addToCounter("warmup_prediction_hits_total");
+    }
+  }
+  m_history->record(entry);
+}
+
+bool RdpWarmup::takeResult(const QString &host, int port,
+                           RdpPreflightResult *result) {
+  auto it = m_results.find(resultKey(host, port));
+  if (it == m_results.end()) {
+    return false;
+  }
+  const Warmed warmed = it.value();
+  m_results.erase(it);
+  if (m_clock.elapsed() - warmed.probedAtMs >= m_resultTtlMs) {
+    return false;
+  }
+
+  // 省下的是连接时本该等待的整个预检
+  const qint64 saved = qMax<qint64>(0, warmed.result.dnsMs) +
+                       qMax<qint64>(0, warmed.result.connectMs) +
+                       qMax<qint64>(0, warmed.result.negotiateMs);
+  ++m_reused;
+  m_savedMs += saved;
+  m_metrics->addToCounter("warmup_reused_total");
+  m_metrics->addToCounter("warmup_saved_ms_total", double(saved));
+  *result = warmed.result;
+  return true;
+}
+
+QVariantMap RdpWarmup::stats() const {
+  QVariantMap result;
+  result.insert(QStringLiteral("predictedConnects"), m_predictedConnects);
+  result.insert(QStringLiteral("predictionHits"), m_predictionHits);
+  result.insert(QStringLiteral("hitRate"),
+                m_predictedConnects
+                    ? double(m_predictionHits) / double(m_predictedConnects)
+                    : 0.0);
+  result.insert(QStringLiteral("probes"), m_probes);
+  result.insert(QStringLiteral("reachable"), m_reachable);
+  result.insert(QStringLiteral("reused"), m_reused);
+  result.insert(QStringLiteral("savedMs"), m_savedMs);
+  result.insert(QStringLiteral("predicted"), m_predictedLabels);
+  return result;
+}
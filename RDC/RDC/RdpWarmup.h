@@ -0,0 +1,94 @@
+#ifndef RDPWARMUP_H
+#define RDPWARMUP_H
+
+#include "RdpPreflight.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+
+class RdpConnectionHistory;
+class RdpMetrics;
+struct RdpSettings;
+
+// 按连接历史预热最可能的下一个连接
+// 启动时与打开连接对话框时，取预测得分最高的 candidates 个目标并发预检
+// （DNS / TCP / X.224），整轮在 budget 毫秒内结束，超时即中止，并补充
+// 控件池。之后 connectToServer 连接到已预检的目标时直接使用未过期的结果，
+// 不再等待预检。预测命中率与节省的时间导出为 warmup_* 计数。
+class RdpWarmup : public QObject {
+  Q_OBJECT
+
+public:
+  // history、metrics 默认为各自的 instance()；候选数与预算可由
+  // RDC_WARMUP_CANDIDATES、RDC_WARMUP_BUDGET_MS 指定
+  explicit RdpWarmup(RdpConnectionHistory *history = nullptr,
+                     RdpMetrics *metrics = nullptr, QObject *parent = nullptr);
+  ~RdpWarmup();
+
+  // 进程内第一个创建的预热器，未创建时为 nullptr（不记录历史、不预热）
+  static RdpWarmup *instance();
+
+  // 每轮预检的目标数，0 表示只记录历史不预热
+  int candidates() const { return m_candidates; }
+  void setCandidates(int count) { m_candidates = qMax(0, count); }
+  // 每轮预热的总时间上限
+  int budget() const { return m_budgetMs; }
+  void setBudget(int ms) { m_budgetMs = qMax(1, ms); }
+  // 预检结果的有效期
+  int resultTtl() const { return m_resultTtlMs; }
+  void setResultTtl(int ms) { m_resultTtlMs = ms; }
+
+  bool isRunning() const { return m_batch != nullptr; }
+
+  // 连接开始：写入历史，并统计是否命中上一轮预测
+  void recordConnect(const RdpSettings &settings);
+  // 取出 host:port 未过期的成功预检结果；取出后不再复用
+  bool takeResult(const QString &host, int port, RdpPreflightResult *result);
+
+  // predictedConnects / predictionHits / hitRate / probes / reachable /
+  // reused / savedMs / predicted（上一轮预测的目标）
+  QVariantMap stats() const;
+
+public slots:
+  // 预测并预检；上一轮仍在进行时忽略
+  void warmUp();
+
+signals:
+  void finished(int probed, int reachable);
+
+private:
+  void onResult(const RdpPreflightResult &result);
+  void finish();
+  static QString resultKey(const QString &host, int port);
+
+  struct Warmed {
+    RdpPreflightResult result;
+    qint64 probedAtMs = 0;
+  };
+
+  RdpConnectionHistory *m_history;
+  RdpMetrics *m_metrics;
+  RdpPreflightBatch *m_batch; // 进行中的一轮，空闲时为 nullptr
+  QTimer m_deadline;
+  QElapsedTimer m_clock;
+  QHash<QString, Warmed> m_results; // host:port -> 成功的预检结果
+  QSet<QString> m_predicted;        // 上一轮预测的目标
+  QStringList m_predictedLabels;
+  int m_candidates;
+  int m_budgetMs;
+  int m_resultTtlMs;
+  int m_roundProbed;
+  int m_roundReachable;
+  quint64 m_predictedConnects;
+  quint64 m_predictionHits;
+  quint64 m_probes;
+  quint64 m_reachable;
+  quint64 m_reused;
+  qint64 m_savedMs;
+};
+
+#endif // RDPWARMUP_H
@@ -1,23 +1,27 @@
 #include "RdpWindow.h"
-#include <QDebug>
+#include "RdcLog.h"
+#include <QEvent>
 #include <QHBoxLayout>
+#include <QScreen>
+#include <QWindow>
 
 
-RdpWindow::RdpWindow(QWidget *parent) : QWidget(parent), m_rdpWidget(nullptr) {
+RdpWindow::RdpWindow(QWidget *parent)
+    : QWidget(parent), m_rdpWidget(nullptr), m_scaleFactor(0) {
   setupUI();
   setWindowTitle("远程桌面连接");
   resize(1024, 768);
 }
 
 RdpWindow::~RdpWindow() {
-  qDebug() << "RdpWindow destructor called";
+  RDC_LOG_DEBUG(RdcLog::General, 0, "RdpWindow destructor called");
   // 移除控件但不删除（由 RdpClient 管理）
   if (m_rdpWidget) {
     m_containerLayout->removeWidget(m_rdpWidget);
     m_rdpWidget->setParent(nullptr);
     m_rdpWidget = nullptr;
   }
-  qDebug() << "RdpWindow destructor finished";
+  RDC_LOG_DEBUG(RdcLog::General, 0, "RdpWindow destructor finished");
 }
 
 void RdpWindow::setupUI() {
@@ -50,11 +54,16 @@ void RdpWindow::setupUI() {
   m_rdpContainer->setStyleSheet("QWidget { background-color: #000000; }");
   m_containerLayout = new QVBoxLayout(m_rdpContainer);
   m_containerLayout->setContentsMargins(0, 0, 0, 0);
+  m_rdpContainer->installEventFilter(this);
 
   m_mainLayout->addWidget(m_rdpContainer, 1); // 1 = 占据剩余空间
 }
 
-void RdpWindow::setRdpWidget(QAxWidget *widget) {
+void RdpWindow::setRdpWidget(QWidget *widget) {
+  if (m_rdpWidget == widget) {
+    return;
+  }
+
   // 移除旧的控件
   if (m_rdpWidget) {
     m_containerLayout->removeWidget(m_rdpWidget);
@@ -77,3 +86,68 @@ void RdpWindow::setServerName(const QString &name) {
   m_serverLabel->setText(QString::fromUtf8("连接到: %1").arg(name));
   setWindowTitle(QString::fromUtf8("远程桌面 - %1").arg(name));
 }
+
+void RdpWindow::showEvent(QShowEvent *event) {
+  QWidget::showEvent(event);
+  // 原生窗口在第一次显示时才创建
+  if (windowHandle()) {
+    connect(windowHandle(), &QWindow::screenChanged, this,
+            &RdpWindow::onScreenChanged, Qt::UniqueConnection);
+    watchScreen();
+  }
+  emit visibilityChanged(!isMinimized());
+}
+
+void RdpWindow::hideEvent(QHideEvent *event) {
+  QWidget::hideEvent(event);
+  emit visibilityChanged(false);
+}
+
+void RdpWindow::changeEvent(QEvent *event) {
+  QWidget::changeEvent(event);
+  if (event->type() == QEvent::WindowStateChange) {
+    emit visibilityChanged(isVisible() && !isMinimized());
+  } else if (event->type() == QEvent::ActivationChange) {
+    emit activeChanged(isActiveWindow());
+  }
+}
+
+bool RdpWindow::eventFilter(QObject *watched, QEvent *event) {
+  if (watched == m_rdpContainer && event->type() == QEvent::Resize) {
+    reportDisplaySize();
+  }
+  return QWidget::eventFilter(watched, event);
+}
+
+void RdpWindow::onScreenChanged() {
+  watchScreen();
+  reportDisplaySize();
+}
+
+void RdpWindow::watchScreen() {
+  QScreen *screen = windowHandle() ? windowHandle()->screen() : nullptr;
+  if (screen == m_screen) {
+    return;
+  }
+  disconnect(m_dpiConnection);
+  m_screen = screen;
+  if (m_screen) {
+    m_dpiConnection =
+        connect(m_screen.data(), &QScreen::logicalDotsPerInchChanged, this,
+                &RdpWindow::reportDisplaySize);
+  }
+}
+
+void RdpWindow::reportDisplaySize() {
+  // 远程桌面按物理像素计算；缩放同时反映系统 DPI 与 Qt 的高 DPI 缩放
+  const qreal ratio = devicePixelRatioF();
+  const QSize size = m_rdpContainer->size() * ratio;
+  const int scaleFactor = qRound(logicalDpiX() * ratio / 96.0 * 100);
+  if (size.isEmpty() ||
+      (size == m_displaySize && scaleFactor == m_scaleFactor)) {
+    return;
+  }
+  m_displaySize = size;
+  m_scaleFactor = scaleFactor;
+  emit displaySizeChanged(size, scaleFactor);
+}
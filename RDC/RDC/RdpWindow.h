@@ -1,9 +1,10 @@
 #ifndef RDPWINDOW_H
 #define RDPWINDOW_H
 
-#include <QAxWidget>
 #include <QLabel>
+#include <QPointer>
 #include <QPushButton>
+#include <QScreen>
 #include <QVBoxLayout>
 #include <QWidget>
 
@@ -15,11 +16,22 @@ public:
   explicit RdpWindow(QWidget *parent = nullptr);
   ~RdpWindow();
 
-  void setRdpWidget(QAxWidget *widget);
+  void setRdpWidget(QWidget *widget);
   void setServerName(const QString &name);
 
 signals:
   void disconnectRequested();
+  // 窗口显示/隐藏（最小化视为隐藏）与获得/失去焦点
+  void visibilityChanged(bool visible);
+  void activeChanged(bool active);
+  // RDP 容器的像素尺寸或缩放百分比（DPI）变化
+  void displaySizeChanged(const QSize &size, int scaleFactor);
+
+protected:
+  void showEvent(QShowEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
+  void changeEvent(QEvent *event) override;
+  bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
   QVBoxLayout *m_mainLayout;
@@ -28,10 +40,18 @@ private:
   QPushButton *m_disconnectButton;
   QWidget *m_rdpContainer;
   QVBoxLayout *m_containerLayout;
-  QAxWidget *m_rdpWidget;
+  QWidget *m_rdpWidget;
   QString m_serverName;
+  QPointer<QScreen> m_screen;
+  QMetaObject::Connection m_dpiConnection;
+  QSize m_displaySize;
+  int m_scaleFactor;
 
   void setupUI();
+  // 跟随窗口所在的屏幕，屏幕或其 DPI 变化时重新报告尺寸
+  void onScreenChanged();
+  void watchScreen();
+  void reportDisplaySize();
 };
 
 #endif // RDPWINDOW_H
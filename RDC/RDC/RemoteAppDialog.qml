@@ -2,6 +2,7 @@ import QtQuick 2.15
 import QtQuick.Window 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
+import RDC 1.0
 
 Dialog {
     id: dialog
@@ -10,18 +11,18 @@ Dialog {
     standardButtons: Dialog.Ok | Dialog.Cancel
     
     width: 500
-    height: 600
+    height: 770
     
     x: (parent.width - width) / 2
     y: (parent.height - height) / 2
     
     // 对外暴露的属性 - 连接设置
-    property string ip: "192.168.10.9"
-    property int port: 8848
-    property string username: "Administrator"
+    property string ip: ""
+    property int port: 3389
+    property string username: ""
     
     // RemoteApp 参数
-    property string executablePath: "C:\\Windows\\explorer.exe"
+    property string executablePath: ""
     property string filePath: ""
     property string workingDirectory: ""
     property bool expandEnvVarInWorkingDirectory: false
@@ -41,13 +42,43 @@ Dialog {
         expandEnvVarInWorkingDirectory = expandWorkDirCheck.checked
         appArguments = argumentsField.text
         expandEnvVarInArguments = expandArgsCheck.checked
+        
+        // 保存为 RemoteApp 档案，服务器与程序相同的已有档案会被更新
+        profileModel.saveProfile({
+            "remoteAppMode": true,
+            "server": ip,
+            "port": port,
+            "username": username,
+            "executablePath": executablePath,
+            "filePath": filePath,
+            "workingDirectory": workingDirectory,
+            "expandEnvVarInWorkingDirectory": expandEnvVarInWorkingDirectory,
+            "arguments": appArguments,
+            "expandEnvVarInArguments": expandEnvVarInArguments
+        })
     }
     
     onAboutToShow: {
-        // 打开对话框时重置或保留上次的值
-        ipField.text = ip || ""
-        portField.text = port.toString() || "3389"
-        usernameField.text = username || ""
+        // 没有上次的值时使用最近保存的档案
+        if (!ip && profileModel.totalCount > 0) {
+            searchField.text = ""
+            if (profileModel.count > 0) {
+                var recent = profileModel.get(0)
+                ip = recent.server
+                port = recent.port
+                username = recent.username
+                executablePath = recent.executablePath
+                filePath = recent.filePath
+                workingDirectory = recent.workingDirectory
+                expandEnvVarInWorkingDirectory = recent.expandEnvVarInWorkingDirectory
+                appArguments = recent.arguments
+                expandEnvVarInArguments = recent.expandEnvVarInArguments
+            }
+        }
+        
+        ipField.text = ip
+        portField.text = port.toString()
+        usernameField.text = username
         
         executablePathField.text = executablePath || ""
         filePathField.text = filePath || ""
@@ -59,6 +90,25 @@ Dialog {
         ipField.forceActiveFocus()
     }
     
+    // 按输入过滤的已保存 RemoteApp
+    ProfileModel {
+        id: profileModel
+        kind: ProfileModel.RemoteApp
+        filter: searchField.text.trim()
+    }
+    
+    function applyProfile(profile) {
+        ipField.text = profile.server
+        portField.text = profile.port.toString()
+        usernameField.text = profile.username
+        executablePathField.text = profile.executablePath
+        filePathField.text = profile.filePath
+        workingDirectoryField.text = profile.workingDirectory
+        expandWorkDirCheck.checked = profile.expandEnvVarInWorkingDirectory
+        argumentsField.text = profile.arguments
+        expandArgsCheck.checked = profile.expandEnvVarInArguments
+    }
+    
     ScrollView {
         anchors.fill: parent
         clip: true
@@ -67,6 +117,40 @@ Dialog {
             width: parent.width
             spacing: 12
             
+            // 已保存的连接
+            GroupBox {
+                Layout.fillWidth: true
+                title: "已保存的连接 (" + profileModel.count + "/" + profileModel.totalCount + ")"
+                visible: profileModel.totalCount > 0
+                
+                ColumnLayout {
+                    anchors.fill: parent
+                    spacing: 6
+                    
+                    TextField {
+                        id: searchField
+                        Layout.fillWidth: true
+                        placeholderText: "搜索名称、主机、用户名或标签"
+                        selectByMouse: true
+                    }
+                    
+                    ListView {
+                        id: profileList
+                        Layout.fillWidth: true
+                        Layout.preferredHeight: 120
+                        clip: true
+                        model: profileModel
+                        ScrollBar.vertical: ScrollBar {}
+                        
+                        delegate: ItemDelegate {
+                            width: profileList.width
+                            text: model.name + "  (" + (model.username ? model.username + "@" : "") + model.server + ":" + model.port + ")"
+                            onClicked: applyProfile(profileModel.get(index))
+                        }
+                    }
+                }
+            }
+            
             // 连接设置组
             GroupBox {
                 Layout.fillWidth: true
@@ -0,0 +1,705 @@
+#include "SessionManager.h"
+#include "RdcLog.h"
+#include "RdcWorker.h"
+#include "RdpBitmapCache.h"
+#include "RdpFile.h"
+#include "RdpMetrics.h"
+#include "RdpSession.h"
+#include "RdpWarmup.h"
+#include "RdpWindow.h"
+#include <QDirIterator>
+
+SessionManager::SessionManager(QObject *parent)
+    : QAbstractListModel(parent), m_controlFactory(&RdpControl::createDefault),
+      m_reaper(new RdpSessionReaper(this)), m_nextId(1), m_nextRequestId(0),
+      m_maxLiveControls(64), m_liveControls(0), m_useCounter(0) {}
+
+SessionManager::~SessionManager() {
+  for (Entry *e : m_entries) {
+    m_reaper->untrack(e->reapId);
+    destroySession(e);
+    delete e;
+  }
+  m_entries.clear();
+  m_byId.clear();
+}
+
+int SessionManager::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant SessionManager::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_entries.size()) {
+    return QVariant();
+  }
+
+  const Entry *e = m_entries.at(index.row());
+  switch (role) {
+  case SessionIdRole:
+    return e->id;
+  case Qt::DisplayRole:
+  case ServerRole:
+    return e->settings.server;
+  case PortRole:
+    return e->settings.port;
+  case UsernameRole:
+    return e->settings.username;
+  case RemoteAppModeRole:
+    return e->settings.remoteAppMode;
+  case ExecutablePathRole:
+    return e->settings.executablePath;
+  case StateRole:
+    return e->state;
+  case LiveRole:
+    return e->session != nullptr;
+  case LastErrorRole:
+    return e->lastError;
+  case MemoryRole:
+    return memoryUsage(e).total();
+  default:
+    return QVariant();
+  }
+}
+
+QHash<int, QByteArray> SessionManager::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles.insert(SessionIdRole, "sessionId");
+  roles.insert(ServerRole, "server");
+  roles.insert(PortRole, "port");
+  roles.insert(UsernameRole, "username");
+  roles.insert(RemoteAppModeRole, "remoteAppMode");
+  roles.insert(ExecutablePathRole, "executablePath");
+  roles.insert(StateRole, "state");
+  roles.insert(LiveRole, "live");
+  roles.insert(LastErrorRole, "lastError");
+  roles.insert(MemoryRole, "memoryBytes");
+  return roles;
+}
+
+void SessionManager::setMaxLiveControls(int max) {
+  max = qMax(1, max);
+  if (m_maxLiveControls != max) {
+    m_maxLiveControls = max;
+    emit maxLiveControlsChanged();
+  }
+}
+
+void SessionManager::setReapIdleTimeout(int ms) {
+  if (m_reaper->idleTimeout() != ms) {
+    m_reaper->setIdleTimeout(ms);
+    emit reaperPolicyChanged();
+  }
+}
+
+void SessionManager::setMemoryBudgetMb(int mb) {
+  const qint64 bytes = qint64(qMax(0, mb)) * 1024 * 1024;
+  if (m_reaper->memoryBudget() != bytes) {
+    m_reaper->setMemoryBudget(bytes);
+    emit reaperPolicyChanged();
+  }
+}
+
+void SessionManager::setControlFactory(const RdpControlFactory &factory) {
+  m_controlFactory = factory;
+}
+
+int SessionManager::addSession(const QVariantMap &settings) {
+  return addSession(RdpSettings::fromVariantMap(settings), QString());
+}
+
+int SessionManager::addSession(const RdpSettings &settings,
+                               const QString &sourceFile) {
+  Entry *e = new Entry;
+  e->id = m_nextId++;
+  e->settings = settings;
+  e->sourceFile = sourceFile;
+  const int sessionId = e->id;
+  e->reapId = m_reaper->track(
+      sessionId, settings.server,
+      [this, sessionId]() {
+        const Entry *current = entry(sessionId);
+        return current ? memoryUsage(current) : RdpMemoryUsage();
+      },
+      [this, sessionId](RdpSessionReaper::Reason reason) {
+        reapSession(sessionId, reason);
+      });
+
+  const int row = m_entries.size();
+  beginInsertRows(QModelIndex(), row, row);
+  m_entries.append(e);
+  m_byId.insert(e->id, e);
+  endInsertRows();
+  emit countChanged();
+  return e->id;
+}
+
+int SessionManager::openSession(const QVariantMap &settings) {
+  const int sessionId = addSession(settings);
+  connectSession(sessionId);
+  return sessionId;
+}
+
+bool SessionManager::connectSession(int sessionId) {
+  Entry *e = entry(sessionId);
+  if (!e) {
+    return false;
+  }
+
+  touch(e);
+  if (!e->session && !ensureCapacity(e)) {
+    const QString error = QString::fromUtf8("已达到最大会话数 (%1)，"
+                                            "请先断开其他会话")
+                              .arg(m_maxLiveControls);
+    setState(e, Failed, error);
+    emit sessionError(sessionId, error);
+    return false;
+  }
+
+  RdpSession *session = ensureSession(e);
+  session->setSettings(e->settings);
+  setState(e, Connecting);
+  if (!session->connectToServer()) {
+    if (e->state == Connecting) {
+      setState(e, Failed, e->lastError);
+    }
+    return false;
+  }
+  return true;
+}
+
+void SessionManager::disconnectSession(int sessionId) {
+  Entry *e = entry(sessionId);
+  if (!e) {
+    return;
+  }
+
+  if (e->session) {
+    e->session->disconnectFromServer();
+  }
+  if (e->window) {
+    e->window->hide();
+  }
+  if (e->state == Connecting || e->state == Connected ||
+      e->state == Reconnecting) {
+    setState(e, Disconnected);
+  }
+}
+
+void SessionManager::removeSession(int sessionId) {
+  const int row = rowOf(sessionId);
+  if (row < 0) {
+    return;
+  }
+
+  beginRemoveRows(QModelIndex(), row, row);
+  Entry *e = m_entries.takeAt(row);
+  m_byId.remove(sessionId);
+  endRemoveRows();
+
+  m_reaper->untrack(e->reapId);
+  destroySession(e);
+  delete e;
+  updateLiveCount();
+  emit countChanged();
+}
+
+void SessionManager::showSession(int sessionId) {
+  Entry *e = entry(sessionId);
+  if (!e) {
+    return;
+  }
+
+  touch(e);
+  if (e->window) {
+    e->window->show();
+    e->window->raise();
+    e->window->activateWindow();
+  } else if (e->state != Connecting && e->state != Connected &&
+             e->state != Reconnecting) {
+    // 不可见的会话在首次显示时才连接
+    connectSession(sessionId);
+  }
+}
+
+QVariantMap SessionManager::sessionSettings(int sessionId) const {
+  Entry *e = entry(sessionId);
+  return e ? e->settings.toVariantMap() : QVariantMap();
+}
+
+int SessionManager::launchRemoteApp(int sessionId, const QVariantMap &app) {
+  Entry *e = entry(sessionId);
+  if (!e || !e->settings.remoteAppMode) {
+    return -1;
+  }
+
+  // 先连接，启动请求排队到登录完成
+  if (e->state != Connecting && e->state != Connected &&
+      e->state != Reconnecting && !connectSession(sessionId)) {
+    return -1;
+  }
+  const RdpSettings launch = RdpSettings::fromVariantMap(app);
+  return e->session->launchRemoteApp(
+      launch.executablePath, launch.filePath, launch.workingDirectory,
+      launch.arguments, launch.expandEnvVarInWorkingDirectory,
+      launch.expandEnvVarInArguments);
+}
+
+int SessionManager::openRemoteApp(const QVariantMap &settings) {
+  const RdpSessionKey key =
+      RdpSessionKey::fromSettings(RdpSettings::fromVariantMap(settings));
+  Entry *cached = entry(m_sessionCache.lookup(key));
+  if (cached && cached->session &&
+      (cached->state == Connecting || cached->state == Connected ||
+       cached->state == Reconnecting)) {
+    touch(cached);
+    if (launchRemoteApp(cached->id, settings) >= 0) {
+      // 省去的是该会话上一次完整登录的耗时
+      const qint64 totalUs = cached->session->lastPhaseUs(RdpMetrics::Total);
+      m_sessionCache.recordSaved(totalUs >= 0
+                                     ? totalUs / 1000
+                                     : cached->session->lastConnectLatencyMs());
+      RDC_LOG_INFO(RdcLog::RemoteApp, cached->id,
+                   "Reusing cached session for %1",
+                   settings.value(QStringLiteral("executablePath")).toString());
+      return cached->id;
+    }
+  }
+
+  const int sessionId = openSession(settings);
+  const State newState = state(sessionId);
+  if (newState == Connecting || newState == Connected) {
+    m_sessionCache.insert(key, sessionId);
+  }
+  return sessionId;
+}
+
+QVariantMap SessionManager::sessionCacheStats() const {
+  const RdpSessionCache::Stats &stats = m_sessionCache.stats();
+  QVariantMap result;
+  result.insert(QStringLiteral("size"), m_sessionCache.size());
+  result.insert(QStringLiteral("lookups"), stats.lookups);
+  result.insert(QStringLiteral("hits"), stats.hits);
+  result.insert(QStringLiteral("hitRate"),
+                stats.lookups ? double(stats.hits) / double(stats.lookups)
+                              : 0.0);
+  result.insert(QStringLiteral("evictions"), stats.evictions);
+  result.insert(QStringLiteral("timeSavedMs"), stats.timeSavedMs);
+  return result;
+}
+
+int SessionManager::importRdpFile(const QString &path) {
+  const QString localPath = RdpFile::localPath(path);
+  QString error;
+  const RdpFile file = RdpFile::load(localPath, &error);
+  return addImported(localPath, file, error);
+}
+
+int SessionManager::addImported(const QString &localPath, const RdpFile &file,
+                                QString error) {
+  if (!error.isEmpty()) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "Import failed: %1", error);
+    emit importError(error);
+    return -1;
+  }
+
+  const RdpSettings settings = file.toSettings();
+  if (settings.server.isEmpty()) {
+    error = QString::fromUtf8("%1 中没有服务器地址").arg(localPath);
+    RDC_LOG_WARNING(RdcLog::General, 0, "Import failed: %1", error);
+    emit importError(error);
+    return -1;
+  }
+  return addSession(settings, localPath);
+}
+
+int SessionManager::importRdpDirectory(const QString &dirPath) {
+  int imported = 0;
+  QDirIterator it(RdpFile::localPath(dirPath),
+                  QStringList() << QStringLiteral("*.rdp"),
+                  QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    if (importRdpFile(it.next()) >= 0) {
+      ++imported;
+    }
+  }
+  RDC_LOG_INFO(RdcLog::General, 0, "Imported %1 .rdp files from %2", imported,
+               dirPath);
+  return imported;
+}
+
+namespace {
+
+// 工作线程中读取的一个 .rdp 文件
+struct ImportedRdpFile {
+  QString path;
+  RdpFile file;
+  QString error;
+};
+
+} // namespace
+
+int SessionManager::importRdpDirectoryAsync(const QString &dirPath) {
+  const int requestId = ++m_nextRequestId;
+  const QString localDir = RdpFile::localPath(dirPath);
+  const QFuture<QVector<ImportedRdpFile>> future =
+      RdcWorker::instance()->run<QVector<ImportedRdpFile>>([localDir]() {
+        QVector<ImportedRdpFile> files;
+        QDirIterator it(localDir, QStringList() << QStringLiteral("*.rdp"),
+                        QDir::Files | QDir::Readable,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+          ImportedRdpFile imported;
+          imported.path = it.next();
+          imported.file = RdpFile::load(imported.path, &imported.error);
+          files.append(imported);
+        }
+        return files;
+      });
+
+  RdcWorker::whenFinished(
+      future, this,
+      [this, requestId,
+       dirPath](const QFuture<QVector<ImportedRdpFile>> &done) {
+        int imported = 0;
+        for (const ImportedRdpFile &file : done.result()) {
+          if (addImported(file.path, file.file, file.error) >= 0) {
+            ++imported;
+          }
+        }
+        RDC_LOG_INFO(RdcLog::General, 0, "Imported %1 .rdp files from %2",
+                     imported, dirPath);
+        emit rdpDirectoryImported(requestId, imported);
+      });
+  return requestId;
+}
+
+bool SessionManager::exportRdpFile(int sessionId, const QString &path) {
+  Entry *e = entry(sessionId);
+  if (!e) {
+    return false;
+  }
+
+  // 以导入时的原文件为底稿，未识别的键原样写回
+  RdpFile file;
+  if (!e->sourceFile.isEmpty()) {
+    file = RdpFile::load(e->sourceFile);
+  }
+  file.updateFrom(e->settings);
+
+  QString error;
+  if (!file.save(RdpFile::localPath(path), &error)) {
+    RDC_LOG_WARNING(RdcLog::General, sessionId, "Export failed: %1", error);
+    emit importError(error);
+    return false;
+  }
+  return true;
+}
+
+RdpSession *SessionManager::session(int sessionId) const {
+  Entry *e = entry(sessionId);
+  return e ? e->session : nullptr;
+}
+
+SessionManager::State SessionManager::state(int sessionId) const {
+  Entry *e = entry(sessionId);
+  return e ? e->state : Idle;
+}
+
+SessionManager::Entry *SessionManager::entry(int sessionId) const {
+  return m_byId.value(sessionId, nullptr);
+}
+
+int SessionManager::rowOf(int sessionId) const {
+  Entry *e = entry(sessionId);
+  return e ? m_entries.indexOf(e) : -1;
+}
+
+RdpSession *SessionManager::ensureSession(Entry *e) {
+  if (e->session) {
+    return e->session;
+  }
+
+  RdpSession *session = new RdpSession(this);
+  session->setLogId(e->id);
+  session->setControlFactory(m_controlFactory);
+  if (m_sessionSetup) {
+    m_sessionSetup(session);
+  }
+  e->session = session;
+
+  const int sessionId = e->id;
+  connect(session, &RdpSession::connectionSuccess, this, [this, sessionId]() {
+    if (Entry *current = entry(sessionId)) {
+      setState(current, Connected);
+      emit sessionConnected(sessionId);
+    }
+  });
+  connect(session, &RdpSession::connectedChanged, this, [this, sessionId]() {
+    Entry *current = entry(sessionId);
+    if (!current || !current->session || current->session->connected()) {
+      return;
+    }
+    if (current->state == Connected) {
+      setState(current, Disconnected);
+      emit sessionDisconnected(sessionId);
+    } else if (current->state == Connecting &&
+               !current->session->connecting() &&
+               !current->session->isRestoring()) {
+      // 连接完成前断开（主机不可达、被拒绝、认证失败）不会发出
+      // connectionError，否则会一直停留在连接中，回收器与控件上限都不会回收
+      const QString error = QString::fromUtf8("连接在完成前断开");
+      setState(current, Failed, error);
+      emit sessionError(sessionId, error);
+    }
+  });
+  connect(session, &RdpSession::reconnectScheduled, this,
+          [this, sessionId](int attempt) {
+            if (Entry *current = entry(sessionId)) {
+              setState(current, Reconnecting);
+              emit sessionReconnecting(sessionId, attempt);
+            }
+          });
+  connect(session, &RdpSession::connectionError, this,
+          [this, sessionId](const QString &error) {
+            if (Entry *current = entry(sessionId)) {
+              setState(current, Failed, error);
+              emit sessionError(sessionId, error);
+            }
+          });
+  connect(session, &RdpSession::remoteAppStarted, this,
+          [this, sessionId]() { emit remoteAppStarted(sessionId); });
+  connect(session, &RdpSession::remoteAppError, this,
+          [this, sessionId](const QString &error) {
+            if (Entry *current = entry(sessionId)) {
+              current->lastError = error;
+            }
+            emit remoteAppError(sessionId, error);
+          });
+  connect(session, &RdpSession::remoteAppResult, this,
+          [this, sessionId](const RdpRemoteAppResult &result) {
+            emit remoteAppResult(sessionId, result.launchId,
+                                 int(result.railResult), result.description(),
+                                 result.latencyUs / 1000.0);
+          });
+  connect(session, &RdpSession::remoteAppActivityChanged, this,
+          [this, sessionId]() {
+            Entry *current = entry(sessionId);
+            if (current && current->session) {
+              updateReapState(current);
+            }
+          });
+  connect(session, &RdpSession::aboutToConnect, this,
+          [this, sessionId](QWidget *widget) {
+            Entry *current = entry(sessionId);
+            if (!current) {
+              return;
+            }
+            // 自动重连沿用原窗口，不抢占焦点
+            if (current->state == Reconnecting && current->window) {
+              current->window->setRdpWidget(widget);
+            } else {
+              showWindow(current, widget);
+            }
+          });
+  connect(session, &RdpSession::aboutToReleaseControl, this,
+          [this, sessionId]() {
+            Entry *current = entry(sessionId);
+            if (current && current->window) {
+              current->window->setRdpWidget(nullptr);
+            }
+          });
+
+  updateLiveCount();
+  return session;
+}
+
+void SessionManager::destroySession(Entry *e) {
+  m_sessionCache.remove(e->id);
+  // 先从窗口取出控件，否则删除窗口会连带删除控件
+  if (e->window) {
+    e->window->setRdpWidget(nullptr);
+    e->window->close();
+    e->window->deleteLater();
+    e->window = nullptr;
+  }
+  if (e->session) {
+    e->session->disconnect(this);
+    delete e->session; // 控件归还控件池
+    e->session = nullptr;
+  }
+  updateReapState(e);
+}
+
+bool SessionManager::ensureCapacity(Entry *requester) {
+  while (m_liveControls >= m_maxLiveControls) {
+    // 回收最久未使用的、未在连接中的会话
+    Entry *victim = nullptr;
+    for (Entry *e : m_entries) {
+      if (e == requester || !e->session || e->state == Connecting ||
+          e->state == Connected || e->state == Reconnecting) {
+        continue;
+      }
+      if (!victim || e->lastUsed < victim->lastUsed) {
+        victim = e;
+      }
+    }
+    if (!victim) {
+      return false;
+    }
+
+    RDC_LOG_INFO(RdcLog::General, victim->id,
+                 "Releasing idle session to stay within %1 live controls",
+                 m_maxLiveControls);
+    destroySession(victim);
+    updateLiveCount();
+    const QModelIndex idx = index(m_entries.indexOf(victim));
+    emit dataChanged(idx, idx, {LiveRole, MemoryRole});
+  }
+  return true;
+}
+
+void SessionManager::setState(Entry *e, State state, const QString &error) {
+  e->state = state;
+  if (state != Connecting && state != Connected && state != Reconnecting) {
+    m_sessionCache.remove(e->id);
+  }
+  if (!error.isEmpty() || state != Failed) {
+    e->lastError = error;
+  }
+  updateReapState(e);
+  const QModelIndex idx = index(m_entries.indexOf(e));
+  emit dataChanged(idx, idx, {StateRole, LiveRole, LastErrorRole, MemoryRole});
+}
+
+void SessionManager::showWindow(Entry *e, QWidget *widget) {
+  // 无界面后端（模拟控件）不创建窗口
+  if (!widget) {
+    return;
+  }
+
+  if (!e->window) {
+    e->window = new RdpWindow();
+    const int sessionId = e->id;
+    connect(e->window, &RdpWindow::disconnectRequested, this,
+            [this, sessionId]() { disconnectSession(sessionId); });
+    // 窗口可见性与焦点驱动后台降级策略
+    connect(e->window, &RdpWindow::visibilityChanged,
+            e->session->throttlePolicy(), &RdpThrottlePolicy::setVisible);
+    connect(e->window, &RdpWindow::activeChanged,
+            e->session->throttlePolicy(), &RdpThrottlePolicy::setActive);
+    // 窗口尺寸与 DPI 变化调整远程桌面分辨率
+    connect(e->window, &RdpWindow::displaySizeChanged,
+            e->session->displayDebouncer(), &RdpDisplayDebouncer::requestSize);
+  }
+  e->window->setRdpWidget(widget);
+  e->window->setServerName(e->settings.server);
+  e->window->show();
+  e->window->raise();
+  e->window->activateWindow();
+}
+
+void SessionManager::updateLiveCount() {
+  int live = 0;
+  for (const Entry *e : m_entries) {
+    if (e->session) {
+      ++live;
+    }
+  }
+  if (live != m_liveControls) {
+    m_liveControls = live;
+    emit liveControlCountChanged();
+  }
+}
+
+void SessionManager::touch(Entry *e) {
+  e->lastUsed = ++m_useCounter;
+  m_reaper->touch(e->reapId);
+}
+
+RdpMemoryUsage SessionManager::memoryUsage(const Entry *e) const {
+  RdpMemoryUsage usage;
+  if (e->session) {
+    usage = e->session->memoryUsage();
+  } else {
+    usage.settings = e->settings.memoryFootprint();
+  }
+  if (e->window) {
+    // 窗口的后备存储按 32 位像素估算
+    usage.window = qint64(e->window->width()) * e->window->height() * 4;
+  }
+  return usage;
+}
+
+void SessionManager::updateReapState(Entry *e) {
+  RdpSessionReaper::State state = RdpSessionReaper::Disconnected;
+  if (!e->session && !e->window) {
+    state = RdpSessionReaper::Released;
+  } else if (e->state == Connecting || e->state == Reconnecting) {
+    state = RdpSessionReaper::Active;
+  } else if (e->state == Connected) {
+    // 没有窗口与启动请求的 RemoteApp 会话视为空闲
+    state = e->settings.remoteAppMode && e->session &&
+                    e->session->isRemoteAppIdle()
+                ? RdpSessionReaper::Idle
+                : RdpSessionReaper::Active;
+  }
+  m_reaper->setState(e->reapId, state);
+}
+
+void SessionManager::reapSession(int sessionId,
+                                 RdpSessionReaper::Reason reason) {
+  Entry *e = entry(sessionId);
+  if (!e) {
+    return;
+  }
+
+  const qint64 bytes = memoryUsage(e).total();
+  const bool wasConnected = e->state == Connected;
+  m_sessionCache.evict(sessionId);
+  destroySession(e);
+  if (wasConnected) {
+    setState(e, Disconnected);
+    emit sessionDisconnected(sessionId);
+  }
+  updateLiveCount();
+  const QModelIndex idx = index(m_entries.indexOf(e));
+  emit dataChanged(idx, idx, {LiveRole, MemoryRole});
+  emit sessionReaped(sessionId, RdpSessionReaper::reasonName(reason), bytes);
+}
+
+QVariantMap SessionManager::sessionMemory(int sessionId) const {
+  const Entry *e = entry(sessionId);
+  return e ? memoryUsage(e).toVariantMap() : QVariantMap();
+}
+
+QVariantMap SessionManager::memoryStats() const {
+  RdpMemoryUsage total;
+  for (const Entry *e : m_entries) {
+    total += memoryUsage(e);
+  }
+  QVariantMap result = total.toVariantMap();
+  const RdpSessionReaper::Stats &stats = m_reaper->stats();
+  result.insert(QStringLiteral("budget"), m_reaper->memoryBudget());
+  result.insert(QStringLiteral("reaped"), stats.reaped);
+  result.insert(QStringLiteral("idleTimeouts"), stats.idleTimeouts);
+  result.insert(QStringLiteral("budgetEvictions"), stats.budgetEvictions);
+  result.insert(QStringLiteral("bytesFreed"), stats.bytesFreed);
+  return result;
+}
+
+int SessionManager::reapIdleSessions() { return m_reaper->sweep(); }
+
+QVariantMap SessionManager::bitmapCacheStats() const {
+  return RdpBitmapCache::instance()->stats();
+}
+
+void SessionManager::warmUpPredicted() {
+  if (RdpWarmup *warmup = RdpWarmup::instance()) {
+    warmup->warmUp();
+  }
+}
+
+QVariantMap SessionManager::warmupStats() const {
+  RdpWarmup *warmup = RdpWarmup::instance();
+  return warmup ? warmup->stats() : QVariantMap();
+}
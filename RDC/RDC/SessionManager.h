@@ -0,0 +1,193 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include "RdpControl.h"
+#include "RdpSessionCache.h"
+#include "RdpSessionReaper.h"
+#include "RdpSettings.h"
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <functional>
+
+class RdpFile;
+class RdpSession;
+class RdpWindow;
+
+// 多会话管理器
+// 每个会话有独立的设置、控件和窗口。会话在连接前只保存设置，
+// RdpSession 与 RdpWindow 在需要时才创建；同时持有控件的会话数受
+// maxLiveControls 限制，超出时回收最久未使用的空闲会话的控件。
+// 断开或空闲的会话由 RdpSessionReaper 按空闲时间与内存预算回收。
+class SessionManager : public QAbstractListModel {
+  Q_OBJECT
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(int liveControlCount READ liveControlCount NOTIFY
+                 liveControlCountChanged)
+  Q_PROPERTY(int maxLiveControls READ maxLiveControls WRITE
+                 setMaxLiveControls NOTIFY maxLiveControlsChanged)
+  Q_PROPERTY(int reapIdleTimeout READ reapIdleTimeout WRITE setReapIdleTimeout
+                 NOTIFY reaperPolicyChanged)
+  Q_PROPERTY(int memoryBudgetMb READ memoryBudgetMb WRITE setMemoryBudgetMb
+                 NOTIFY reaperPolicyChanged)
+
+public:
+  enum State { Idle, Connecting, Connected, Disconnected, Failed, Reconnecting };
+  Q_ENUM(State)
+
+  enum Roles {
+    SessionIdRole = Qt::UserRole + 1,
+    ServerRole,
+    PortRole,
+    UsernameRole,
+    RemoteAppModeRole,
+    ExecutablePathRole,
+    StateRole,
+    LiveRole,
+    LastErrorRole,
+    MemoryRole
+  };
+
+  explicit SessionManager(QObject *parent = nullptr);
+  ~SessionManager();
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  int count() const { return m_entries.size(); }
+  int liveControlCount() const { return m_liveControls; }
+  int maxLiveControls() const { return m_maxLiveControls; }
+  void setMaxLiveControls(int max);
+  // 回收策略：断开或空闲会话（含最后一个应用已关闭的 RemoteApp 会话）
+  // 保留的毫秒数（小于 0 不按时间回收）与内存上限（0 不限）
+  int reapIdleTimeout() const { return m_reaper->idleTimeout(); }
+  void setReapIdleTimeout(int ms);
+  int memoryBudgetMb() const {
+    return int(m_reaper->memoryBudget() / (1024 * 1024));
+  }
+  void setMemoryBudgetMb(int mb);
+
+  // 新会话使用的控件工厂（默认为 RdpControl::createDefault）
+  void setControlFactory(const RdpControlFactory &factory);
+  // 新建的 RdpSession 在首次连接前经过 setup（测试中替换能力缓存、
+  // 位图缓存与统计，关闭预检）
+  void setSessionSetup(const std::function<void(RdpSession *)> &setup) {
+    m_sessionSetup = setup;
+  }
+
+  // 只登记会话，不创建控件；返回会话 ID
+  Q_INVOKABLE int addSession(const QVariantMap &settings);
+  // 登记并立即连接
+  Q_INVOKABLE int openSession(const QVariantMap &settings);
+  Q_INVOKABLE bool connectSession(int sessionId);
+  Q_INVOKABLE void disconnectSession(int sessionId);
+  Q_INVOKABLE void removeSession(int sessionId);
+  Q_INVOKABLE void showSession(int sessionId);
+  Q_INVOKABLE QVariantMap sessionSettings(int sessionId) const;
+
+  // 在会话上追加启动一个 RemoteApp（键同 RdpSettings 的 RemoteApp 字段），
+  // 未连接的会话会先连接；返回启动 ID，失败返回 -1
+  Q_INVOKABLE int launchRemoteApp(int sessionId, const QVariantMap &app);
+  // 会话缓存中有服务器、用户与重定向设置都相同的活动 RemoteApp 会话时
+  // 复用其连接启动应用，否则新建会话；返回会话 ID
+  Q_INVOKABLE int openRemoteApp(const QVariantMap &settings);
+  // 会话缓存统计：size / lookups / hits / hitRate / evictions / timeSavedMs
+  Q_INVOKABLE QVariantMap sessionCacheStats() const;
+
+  // 会话的内存估算：control / frameBuffer / subObjects / settings / window / total
+  Q_INVOKABLE QVariantMap sessionMemory(int sessionId) const;
+  // 所有会话的内存估算合计，以及 budget、reaped、bytesFreed
+  Q_INVOKABLE QVariantMap memoryStats() const;
+  // 立即按回收策略检查一次，返回释放的会话数
+  Q_INVOKABLE int reapIdleSessions();
+  // 持久化位图缓存统计：lookups / hits / hitRate / hostCount / totalBytes /
+  // evictedFiles / evictedBytes / hostQuota / totalQuota
+  Q_INVOKABLE QVariantMap bitmapCacheStats() const;
+
+  // 按连接历史预检最可能的下一个连接（打开连接对话框时调用）
+  Q_INVOKABLE void warmUpPredicted();
+  // 预测命中率与预热节省的时间：predictedConnects / predictionHits /
+  // hitRate / probes / reachable / reused / savedMs / predicted
+  Q_INVOKABLE QVariantMap warmupStats() const;
+
+  // .rdp 文件导入导出；导入失败返回 -1 并发出 importError
+  Q_INVOKABLE int importRdpFile(const QString &path);
+  // 导入目录下（含子目录）的所有 .rdp 文件，返回成功导入的数量
+  Q_INVOKABLE int importRdpDirectory(const QString &dirPath);
+  // 在 RdcWorker 中遍历目录并解析文件，立即返回请求 ID；会话在 GUI 线程
+  // 中登记，完成后发出 rdpDirectoryImported
+  Q_INVOKABLE int importRdpDirectoryAsync(const QString &dirPath);
+  // 从 .rdp 文件导入的会话会保留原文件中未识别的键
+  Q_INVOKABLE bool exportRdpFile(int sessionId, const QString &path);
+
+  RdpSession *session(int sessionId) const;
+  State state(int sessionId) const;
+
+signals:
+  void countChanged();
+  void liveControlCountChanged();
+  void maxLiveControlsChanged();
+  void reaperPolicyChanged();
+  void sessionConnected(int sessionId);
+  void sessionDisconnected(int sessionId);
+  // 瞬时断线后自动重连中，attempt 从 1 开始
+  void sessionReconnecting(int sessionId, int attempt);
+  void sessionError(int sessionId, const QString &error);
+  void remoteAppStarted(int sessionId);
+  void remoteAppError(int sessionId, const QString &error);
+  // launchId 为 -1 表示结果无法对应到启动请求；result 为 RdpEvent::RailResult，
+  // 调用 ServerStartProgram 失败时为 RailUnknown；latencyMs 为发出到结果的耗时
+  void remoteAppResult(int sessionId, int launchId, int result,
+                       const QString &description, double latencyMs);
+  // 会话的控件、窗口与子对象已被回收；reason 为 idle_timeout 或
+  // memory_budget，bytes 为释放前的内存估算
+  void sessionReaped(int sessionId, const QString &reason, qint64 bytes);
+  void importError(const QString &error);
+  void rdpDirectoryImported(int requestId, int imported);
+
+private:
+  struct Entry {
+    int id;
+    RdpSettings settings;
+    QString sourceFile; // 导入来源的 .rdp 文件
+    RdpSession *session = nullptr;
+    RdpWindow *window = nullptr;
+    State state = Idle;
+    QString lastError;
+    quint64 lastUsed = 0;
+    int reapId = 0; // RdpSessionReaper 中的 ID
+  };
+
+  int addSession(const RdpSettings &settings, const QString &sourceFile);
+  // 登记已读取的 .rdp 文件，error 非空或缺少服务器地址时发出 importError
+  int addImported(const QString &localPath, const RdpFile &file,
+                  QString error);
+  Entry *entry(int sessionId) const;
+  int rowOf(int sessionId) const;
+  RdpSession *ensureSession(Entry *e);
+  void destroySession(Entry *e);
+  bool ensureCapacity(Entry *requester);
+  void setState(Entry *e, State state, const QString &error = QString());
+  void showWindow(Entry *e, QWidget *widget);
+  void updateLiveCount();
+  void touch(Entry *e);
+  RdpMemoryUsage memoryUsage(const Entry *e) const;
+  // 按会话状态更新回收器中的状态
+  void updateReapState(Entry *e);
+  void reapSession(int sessionId, RdpSessionReaper::Reason reason);
+
+  QList<Entry *> m_entries;
+  QHash<int, Entry *> m_byId;
+  RdpControlFactory m_controlFactory;
+  std::function<void(RdpSession *)> m_sessionSetup;
+  RdpSessionCache m_sessionCache;
+  RdpSessionReaper *m_reaper; // 子对象
+  int m_nextId;
+  int m_nextRequestId;
+  int m_maxLiveControls;
+  int m_liveControls;
+  quint64 m_useCounter;
+};
+
+#endif // SESSIONMANAGER_H
@@ -1,26 +1,309 @@
+#include "ProfileListModel.h"
+#include "ProfileStore.h"
+#include "RdcLauncher.h"
+#include "RdcLoadTest.h"
+#include "RdcLog.h"
+#include "RdcSelfTest.h"
+#include "RdcStartupProfiler.h"
+#include "RdpFile.h"
+#include "RdpBitmapCache.h"
 #include "RdpClient.h"
+#include "RdpControlPool.h"
+#include "RdpEventRouter.h"
+#include "RdpMetricsModel.h"
+#include "RdpMetricsServer.h"
+#include "RdpPreflight.h"
+#include "RdpPropertyPlan.h"
+#include "RdpSession.h"
+#include "RdpWarmup.h"
+#include "SessionManager.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickStyle>
+#include <QQuickWindow>
+#include <QStandardPaths>
+#include <QTextStream>
 
 int main(int argc, char *argv[]) {
+  RdcStartupProfiler::start();
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
   QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
 
   QApplication app(argc, argv);
+  RdcStartupProfiler *profiler = RdcStartupProfiler::instance();
+  profiler->mark(RdcStartupProfiler::AppConstructed);
+
+  // 连接路径上的日志由后台线程写入文件，RDC_LOG_FILE 可指定路径
+  QString logFile = qEnvironmentVariable("RDC_LOG_FILE");
+  if (logFile.isEmpty()) {
+    logFile = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+              QStringLiteral("/rdc.log");
+  }
+  RdcLog::start(logFile);
+
+  // 命令行给出连接目标时跳过 QML 界面，直接打开会话
+  QCommandLineParser parser;
+  parser.setApplicationDescription(QString::fromUtf8("RDC 远程桌面客户端"));
+  parser.addHelpOption();
+  RdcLauncher::addOptions(parser);
+  parser.addOptions({
+      {QStringLiteral("startup-profile"),
+       QString::fromUtf8("退出时把启动时间点追加到文件（JSON 行）"),
+       QStringLiteral("file")},
+      {QStringLiteral("startup-exit"),
+       QString::fromUtf8("界面可交互后立即退出")},
+      {QStringLiteral("eager-dialogs"),
+       QString::fromUtf8("启动时创建全部对话框（启动基准的对照）")},
+      {QStringLiteral("startup-benchmark"),
+       QString::fromUtf8("重复启动 runs 次，输出启动耗时的中位数与分位数"),
+       QStringLiteral("runs")},
+      {QStringLiteral("event-benchmark"),
+       QString::fromUtf8("用模拟事件源测量不同会话数下的控件事件分发吞吐量"),
+       QStringLiteral("events")},
+      {QStringLiteral("property-benchmark"),
+       QString::fromUtf8("用模拟控件比较按名称与按 DISPID 下发连接属性的耗时"),
+       QStringLiteral("iterations")},
+      {QStringLiteral("connect-benchmark"),
+       QString::fromUtf8("用脚本化的模拟控件测量连接与应用启动延迟"),
+       QStringLiteral("runs")},
+      {QStringLiteral("rdp-file-benchmark"),
+       QString::fromUtf8("用合成的 .rdp 文件测量解析、加载与目录索引的吞吐量"),
+       QStringLiteral("files")},
+      {QStringLiteral("settings-benchmark"),
+       QString::fromUtf8("比较逐个写入属性与 applySettings 的耗时、变化通知数"
+                         "与分配次数"),
+       QStringLiteral("iterations")},
+      {QStringLiteral("profile-search-benchmark"),
+       QString::fromUtf8("加载合成的连接档案，测量逐字输入时每次按键的搜索耗时"),
+       QStringLiteral("profiles")},
+      {QStringLiteral("log-benchmark"),
+       QString::fromUtf8("比较 qDebug 与结构化日志在调用线程上每条记录的耗时"),
+       QStringLiteral("records")},
+      {QStringLiteral("preflight-test"),
+       QString::fromUtf8("对本机回环上的 RDP 监听器替身检查连接预检")},
+  });
+  RdcLoadTest::addOptions(parser);
+  RdcSelfTest::addOptions(parser);
+  parser.process(app);
+
+  // 合成负载测试，只使用模拟控件，不创建界面
+  RdcLoadTestOptions loadOptions;
+  if (RdcLoadTest::readOptions(parser, &loadOptions)) {
+    RdcLoadTest loadTest(loadOptions);
+    QObject::connect(
+        &loadTest, &RdcLoadTest::finished, &app,
+        [](int code) { QCoreApplication::exit(code); }, Qt::QueuedConnection);
+    loadTest.start();
+    const int exitCode = app.exec();
+    RdcLog::stop();
+    return exitCode;
+  }
+  // 场景测试，同样只使用模拟控件
+  QStringList selfTestSuites;
+  if (RdcSelfTest::readOptions(parser, &selfTestSuites)) {
+    QTextStream out(stdout);
+    const int failures = RdcSelfTest::run(selfTestSuites, out);
+    RdcLog::stop();
+    return failures > 0 ? 1 : 0;
+  }
+  if (parser.isSet(QStringLiteral("session-stress"))) {
+    const int sessions =
+        qMax(1, parser.value(QStringLiteral("session-stress")).toInt());
+    QTextStream out(stdout);
+    const int exitCode = RdcLoadTest::runSessionStress(sessions, out);
+    RdcLog::stop();
+    return exitCode;
+  }
+
+  // 启动分析，RDC_STARTUP_PROFILE 可指定默认的输出文件
+  QString profileFile = parser.value(QStringLiteral("startup-profile"));
+  if (profileFile.isEmpty()) {
+    profileFile = qEnvironmentVariable("RDC_STARTUP_PROFILE");
+  }
+  profiler->setOutputFile(profileFile);
+  profiler->setQuitWhenInteractive(parser.isSet(QStringLiteral("startup-exit")));
+  if (parser.isSet(QStringLiteral("startup-benchmark"))) {
+    const int runs =
+        qMax(1, parser.value(QStringLiteral("startup-benchmark")).toInt());
+    // 命令行给出连接目标时测量快速启动路径：目标与选项原样传给子进程，
+    // 子进程连接完成后退出（加 --fake 可在没有服务器的环境中运行）
+    QStringList childArguments;
+    RdcLaunchOptions benchmarkLaunch;
+    QString benchmarkError;
+    if (RdcLauncher::readOptions(parser, &benchmarkLaunch, &benchmarkError) &&
+        benchmarkLaunch.isLaunch()) {
+      const QStringList arguments = QCoreApplication::arguments().mid(1);
+      for (int i = 0; i < arguments.size(); ++i) {
+        if (arguments.at(i) == QLatin1String("--startup-benchmark")) {
+          ++i; // 跳过次数
+        } else if (!arguments.at(i).startsWith(
+                       QLatin1String("--startup-benchmark="))) {
+          childArguments << arguments.at(i);
+        }
+      }
+      childArguments << QStringLiteral("--quit");
+    }
+    QTextStream out(stdout);
+    const QString program = QCoreApplication::applicationFilePath();
+    int completed = 0;
+    if (!childArguments.isEmpty()) {
+      completed =
+          RdcStartupProfiler::runBenchmark(program, childArguments, runs, out);
+    } else {
+      // 界面路径与启动时创建全部对话框的对照，差值即按需创建节省的时间
+      out << "lazy dialogs:\n";
+      completed =
+          RdcStartupProfiler::runBenchmark(program, QStringList(), runs, out);
+      out << "eager dialogs (--eager-dialogs):\n";
+      out.flush();
+      completed += RdcStartupProfiler::runBenchmark(
+          program, QStringList() << QStringLiteral("--eager-dialogs"), runs,
+          out);
+    }
+    RdcLog::stop();
+    return completed > 0 ? 0 : 1;
+  }
+  if (parser.isSet(QStringLiteral("event-benchmark"))) {
+    const int events =
+        qMax(1, parser.value(QStringLiteral("event-benchmark")).toInt());
+    QTextStream out(stdout);
+    RdpEventRouter::runBenchmark(events, out);
+    RdcLog::stop();
+    return 0;
+  }
+  if (parser.isSet(QStringLiteral("property-benchmark"))) {
+    const int iterations =
+        qMax(1, parser.value(QStringLiteral("property-benchmark")).toInt());
+    QTextStream out(stdout);
+    RdpPropertyPlan::runBenchmark(iterations, out);
+    RdcLog::stop();
+    return 0;
+  }
+  if (parser.isSet(QStringLiteral("connect-benchmark"))) {
+    const int runs =
+        qMax(1, parser.value(QStringLiteral("connect-benchmark")).toInt());
+    QTextStream out(stdout);
+    RdpSession::runBenchmark(runs, out);
+    RdcLog::stop();
+    return 0;
+  }
+  if (parser.isSet(QStringLiteral("rdp-file-benchmark"))) {
+    const int files =
+        qMax(1, parser.value(QStringLiteral("rdp-file-benchmark")).toInt());
+    QTextStream out(stdout);
+    const int failures = RdpFile::runBenchmark(files, out);
+    RdcLog::stop();
+    return failures > 0 ? 1 : 0;
+  }
+  if (parser.isSet(QStringLiteral("settings-benchmark"))) {
+    const int iterations =
+        qMax(1, parser.value(QStringLiteral("settings-benchmark")).toInt());
+    QTextStream out(stdout);
+    RdpClient::runBenchmark(iterations, out);
+    RdcLog::stop();
+    return 0;
+  }
+  if (parser.isSet(QStringLiteral("profile-search-benchmark"))) {
+    const int profiles = qMax(
+        1, parser.value(QStringLiteral("profile-search-benchmark")).toInt());
+    QTextStream out(stdout);
+    const int failures = ProfileStore::runSearchBenchmark(profiles, out);
+    RdcLog::stop();
+    return failures > 0 ? 1 : 0;
+  }
+  if (parser.isSet(QStringLiteral("log-benchmark"))) {
+    const int records =
+        qMax(1, parser.value(QStringLiteral("log-benchmark")).toInt());
+    QTextStream out(stdout);
+    RdcLog::runBenchmark(records, out);
+    return 0;
+  }
+  if (parser.isSet(QStringLiteral("preflight-test"))) {
+    QTextStream out(stdout);
+    const int failures = RdpPreflight::runSelfTest(out);
+    RdcLog::stop();
+    return failures > 0 ? 1 : 0;
+  }
+
+  // 启动时在工作线程中按配额清理持久化位图缓存，不阻塞界面与连接
+  RdpBitmapCache::instance()->evictInBackground();
+
+  // 记录连接历史；图形界面启动后按历史预热可能的下一个连接
+  RdpWarmup warmup;
+
+  RdcLaunchOptions launchOptions;
+  QString launchError;
+  if (!RdcLauncher::readOptions(parser, &launchOptions, &launchError)) {
+    RDC_LOG_WARNING(RdcLog::General, 0, "%1", launchError);
+    RdcLog::stop();
+    return 2;
+  }
+  if (launchOptions.isLaunch()) {
+    RdcLauncher launcher(launchOptions);
+    // 失败可能在进入事件循环前就已发生，排队到 exec() 中再退出
+    QObject::connect(
+        &launcher, &RdcLauncher::finished, &app,
+        [](int code) { QCoreApplication::exit(code); }, Qt::QueuedConnection);
+    launcher.start();
+    const int exitCode = app.exec();
+    RdcLog::stop();
+    return exitCode;
+  }
 
   // 设置 Qt Quick Controls 样式
   QQuickStyle::setStyle("Fusion");
 
   // 注册 RdpClient 类型到 QML
   qmlRegisterType<RdpClient>("RDC", 1, 0, "RdpClient");
+  qmlRegisterType<SessionManager>("RDC", 1, 0, "SessionManager");
+  qmlRegisterType<ProfileListModel>("RDC", 1, 0, "ProfileModel");
+  qmlRegisterUncreatableType<RdpLinkTuner>("RDC", 1, 0, "RdpLinkTuner",
+                                           "RdpLinkTuner 由会话创建");
+  qmlRegisterType<RdpMetricsModel>("RDC", 1, 0, "RdpMetricsModel");
+  profiler->mark(RdcStartupProfiler::TypesRegistered);
+
+  // 本机的 Prometheus 抓取端点，RDC_METRICS_PORT=0 时关闭
+  RdpMetricsServer metricsServer;
+  bool portOk = false;
+  int metricsPort = qEnvironmentVariableIntValue("RDC_METRICS_PORT", &portOk);
+  if (!portOk) {
+    metricsPort = 9469;
+  }
+  if (metricsPort > 0) {
+    metricsServer.listen(quint16(metricsPort));
+  }
+
+  // RDP 控件池先于 QML 引擎创建、后于引擎销毁：QML 拥有的会话析构时
+  // 仍会把控件归还到池中。控件在 QML 加载完成后才开始预热
+  RdpControlPool controlPool(&RdpControl::createDefault);
+  bool ok = false;
+  int poolSize = qEnvironmentVariableIntValue("RDC_CONTROL_POOL_SIZE", &ok);
+  if (ok) {
+    controlPool.setSize(poolSize);
+  }
 
   QQmlApplicationEngine engine;
+  engine.rootContext()->setContextProperty(
+      QStringLiteral("eagerDialogs"),
+      parser.isSet(QStringLiteral("eager-dialogs")));
   engine.load(QUrl(QStringLiteral("qrc:/qt/qml/rdc/main.qml")));
-  if (engine.rootObjects().isEmpty())
+  if (engine.rootObjects().isEmpty()) {
+    RdcLog::stop();
     return -1;
+  }
+  profiler->mark(RdcStartupProfiler::EngineLoaded);
+  profiler->watchWindow(
+      qobject_cast<QQuickWindow *>(engine.rootObjects().first()));
+
+  // QML 加载完成后在后台预热 RDP 控件
+  controlPool.warmUp();
+  warmup.warmUp();
 
-  return app.exec();
+  const int exitCode = app.exec();
+  RdcLog::stop();
+  return exitCode;
 }
@@ -2,6 +2,7 @@ import QtQuick 2.15
 import QtQuick.Window 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
+import QtQuick.Dialogs 1.3 as Dialogs
 import RDC 1.0
 
 Window {
@@ -11,124 +12,303 @@ Window {
     height: 600
     title: "RDC - 远程桌面客户端"
 
-    // RDP 客户端
-    RdpClient {
-        id: rdpClient
-        
-        onConnectionSuccess: {
-            if (remoteAppMode) {
-                statusText.text = "已连接到: " + server + "，等待启动应用..."
+    // 会话管理器：每次连接都是一个独立会话
+    SessionManager {
+        id: sessionManager
+
+        onSessionConnected: {
+            var settings = sessionManager.sessionSettings(sessionId)
+            if (settings.remoteAppMode) {
+                statusText.text = "已连接到: " + settings.server + "，等待启动应用..."
             } else {
-                statusText.text = "已连接到: " + server
+                statusText.text = "已连接到: " + settings.server
             }
             statusText.color = "green"
         }
-        
-        onConnectionError: {
+
+        onSessionReconnecting: {
+            statusText.text = "连接中断，正在自动重连 (第 " + attempt + " 次): "
+                    + sessionManager.sessionSettings(sessionId).server
+            statusText.color = "orange"
+        }
+
+        onSessionDisconnected: {
+            statusText.text = "未连接"
+            statusText.color = "#666666"
+        }
+
+        onSessionError: {
             statusText.text = "连接错误: " + error
             statusText.color = "red"
-            errorDialog.text = error
-            errorDialog.open()
+            showError(error)
         }
-        
-        onConnectedChanged: {
-            if (!connected) {
-                statusText.text = "未连接"
-                statusText.color = "#666666"
-            }
-        }
-        
+
         onRemoteAppStarted: {
-            statusText.text = "RemoteApp 已启动: " + executablePath
+            statusText.text = "RemoteApp 已启动: " + sessionManager.sessionSettings(sessionId).executablePath
             statusText.color = "green"
         }
-        
+
         onRemoteAppError: {
             statusText.text = "RemoteApp 错误: " + error
             statusText.color = "red"
-            errorDialog.text = "RemoteApp 错误: " + error
+            showError("RemoteApp 错误: " + error)
+        }
+
+        onRemoteAppResult: {
+            if (result !== 0) {
+                statusText.text = "RemoteApp 启动失败: " + description
+                statusText.color = "red"
+            } else {
+                statusText.text = "RemoteApp 已启动 (" + latencyMs.toFixed(0) + " ms)"
+                statusText.color = "green"
+            }
+        }
+
+        onSessionReaped: {
+            statusText.text = (reason === "memory_budget" ? "内存超出上限，已释放会话: "
+                                                          : "会话空闲超时，已释放: ")
+                    + sessionManager.sessionSettings(sessionId).server
+                    + " (" + (bytes / 1048576).toFixed(1) + " MB)"
+            statusText.color = "#666666"
+        }
+
+        onImportError: {
+            showError(error)
+        }
+    }
+
+    // 对话框按需创建：首次打开时才编译、实例化，启动时只加载主界面
+    property var connectionDialog: null
+    property var remoteAppDialog: null
+    property var rdpFileDialog: null
+    property var metricsDialog: null
+    property var errorDialog: null
+
+    // source 为 QML 文件地址或 Component，失败时返回 null
+    function createDialog(source) {
+        var component = typeof source === "string" ? Qt.createComponent(source) : source
+        if (component.status !== Component.Ready) {
+            console.warn("无法创建对话框: " + component.errorString())
+            return null
+        }
+        return component.createObject(mainWindow.contentItem)
+    }
+
+    // 基准测试对照（--eager-dialogs）：启动时就创建全部对话框
+    Component.onCompleted: {
+        if (eagerDialogs) {
+            ensureErrorDialog()
+            ensureConnectionDialog()
+            ensureRemoteAppDialog()
+            ensureRdpFileDialog()
+            ensureMetricsDialog()
+        }
+    }
+
+    function ensureErrorDialog() {
+        if (!errorDialog) {
+            errorDialog = createDialog(errorDialogComponent)
+        }
+        return errorDialog
+    }
+
+    function showError(text) {
+        if (ensureErrorDialog()) {
+            errorDialog.text = text
             errorDialog.open()
         }
     }
 
-    // 连接配置对话框
-    ConnectionDialog {
-        id: connectionDialog
-        onAccepted: {
-            console.log("连接配置: IP=" + ip + ", 端口=" + port + ", 用户名=" + username)
-            console.log("分辨率=" + desktopWidth + "x" + desktopHeight + ", 色彩深度=" + colorDepth)
-            console.log("全屏=" + fullScreen + ", 音频=" + enableSound + ", 剪贴板=" + enableClipboard)
-            
-            // 重要：禁用 RemoteApp 模式（桌面模式）
-            rdpClient.remoteAppMode = false
-            
-            // 配置 RDP 客户端 - 基本设置
-            rdpClient.server = ip
-            rdpClient.port = port
-            rdpClient.username = username
-            
-            // 配置 RDP 客户端 - 显示设置
-            rdpClient.desktopWidth = desktopWidth
-            rdpClient.desktopHeight = desktopHeight
-            rdpClient.colorDepth = colorDepth
-            rdpClient.fullScreen = fullScreen
-            
-            // 配置 RDP 客户端 - 本地资源
-            rdpClient.enableSound = enableSound
-            rdpClient.enableClipboard = enableClipboard
-            rdpClient.enablePrinter = enablePrinter
-            
-            // 发起连接
-            if (rdpClient.connectToServer()) {
-                statusText.text = "正在连接到 " + ip + "..."
-                statusText.color = "blue"
+    function ensureConnectionDialog() {
+        if (!connectionDialog) {
+            connectionDialog = createDialog(Qt.resolvedUrl("ConnectionDialog.qml"))
+            if (connectionDialog)
+                connectionDialog.accepted.connect(startDesktopSession)
+        }
+        return connectionDialog
+    }
+
+    function openConnectionDialog() {
+        if (!ensureConnectionDialog())
+            return
+        // 用户填写期间预检最可能连接的主机
+        sessionManager.warmUpPredicted()
+        connectionDialog.open()
+    }
+
+    function startDesktopSession() {
+        var d = connectionDialog
+        console.log("连接配置: IP=" + d.ip + ", 端口=" + d.port + ", 用户名=" + d.username)
+        console.log("分辨率=" + d.desktopWidth + "x" + d.desktopHeight + ", 色彩深度=" + d.colorDepth)
+        console.log("全屏=" + d.fullScreen + ", 音频=" + d.enableSound + ", 剪贴板=" + d.enableClipboard)
+
+        // 桌面模式（禁用 RemoteApp）
+        sessionManager.openSession({
+            "remoteAppMode": false,
+            "server": d.ip,
+            "port": d.port,
+            "username": d.username,
+            "desktopWidth": d.desktopWidth,
+            "desktopHeight": d.desktopHeight,
+            "colorDepth": d.colorDepth,
+            "fullScreen": d.fullScreen,
+            "dynamicResolution": d.dynamicResolution,
+            "enableSound": d.enableSound,
+            "enableClipboard": d.enableClipboard,
+            "enablePrinter": d.enablePrinter
+        })
+        statusText.text = "正在连接到 " + d.ip + "..."
+        statusText.color = "blue"
+    }
+
+    function ensureRemoteAppDialog() {
+        if (!remoteAppDialog) {
+            remoteAppDialog = createDialog(Qt.resolvedUrl("RemoteAppDialog.qml"))
+            if (remoteAppDialog)
+                remoteAppDialog.accepted.connect(startRemoteAppSession)
+        }
+        return remoteAppDialog
+    }
+
+    function openRemoteAppDialog() {
+        if (!ensureRemoteAppDialog())
+            return
+        sessionManager.warmUpPredicted()
+        remoteAppDialog.open()
+    }
+
+    function startRemoteAppSession() {
+        var d = remoteAppDialog
+        console.log("RemoteApp配置: IP=" + d.ip + ", 端口=" + d.port + ", 用户名=" + d.username)
+        console.log("可执行文件=" + d.executablePath)
+        console.log("文件路径=" + d.filePath)
+        console.log("工作目录=" + d.workingDirectory + ", 展开环境变量=" + d.expandEnvVarInWorkingDirectory)
+        console.log("参数=" + d.appArguments + ", 展开环境变量=" + d.expandEnvVarInArguments)
+
+        // 已连接到同一服务器的 RemoteApp 会话直接复用，不再重新登录
+        sessionManager.openRemoteApp({
+            "server": d.ip,
+            "port": d.port,
+            "username": d.username,
+            "remoteAppMode": true,
+            "executablePath": d.executablePath,
+            "filePath": d.filePath,
+            "workingDirectory": d.workingDirectory,
+            "expandEnvVarInWorkingDirectory": d.expandEnvVarInWorkingDirectory,
+            "arguments": d.appArguments,
+            "expandEnvVarInArguments": d.expandEnvVarInArguments
+        })
+        statusText.text = "正在连接到 " + d.ip + " 并启动应用..."
+        statusText.color = "blue"
+    }
+
+    function ensureRdpFileDialog() {
+        if (!rdpFileDialog) {
+            rdpFileDialog = createDialog(rdpFileDialogComponent)
+        }
+        return rdpFileDialog
+    }
+
+    function openRdpFileDialog() {
+        if (ensureRdpFileDialog()) {
+            rdpFileDialog.open()
+        }
+    }
+
+    function ensureMetricsDialog() {
+        if (!metricsDialog) {
+            metricsDialog = createDialog(metricsDialogComponent)
+        }
+        return metricsDialog
+    }
+
+    function openMetricsDialog() {
+        if (ensureMetricsDialog()) {
+            metricsDialog.open()
+        }
+    }
+
+    // .rdp 文件选择
+    Component {
+        id: rdpFileDialogComponent
+
+        Dialogs.FileDialog {
+            title: "打开 .rdp 文件"
+            nameFilters: ["远程桌面连接 (*.rdp)", "所有文件 (*)"]
+            onAccepted: {
+                var sessionId = sessionManager.importRdpFile(fileUrl)
+                if (sessionId >= 0) {
+                    sessionManager.showSession(sessionId)
+                }
             }
         }
     }
-    
-    // RemoteApp 配置对话框
-    RemoteAppDialog {
-        id: remoteAppDialog
-        onAccepted: {
-            console.log("RemoteApp配置: IP=" + ip + ", 端口=" + port + ", 用户名=" + username)
-            console.log("可执行文件=" + executablePath)
-            console.log("文件路径=" + filePath)
-            console.log("工作目录=" + workingDirectory + ", 展开环境变量=" + expandEnvVarInWorkingDirectory)
-            console.log("参数=" + appArguments + ", 展开环境变量=" + expandEnvVarInArguments)
-            
-            // 配置 RDP 客户端 - 基本设置
-            rdpClient.server = ip
-            rdpClient.port = port
-            rdpClient.username = username
-            
-            // 配置 RemoteApp 模式
-            rdpClient.remoteAppMode = true
-            rdpClient.executablePath = executablePath
-            rdpClient.filePath = filePath
-            rdpClient.workingDirectory = workingDirectory
-            rdpClient.expandEnvVarInWorkingDirectory = expandEnvVarInWorkingDirectory
-            rdpClient.arguments = appArguments
-            rdpClient.expandEnvVarInArguments = expandEnvVarInArguments
-            
-            // 发起连接
-            if (rdpClient.connectToServer()) {
-                statusText.text = "正在连接到 " + ip + " 并启动应用..."
-                statusText.color = "blue"
+
+    // 连接各阶段耗时统计
+    Component {
+        id: metricsDialogComponent
+
+        Dialog {
+            title: "连接耗时统计"
+            modal: true
+            standardButtons: Dialog.Close | Dialog.Reset
+            anchors.centerIn: parent
+            width: 640
+            height: 420
+
+            onReset: metricsModel.clear()
+
+            RdpMetricsModel {
+                id: metricsModel
+            }
+
+            ColumnLayout {
+                anchors.fill: parent
+
+                Label {
+                    text: metricsModel.count > 0 ? "单位：毫秒" : "暂无连接记录"
+                    color: "#666666"
+                }
+
+                ListView {
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                    clip: true
+                    model: metricsModel
+                    section.property: "host"
+                    section.delegate: Label {
+                        text: section
+                        font.bold: true
+                        topPadding: 6
+                    }
+                    delegate: Label {
+                        width: ListView.view.width
+                        text: phase + "  n=" + sampleCount
+                              + "  p50=" + p50.toFixed(1)
+                              + "  p90=" + p90.toFixed(1)
+                              + "  p99=" + p99.toFixed(1)
+                              + "  max=" + max.toFixed(1)
+                              + (phase === "total" ? "  成功=" + successCount + "  失败=" + failureCount : "")
+                    }
+                }
             }
         }
     }
-    
+
     // 错误对话框
-    Dialog {
-        id: errorDialog
-        title: "连接错误"
-        modal: true
-        standardButtons: Dialog.Ok
-        property alias text: errorText.text
-        
-        Text {
-            id: errorText
-            wrapMode: Text.WordWrap
+    Component {
+        id: errorDialogComponent
+
+        Dialog {
+            title: "连接错误"
+            modal: true
+            standardButtons: Dialog.Ok
+            property alias text: errorText.text
+
+            Text {
+                id: errorText
+                wrapMode: Text.WordWrap
+            }
         }
     }
 
@@ -147,14 +327,21 @@ Window {
                 MenuItem {
                     text: "启动(&S)"
                     onTriggered: {
-                        connectionDialog.open()
+                        openConnectionDialog()
                     }
                 }
                 
                 MenuItem {
                     text: "启动应用(&A)"
                     onTriggered: {
-                        remoteAppDialog.open()
+                        openRemoteAppDialog()
+                    }
+                }
+                
+                MenuItem {
+                    text: "打开 .rdp 文件(&O)..."
+                    onTriggered: {
+                        openRdpFileDialog()
                     }
                 }
                 
@@ -168,6 +355,17 @@ Window {
                 }
             }
             
+            Menu {
+                title: "查看(&V)"
+
+                MenuItem {
+                    text: "连接耗时统计(&M)"
+                    onTriggered: {
+                        openMetricsDialog()
+                    }
+                }
+            }
+
             Menu {
                 title: "帮助(&H)"
                 
@@ -206,5 +404,60 @@ Window {
                 }
             }
         }
+
+        // 会话列表
+        ListView {
+            id: sessionList
+            Layout.fillWidth: true
+            Layout.preferredHeight: Math.min(contentHeight, 240)
+            visible: count > 0
+            clip: true
+            model: sessionManager
+
+            delegate: RowLayout {
+                width: sessionList.width
+                spacing: 10
+
+                Label {
+                    Layout.fillWidth: true
+                    Layout.leftMargin: 10
+                    elide: Text.ElideRight
+                    text: model.username + "@" + model.server + ":" + model.port
+                          + (model.remoteAppMode ? "  [" + model.executablePath + "]" : "")
+                }
+
+                Label {
+                    visible: model.live
+                    color: "#666666"
+                    text: (model.memoryBytes / 1048576).toFixed(1) + " MB"
+                }
+
+                Label {
+                    text: ["空闲", "连接中", "已连接", "已断开", "失败", "重连中"][model.state]
+                    color: model.state === SessionManager.Connected ? "green"
+                         : model.state === SessionManager.Failed ? "red"
+                         : model.state === SessionManager.Reconnecting ? "orange" : "#666666"
+                }
+
+                Button {
+                    text: "显示"
+                    onClicked: sessionManager.showSession(model.sessionId)
+                }
+
+                Button {
+                    text: "断开"
+                    enabled: model.state === SessionManager.Connecting
+                             || model.state === SessionManager.Connected
+                             || model.state === SessionManager.Reconnecting
+                    onClicked: sessionManager.disconnectSession(model.sessionId)
+                }
+
+                Button {
+                    Layout.rightMargin: 10
+                    text: "关闭"
+                    onClicked: sessionManager.removeSession(model.sessionId)
+                }
+            }
+        }
     }
 }